@@ -41,6 +41,7 @@
  *
  * vgsm.usecnt_lock
  * vgsm.operators_list_lock
+ * vgsm.hg_heap_lock
  * timers_lock
  *
  * vgsm_me callbacks are invoked without locks, it is their
@@ -415,6 +416,11 @@ static int vgsm_state_from_var(
 	} else if (!strcasecmp(var->name, "sms_spooler_pars")) {
 		strncpy(state->sms_spooler_pars, var->value,
 			sizeof(state->sms_spooler_pars));
+	} else if (!strcasecmp(var->name, "max_parallel_init")) {
+		state->max_parallel_init = atoi(var->value);
+	} else if (!strcasecmp(var->name, "sim_cache_dir")) {
+		strncpy(state->sim_cache_dir, var->value,
+			sizeof(state->sim_cache_dir));
 	} else {
 		return -1;
 	}
@@ -1092,6 +1098,8 @@ static int vgsm_call(
 	me->vgsm_chan = vgsm_chan_get(vgsm_chan);
 	me->call_present = FALSE;
 
+	vgsm_hg_me_call_started(me);
+
 	ast_dsp_digitmode(vgsm_chan->dsp,
 		DSP_DIGITMODE_DTMF |
 		(vgsm_chan->mc->dtmf_quelch ? 0 : DSP_DIGITMODE_NOQUELCH) |
@@ -1151,6 +1159,7 @@ err_atd_failed:
 	ast_mutex_lock(&me->lock);
 	vgsm_chan_put(me->vgsm_chan);
 	me->vgsm_chan = NULL;
+	vgsm_hg_me_call_ended(me);
 	ast_mutex_unlock(&me->lock);
 err_me_busy:
 err_me_not_registered:
@@ -1463,6 +1472,8 @@ static int vgsm_hangup(struct ast_channel *ast_chan)
 			/* Detach ME and channel */
 			vgsm_chan_put(vgsm_chan->me->vgsm_chan);
 			vgsm_chan->me->vgsm_chan = NULL;
+
+			vgsm_hg_me_call_ended(vgsm_chan->me);
 		}
 
 		ast_mutex_unlock(&vgsm_chan->me->lock);
@@ -2655,12 +2666,19 @@ static int vgsm_load_module(void)
 
 	ast_rwlock_init(&vgsm.huntgroups_list_lock);
 	INIT_LIST_HEAD(&vgsm.huntgroups_list);
+	ast_mutex_init(&vgsm.hg_heap_lock);
+
+	ast_mutex_init(&vgsm.sim_caches_list_lock);
+	INIT_LIST_HEAD(&vgsm.sim_caches_list);
+
+	ast_mutex_init(&vgsm.init_slots_lock);
 
 	vgsm.default_mc = vgsm_me_config_alloc();
 	vgsm_me_config_default(vgsm.default_mc);
 
 	strcpy(vgsm.sms_spooler, "/usr/sbin/sendmail");
 	strcpy(vgsm.sms_spooler_pars, "-it");
+	strcpy(vgsm.sim_cache_dir, "/var/lib/asterisk/vgsm");
 
 	vgsm_reload_config();
 
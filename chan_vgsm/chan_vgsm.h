@@ -87,8 +87,16 @@ struct vgsm_state
 
 	ast_rwlock_t huntgroups_list_lock;
 	struct list_head huntgroups_list;
+	ast_mutex_t hg_heap_lock;
 //	struct list_head sim_holders_list;
 
+	ast_mutex_t sim_caches_list_lock;
+	struct list_head sim_caches_list;
+
+	ast_mutex_t init_slots_lock;
+	int init_slots_used;
+	int max_parallel_init;
+
 	ast_rwlock_t operators_lock;
 	struct list_head op_countries_list;
 	struct list_head op_list;
@@ -100,6 +108,8 @@ struct vgsm_state
 
 	char sms_spooler[PATH_MAX];
 	char sms_spooler_pars[512];
+
+	char sim_cache_dir[PATH_MAX];
 };
 
 struct vgsm_chan *vgsm_chan_get(struct vgsm_chan *vgsm_chan);
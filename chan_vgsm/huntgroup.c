@@ -48,6 +48,34 @@
 	do {} while(0);
 #endif
 
+static void vgsm_hg_heap_remove(
+	struct vgsm_huntgroup *hg,
+	struct vgsm_huntgroup_member *hgm);
+
+static void vgsm_hg_clear_members(
+	struct vgsm_huntgroup *hg)
+{
+	struct vgsm_huntgroup_member *hgm, *tpos;
+	list_for_each_entry_safe(hgm, tpos, &hg->members, node) {
+
+		if (hgm->linked) {
+			ast_mutex_lock(&vgsm.hg_heap_lock);
+			if (hgm->heap_index >= 0)
+				vgsm_hg_heap_remove(hg, hgm);
+
+			list_del(&hgm->me_node);
+			hgm->linked = FALSE;
+			ast_mutex_unlock(&vgsm.hg_heap_lock);
+		}
+
+		vgsm_me_put(hgm->me);
+		hgm->me = NULL;
+		
+		list_del(&hgm->node);
+		free(hgm);
+	}
+}
+
 static struct vgsm_huntgroup *vgsm_hg_alloc(void)
 {
 	struct vgsm_huntgroup *hg;
@@ -89,8 +117,14 @@ void vgsm_hg_put(struct vgsm_huntgroup *hg)
 	int refcnt = --hg->refcnt;
 	ast_mutex_unlock(&vgsm.usecnt_lock);
 
-	if (!refcnt)
+	if (!refcnt) {
+		vgsm_hg_clear_members(hg);
+
+		if (hg->heap)
+			free(hg->heap);
+
 		free(hg);
+	}
 }
 
 struct vgsm_huntgroup *vgsm_hg_get_by_name(const char *name)
@@ -118,6 +152,14 @@ static const char *vgsm_huntgroup_mode_to_text(
 		return "sequential";
 	case VGSM_HUNTGROUP_MODE_CYCLIC:
 		return "cyclic";
+	case VGSM_HUNTGROUP_MODE_LRU:
+		return "lru";
+	case VGSM_HUNTGROUP_MODE_LEAST_MINUTES:
+		return "least_minutes";
+	case VGSM_HUNTGROUP_MODE_BEST_SIGNAL:
+		return "best_signal";
+	case VGSM_HUNTGROUP_MODE_FEWEST_FAILURES:
+		return "fewest_failures";
 	}
 
 	return "*INVALID*";
@@ -130,6 +172,14 @@ static enum vgsm_huntgroup_mode
 		return VGSM_HUNTGROUP_MODE_SEQUENTIAL;
 	else if (!strcasecmp(str, "cyclic"))
 		return VGSM_HUNTGROUP_MODE_CYCLIC;
+	else if (!strcasecmp(str, "lru"))
+		return VGSM_HUNTGROUP_MODE_LRU;
+	else if (!strcasecmp(str, "least_minutes"))
+		return VGSM_HUNTGROUP_MODE_LEAST_MINUTES;
+	else if (!strcasecmp(str, "best_signal"))
+		return VGSM_HUNTGROUP_MODE_BEST_SIGNAL;
+	else if (!strcasecmp(str, "fewest_failures"))
+		return VGSM_HUNTGROUP_MODE_FEWEST_FAILURES;
 	else {
 		ast_log(LOG_ERROR,
 			"Unknown huntgroup mode '%s'\n",
@@ -139,19 +189,6 @@ static enum vgsm_huntgroup_mode
 	}
 }
 
-static void vgsm_hg_clear_members(
-	struct vgsm_huntgroup *hg)
-{
-	struct vgsm_huntgroup_member *hgm, *tpos;
-	list_for_each_entry_safe(hgm, tpos, &hg->members, node) {
-		vgsm_me_put(hgm->me);
-		hgm->me = NULL;
-		
-		list_del(&hgm->node);
-		free(hgm);
-	}
-}
-
 static void vgsm_hg_parse_members(
 	struct vgsm_huntgroup *hg,
 	const char *value)
@@ -182,9 +219,11 @@ static void vgsm_hg_parse_members(
 		
 		struct vgsm_huntgroup_member *hgm;
 		hgm = malloc(sizeof(*hgm));
-		memset(hgm, 0, sizeof(hgm));
+		memset(hgm, 0, sizeof(*hgm));
 
 		hgm->me = vgsm_me_get(me);
+		hgm->hg = hg;
+		hgm->heap_index = -1;
 
 		list_add_tail(&hgm->node, &hg->members);
 
@@ -195,6 +234,275 @@ static void vgsm_hg_parse_members(
 	free(str);
 }
 
+/*---------------------------------------------------------------------------*/
+
+/* Members are ordered by key, ties are broken by configuration order */
+static int vgsm_hg_member_before(
+	struct vgsm_huntgroup_member *a,
+	struct vgsm_huntgroup_member *b)
+{
+	return a->key < b->key ||
+		(a->key == b->key && a->index < b->index);
+}
+
+static void vgsm_hg_heap_set(
+	struct vgsm_huntgroup *hg,
+	int pos,
+	struct vgsm_huntgroup_member *hgm)
+{
+	hg->heap[pos] = hgm;
+	hgm->heap_index = pos;
+}
+
+static void vgsm_hg_heap_up(
+	struct vgsm_huntgroup *hg,
+	int pos)
+{
+	struct vgsm_huntgroup_member *hgm = hg->heap[pos];
+
+	while (pos > 0) {
+		int parent = (pos - 1) / 2;
+
+		if (!vgsm_hg_member_before(hgm, hg->heap[parent]))
+			break;
+
+		vgsm_hg_heap_set(hg, pos, hg->heap[parent]);
+		pos = parent;
+	}
+
+	vgsm_hg_heap_set(hg, pos, hgm);
+}
+
+static void vgsm_hg_heap_down(
+	struct vgsm_huntgroup *hg,
+	int pos)
+{
+	struct vgsm_huntgroup_member *hgm = hg->heap[pos];
+
+	for (;;) {
+		int child = pos * 2 + 1;
+
+		if (child >= hg->heap_count)
+			break;
+
+		if (child + 1 < hg->heap_count &&
+		    vgsm_hg_member_before(hg->heap[child + 1], hg->heap[child]))
+			child++;
+
+		if (!vgsm_hg_member_before(hg->heap[child], hgm))
+			break;
+
+		vgsm_hg_heap_set(hg, pos, hg->heap[child]);
+		pos = child;
+	}
+
+	vgsm_hg_heap_set(hg, pos, hgm);
+}
+
+static void vgsm_hg_heap_insert(
+	struct vgsm_huntgroup *hg,
+	struct vgsm_huntgroup_member *hgm)
+{
+	assert(hg->heap_count < hg->heap_size);
+
+	vgsm_hg_heap_set(hg, hg->heap_count++, hgm);
+	vgsm_hg_heap_up(hg, hgm->heap_index);
+}
+
+static void vgsm_hg_heap_remove(
+	struct vgsm_huntgroup *hg,
+	struct vgsm_huntgroup_member *hgm)
+{
+	int pos = hgm->heap_index;
+
+	hgm->heap_index = -1;
+
+	if (--hg->heap_count == pos)
+		return;
+
+	vgsm_hg_heap_set(hg, pos, hg->heap[hg->heap_count]);
+	vgsm_hg_heap_up(hg, pos);
+	vgsm_hg_heap_down(hg, pos);
+}
+
+/* me->lock must be held */
+static BOOL vgsm_hg_me_available(struct vgsm_me *me)
+{
+	return me->status == VGSM_ME_STATUS_READY &&
+		!me->vgsm_chan &&
+		(me->net.status == VGSM_NET_STATUS_REGISTERED_HOME ||
+		 me->net.status == VGSM_NET_STATUS_REGISTERED_ROAMING);
+}
+
+/* Failures decay with a half life of VGSM_HG_FAILURES_HALF_LIFE. Instead of
+ * decaying every counter as time passes, each ME keeps log2 of its failure
+ * count scaled to a common time origin, in 1/256 units:
+ *
+ *   key = log2(sum(2 ^ (t_i / half_life)))
+ *
+ * Since all the counters decay at the same rate their order never changes
+ * by itself, so the heap only needs updating when a failure is recorded.
+ */
+#define VGSM_HG_FAILURES_HALF_LIFE (10 * 60)
+
+static long long vgsm_hg_log2_add(long long a, long long b)
+{
+	/* 256 * log2(1 + 2^-k) */
+	static const int table[] = { 256, 150, 82, 44, 22, 11, 6, 3, 1, 1, 0 };
+
+	long long hi = a > b ? a : b;
+	long long diff = a > b ? a - b : b - a;
+	unsigned long long k = diff / 256;
+
+	if (k >= ARRAY_SIZE(table) - 1)
+		return hi;
+
+	return hi + table[k] -
+		(table[k] - table[k + 1]) * (diff % 256) / 256;
+}
+
+/* me->lock must be held */
+static long long vgsm_hg_member_key(
+	enum vgsm_huntgroup_mode mode,
+	struct vgsm_me *me)
+{
+	int rssi = me->net.sci2.rssi;
+	int ber = me->net.sci2.ber;
+
+	switch(mode) {
+	case VGSM_HUNTGROUP_MODE_LRU:
+		return me->hunt.last_used;
+
+	case VGSM_HUNTGROUP_MODE_LEAST_MINUTES:
+		return me->hunt.call_time;
+
+	case VGSM_HUNTGROUP_MODE_BEST_SIGNAL:
+		/* RSSI 0-31 and BER 0-7, 99 meaning unknown */
+		return ((rssi >= 0 && rssi <= 31) ? 31 - rssi : 32) * 8 +
+			((ber >= 0 && ber <= 7) ? ber : 7);
+
+	case VGSM_HUNTGROUP_MODE_FEWEST_FAILURES:
+		return me->hunt.total_failures ? me->hunt.failures : 0;
+
+	case VGSM_HUNTGROUP_MODE_SEQUENTIAL:
+	case VGSM_HUNTGROUP_MODE_CYCLIC:
+	break;
+	}
+
+	return 0;
+}
+
+/* Must be called with me->lock held whenever something that affects
+ * hunting changes: status, registration, attached channel, signal or
+ * failures.
+ */
+void vgsm_hg_me_update(struct vgsm_me *me)
+{
+	BOOL available = vgsm_hg_me_available(me);
+
+	ast_mutex_lock(&vgsm.hg_heap_lock);
+
+	struct vgsm_huntgroup_member *hgm;
+	list_for_each_entry(hgm, &me->hg_members, me_node) {
+		struct vgsm_huntgroup *hg = hgm->hg;
+
+		if (!vgsm_hg_mode_is_heap(hg->mode))
+			continue;
+
+		if (!available) {
+			if (hgm->heap_index >= 0)
+				vgsm_hg_heap_remove(hg, hgm);
+
+			continue;
+		}
+
+		long long key = vgsm_hg_member_key(hg->mode, me);
+
+		if (hgm->heap_index < 0) {
+			hgm->key = key;
+			vgsm_hg_heap_insert(hg, hgm);
+		} else if (key < hgm->key) {
+			hgm->key = key;
+			vgsm_hg_heap_up(hg, hgm->heap_index);
+		} else if (key > hgm->key) {
+			hgm->key = key;
+			vgsm_hg_heap_down(hg, hgm->heap_index);
+		}
+	}
+
+	ast_mutex_unlock(&vgsm.hg_heap_lock);
+}
+
+void vgsm_hg_me_call_started(struct vgsm_me *me)
+{
+	longtime_t now = longtime_now();
+
+	me->hunt.call_started = now;
+	me->hunt.last_used = now;
+
+	vgsm_hg_me_update(me);
+}
+
+void vgsm_hg_me_call_ended(struct vgsm_me *me)
+{
+	if (me->hunt.call_started) {
+		me->hunt.call_time += longtime_now() - me->hunt.call_started;
+		me->hunt.call_started = 0;
+	}
+
+	vgsm_hg_me_update(me);
+}
+
+void vgsm_hg_me_call_failed(struct vgsm_me *me)
+{
+	long long now = longtime_now() / SEC * 256 /
+				VGSM_HG_FAILURES_HALF_LIFE;
+
+	if (me->hunt.total_failures)
+		me->hunt.failures = vgsm_hg_log2_add(me->hunt.failures, now);
+	else
+		me->hunt.failures = now;
+
+	me->hunt.total_failures++;
+
+	vgsm_hg_me_update(me);
+}
+
+static void vgsm_hg_link_members(struct vgsm_huntgroup *hg)
+{
+	struct vgsm_huntgroup_member *hgm;
+	int nmembers = 0;
+
+	list_for_each_entry(hgm, &hg->members, node)
+		hgm->index = nmembers++;
+
+	if (vgsm_hg_mode_is_heap(hg->mode)) {
+		hg->heap = malloc(sizeof(*hg->heap) * (nmembers + 1));
+		if (!hg->heap) {
+			ast_log(LOG_ERROR,
+				"Cannot allocate huntgroup heap, falling back"
+				" to sequential mode\n");
+
+			hg->mode = VGSM_HUNTGROUP_MODE_SEQUENTIAL;
+		}
+
+		hg->heap_size = nmembers;
+	}
+
+	list_for_each_entry(hgm, &hg->members, node) {
+		ast_mutex_lock(&hgm->me->lock);
+
+		ast_mutex_lock(&vgsm.hg_heap_lock);
+		list_add_tail(&hgm->me_node, &hgm->me->hg_members);
+		hgm->linked = TRUE;
+		ast_mutex_unlock(&vgsm.hg_heap_lock);
+
+		vgsm_hg_me_update(hgm->me);
+
+		ast_mutex_unlock(&hgm->me->lock);
+	}
+}
+
 static int vgsm_hg_from_var(
 	struct vgsm_huntgroup *hg,
 	struct ast_variable *var)
@@ -234,6 +542,8 @@ static void vgsm_hg_reconfigure(
 		var = var->next;
 	}
 
+	vgsm_hg_link_members(hg);
+
 	ast_rwlock_wrlock(&vgsm.huntgroups_list_lock);
 
 	struct vgsm_huntgroup *old_hg, *tpos;
@@ -326,7 +636,44 @@ static void vgsm_hg_show_details(
 	list_for_each_entry(hgm, &hg->members, node) {
 		ast_cli(fd, "%s, ", hgm->me->name);
 	}
-	ast_cli(fd, "\n\n");
+	ast_cli(fd, "\n");
+
+	if (vgsm_hg_mode_is_heap(hg->mode)) {
+		longtime_t now = longtime_now();
+
+		ast_mutex_lock(&vgsm.hg_heap_lock);
+		ast_cli(fd, "Available: %d\n\n", hg->heap_count);
+		ast_mutex_unlock(&vgsm.hg_heap_lock);
+
+		ast_cli(fd,
+			"Member           Heap Last used Call min RSSI BER"
+			" Failures\n");
+
+		list_for_each_entry(hgm, &hg->members, node) {
+			struct vgsm_me *me = hgm->me;
+			char rank[8] = "-";
+
+			ast_mutex_lock(&me->lock);
+			ast_mutex_lock(&vgsm.hg_heap_lock);
+			if (hgm->heap_index >= 0)
+				snprintf(rank, sizeof(rank), "%d",
+					hgm->heap_index);
+			ast_mutex_unlock(&vgsm.hg_heap_lock);
+
+			ast_cli(fd, "%-16s %-4s %8llds %8lld %4d %3d %8d\n",
+				me->name,
+				rank,
+				me->hunt.last_used ?
+				 (now - me->hunt.last_used) / SEC : -1LL,
+				me->hunt.call_time / (60 * SEC),
+				me->net.sci2.rssi,
+				me->net.sci2.ber,
+				me->hunt.total_failures);
+			ast_mutex_unlock(&me->lock);
+		}
+	}
+
+	ast_cli(fd, "\n");
 }
 
 #if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
@@ -423,11 +770,70 @@ static struct vgsm_huntgroup_member *vgsm_hg_next_member(
 	return memb;
 }
 
+/* The heap may be momentarily stale, since it is updated after the ME
+ * changed state. The top is re-checked under me->lock and fixed up if
+ * needed.
+ */
+static struct vgsm_me *vgsm_hg_hunt_heap(
+	struct vgsm_huntgroup *hg)
+{
+	int attempts;
+
+	for (attempts = 0; attempts <= hg->heap_size; attempts++) {
+		struct vgsm_me *me;
+
+		ast_mutex_lock(&vgsm.hg_heap_lock);
+		if (!hg->heap_count) {
+			ast_mutex_unlock(&vgsm.hg_heap_lock);
+			break;
+		}
+
+		me = vgsm_me_get(hg->heap[0]->me);
+		ast_mutex_unlock(&vgsm.hg_heap_lock);
+
+		ast_mutex_lock(&me->lock);
+
+		if (vgsm_hg_me_available(me)) {
+			/* The channel is attached later, meanwhile move
+			 * the ME back in LRU order
+			 */
+			me->hunt.last_used = longtime_now();
+			vgsm_hg_me_update(me);
+
+			ast_mutex_unlock(&me->lock);
+
+			vgsm_hg_debug(hg,
+				"Huntgroup: found me '%s'\n", me->name);
+
+			return me;
+		}
+
+		vgsm_hg_me_update(me);
+		ast_mutex_unlock(&me->lock);
+
+		vgsm_hg_debug(hg,
+			"Huntgroup: me '%s' no longer available\n",
+			me->name);
+
+		vgsm_me_put(me);
+	}
+
+	vgsm_hg_debug(hg, "Huntgroup: no available me\n");
+
+	return NULL;
+}
+
 struct vgsm_me *vgsm_hg_hunt(
 	struct vgsm_huntgroup *hg,
 	struct vgsm_me *cur_me,
 	struct vgsm_me *first_me)
 {
+	/* Retries after a failed attempt still scan the members in
+	 * configuration order
+	 */
+	if (vgsm_hg_mode_is_heap(hg->mode) && !cur_me && !first_me)
+		return vgsm_hg_hunt_heap(hg);
+
 	ast_rwlock_rdlock(&vgsm.huntgroups_list_lock);
 
 	if (list_empty(&hg->members)) {
@@ -464,6 +870,10 @@ struct vgsm_me *vgsm_hg_hunt(
 		break;
 
 		case VGSM_HUNTGROUP_MODE_SEQUENTIAL:
+		case VGSM_HUNTGROUP_MODE_LRU:
+		case VGSM_HUNTGROUP_MODE_LEAST_MINUTES:
+		case VGSM_HUNTGROUP_MODE_BEST_SIGNAL:
+		case VGSM_HUNTGROUP_MODE_FEWEST_FAILURES:
 		break;
 		}
 	}
@@ -482,12 +892,7 @@ struct vgsm_me *vgsm_hg_hunt(
 
 		ast_mutex_lock(&hgm->me->lock);
 
-		if (hgm->me->status == VGSM_ME_STATUS_READY &&
-		   !hgm->me->vgsm_chan &&
-		   (hgm->me->net.status ==
-					VGSM_NET_STATUS_REGISTERED_HOME ||
-		    hgm->me->net.status ==
-					VGSM_NET_STATUS_REGISTERED_ROAMING)) {
+		if (vgsm_hg_me_available(hgm->me)) {
 
 			hg->current_member = hgm;
 
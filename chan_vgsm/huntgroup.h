@@ -21,15 +21,37 @@ enum vgsm_huntgroup_mode
 {
 	VGSM_HUNTGROUP_MODE_SEQUENTIAL,
 	VGSM_HUNTGROUP_MODE_CYCLIC,
+	VGSM_HUNTGROUP_MODE_LRU,
+	VGSM_HUNTGROUP_MODE_LEAST_MINUTES,
+	VGSM_HUNTGROUP_MODE_BEST_SIGNAL,
+	VGSM_HUNTGROUP_MODE_FEWEST_FAILURES,
 };
 
+/* Modes other than sequential and cyclic keep the available members in a
+ * binary heap ordered by the mode's key. The heap is updated whenever a
+ * member ME changes state, hunting just picks the top.
+ */
+static inline int vgsm_hg_mode_is_heap(enum vgsm_huntgroup_mode mode)
+{
+	return mode >= VGSM_HUNTGROUP_MODE_LRU;
+}
+
 struct vgsm_me;
+struct vgsm_huntgroup;
 
 struct vgsm_huntgroup_member
 {
 	struct list_head node;
 
 	struct vgsm_me *me;
+	struct vgsm_huntgroup *hg;
+
+	/* Protected by vgsm_hg_heap_lock */
+	struct list_head me_node;
+	int linked;
+	int index;
+	int heap_index;
+	long long key;
 };
 
 struct vgsm_huntgroup
@@ -46,6 +68,11 @@ struct vgsm_huntgroup
 
 	struct vgsm_huntgroup_member *current_member;
 
+	/* Protected by vgsm_hg_heap_lock */
+	struct vgsm_huntgroup_member **heap;
+	int heap_count;
+	int heap_size;
+
 	BOOL debug;
 };
 
@@ -60,6 +87,11 @@ struct vgsm_me *vgsm_hg_hunt(
 	struct vgsm_me *cur_me,
 	struct vgsm_me *first_me);
 
+void vgsm_hg_me_update(struct vgsm_me *me);
+void vgsm_hg_me_call_started(struct vgsm_me *me);
+void vgsm_hg_me_call_ended(struct vgsm_me *me);
+void vgsm_hg_me_call_failed(struct vgsm_me *me);
+
 int vgsm_hg_load(void);
 int vgsm_hg_unload(void);
 
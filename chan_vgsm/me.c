@@ -69,6 +69,7 @@
 #include "sim.h"
 #include "sim_file.h"
 #include "timer.h"
+#include "huntgroup.h"
 
 #define FAILED_RETRY_TIME (5 * SEC)
 #define READY_UPDATE_TIME (30 * SEC)
@@ -78,6 +79,7 @@
 #define POWERING_OFF_TIMEOUT (7 * SEC)
 #define WAITING_INITIALIZATION_DELAY (2 * SEC)
 #define WAITING_INITIALIZATION_SIM_INSERTED_DELAY (5 * SEC)
+#define WAITING_INITIALIZATION_SLOT_RETRY (500 * MILLISEC)
 
 
 
@@ -1210,6 +1212,8 @@ struct vgsm_me *vgsm_me_alloc(void)
 	INIT_LIST_HEAD(&me->stats.inbound_counters);
 	INIT_LIST_HEAD(&me->stats.outbound_counters);
 
+	INIT_LIST_HEAD(&me->hg_members);
+
 	me->status = VGSM_ME_STATUS_UNCONFIGURED;
 	me->in_service = TRUE;
 
@@ -1262,6 +1266,9 @@ void _vgsm_me_put(struct vgsm_me *me, const char *file, int line, const char *fu
 	if (!refcnt) {
 		vgsm_comm_destroy(&me->comm);
 
+		if (me->sim.cache)
+			vgsm_sim_cache_put(me->sim.cache);
+
 		if (me->status_reason)
 			free(me->status_reason);
 
@@ -1357,6 +1364,8 @@ void vgsm_me_set_status_va(
 		me->failure_attempts++;
 	}
 
+	vgsm_hg_me_update(me);
+
 	if (me->monitor_thread != AST_PTHREADT_NULL)
 		pthread_kill(me->monitor_thread, SIGURG);
 
@@ -1446,6 +1455,30 @@ static void vgsm_me_emerg_off(
 
 #define to_me(cm) container_of((cm), struct vgsm_me, comm)
 
+/* Causes that say something about the destination rather than about the
+ * ME or its network do not count as failures for huntgroups
+ */
+static BOOL vgsm_me_cause_is_failure(int location, int reason)
+{
+	int cause = (location == VGSM_CAUSE_LOCATION_LOCAL) ?
+			reason : vgsm_cause_to_ast_cause(location, reason);
+
+	switch(cause) {
+	case AST_CAUSE_UNALLOCATED:
+	case AST_CAUSE_NORMAL_CLEARING:
+	case AST_CAUSE_USER_BUSY:
+	case AST_CAUSE_NO_USER_RESPONSE:
+	case AST_CAUSE_NO_ANSWER:
+	case AST_CAUSE_CALL_REJECTED:
+	case AST_CAUSE_NUMBER_CHANGED:
+	case AST_CAUSE_INVALID_NUMBER_FORMAT:
+	case AST_CAUSE_NORMAL_UNSPECIFIED:
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 void vgsm_me_counter_inc(
 	struct vgsm_me *me,
 	BOOL outbound,
@@ -1484,6 +1517,10 @@ void vgsm_me_counter_inc(
 found:
 	counter->count++;
 
+	if (outbound && me->vgsm_chan && me->vgsm_chan->outbound &&
+	    vgsm_me_cause_is_failure(location, reason))
+		vgsm_hg_me_call_failed(me);
+
 	ast_mutex_unlock(&me->lock);
 
 	return;
@@ -1576,6 +1613,8 @@ static void vgsm_me_received_hangup(struct vgsm_me *me)
 		/* Detach channel from me */
 		vgsm_chan_put(me->vgsm_chan);
 		me->vgsm_chan = NULL;
+
+		vgsm_hg_me_call_ended(me);
 	}
 	ast_mutex_unlock(&me->lock);
 
@@ -1756,6 +1795,8 @@ static void handle_unsolicited_cring(
 		goto err_alloc_call;
 	}
 
+	vgsm_hg_me_call_started(me);
+
 	ast_mutex_unlock(&me->lock);
 
 	return;
@@ -1805,6 +1846,10 @@ static void vgsm_update_me_by_creg(
 		vgsm_me_debug_state(me,
 			"registration %s\n",
 			vgsm_net_status_to_text(me->net.status));
+
+		ast_mutex_lock(&me->lock);
+		vgsm_hg_me_update(me);
+		ast_mutex_unlock(&me->lock);
 	}
 
 	if (me->net.status == VGSM_NET_STATUS_REGISTERED_HOME ||
@@ -2463,6 +2508,12 @@ static void handle_unsolicited_ciev_signal(
 	struct vgsm_me *me = to_me(urc->comm);
 
 	vgsm_me_debug_state(me, "Signal: %s\n", pars);
+
+	/* The "signal" indicator reports the bit error rate */
+	ast_mutex_lock(&me->lock);
+	if (sscanf(pars, "%d", &me->net.sci2.ber) == 1)
+		vgsm_hg_me_update(me);
+	ast_mutex_unlock(&me->lock);
 }
 
 static void handle_unsolicited_ciev_service(
@@ -2895,6 +2946,8 @@ static int vgsm_update_smond(struct vgsm_me *me)
 			me->net.sci2.ber = 0;
 	}
 
+	vgsm_hg_me_update(me);
+
 	vgsm_req_put(req);
 
 	ast_mutex_unlock(&me->lock);
@@ -3124,6 +3177,11 @@ static void handle_unsolicited_scks(
 	} else {
 		me->sim.inserted = FALSE;
 
+		if (me->sim.cache) {
+			vgsm_sim_cache_put(me->sim.cache);
+			me->sim.cache = NULL;
+		}
+
 		if (me->status == VGSM_ME_STATUS_READY ||
 		    me->status == VGSM_ME_STATUS_WAITING_PIN)
 			vgsm_me_set_status(me,
@@ -3145,9 +3203,33 @@ static void handle_unsolicited_sbc(
 		"%s: Power supply: %s\n", pars, me->name);
 }
 
+#define VGSM_SAT_CMD_REFRESH	0x01
+
 static void handle_unsolicited_sstn(
 	const struct vgsm_req *urc)
 {
+	struct vgsm_comm *comm = urc->comm;
+	struct vgsm_me *me = to_me(comm);
+	const char *line = vgsm_req_first_line(urc)->text;
+	const char *pars = line + strlen(urc->urc_class->code);
+
+	if (atoi(pars) != VGSM_SAT_CMD_REFRESH)
+		return;
+
+	/* The SIM files may have changed under us */
+	struct vgsm_sim_cache *cache = NULL;
+
+	ast_mutex_lock(&me->lock);
+	if (me->sim.cache)
+		cache = vgsm_sim_cache_get(me->sim.cache);
+	ast_mutex_unlock(&me->lock);
+
+	if (cache) {
+		vgsm_me_debug_state(me, "SIM refresh, cache invalidated\n");
+
+		vgsm_sim_cache_invalidate(cache);
+		vgsm_sim_cache_put(cache);
+	}
 }
 
 static void handle_unsolicited_sctm_a(
@@ -3803,14 +3885,39 @@ err_tcgetattr:
 	return -1;
 }
 
+/* Elementary files read at initialization and kept in the SIM cache */
+static const __u16 vgsm_sim_prefetch_files[] = {
+	0x6FAE,	/* EF_Phase */
+	0x6F05,	/* EF_LP */
+	0x6F46,	/* EF_SPN */
+	0x6F30,	/* EF_PLMNsel */
+	0x6F7B,	/* EF_FPLMN */
+	0x6F42,	/* EF_SMSP */
+};
+
 static int vgsm_me_update_static_info(
 	struct vgsm_me *me,
 	struct vgsm_me_config *mc)
 {
 	struct vgsm_comm *comm = &me->comm;
+	struct vgsm_sim_cache *cache = NULL;
 	struct vgsm_req *req;
 	int err;
 
+	/* The module identity cannot change as long as the device does not,
+	 * there is no need to ask again on every re-initialization
+	 */
+	ast_mutex_lock(&me->lock);
+	BOOL identity_known =
+		me->me.imei[0] &&
+		!strcmp(me->me.device_filename, mc->device_filename);
+	ast_mutex_unlock(&me->lock);
+
+	if (identity_known) {
+		me->bringup.skipped_requests += 4;
+		goto identity_done;
+	}
+
 	/*--------*/
 	req = vgsm_req_make_wait(comm, 5 * SEC, "AT+CGMI");
 	err = vgsm_req_status(req);
@@ -3875,10 +3982,13 @@ static int vgsm_me_update_static_info(
 	strncpy(me->me.imei,
 		vgsm_req_first_line(req)->text,
 		sizeof(me->me.imei));
+	strncpy(me->me.device_filename, mc->device_filename,
+		sizeof(me->me.device_filename));
 	ast_mutex_unlock(&me->lock);
 
 	vgsm_req_put(req);
-	
+
+identity_done:
 	/*--------*/
 	req = vgsm_req_make_wait(comm, 100 * MILLISEC, "AT^SCKS?");
 	err = vgsm_req_status(req);
@@ -3921,23 +4031,6 @@ static int vgsm_me_update_static_info(
 	if (!me->sim.inserted)
 		goto no_sim;
 	
-	/*--------*/
-	req = vgsm_req_make_wait(comm, 20 * SEC, "AT+CIMI");
-	err = vgsm_req_status(req);
-	if (err != VGSM_RESP_OK) {
-		vgsm_me_failed(me, err);
-		vgsm_req_put(req);
-		goto err_failed;
-	}
-
-	ast_mutex_lock(&me->lock);
-	strncpy(me->sim.imsi,
-		vgsm_req_first_line(req)->text,
-		sizeof(me->sim.imsi));
-	ast_mutex_unlock(&me->lock);
-
-	vgsm_req_put(req);
-
 	/*--------*/
 	req = vgsm_req_make_wait(comm, 20 * SEC, "AT+CXXCID");
 	err = vgsm_req_status(req);
@@ -3960,6 +4053,51 @@ static int vgsm_me_update_static_info(
 
 	vgsm_req_put(req);
 
+	/* A different card gets a different cache, so swapping the SIM
+	 * never returns stale files. The ME keeps its own reference, ours
+	 * is needed as the SIM may be removed while we are still using it.
+	 */
+	struct vgsm_sim_cache *old_cache;
+	cache = vgsm_sim_cache_get_by_card_id(me->sim.card_id);
+
+	ast_mutex_lock(&me->lock);
+	old_cache = me->sim.cache;
+	me->sim.cache = cache ? vgsm_sim_cache_get(cache) : NULL;
+	ast_mutex_unlock(&me->lock);
+
+	if (old_cache)
+		vgsm_sim_cache_put(old_cache);
+
+	/*--------*/
+	char imsi[sizeof(me->sim.imsi)];
+
+	if (cache && vgsm_sim_cache_get_imsi(cache, imsi, sizeof(imsi)) >= 0) {
+		ast_mutex_lock(&me->lock);
+		strncpy(me->sim.imsi, imsi, sizeof(me->sim.imsi));
+		ast_mutex_unlock(&me->lock);
+
+		me->bringup.skipped_requests++;
+	} else {
+		req = vgsm_req_make_wait(comm, 20 * SEC, "AT+CIMI");
+		err = vgsm_req_status(req);
+		if (err != VGSM_RESP_OK) {
+			vgsm_me_failed(me, err);
+			vgsm_req_put(req);
+			goto err_failed;
+		}
+
+		ast_mutex_lock(&me->lock);
+		strncpy(me->sim.imsi,
+			vgsm_req_first_line(req)->text,
+			sizeof(me->sim.imsi));
+		ast_mutex_unlock(&me->lock);
+
+		vgsm_req_put(req);
+
+		if (cache)
+			vgsm_sim_cache_set_imsi(cache, me->sim.imsi);
+	}
+
 	/*--------*/
 retry_csca:
 	req = vgsm_req_make_wait(comm, 20 * SEC, "AT+CSCA?");
@@ -4001,11 +4139,38 @@ retry_csca:
 
 	vgsm_req_put(req);
 
+	/*--------*/
+	if (cache) {
+		int hits, misses;
+
+		ast_mutex_lock(&cache->lock);
+		hits = cache->hits;
+		misses = cache->misses;
+		ast_mutex_unlock(&cache->lock);
+
+		vgsm_sim_cache_prefetch(comm, cache,
+			vgsm_sim_prefetch_files,
+			ARRAY_SIZE(vgsm_sim_prefetch_files));
+
+		ast_mutex_lock(&cache->lock);
+		hits = cache->hits - hits;
+		misses = cache->misses - misses;
+		ast_mutex_unlock(&cache->lock);
+
+		vgsm_me_debug_state(me,
+			"SIM files prefetched, %d cached, %d read\n",
+			hits, misses);
+	}
+
 no_sim:
+	if (cache)
+		vgsm_sim_cache_put(cache);
 
 	return 0;
 
 err_failed:
+	if (cache)
+		vgsm_sim_cache_put(cache);
 
 	return -1;
 }
@@ -4108,6 +4273,10 @@ static int vgsm_me_open(
 	ast_mutex_lock(&me->lock);
 	struct vgsm_me_config *mc;
 	mc = vgsm_me_config_get(me->current_config);
+
+	/* Retries after failures are accounted to the same bring-up */
+	if (!me->bringup.start)
+		me->bringup.start = longtime_now();
 	ast_mutex_unlock(&me->lock);
 
 	me->me_fd = open(mc->device_filename, O_RDWR | O_NOCTTY | O_NDELAY);
@@ -4346,6 +4515,8 @@ static void vgsm_me_initialize(
 {
 	vgsm_me_debug_state(me, "ME initializing...\n");
 
+	longtime_t init_start = longtime_now();
+
 	ast_mutex_lock(&me->lock);
 	struct vgsm_me_config *mc;
 	mc = vgsm_me_config_get(me->current_config);
@@ -4416,6 +4587,14 @@ static void vgsm_me_initialize(
 
 	me->failure_attempts = 0;
 
+	ast_mutex_lock(&me->lock);
+	me->bringup.init_time = longtime_now() - init_start;
+	if (me->bringup.start) {
+		me->bringup.time_to_ready = longtime_now() - me->bringup.start;
+		me->bringup.start = 0;
+	}
+	ast_mutex_unlock(&me->lock);
+
 	if (me->in_service) {
 		vgsm_me_set_status(me,
 			VGSM_ME_STATUS_READY,
@@ -4428,7 +4607,10 @@ static void vgsm_me_initialize(
 			" ");
 	}
 
-	vgsm_me_debug_state(me, "me successfully initialized\n");
+	vgsm_me_debug_state(me,
+		"me successfully initialized in %.1fs, ready after %.1fs\n",
+		me->bringup.init_time / (double)SEC,
+		me->bringup.time_to_ready / (double)SEC);
 
 	vgsm_me_config_put(mc);
 
@@ -4446,6 +4628,32 @@ initialization_failed:
 		vgsm_me_failed_text(me, "");
 }
 
+/* Bounds the number of MEs going through the AT initialization sequence at
+ * the same time, as configured by max_parallel_init (0 means no limit).
+ * MEs which do not get a slot retry shortly afterwards from their own timer.
+ */
+static BOOL vgsm_me_init_slot_get(void)
+{
+	BOOL res = TRUE;
+
+	ast_mutex_lock(&vgsm.init_slots_lock);
+	if (vgsm.max_parallel_init > 0 &&
+	    vgsm.init_slots_used >= vgsm.max_parallel_init)
+		res = FALSE;
+	else
+		vgsm.init_slots_used++;
+	ast_mutex_unlock(&vgsm.init_slots_lock);
+
+	return res;
+}
+
+static void vgsm_me_init_slot_put(void)
+{
+	ast_mutex_lock(&vgsm.init_slots_lock);
+	vgsm.init_slots_used--;
+	ast_mutex_unlock(&vgsm.init_slots_lock);
+}
+
 static void vgsm_me_timer_fired(struct vgsm_me *me);
 static void vgsm_me_timer(struct vgsm_timer *timer, enum vgsm_timer_action action, void *start_data)
 {
@@ -4571,7 +4779,16 @@ static void vgsm_me_timer_fired(struct vgsm_me *me)
 	break;
 
 	case VGSM_ME_STATUS_WAITING_INITIALIZATION:
+		if (!vgsm_me_init_slot_get()) {
+			vgsm_me_set_status(me,
+				VGSM_ME_STATUS_WAITING_INITIALIZATION,
+				WAITING_INITIALIZATION_SLOT_RETRY,
+				"Waiting for an initialization slot");
+			break;
+		}
+
 		vgsm_me_initialize(me);
+		vgsm_me_init_slot_put();
 	break;
 
 	case VGSM_ME_STATUS_READY:
@@ -4732,6 +4949,18 @@ static void vgsm_me_show_me(int fd, struct vgsm_me *me)
 	if (me->failure_count)
 		ast_cli(fd, "\n  Failure count: %d\n", me->failure_count);
 
+	if (me->bringup.start)
+		ast_cli(fd, "  Bring-up in progress since: %.1fs\n",
+			(longtime_now() - me->bringup.start) / (double)SEC);
+
+	if (me->bringup.time_to_ready)
+		ast_cli(fd,
+			"  Time to ready: %.1fs"
+			" (initialization %.1fs, %d requests skipped)\n",
+			me->bringup.time_to_ready / (double)SEC,
+			me->bringup.init_time / (double)SEC,
+			me->bringup.skipped_requests);
+
 	if (me->status == VGSM_ME_STATUS_UNCONFIGURED)
 		goto out;
 
@@ -5106,6 +5335,40 @@ static int vgsm_me_show_callwaiting(int fd, struct vgsm_me *me)
 	return RESULT_SUCCESS;
 }
 
+static void vgsm_me_show_sim_plmns(int fd, const __u8 *buf, int len)
+{
+	int i;
+
+	for(i=0; i + 2 < len; i+=3) {
+
+		if (buf[i] == 0xff &&
+		    buf[i + 1] == 0xff &&
+		    buf[i + 2] == 0xff)
+			continue;
+
+		__u16 mcc = (buf[i] & 0x0f) * 100 +
+			    ((buf[i] & 0xf0) >> 4) * 10 +
+			    (buf[i + 1] & 0x0f);
+
+		__u16 mnc = (buf[i + 2] & 0x0f) * 10+
+			    ((buf[i + 2] & 0xf0) >> 4);
+
+		if ((buf[i + 1] & 0xf0) != 0xf0)
+			    mnc += ((buf[i + 1] & 0xf0) >> 4) * 100;
+
+		ast_cli(fd, "  %03d%02d", mcc, mnc);
+
+		struct vgsm_operator_info *op_info;
+		op_info = vgsm_operators_search(mcc, mnc);
+		if (op_info)
+			ast_cli(fd, " %s - %s",
+				op_info->name,
+				op_info->country ? op_info->country->name : "");
+
+		ast_cli(fd, "\n");
+	}
+}
+
 static int vgsm_me_show_sim(int fd, struct vgsm_me *me)
 {
 	ast_mutex_lock(&me->lock);
@@ -5151,168 +5414,66 @@ static int vgsm_me_show_sim(int fd, struct vgsm_me *me)
 
 	ast_cli(fd, "\n");
 
-#if 0
-	struct vgsm_sim *sim = me->sim.sim;
-	if (!sim)
+	/* Only what is in the cache is shown, no SIM I/O with me->lock held */
+	struct vgsm_sim_cache *cache = me->sim.cache;
+	if (!cache)
 		goto out;
 
-	struct vgsm_sim_file *file;
-	__u8 *buf;
+	__u8 buf[256];
+	int len;
 	int i;
-	int err;
-
-	/***************/
-
-	file = vgsm_sim_file_alloc(sim);
-	if (!file)
-		goto out;
-	vgsm_sim_file_open(file, 0x6F46);
-
-	buf = alloca(file->length + 1);
-	vgsm_sim_file_read(file, buf, 0, file->length);
-	buf[file->length] = '\0';
-	ast_cli(fd, "  Operator name: %s\n", buf);
-	vgsm_sim_file_put(file);
 
-	/***************/
-
-	file = vgsm_sim_file_alloc(sim);
-	if (!file)
-		goto out;
-
-	__u8 phase;
-	vgsm_sim_file_open(file, 0x6FAE);
-	err = vgsm_sim_file_read(file, &phase, 0, 1);
-	if (err < 0) {
-		ast_cli(fd, "Cannot read SIM file: %s\n", strerror(-err));
-		goto out;
-	}
-
-	if (phase == 3)
-		ast_cli(fd, "  Phase: 2 with profile download\n");
-	else
-		ast_cli(fd, "  Phase: %d\n", phase);
-
-	vgsm_sim_file_put(file);
-
-	/***************/
-
-	file = vgsm_sim_file_alloc(sim);
-	if (!file)
-		goto out;
-	vgsm_sim_file_open(file, 0x6F30);
-
-	buf = alloca(file->length);
-
-	err = vgsm_sim_file_read(file, buf, 0, file->length);
-	if (err < 0) {
-		ast_cli(fd, "Cannot read SIM file: %s\n", strerror(-err));
-		goto out;
-	}
-
-	ast_cli(fd, "\nPLMN Selector:\n");
-	for(i=0; i<file->length; i+=3) {
-
-		if (buf[i] == 0xff &&
-		    buf[i + 1] == 0xff &&
-		    buf[i + 2] == 0xff)
-			continue;
-
-		__u16 mcc = (buf[i] & 0x0f) * 100 +
-			    ((buf[i] & 0xf0) >> 4) * 10 +
-			    (buf[i + 1] & 0x0f);
-
-		__u16 mnc = (buf[i + 2] & 0x0f) * 10+
-			    ((buf[i + 2] & 0xf0) >> 4);
-
-		if ((buf[i + 1] & 0xf0) != 0xf0)
-			    mnc += ((buf[i + 1] & 0xf0) >> 4) * 100;
-
-		ast_cli(fd, "  %03d%02d", mcc, mnc);
-
-		struct vgsm_operator_info *op_info;
-		op_info = vgsm_operators_search(mcc, mnc);
-		if (op_info)
-			ast_cli(fd, " %s - %s",
-				op_info->name,
-				op_info->country ? op_info->country->name : "");
-
-		ast_cli(fd, "\n");
+	len = vgsm_sim_cache_read(cache, 0x6F46, buf, sizeof(buf));
+	if (len > 1) {
+		/* First byte is the display condition, the name is padded
+		 * with 0xff
+		 */
+		for(i=1; i<len && buf[i] != 0xff; i++);
+		ast_cli(fd, "  Service provider: %.*s\n", i - 1, buf + 1);
 	}
 
-	vgsm_sim_file_put(file);
-
-	/***************/
-
-	file = vgsm_sim_file_alloc(sim);
-	if (!file)
-		goto out;
-	vgsm_sim_file_open(file, 0x6F7B);
-
-	buf = alloca(file->length);
-
-	err = vgsm_sim_file_read(file, buf, 0, file->length);
-	if (err < 0) {
-		ast_cli(fd, "Cannot read SIM file: %s\n", strerror(-err));
-		goto out;
+	len = vgsm_sim_cache_read(cache, 0x6FAE, buf, sizeof(buf));
+	if (len > 0) {
+		if (buf[0] == 3)
+			ast_cli(fd, "  Phase: 2 with profile download\n");
+		else
+			ast_cli(fd, "  Phase: %d\n", buf[0]);
 	}
 
-	ast_cli(fd, "\nForbidden PLMNs:\n");
-	for(i=0; i<file->length; i+=3) {
-
-		if (buf[i] == 0xff &&
-		    buf[i + 1] == 0xff &&
-		    buf[i + 2] == 0xff)
-			continue;
-
-		__u16 mcc = (buf[i] & 0x0f) * 100 +
-			    ((buf[i] & 0xf0) >> 4) * 10 +
-			    (buf[i + 1] & 0x0f);
-
-		__u16 mnc = (buf[i + 2] & 0x0f) * 10+
-			    ((buf[i + 2] & 0xf0) >> 4);
-
-		if ((buf[i + 1] & 0xf0) != 0xf0)
-			    mnc += ((buf[i + 1] & 0xf0) >> 4) * 100;
-
-		ast_cli(fd, "  %03d%02d", mcc, mnc);
-
-		struct vgsm_operator_info *op_info;
-		op_info = vgsm_operators_search(mcc, mnc);
-		if (op_info)
-			ast_cli(fd, " %s - %s",
-				op_info->name,
-				op_info->country ? op_info->country->name : "");
-
-		ast_cli(fd, "\n");
+	len = vgsm_sim_cache_read(cache, 0x6F30, buf, sizeof(buf));
+	if (len > 0) {
+		ast_cli(fd, "\nPLMN Selector:\n");
+		vgsm_me_show_sim_plmns(fd, buf, len);
 	}
 
-	vgsm_sim_file_put(file);
-
-	/***************/
-
-	file = vgsm_sim_file_alloc(sim);
-	if (!file)
-		goto out;
-
-	vgsm_sim_file_open(file, 0x6F05);
-
-	buf = alloca(file->length);
-	err = vgsm_sim_file_read(file, buf, 0, file->length);
-	if (err < 0) {
-		ast_cli(fd, "Cannot read SIM file: %s\n", strerror(-err));
-		goto out;
+	len = vgsm_sim_cache_read(cache, 0x6F7B, buf, sizeof(buf));
+	if (len > 0) {
+		ast_cli(fd, "\nForbidden PLMNs:\n");
+		vgsm_me_show_sim_plmns(fd, buf, len);
 	}
 
-	ast_cli(fd, "\nPreferred languages:\n");
-	for(i=0; i<file->length; i++) {
-		ast_cli(fd, "  %s\n", vgsm_sim_language_to_text(buf[i]));
+	len = vgsm_sim_cache_read(cache, 0x6F05, buf, sizeof(buf));
+	if (len > 0) {
+		ast_cli(fd, "\nPreferred languages:\n");
+		for(i=0; i<len; i++) {
+			if (buf[i] != 0xff)
+				ast_cli(fd, "  %s\n",
+					vgsm_sim_language_to_text(buf[i]));
+		}
 	}
 
-	vgsm_sim_file_put(file);
+	ast_mutex_lock(&cache->lock);
+	ast_cli(fd,
+		"\nSIM cache:\n"
+		"  Files: %d\n"
+		"  Hits: %d\n"
+		"  Misses: %d\n",
+		cache->nentries,
+		cache->hits,
+		cache->misses);
+	ast_mutex_unlock(&cache->lock);
 
 	ast_cli(fd, "\n");
-#endif
 
 out:
 
@@ -5712,6 +5873,9 @@ static int vgsm_me_show_summary(int fd, struct vgsm_me *me)
 		if (me->sending_sms)
 			ast_cli(fd, " - SENDING_SMS");
 
+		if (me->bringup.time_to_ready)
+			ast_cli(fd, " (ready in %.1fs)",
+				me->bringup.time_to_ready / (double)SEC);
 	} else {
 		if (me->status_reason)
 			ast_cli(fd, "  %s", me->status_reason);
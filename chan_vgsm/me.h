@@ -316,6 +316,11 @@ struct vgsm_me
 		char model[32];
 		char version[32];
 		char imei[32];
+
+		/* Device the identity above has been read from, it is not
+		 * queried again as long as it does not change
+		 */
+		char device_filename[PATH_MAX];
 	} me;
 
 	struct {
@@ -324,6 +329,8 @@ struct vgsm_me
 		char card_id[32];
 		int remaining_attempts;
 		struct vgsm_number smcc_address;
+
+		struct vgsm_sim_cache *cache;
 	} sim;
 
 	struct {
@@ -358,6 +365,26 @@ struct vgsm_me
 
 	} stats;
 
+	struct {
+		longtime_t last_used;
+		longtime_t call_started;
+		longtime_t call_time;
+
+		/* log2 of the decaying failure count, see huntgroup.c */
+		long long failures;
+		int total_failures;
+	} hunt;
+
+	struct {
+		longtime_t start;
+		longtime_t time_to_ready;
+		longtime_t init_time;
+		int skipped_requests;
+	} bringup;
+
+	/* Huntgroup memberships, protected by vgsm_hg_heap_lock */
+	struct list_head hg_members;
+
 	BOOL debug_state;
 	BOOL debug_call;
 	BOOL debug_sms;
@@ -12,11 +12,15 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
+#include <unistd.h>
+#include <ctype.h>
 #include <wchar.h>
 #include <linux/types.h>
 #include <netinet/in.h>
 #include <errno.h>
+#include <sys/stat.h>
 #include <locale.h>
 #include <iconv.h>
 #include <asterisk/version.h>
@@ -31,6 +35,7 @@
 
 #include "chan_vgsm.h"
 #include "util.h"
+#include "sim.h"
 #include "sim_file.h"
 
 static const char *vgsm_sim_type_of_file_to_text(
@@ -90,7 +95,572 @@ const char *vgsm_sim_language_to_text(enum vgsm_sim_dcs_language value)
 	return "*INVALID*";
 };
 
-struct vgsm_sim_file *vgsm_sim_file_alloc(struct vgsm_sim *sim)
+#define VGSM_SIM_CRSM_READ_BINARY	176
+#define VGSM_SIM_CRSM_READ_RECORD	178
+#define VGSM_SIM_CRSM_GET_RESPONSE	192
+
+/* Maximum P3 value, the most we can get out of a single CRSM request */
+#define VGSM_SIM_CRSM_MAX_LEN		255
+
+static inline int hex_value(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+
+	c |= 0x20;
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+
+	return -1;
+}
+
+static int hex_decode(const char *src, __u8 *dst, int len)
+{
+	int i;
+
+	for(i=0; i<len; i++) {
+		int hi = hex_value(src[i * 2]);
+		int lo = hex_value(src[i * 2 + 1]);
+
+		if ((hi | lo) < 0)
+			return -1;
+
+		dst[i] = hi << 4 | lo;
+	}
+
+	return 0;
+}
+
+/* Issues a restricted SIM access and decodes the response payload in buf.
+ * Returns the number of bytes decoded or a negative error.
+ */
+static int vgsm_sim_crsm(
+	struct vgsm_comm *comm,
+	int command, __u16 file_id,
+	int p1, int p2, int p3,
+	__u8 *buf, int buf_size)
+{
+	struct vgsm_req *req;
+	int err;
+
+	if (command == VGSM_SIM_CRSM_GET_RESPONSE)
+		req = vgsm_req_make_wait(comm, 5 * SEC,
+				"AT+CRSM=%d,%d", command, file_id);
+	else
+		req = vgsm_req_make_wait(comm, 5 * SEC,
+				"AT+CRSM=%d,%d,%d,%d,%d",
+				command, file_id, p1, p2, p3);
+
+	if (vgsm_req_status(req) != VGSM_RESP_OK) {
+		err = -EIO;
+		goto err_req_make;
+	}
+
+	const char *line = vgsm_req_first_line(req)->text;
+	if (strncmp(line, "+CRSM: ", strlen("+CRSM: "))) {
+		ast_log(LOG_ERROR, "Unexpected CRSM response '%s'\n", line);
+		err = -EINVAL;
+		goto err_parse_response;
+	}
+
+	const char *pars_ptr = line + strlen("+CRSM: ");
+	char field[16];
+
+	if (!get_token(&pars_ptr, field, sizeof(field))) {
+		ast_log(LOG_ERROR, "Cannot parse CRSM sw1 '%s'\n", line);
+		err = -EINVAL;
+		goto err_parse_response;
+	}
+
+	int sw1 = atoi(field);
+
+	if (!get_token(&pars_ptr, field, sizeof(field))) {
+		ast_log(LOG_ERROR, "Cannot parse CRSM sw2 '%s'\n", line);
+		err = -EINVAL;
+		goto err_parse_response;
+	}
+
+	if (sw1 != 0x90 && sw1 != 0x91) {
+		err = -EIO;
+		goto err_read_failed;
+	}
+
+	/* The payload is decoded in place, without copying it to a token */
+	if (*pars_ptr == '"')
+		pars_ptr++;
+
+	int hex_len = strcspn(pars_ptr, "\",");
+	if (hex_len % 2) {
+		ast_log(LOG_ERROR, "Invalid CRSM response '%s'\n", line);
+		err = -EINVAL;
+		goto err_parse_response;
+	}
+
+	int len = min(hex_len / 2, buf_size);
+
+	if (hex_decode(pars_ptr, buf, len) < 0) {
+		ast_log(LOG_ERROR, "Invalid CRSM response '%s'\n", line);
+		err = -EINVAL;
+		goto err_parse_response;
+	}
+
+	vgsm_req_put(req);
+
+	return len;
+
+err_read_failed:
+err_parse_response:
+err_req_make:
+	vgsm_req_put(req);
+
+	return err;
+}
+
+/* Reads the whole file with as few requests as possible: transparent files
+ * in maximal READ BINARY chunks, record files one READ RECORD per record.
+ */
+static int vgsm_sim_file_fetch(
+	struct vgsm_comm *comm,
+	struct vgsm_sim_file *sim_file,
+	__u8 *data)
+{
+	int err;
+
+	if (sim_file->structure == VGSM_SIM_EF_TRANSPARENT) {
+		int pos;
+		for(pos=0; pos<sim_file->length; pos += err) {
+			int chunk = min(sim_file->length - pos,
+					VGSM_SIM_CRSM_MAX_LEN);
+
+			err = vgsm_sim_crsm(comm, VGSM_SIM_CRSM_READ_BINARY,
+					sim_file->id,
+					(pos >> 8) & 0xff, pos & 0xff, chunk,
+					data + pos, chunk);
+			if (err < 0)
+				return err;
+
+			if (err != chunk)
+				return -EIO;
+		}
+	} else {
+		int rec_len = sim_file->record_length;
+		int rec;
+
+		if (!rec_len)
+			return -EINVAL;
+
+		for(rec=1; rec * rec_len <= sim_file->length; rec++) {
+			err = vgsm_sim_crsm(comm, VGSM_SIM_CRSM_READ_RECORD,
+					sim_file->id,
+					rec, 4, rec_len,
+					data + (rec - 1) * rec_len, rec_len);
+			if (err < 0)
+				return err;
+
+			if (err != rec_len)
+				return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static struct vgsm_sim_cache_entry *vgsm_sim_cache_lookup(
+	struct vgsm_sim_cache *cache,
+	__u16 file_id)
+{
+	struct vgsm_sim_cache_entry *entry;
+
+	list_for_each_entry(entry, &cache->entries, node) {
+		if (entry->id == file_id)
+			return entry;
+	}
+
+	return NULL;
+}
+
+static struct vgsm_sim_cache_entry *vgsm_sim_cache_entry_alloc(
+	__u16 file_id,
+	__u16 length)
+{
+	struct vgsm_sim_cache_entry *entry;
+
+	entry = malloc(sizeof(*entry) + length);
+	if (!entry)
+		return NULL;
+
+	memset(entry, 0, sizeof(*entry));
+
+	entry->id = file_id;
+	entry->length = length;
+
+	return entry;
+}
+
+/* Must be called with cache->lock held */
+static void vgsm_sim_cache_flush(struct vgsm_sim_cache *cache)
+{
+	struct vgsm_sim_cache_entry *entry, *t;
+
+	list_for_each_entry_safe(entry, t, &cache->entries, node) {
+		list_del(&entry->node);
+		free(entry);
+	}
+
+	cache->nentries = 0;
+}
+
+/* Only the ICCID digits make it to the filename */
+static int vgsm_sim_cache_filename(
+	struct vgsm_sim_cache *cache,
+	char *filename, int filename_size)
+{
+	char card_id[sizeof(cache->card_id)];
+	char *c = card_id;
+	int i;
+
+	if (!vgsm.sim_cache_dir[0])
+		return -ENOENT;
+
+	for(i=0; cache->card_id[i]; i++) {
+		if (isalnum(cache->card_id[i]))
+			*c++ = cache->card_id[i];
+	}
+	*c = '\0';
+
+	if (!card_id[0])
+		return -ENOENT;
+
+	snprintf(filename, filename_size, "%s/sim_%s",
+		vgsm.sim_cache_dir, card_id);
+
+	return 0;
+}
+
+static void vgsm_sim_cache_load(struct vgsm_sim_cache *cache)
+{
+	char filename[PATH_MAX];
+	char *line = NULL;
+	size_t line_size = 0;
+	FILE *f;
+
+	if (vgsm_sim_cache_filename(cache, filename, sizeof(filename)) < 0)
+		return;
+
+	f = fopen(filename, "r");
+	if (!f)
+		return;
+
+	while(getline(&line, &line_size, f) > 0) {
+		unsigned int id, type, structure, record_length, length;
+		int data_pos;
+
+		if (line[0] == '#')
+			continue;
+
+		if (!strncmp(line, "imsi ", strlen("imsi "))) {
+			ast_mutex_lock(&cache->lock);
+			sscanf(line + strlen("imsi "), "%31s", cache->imsi);
+			ast_mutex_unlock(&cache->lock);
+
+			continue;
+		}
+
+		if (sscanf(line, "%x %u %u %u %u %n",
+				&id, &type, &structure, &record_length,
+				&length, &data_pos) < 5 ||
+		    id > 0xffff || length > 0xffff || record_length > 0xff) {
+			ast_log(LOG_WARNING,
+				"Ignoring invalid SIM cache line in %s\n",
+				filename);
+			continue;
+		}
+
+		struct vgsm_sim_cache_entry *entry;
+		entry = vgsm_sim_cache_entry_alloc(id, length);
+		if (!entry)
+			break;
+
+		entry->type = type;
+		entry->structure = structure;
+		entry->record_length = record_length;
+
+		if (line[data_pos] != '-') {
+			if (strspn(line + data_pos,
+					"0123456789abcdefABCDEF") != length * 2 ||
+			    hex_decode(line + data_pos,
+					entry->data, length) < 0) {
+				ast_log(LOG_WARNING,
+					"Ignoring invalid SIM cache data"
+					" in %s\n", filename);
+				free(entry);
+				continue;
+			}
+
+			entry->have_data = TRUE;
+		}
+
+		ast_mutex_lock(&cache->lock);
+		if (vgsm_sim_cache_lookup(cache, id)) {
+			free(entry);
+		} else {
+			list_add_tail(&entry->node, &cache->entries);
+			cache->nentries++;
+		}
+		ast_mutex_unlock(&cache->lock);
+	}
+
+	free(line);
+	fclose(f);
+}
+
+int vgsm_sim_cache_save(struct vgsm_sim_cache *cache)
+{
+	static const char hexdigits[] = "0123456789ABCDEF";
+	char filename[PATH_MAX];
+	char tmp_filename[PATH_MAX + 8];
+	int err;
+
+	if (vgsm_sim_cache_filename(cache, filename, sizeof(filename)) < 0)
+		return 0;
+
+	if (mkdir(vgsm.sim_cache_dir, 0750) < 0 && errno != EEXIST) {
+		ast_log(LOG_WARNING, "Cannot create %s: %s\n",
+			vgsm.sim_cache_dir, strerror(errno));
+		err = -errno;
+		goto err_mkdir;
+	}
+
+	snprintf(tmp_filename, sizeof(tmp_filename), "%s.tmp", filename);
+
+	FILE *f = fopen(tmp_filename, "w");
+	if (!f) {
+		ast_log(LOG_WARNING, "Cannot create %s: %s\n",
+			tmp_filename, strerror(errno));
+		err = -errno;
+		goto err_fopen;
+	}
+
+	ast_mutex_lock(&cache->lock);
+
+	fprintf(f, "# vGSM SIM cache for card %s\n", cache->card_id);
+
+	if (cache->imsi[0])
+		fprintf(f, "imsi %s\n", cache->imsi);
+
+	fprintf(f, "# id type structure record_length length data\n");
+
+	struct vgsm_sim_cache_entry *entry;
+	list_for_each_entry(entry, &cache->entries, node) {
+		fprintf(f, "%04x %d %d %d %d ",
+			entry->id,
+			entry->type,
+			entry->structure,
+			entry->record_length,
+			entry->length);
+
+		if (entry->have_data) {
+			int i;
+			for(i=0; i<entry->length; i++) {
+				fputc(hexdigits[entry->data[i] >> 4], f);
+				fputc(hexdigits[entry->data[i] & 0x0f], f);
+			}
+		} else
+			fputc('-', f);
+
+		fputc('\n', f);
+	}
+
+	cache->dirty = FALSE;
+
+	ast_mutex_unlock(&cache->lock);
+
+	if (fclose(f) < 0) {
+		err = -errno;
+		goto err_fclose;
+	}
+
+	if (rename(tmp_filename, filename) < 0) {
+		ast_log(LOG_WARNING, "Cannot rename %s: %s\n",
+			tmp_filename, strerror(errno));
+		err = -errno;
+		goto err_rename;
+	}
+
+	return 0;
+
+err_rename:
+err_fclose:
+	unlink(tmp_filename);
+err_fopen:
+err_mkdir:
+
+	return err;
+}
+
+struct vgsm_sim_cache *vgsm_sim_cache_get(
+	struct vgsm_sim_cache *cache)
+{
+	assert(cache);
+	assert(cache->refcnt > 0);
+	assert(cache->refcnt < 100000);
+
+	ast_mutex_lock(&vgsm.sim_caches_list_lock);
+	cache->refcnt++;
+	ast_mutex_unlock(&vgsm.sim_caches_list_lock);
+
+	return cache;
+}
+
+/* The cache lives as long as some ME is using the SIM, afterwards it only
+ * survives on disk.
+ */
+void _vgsm_sim_cache_put(struct vgsm_sim_cache *cache)
+{
+	assert(cache);
+	assert(cache->refcnt > 0);
+	assert(cache->refcnt < 100000);
+
+	ast_mutex_lock(&vgsm.sim_caches_list_lock);
+	int refcnt = --cache->refcnt;
+	if (!refcnt)
+		list_del(&cache->node);
+	ast_mutex_unlock(&vgsm.sim_caches_list_lock);
+
+	if (!refcnt) {
+		if (cache->dirty)
+			vgsm_sim_cache_save(cache);
+
+		vgsm_sim_cache_flush(cache);
+		ast_mutex_destroy(&cache->lock);
+		free(cache);
+	}
+}
+
+struct vgsm_sim_cache *vgsm_sim_cache_get_by_card_id(const char *card_id)
+{
+	struct vgsm_sim_cache *cache, *new_cache;
+
+	ast_mutex_lock(&vgsm.sim_caches_list_lock);
+	list_for_each_entry(cache, &vgsm.sim_caches_list, node) {
+		if (!strcmp(cache->card_id, card_id)) {
+			cache->refcnt++;
+			ast_mutex_unlock(&vgsm.sim_caches_list_lock);
+			return cache;
+		}
+	}
+	ast_mutex_unlock(&vgsm.sim_caches_list_lock);
+
+	new_cache = malloc(sizeof(*new_cache));
+	if (!new_cache)
+		return NULL;
+
+	memset(new_cache, 0, sizeof(*new_cache));
+
+	new_cache->refcnt = 1;
+	ast_mutex_init(&new_cache->lock);
+	INIT_LIST_HEAD(&new_cache->entries);
+	strncpy(new_cache->card_id, card_id, sizeof(new_cache->card_id) - 1);
+
+	vgsm_sim_cache_load(new_cache);
+
+	ast_mutex_lock(&vgsm.sim_caches_list_lock);
+	list_for_each_entry(cache, &vgsm.sim_caches_list, node) {
+		if (!strcmp(cache->card_id, card_id)) {
+			cache->refcnt++;
+			ast_mutex_unlock(&vgsm.sim_caches_list_lock);
+
+			vgsm_sim_cache_flush(new_cache);
+			ast_mutex_destroy(&new_cache->lock);
+			free(new_cache);
+
+			return cache;
+		}
+	}
+	list_add_tail(&new_cache->node, &vgsm.sim_caches_list);
+	ast_mutex_unlock(&vgsm.sim_caches_list_lock);
+
+	return new_cache;
+}
+
+/* Called when the SIM reports its files may have changed (REFRESH) */
+void vgsm_sim_cache_invalidate(struct vgsm_sim_cache *cache)
+{
+	char filename[PATH_MAX];
+
+	ast_mutex_lock(&cache->lock);
+	vgsm_sim_cache_flush(cache);
+	cache->imsi[0] = '\0';
+	cache->dirty = FALSE;
+	ast_mutex_unlock(&cache->lock);
+
+	if (vgsm_sim_cache_filename(cache, filename, sizeof(filename)) >= 0)
+		unlink(filename);
+}
+
+/* Copies a cached file content without touching the SIM. Returns the
+ * number of bytes copied or -ENOENT if the file has not been read yet.
+ */
+int vgsm_sim_cache_read(
+	struct vgsm_sim_cache *cache,
+	__u16 file_id,
+	void *data, int max_len)
+{
+	struct vgsm_sim_cache_entry *entry;
+	int len;
+
+	ast_mutex_lock(&cache->lock);
+
+	entry = vgsm_sim_cache_lookup(cache, file_id);
+	if (!entry || !entry->have_data) {
+		ast_mutex_unlock(&cache->lock);
+		return -ENOENT;
+	}
+
+	len = min((int)entry->length, max_len);
+	memcpy(data, entry->data, len);
+
+	ast_mutex_unlock(&cache->lock);
+
+	return len;
+}
+
+/* The IMSI is bound to the card too, it is kept along with its files */
+int vgsm_sim_cache_get_imsi(
+	struct vgsm_sim_cache *cache,
+	char *imsi, int imsi_size)
+{
+	int err = -ENOENT;
+
+	ast_mutex_lock(&cache->lock);
+	if (cache->imsi[0]) {
+		strncpy(imsi, cache->imsi, imsi_size);
+		err = 0;
+	}
+	ast_mutex_unlock(&cache->lock);
+
+	return err;
+}
+
+void vgsm_sim_cache_set_imsi(
+	struct vgsm_sim_cache *cache,
+	const char *imsi)
+{
+	ast_mutex_lock(&cache->lock);
+	if (strcmp(cache->imsi, imsi)) {
+		strncpy(cache->imsi, imsi, sizeof(cache->imsi) - 1);
+		cache->dirty = TRUE;
+	}
+	ast_mutex_unlock(&cache->lock);
+}
+
+/*---------------------------------------------------------------------------*/
+
+struct vgsm_sim_file *vgsm_sim_file_alloc(
+	struct vgsm_sim *sim,
+	struct vgsm_sim_cache *cache)
 {
 	struct vgsm_sim_file *sim_file;
 
@@ -101,7 +671,12 @@ struct vgsm_sim_file *vgsm_sim_file_alloc(struct vgsm_sim *sim)
 	memset(sim_file, 0, sizeof(*sim_file));
 
 	sim_file->refcnt = 1;
-	sim_file->sim = vgsm_sim_get(sim);
+
+	if (sim)
+		sim_file->sim = vgsm_sim_get(sim);
+
+	if (cache)
+		sim_file->cache = vgsm_sim_cache_get(cache);
 
 	return sim_file;
 }
@@ -131,7 +706,11 @@ void _vgsm_sim_file_put(struct vgsm_sim_file *sim_file)
 	ast_mutex_unlock(&vgsm.usecnt_lock);
 
 	if (!refcnt) {
-		vgsm_sim_put(sim_file->sim);
+		if (sim_file->sim)
+			vgsm_sim_put(sim_file->sim);
+
+		if (sim_file->cache)
+			vgsm_sim_cache_put(sim_file->cache);
 
 		free(sim_file);
 	}
@@ -142,92 +721,145 @@ int vgsm_sim_file_open(
 	struct vgsm_sim_file *sim_file,
 	__u16 file_id)
 {
+	struct vgsm_sim_cache *cache = sim_file->cache;
 	int err;
 
-	struct vgsm_req *req;
-	req = vgsm_req_make_wait(comm, 5 * SEC,
-				"AT+CRSM=192,%d", file_id);
-	if (vgsm_req_status(req) != VGSM_RESP_OK) {
-		vgsm_req_put(req);
-		err = -EIO;
-		goto err_req_make;
-	}
-
 	sim_file->id = file_id;
 
-	const char *line = vgsm_req_first_line(req)->text;
-	const char *pars_ptr = line + strlen("+CRSM: ");
-	char field[512];
-
-	if (!get_token(&pars_ptr, field, sizeof(field))) {
-		ast_log(LOG_ERROR, "Cannot parse CRSM sw1 '%s'\n", line);
-		vgsm_req_put(req);
-		err = -EINVAL;
-		goto err_parse_response;
+	if (cache) {
+		struct vgsm_sim_cache_entry *entry;
+
+		ast_mutex_lock(&cache->lock);
+		entry = vgsm_sim_cache_lookup(cache, file_id);
+		if (entry) {
+			sim_file->type = entry->type;
+			sim_file->structure = entry->structure;
+			sim_file->record_length = entry->record_length;
+			sim_file->length = entry->length;
+			cache->hits++;
+			ast_mutex_unlock(&cache->lock);
+
+			return 0;
+		}
+		cache->misses++;
+		ast_mutex_unlock(&cache->lock);
 	}
 
-	int sw1 = atoi(field);
+	__u8 buf[sizeof(struct vgsm_sim_file_stats)];
+	memset(buf, 0, sizeof(buf));
 
-	if (!get_token(&pars_ptr, field, sizeof(field))) {
-		ast_log(LOG_ERROR, "Cannot parse CRSM sw2 '%s'\n", line);
-		vgsm_req_put(req);
-		err = -EINVAL;
-		goto err_parse_response;
-	}
+	err = vgsm_sim_crsm(comm, VGSM_SIM_CRSM_GET_RESPONSE, file_id,
+				0, 0, 0, buf, sizeof(buf));
+	if (err < 0)
+		goto err_crsm;
 
-	//int sw2 = atoi(field);
+	struct vgsm_sim_file_stats *stats = (struct vgsm_sim_file_stats *)buf;
 
-	if (!get_token(&pars_ptr, field, sizeof(field))) {
-		ast_log(LOG_ERROR, "Cannot parse CRSM response '%s'\n", line);
-		vgsm_req_put(req);
+	if (err <= offsetof(struct vgsm_sim_file_stats, type_of_file)) {
+		ast_log(LOG_ERROR, "SIM file %04x header too short\n",
+			file_id);
 		err = -EINVAL;
-		goto err_parse_response;
+		goto err_too_short;
 	}
 
-	if (sw1 != 0x90) {
-		vgsm_req_put(req);
-		err = -EIO;
-		goto err_read_failed;
+	if (sim_file->id != ntohs(stats->file_id))
+		ast_log(LOG_WARNING, "SIM file ID differs from requested\n");
+
+	sim_file->length = ntohs(stats->length);
+	sim_file->type = stats->type_of_file;
+
+	if (sim_file->type == VGSM_SIM_TOF_EF) {
+		sim_file->structure = stats->ef_structure;
+		sim_file->record_length = stats->ef_record_length;
 	}
 
-	if (strlen(field) % 2) {
-		ast_log(LOG_ERROR, "Invalid CRSM response '%s'\n", field);
-		vgsm_req_put(req);
-		err = -EIO;
-		goto err_response_invalid;
+	if (cache) {
+		struct vgsm_sim_cache_entry *entry;
+
+		entry = vgsm_sim_cache_entry_alloc(file_id,
+				sim_file->type == VGSM_SIM_TOF_EF ?
+					sim_file->length : 0);
+		if (!entry)
+			return 0;
+
+		entry->type = sim_file->type;
+		entry->structure = sim_file->structure;
+		entry->record_length = sim_file->record_length;
+		entry->length = sim_file->length;
+
+		ast_mutex_lock(&cache->lock);
+		if (vgsm_sim_cache_lookup(cache, file_id)) {
+			free(entry);
+		} else {
+			list_add_tail(&entry->node, &cache->entries);
+			cache->nentries++;
+			cache->dirty = TRUE;
+		}
+		ast_mutex_unlock(&cache->lock);
 	}
 
-	char buf[sizeof(field)/2];
-	int buf_len = strlen(field) / 2;
+	return 0;
+
+err_too_short:
+err_crsm:
 
-	int i;
-	for(i=0; i<buf_len; i++) {
-		buf[i] = char_to_hexdigit(field[i * 2]) << 4 |
-		         char_to_hexdigit(field[i * 2 + 1]);
+	return err;
+}
+
+/* With a cache attached the whole file is read at once and kept, so that
+ * subsequent reads (and restarts) do not touch the SIM anymore.
+ * data may be NULL to just fill the cache.
+ */
+static int vgsm_sim_file_read_cached(
+	struct vgsm_comm *comm,
+	struct vgsm_sim_file *sim_file,
+	void *data, __u16 offset, __u16 len)
+{
+	struct vgsm_sim_cache *cache = sim_file->cache;
+	struct vgsm_sim_cache_entry *entry;
+	int err;
+
+	ast_mutex_lock(&cache->lock);
+	entry = vgsm_sim_cache_lookup(cache, sim_file->id);
+	if (entry && entry->have_data && entry->length == sim_file->length) {
+		if (data)
+			memcpy(data, entry->data + offset, len);
+		ast_mutex_unlock(&cache->lock);
+
+		return 0;
 	}
+	ast_mutex_unlock(&cache->lock);
 
-#if 0
-	ast_verbose("  Status = %d\n", sw1);
-	ast_verbose("  Status2 = %d\n", sw2);
-	ast_verbose("  Response = %s\n", field);
-#endif
+	/* The SIM I/O is done without holding the cache lock */
+	__u8 *buf = malloc(sim_file->length);
+	if (!buf) {
+		err = -ENOMEM;
+		goto err_malloc;
+	}
 
-	struct vgsm_sim_file_stats *stats = (struct vgsm_sim_file_stats *)buf;
+	err = vgsm_sim_file_fetch(comm, sim_file, buf);
+	if (err < 0)
+		goto err_fetch;
 
-	if (sim_file->id != ntohs(stats->file_id))
-		ast_log(LOG_WARNING, "SIM file ID differs from requested\n");
+	ast_mutex_lock(&cache->lock);
+	entry = vgsm_sim_cache_lookup(cache, sim_file->id);
+	if (entry && entry->length == sim_file->length) {
+		memcpy(entry->data, buf, sim_file->length);
+		entry->have_data = TRUE;
+		cache->dirty = TRUE;
+	}
+	ast_mutex_unlock(&cache->lock);
 
-	sim_file->length = ntohs(stats->length);
-	sim_file->type = stats->type_of_file;
+	if (data)
+		memcpy(data, buf + offset, len);
 
-	vgsm_req_put(req);
+	free(buf);
 
 	return 0;
 
-err_response_invalid:
-err_read_failed:
-err_parse_response:
-err_req_make:
+err_fetch:
+	free(buf);
+err_malloc:
 
 	return err;
 }
@@ -235,86 +867,86 @@ err_req_make:
 int vgsm_sim_file_read(
 	struct vgsm_comm *comm,
 	struct vgsm_sim_file *sim_file,
-	void *data, __u16 offset, __u8 len)
+	void *data, __u16 offset, __u16 len)
 {
 	int err;
 
-	struct vgsm_req *req;
-	req = vgsm_req_make_wait(comm, 5 * SEC,
-				"AT+CRSM=176,%d,%d,%d,%d",
-				sim_file->id,
-				offset & 0xff00 >> 8,
-				offset & 0x00ff,
-				len);
-	if (vgsm_req_status(req) != VGSM_RESP_OK) {
-		vgsm_req_put(req);
-		err = -EIO;
-		goto err_req_make;
-	}
+	if (offset + len > sim_file->length)
+		return -EINVAL;
 
-	const char *line = vgsm_req_first_line(req)->text;
-	const char *pars_ptr = line + strlen("+CRSM: ");
+	if (sim_file->cache)
+		return vgsm_sim_file_read_cached(comm, sim_file,
+						data, offset, len);
 
-	int field_len = max(32, 32 + len * 2);
-	char *field = alloca(field_len);
+	if (sim_file->structure != VGSM_SIM_EF_TRANSPARENT) {
+		__u8 *buf = alloca(sim_file->length);
 
-	if (!get_token(&pars_ptr, field, field_len)) {
-		ast_log(LOG_ERROR, "Cannot parse CRSM sw1 '%s'\n", line);
-		vgsm_req_put(req);
-		err = -EINVAL;
-		goto err_parse_response;
-	}
+		err = vgsm_sim_file_fetch(comm, sim_file, buf);
+		if (err < 0)
+			return err;
 
-	int sw1 = atoi(field);
+		memcpy(data, buf + offset, len);
 
-	if (!get_token(&pars_ptr, field, field_len)) {
-		ast_log(LOG_ERROR, "Cannot parse CRSM sw2 '%s'\n", line);
-		vgsm_req_put(req);
-		err = -EINVAL;
-		goto err_parse_response;
+		return 0;
 	}
 
-	//int sw2 = atoi(field);
-
-	if (!get_token(&pars_ptr, field, field_len)) {
-		ast_log(LOG_ERROR, "Cannot parse CRSM response '%s'\n", line);
-		vgsm_req_put(req);
-		err = -EINVAL;
-		goto err_parse_response;
-	}
+	int pos;
+	for(pos=0; pos<len; pos += err) {
+		int chunk = min(len - pos, VGSM_SIM_CRSM_MAX_LEN);
 
-	if (strlen(field) % 2) {
-		ast_log(LOG_ERROR, "CRSM response '%s' invalid\n", line);
-		vgsm_req_put(req);
-		err = -EINVAL;
-		goto err_parse_response;
+		err = vgsm_sim_crsm(comm, VGSM_SIM_CRSM_READ_BINARY,
+				sim_file->id,
+				((offset + pos) >> 8) & 0xff,
+				(offset + pos) & 0xff,
+				chunk,
+				(__u8 *)data + pos, chunk);
+		if (err < 0)
+			return err;
+
+		if (err != chunk)
+			return -EIO;
 	}
 
-	if (sw1 != 0x90) {
-		vgsm_req_put(req);
-		err = -EIO;
-		goto err_read_failed;
-	}
+	return 0;
+}
 
+/* Reads the listed elementary files in the cache, so that they are
+ * available without SIM I/O later and after a restart with the same card.
+ */
+int vgsm_sim_cache_prefetch(
+	struct vgsm_comm *comm,
+	struct vgsm_sim_cache *cache,
+	const __u16 *file_ids,
+	int nfile_ids)
+{
+	int err;
 	int i;
-	for(i=0; i<len; i++) {
-		((__u8 *)data)[i] = char_to_hexdigit(field[i * 2]) << 4 |
-		    		     char_to_hexdigit(field[i * 2 + 1]);
-	}
 
-	vgsm_req_put(req);
+	for(i=0; i<nfile_ids; i++) {
+		struct vgsm_sim_file *sim_file;
 
-#if 0
-	ast_verbose("  Status = %d\n", sw1);
-	ast_verbose("  Status2 = %d\n", sw2);
-	ast_verbose("  Response = %s\n", field);
-#endif
+		sim_file = vgsm_sim_file_alloc(NULL, cache);
+		if (!sim_file) {
+			err = -ENOMEM;
+			goto err_file_alloc;
+		}
+
+		/* Missing files are fine, not every SIM has all of them */
+		if (vgsm_sim_file_open(comm, sim_file, file_ids[i]) >= 0 &&
+		    sim_file->type == VGSM_SIM_TOF_EF &&
+		    sim_file->length)
+			vgsm_sim_file_read_cached(comm, sim_file,
+					NULL, 0, sim_file->length);
+
+		vgsm_sim_file_put(sim_file);
+	}
+
+	if (cache->dirty)
+		vgsm_sim_cache_save(cache);
 
 	return 0;
 
-err_read_failed:
-err_parse_response:
-err_req_make:
+err_file_alloc:
 
 	return err;
 }
@@ -13,6 +13,12 @@
 #ifndef _VGSM_SIM_FILE_H
 #define _VGSM_SIM_FILE_H
 
+#include <list.h>
+
+#include <asterisk/lock.h>
+
+#include "util.h"
+
 enum vgsm_sim_type_of_file
 {
 	VGSM_SIM_TOF_RFU	= 0x00,
@@ -21,6 +27,13 @@ enum vgsm_sim_type_of_file
 	VGSM_SIM_TOF_EF		= 0x04,
 };
 
+enum vgsm_sim_ef_structure
+{
+	VGSM_SIM_EF_TRANSPARENT		= 0x00,
+	VGSM_SIM_EF_LINEAR_FIXED	= 0x01,
+	VGSM_SIM_EF_CYCLIC		= 0x03,
+};
+
 enum vgsm_sim_dcs_language
 {
 	VGSM_SIM_DCS_LANG_GERMAN	= 0x0,
@@ -62,6 +75,10 @@ struct vgsm_sim_file_stats {
 	__u8 chv2_status;
 	__u8 unblock_chv2_status;
 	};
+	struct {
+	__u8 ef_structure;
+	__u8 ef_record_length;
+	};
 	};
 } __attribute__ ((__packed__));
 
@@ -74,11 +91,77 @@ struct vgsm_sim_file
 	__u16 id;
 
 	enum vgsm_sim_type_of_file type;
+	enum vgsm_sim_ef_structure structure;
+	__u8 record_length;
+
+	__u16 length;
+
+	struct vgsm_sim_cache *cache;
+};
+
+/* Elementary files of a single SIM card, keyed by ICCID and persisted in
+ * vgsm.sim_cache_dir. Entries hold the GET RESPONSE header and, once read,
+ * the whole file content.
+ */
+struct vgsm_sim_cache_entry
+{
+	struct list_head node;
+
+	__u16 id;
+	enum vgsm_sim_type_of_file type;
+	enum vgsm_sim_ef_structure structure;
+	__u8 record_length;
+	__u16 length;
 
-	__u8 length;
+	BOOL have_data;
+	__u8 data[];
 };
 
-struct vgsm_sim_file *vgsm_sim_file_alloc(struct vgsm_sim *sim);
+struct vgsm_sim_cache
+{
+	struct list_head node;
+	int refcnt;
+
+	ast_mutex_t lock;
+
+	char card_id[32];
+	char imsi[32];
+
+	struct list_head entries;
+	int nentries;
+	BOOL dirty;
+
+	int hits;
+	int misses;
+};
+
+struct vgsm_sim_cache *vgsm_sim_cache_get_by_card_id(const char *card_id);
+struct vgsm_sim_cache *vgsm_sim_cache_get(struct vgsm_sim_cache *cache);
+void _vgsm_sim_cache_put(struct vgsm_sim_cache *cache);
+#define vgsm_sim_cache_put(cache) \
+	do { _vgsm_sim_cache_put(cache); (cache) = NULL; } while(0)
+
+void vgsm_sim_cache_invalidate(struct vgsm_sim_cache *cache);
+int vgsm_sim_cache_save(struct vgsm_sim_cache *cache);
+int vgsm_sim_cache_read(
+	struct vgsm_sim_cache *cache,
+	__u16 file_id,
+	void *data, int max_len);
+int vgsm_sim_cache_get_imsi(
+	struct vgsm_sim_cache *cache,
+	char *imsi, int imsi_size);
+void vgsm_sim_cache_set_imsi(
+	struct vgsm_sim_cache *cache,
+	const char *imsi);
+int vgsm_sim_cache_prefetch(
+	struct vgsm_comm *comm,
+	struct vgsm_sim_cache *cache,
+	const __u16 *file_ids,
+	int nfile_ids);
+
+struct vgsm_sim_file *vgsm_sim_file_alloc(
+	struct vgsm_sim *sim,
+	struct vgsm_sim_cache *cache);
 struct vgsm_sim_file *vgsm_sim_file_get(struct vgsm_sim_file *sim_file);
 void _vgsm_sim_file_put(struct vgsm_sim_file *sim_file);
 #define vgsm_sim_file_put(sim_file) \
@@ -91,7 +174,7 @@ int vgsm_sim_file_open(
 int vgsm_sim_file_read(
 	struct vgsm_comm *comm,
 	struct vgsm_sim_file *sim_file,
-	void *data, __u16 offset, __u8 len);
+	void *data, __u16 offset, __u16 len);
 void vgsm_sim_file_stats_dump(struct vgsm_sim_file *sim_file);
 
 const char *vgsm_sim_language_to_text(enum vgsm_sim_dcs_language value);
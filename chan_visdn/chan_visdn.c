@@ -23,6 +23,8 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
 
 #include <asm/types.h>
 #include <linux/netlink.h>
@@ -65,6 +67,7 @@
 #include <asterisk/musiconhold.h>
 #include <asterisk/causes.h>
 #include <asterisk/dsp.h>
+#include <asterisk/alaw.h>
 
 
 #include <linux/lapd.h>
@@ -72,6 +75,7 @@
 
 #include <linux/kstreamer/hdlc_framer.h>
 #include <linux/kstreamer/octet_reverser.h>
+#include <linux/kstreamer/dtmf_detector.h>
 
 /* FUCK YOU ASTERSISK */
 #undef pthread_mutex_t
@@ -101,6 +105,7 @@
 #include <libq931/ces.h>
 #include <libq931/ccb.h>
 #include <libq931/input.h>
+#include <libq931/trace.h>
 
 #include <libq931/ie.h>
 #include <libq931/ie_bearer_capability.h>
@@ -221,6 +226,7 @@ static struct visdn_chan *visdn_chan_alloc(void)
 	ast_cond_init(&visdn_chan->refcnt_decremented_cond, NULL);
 
 	visdn_chan->up_fd = -1;
+	visdn_chan->last_tx_sample = AST_LIN2A(0);
 
 	visdn_chan->dsp = ast_dsp_new();
 	if (!visdn_chan->dsp)
@@ -461,6 +467,11 @@ void refresh_polls_list(void)
 	visdn.poll_infos[visdn.npolls].type = POLL_INFO_TYPE_NETLINK;
 	visdn.npolls++;
 
+	visdn.polls[visdn.npolls].fd = visdn.timer_fd;
+	visdn.polls[visdn.npolls].events = POLLIN | POLLERR;
+	visdn.poll_infos[visdn.npolls].type = POLL_INFO_TYPE_TIMER;
+	visdn.npolls++;
+
 	struct visdn_intf *intf;
 	ast_rwlock_rdlock(&visdn.intfs_list_lock);
 	list_for_each_entry(intf, &visdn.intfs_list, node) {
@@ -1556,166 +1567,676 @@ static int visdn_answer(struct ast_channel *ast_chan)
 	return 0;
 }
 
-static int visdn_bridge(
-	struct ast_channel *c0,
-	struct ast_channel *c1,
-	int flags, struct ast_frame **fo,
-	struct ast_channel **rc,
-	int timeoutms)
+static int visdn_pipeline_set_octet_reverser(
+	struct ks_pipeline *pipeline,
+	BOOL enabled)
 {
-	return AST_BRIDGE_FAILED_NOWARN;
+	/* TODO: Do this only once */
+	struct ks_feature *octet_reverser_attr;
 
-#if 0
-	/* if need DTMF, cant native bridge (at least not yet...) */
-	if (flags & (AST_BRIDGE_DTMF_CHANNEL_0 | AST_BRIDGE_DTMF_CHANNEL_1))
-		return AST_BRIDGE_FAILED;
+	octet_reverser_attr = ks_feature_get_by_name(ks_conn, "octet_reverser");
+	if (!octet_reverser_attr) {
+		ast_log(LOG_ERROR,
+			"Cannot find octet reverser attr\n");
+		goto err_missing_octet_reverser;
+	}
+
+	struct ks_octet_reverser_descr *octet_reverser = NULL;
 
-	struct visdn_chan *visdn_chan1 = to_visdn_chan(c0);
-	struct visdn_chan *visdn_chan2 = to_visdn_chan(c1);
+	int i;
+	for(i=0; i<pipeline->chans_cnt; i++) {
+		struct ks_chan *chan = pipeline->chans[i];
+		struct ks_feature_value *featval;
+
+		list_for_each_entry(featval, &chan->features, node) {
 
-	char pipeline[100], dest1[100], dest2[100];
+			if (featval->feature == octet_reverser_attr) {
 
-	snprintf(pipeline, sizeof(pipeline),
-		"/sys/class/net/%s/visdn_channel/connected/../B%d",
-		visdn_chan1->q931_call->intf->name,
-		visdn_chan1->q931_call->channel->id+1);
+				struct ks_octet_reverser_descr *descr =
+					(struct ks_octet_reverser_descr *)
+					featval->payload;
 
-	memset(dest1, 0, sizeof(dest1));
-	if (readlink(pipeline, dest1, sizeof(dest1) - 1) < 0) {
-		ast_log(LOG_ERROR, "readlink(%s): %s\n", pipeline, strerror(errno));
-		return AST_BRIDGE_FAILED;
+				if (!octet_reverser || descr->hardware)
+					octet_reverser = descr;
+			}
+		}
 	}
 
-	char *chanid1 = strrchr(dest1, '/');
-	if (!chanid1 || !strlen(chanid1 + 1)) {
+	if (!octet_reverser) {
 		ast_log(LOG_ERROR,
-			"Invalid chanid found in symlink %s\n",
-			dest1);
-		return AST_BRIDGE_FAILED;
+			"Cannot find octet reverser along the pipeline\n");
+		goto err_missing_octet_reverser_in_pipeline;
 	}
 
-	chanid1++;
+	octet_reverser->enabled = enabled;
 
-	snprintf(pipeline, sizeof(pipeline),
-		"/sys/class/net/%s/visdn_channel/connected/../B%d",
-		visdn_chan2->q931_call->intf->name,
-		visdn_chan2->q931_call->channel->id+1);
+	return 0;
 
-	memset(dest2, 0, sizeof(dest2));
-	if (readlink(pipeline, dest2, sizeof(dest2) - 1) < 0) {
-		ast_log(LOG_ERROR, "readlink(%s): %s\n", pipeline, strerror(errno));
-		return AST_BRIDGE_FAILED;
+err_missing_octet_reverser_in_pipeline:
+err_missing_octet_reverser:
+
+	return -1;
+}
+
+
+static int visdn_pipeline_start_complete(struct ks_req *req)
+{
+	struct ks_pipeline *pipeline = req->response_data;
+
+	if (req->err < 0) {
+		ast_log(LOG_ERROR,
+			"Cannot start pipeline %06d: %s\n",
+			pipeline->id, strerror(-req->err));
+
+		/* visdn_pipeline_route() marked it FLOWING optimistically;
+		 * the kernel did not get there, so do not let a later
+		 * update or dump believe it did. Any further update moves
+		 * the kernel's pipeline from wherever it stopped.
+		 */
+		pipeline->status = KS_PIPELINE_STATUS_CONNECTED;
 	}
 
-	char *chanid2 = strrchr(dest2, '/');
-	if (!chanid2 || !strlen(chanid2 + 1)) {
+	ks_pipeline_put(pipeline);
+
+	return 0;
+}
+
+/* Allocates a pipeline routed between two nodes and starts it, enabling
+ * the octet reverser along the way if requested. We do not wait for the
+ * pipeline to be flowing: its status reads FLOWING until the kernel's
+ * answer arrives, and a failure to start it is logged and the status
+ * put back to CONNECTED by visdn_pipeline_start_complete().
+ */
+static struct ks_pipeline *visdn_pipeline_route(
+	struct ks_node *from,
+	struct ks_node *to,
+	BOOL octet_reverse)
+{
+	struct ks_pipeline *pipeline;
+	int err;
+
+	pipeline = ks_pipeline_alloc();
+	if (!pipeline) {
 		ast_log(LOG_ERROR,
-			"Invalid chanid found in symlink %s\n",
-			dest2);
-		return AST_BRIDGE_FAILED;
+			"Cannot allocate pipeline\n");
+		goto err_pipeline_alloc;
 	}
 
-	chanid2++;
+	err = ks_conn_remote_topology_lock(ks_conn);
+	if (err < 0) {
+		ast_log(LOG_ERROR,
+			"Cannot lock kstreamer topology: %s\n", strerror(-err));
+		goto err_kstreamer_lock;
+	}
 
-	visdn_debug("Connecting chan %s to chan %s\n", chanid1, chanid2);
+	err = ks_pipeline_autoroute(pipeline, ks_conn, from, to);
+	if (err < 0) {
+		ast_log(LOG_ERROR,
+			"Cannot connect nodes %06d and %06d: %s\n",
+			from->id, to->id, strerror(-err));
+		goto err_pipeline_connect;
+	}
 
-	int fd = open("/sys/visdn_tdm/internal-cxc/connect", O_WRONLY);
-	if (fd < 0) {
+	err = ks_pipeline_create(pipeline, ks_conn);
+	if (err < 0) {
 		ast_log(LOG_ERROR,
-			"Cannot open /sys/visdn_tdm/internal-cxc/connect: %s\n",
-			strerror(errno));
-		return AST_BRIDGE_FAILED;
+			"Cannot create pipeline: %s\n",
+			strerror(-err));
+		goto err_pipeline_create;
 	}
 
-	if (ioctl(visdn_chan1->up_fd,
-			VISDN_IOC_DISCONNECT, NULL) < 0) {
+	err = ks_conn_remote_topology_unlock(ks_conn);
+	if (err < 0) {
 		ast_log(LOG_ERROR,
-			"ioctl(VISDN_IOC_DISCONNECT): %s\n",
-			strerror(errno));
+			"Error unlocking kstreamer's topology\n");
 	}
 
-	close(visdn_chan1->up_fd);
-	visdn_chan1->up_fd = -1;
+	if (octet_reverse) {
+		err = visdn_pipeline_set_octet_reverser(pipeline, TRUE);
+		if (err < 0) {
+			ast_log(LOG_ERROR,
+				"Cannot enable octet reverser\n");
+			goto err_pipeline_octet_reverser_enable;
+		}
 
-	if (ioctl(visdn_chan2->up_fd,
-			VISDN_IOC_DISCONNECT, NULL) < 0) {
+		err = ks_pipeline_update_chans(pipeline, ks_conn);
+		if (err < 0) {
+			ast_log(LOG_ERROR,
+				"Cannot update pipeline's channels\n");
+			goto err_pipeline_update_chans;
+		}
+	}
+
+	pipeline->status = KS_PIPELINE_STATUS_FLOWING;
+
+	struct ks_req *req;
+	req = ks_pipeline_update_async(pipeline, ks_conn,
+			visdn_pipeline_start_complete,
+			ks_pipeline_get(pipeline));
+	if (!req) {
 		ast_log(LOG_ERROR,
-			"ioctl(VISDN_IOC_DISCONNECT): %s\n",
-			strerror(errno));
+			"Cannot start pipeline\n");
+		ks_pipeline_put(pipeline);
+		goto err_pipeline_update;
 	}
 
-	close(visdn_chan2->up_fd);
-	visdn_chan2->up_fd = -1;
+	ks_req_put(req);
 
-	char command[256];
-	snprintf(command, sizeof(command),
-		"%s\n%s\n",
-		chanid1,
-		chanid2);
+	return pipeline;
 
-	if (write(fd, command, strlen(command)) < 0) {
+err_pipeline_update:
+err_pipeline_update_chans:
+err_pipeline_octet_reverser_enable:
+	ks_pipeline_destroy(pipeline, ks_conn);
+	ks_pipeline_put(pipeline);
+
+	return NULL;
+
+err_pipeline_create:
+err_pipeline_connect:
+	ks_conn_remote_topology_unlock(ks_conn);
+err_kstreamer_lock:
+	ks_pipeline_put(pipeline);
+err_pipeline_alloc:
+
+	return NULL;
+}
+
+static void visdn_pipeline_unroute(struct ks_pipeline **pipeline)
+{
+	if (!*pipeline)
+		return;
+
+	/* Nobody would look at the result anyway */
+	ks_pipeline_destroy_noack(*pipeline, ks_conn);
+	ks_pipeline_put(*pipeline);
+	*pipeline = NULL;
+}
+
+/* Connects the bearer channel to the userport, in both directions */
+static int visdn_chan_connect_userport(struct visdn_chan *visdn_chan)
+{
+	visdn_chan->pipeline_rx = visdn_pipeline_route(
+					visdn_chan->node_bearer,
+					visdn_chan->node_userport,
+					TRUE);
+	if (!visdn_chan->pipeline_rx) {
 		ast_log(LOG_ERROR,
-			"Cannot write to /sys/: %s\n",
-			strerror(errno));
+			"Cannot start RX pipeline\n");
+		goto err_pipeline_rx;
+	}
 
-		close(fd);
+	visdn_chan->pipeline_tx = visdn_pipeline_route(
+					visdn_chan->node_userport,
+					visdn_chan->node_bearer,
+					TRUE);
+	if (!visdn_chan->pipeline_tx) {
+		ast_log(LOG_ERROR,
+			"Cannot start TX pipeline\n");
+		goto err_pipeline_tx;
+	}
 
-		return AST_BRIDGE_FAILED;
+	return 0;
+
+	visdn_pipeline_unroute(&visdn_chan->pipeline_tx);
+err_pipeline_tx:
+	visdn_pipeline_unroute(&visdn_chan->pipeline_rx);
+err_pipeline_rx:
+
+	return -1;
+}
+
+static void visdn_chan_disconnect_userport(struct visdn_chan *visdn_chan)
+{
+	visdn_pipeline_unroute(&visdn_chan->pipeline_tone);
+	visdn_pipeline_unroute(&visdn_chan->pipeline_tx);
+	visdn_pipeline_unroute(&visdn_chan->pipeline_rx);
+}
+
+/* Asterisk's indications and the corresponding ks-tonegen nodes */
+static const struct {
+	const char *indication;
+	const char *node;
+} visdn_kernel_tones[] = {
+	{ "dial",	"tone-dial" },
+	{ "busy",	"tone-busy" },
+	{ "congestion",	"tone-congestion" },
+	{ "ring",	"tone-ringback" },
+};
+
+/* Routes a ks-tonegen generator to the bearer in place of the userport. It
+ * fails when the tone is not provided by the kernel, in which case Asterisk
+ * has to generate it.
+ */
+static int visdn_chan_start_kernel_tone(
+	struct visdn_chan *visdn_chan,
+	const char *indication)
+{
+	struct ks_node *node_tone;
+	char path[64];
+	int i;
+
+	if (!visdn_chan->ic->kernel_tones)
+		return -1;
+
+	if (!visdn_chan->pipeline_tx && !visdn_chan->pipeline_tone)
+		return -1;
+
+	for (i=0; i<ARRAY_SIZE(visdn_kernel_tones); i++) {
+		if (!strcmp(visdn_kernel_tones[i].indication, indication))
+			break;
 	}
 
-	close(fd);
+	if (i == ARRAY_SIZE(visdn_kernel_tones))
+		return -1;
+
+	snprintf(path, sizeof(path), "/sys/devices/ks-system/%s",
+		visdn_kernel_tones[i].node);
+
+	node_tone = ks_node_get_by_path(ks_conn, path);
+	if (!node_tone) {
+		visdn_chan_debug(visdn_chan,
+			"Tone node %s not found, is ks-tonegen loaded?\n",
+			path);
+		return -1;
+	}
+
+	visdn_pipeline_unroute(&visdn_chan->pipeline_tone);
+	visdn_pipeline_unroute(&visdn_chan->pipeline_tx);
+
+	visdn_chan->pipeline_tone = visdn_pipeline_route(
+					node_tone,
+					visdn_chan->node_bearer,
+					TRUE);
+
+	ks_node_put(node_tone);
+
+	if (!visdn_chan->pipeline_tone) {
+		ast_log(LOG_WARNING,
+			"Cannot route %s, falling back to Asterisk\n", path);
+
+		visdn_chan->pipeline_tx = visdn_pipeline_route(
+					visdn_chan->node_userport,
+					visdn_chan->node_bearer,
+					TRUE);
+
+		return -1;
+	}
+
+	visdn_chan_debug(visdn_chan, "Playing %s\n", path);
+
+	return 0;
+}
+
+static void visdn_chan_stop_kernel_tone(struct visdn_chan *visdn_chan)
+{
+	if (!visdn_chan->pipeline_tone)
+		return;
+
+	visdn_pipeline_unroute(&visdn_chan->pipeline_tone);
+
+	visdn_chan->pipeline_tx = visdn_pipeline_route(
+					visdn_chan->node_userport,
+					visdn_chan->node_bearer,
+					TRUE);
+	if (!visdn_chan->pipeline_tx)
+		ast_log(LOG_ERROR, "Cannot restart TX pipeline\n");
+}
+
+/* Both channels have to be locked */
+static int visdn_bridge_connect(
+	struct visdn_chan *visdn_chan0,
+	struct visdn_chan *visdn_chan1)
+{
+	visdn_chan_disconnect_userport(visdn_chan0);
+	visdn_chan_disconnect_userport(visdn_chan1);
+
+	visdn_chan0->pipeline_bridge = visdn_pipeline_route(
+					visdn_chan0->node_bearer,
+					visdn_chan1->node_bearer,
+					FALSE);
+	if (!visdn_chan0->pipeline_bridge)
+		goto err_pipeline_bridge0;
+
+	visdn_chan1->pipeline_bridge = visdn_pipeline_route(
+					visdn_chan1->node_bearer,
+					visdn_chan0->node_bearer,
+					FALSE);
+	if (!visdn_chan1->pipeline_bridge)
+		goto err_pipeline_bridge1;
+
+	return 0;
+
+	visdn_pipeline_unroute(&visdn_chan1->pipeline_bridge);
+err_pipeline_bridge1:
+	visdn_pipeline_unroute(&visdn_chan0->pipeline_bridge);
+err_pipeline_bridge0:
+	visdn_chan_connect_userport(visdn_chan1);
+	visdn_chan_connect_userport(visdn_chan0);
+
+	return -1;
+}
+
+/* Both channels have to be locked. A channel whose bearer has been
+ * disconnected in the meantime is left alone.
+ */
+static void visdn_bridge_disconnect(
+	struct visdn_chan *visdn_chan0,
+	struct visdn_chan *visdn_chan1)
+{
+	visdn_pipeline_unroute(&visdn_chan0->pipeline_bridge);
+	visdn_pipeline_unroute(&visdn_chan1->pipeline_bridge);
+
+	if (visdn_chan0->up_fd >= 0)
+		visdn_chan_connect_userport(visdn_chan0);
+
+	if (visdn_chan1->up_fd >= 0)
+		visdn_chan_connect_userport(visdn_chan1);
+}
+
+/* Enables or disables the ks-dtmf detector along the pipeline. It fails when
+ * ks-dtmf is not loaded or the pipeline does not go through the softswitch,
+ * i.e. it is switched by the hardware, where the detector cannot see it.
+ */
+static int visdn_pipeline_set_dtmf_detector(
+	struct ks_pipeline *pipeline,
+	BOOL enabled,
+	BOOL mu_law,
+	int *feature_id)
+{
+	struct ks_feature *dtmf_detector_attr;
+	struct ks_dtmf_detector_descr *dtmf_detector = NULL;
+	int i;
+
+	dtmf_detector_attr = ks_feature_get_by_name(ks_conn, "dtmf_detector");
+	if (!dtmf_detector_attr)
+		goto err_missing_dtmf_detector;
+
+	for(i=0; i<pipeline->chans_cnt && !dtmf_detector; i++) {
+		struct ks_chan *chan = pipeline->chans[i];
+		struct ks_feature_value *featval;
 
+		list_for_each_entry(featval, &chan->features, node) {
+			if (featval->feature == dtmf_detector_attr) {
+				dtmf_detector =
+					(struct ks_dtmf_detector_descr *)
+					featval->payload;
+				break;
+			}
+		}
+	}
+
+	if (!dtmf_detector)
+		goto err_missing_dtmf_detector_in_pipeline;
+
+	/* Bearers carry bit-reversed octets when not going to userports */
+	dtmf_detector->enabled = enabled;
+	dtmf_detector->mu_mode = mu_law;
+	dtmf_detector->reversed = TRUE;
+
+	*feature_id = dtmf_detector_attr->id;
+
+	ks_feature_put(dtmf_detector_attr);
+
+	return 0;
+
+err_missing_dtmf_detector_in_pipeline:
+	ks_feature_put(dtmf_detector_attr);
+err_missing_dtmf_detector:
+
+	return -1;
+}
+
+/* Both channels have to be locked */
+static int visdn_bridge_dtmf_enable(struct visdn_chan *visdn_chan)
+{
+	int err;
+
+	err = visdn_pipeline_set_dtmf_detector(visdn_chan->pipeline_bridge,
+			TRUE,
+			visdn_chan->ast_frame_subclass == AST_FORMAT_ULAW,
+			&visdn_chan->bridge_dtmf_feature_id);
+	if (err < 0)
+		return -1;
+
+	err = ks_pipeline_update_chans(visdn_chan->pipeline_bridge, ks_conn);
+	if (err < 0) {
+		ast_log(LOG_ERROR,
+			"Cannot enable DTMF detector: %s\n", strerror(-err));
+		return -1;
+	}
+
+	visdn_chan->bridge_dtmf_pipeline_id = visdn_chan->pipeline_bridge->id;
+
+	ast_mutex_lock(&visdn.bridges_lock);
+	list_add_tail(&visdn_chan->bridge_dtmf_node, &visdn.bridges_dtmf);
+	visdn_chan->bridge_dtmf = TRUE;
+	ast_mutex_unlock(&visdn.bridges_lock);
+
+	return 0;
+}
+
+/* Both channels have to be locked */
+static void visdn_bridge_dtmf_disable(struct visdn_chan *visdn_chan)
+{
+	int feature_id;
+
+	if (!visdn_chan->bridge_dtmf)
+		return;
+
+	ast_mutex_lock(&visdn.bridges_lock);
+	list_del(&visdn_chan->bridge_dtmf_node);
+	visdn_chan->bridge_dtmf = FALSE;
+	ast_mutex_unlock(&visdn.bridges_lock);
+
+	if (visdn_chan->pipeline_bridge &&
+	    visdn_pipeline_set_dtmf_detector(visdn_chan->pipeline_bridge,
+					FALSE, FALSE, &feature_id) >= 0)
+		ks_pipeline_update_chans(visdn_chan->pipeline_bridge, ks_conn);
+}
+
+/* Called by libkstreamer's protocol thread. Digits detected on a bridge
+ * pipeline are queued to the channel they come from, the bridge then
+ * returns them to Asterisk.
+ */
+static void visdn_dtmf_event(
+	struct ks_conn *conn,
+	struct ks_event *event,
+	void *data)
+{
+	struct ks_dtmf_event *dtmf_event = event->payload;
+	struct visdn_chan *visdn_chan;
+
+	if (event->payload_len < sizeof(*dtmf_event) ||
+	    dtmf_event->type != KS_DTMF_EVENT_END)
+		return;
+
+retry:
+	ast_mutex_lock(&visdn.bridges_lock);
+	list_for_each_entry(visdn_chan, &visdn.bridges_dtmf, bridge_dtmf_node) {
+		if (visdn_chan->bridge_dtmf_feature_id == event->feature_id &&
+		    visdn_chan->bridge_dtmf_pipeline_id == event->pipeline_id) {
+			struct ast_channel *ast_chan = visdn_chan->ast_chan;
+			struct ast_frame f = { AST_FRAME_DTMF,
+						dtmf_event->digit };
+
+			/* The bridge takes bridges_lock with the channel
+			 * locked
+			 */
+			if (ast_mutex_trylock(&ast_chan->lock)) {
+				ast_mutex_unlock(&visdn.bridges_lock);
+				usleep(1);
+				goto retry;
+			}
+
+			visdn_debug("Digit '%c' detected on bridged %s\n",
+				dtmf_event->digit, ast_chan->name);
+
+			ast_queue_frame(ast_chan, &f);
+			visdn.bridges_dtmf_digits++;
+
+			ast_mutex_unlock(&ast_chan->lock);
+
+			break;
+		}
+	}
+	ast_mutex_unlock(&visdn.bridges_lock);
+}
+
+static struct ks_event_handler visdn_dtmf_event_handler =
+{
+	.func = visdn_dtmf_event,
+};
+
+static BOOL visdn_chan_can_native_bridge(struct visdn_chan *visdn_chan)
+{
+	return visdn_chan->ic->native_bridge &&
+		!visdn_chan->is_framed &&
+		visdn_chan->up_fd >= 0 &&
+		visdn_chan->pipeline_rx &&
+		visdn_chan->pipeline_tx;
+}
+
+static void visdn_lock_both(
+	struct ast_channel *c0,
+	struct ast_channel *c1)
+{
+	ast_mutex_lock(&c0->lock);
+	while(ast_mutex_trylock(&c1->lock)) {
+		ast_mutex_unlock(&c0->lock);
+		usleep(1);
+		ast_mutex_lock(&c0->lock);
+	}
+}
+
+/* The B-channels are connected to each other in the kernel, through the
+ * card's switch when possible, and audio does not go through Asterisk
+ * anymore. We only wait for something Asterisk has to handle, then
+ * connect the channels back to their userports.
+ *
+ * When Asterisk wants DTMF the pipelines have to go through the softswitch,
+ * where ks-dtmf detects the digits for us; otherwise the bridge is left to
+ * Asterisk.
+ */
+static int visdn_bridge(
+	struct ast_channel *c0,
+	struct ast_channel *c1,
+	int flags, struct ast_frame **fo,
+	struct ast_channel **rc,
+	int timeoutms)
+{
+	struct visdn_chan *visdn_chan0 = to_visdn_chan(c0);
+	struct visdn_chan *visdn_chan1 = to_visdn_chan(c1);
+	struct ast_channel *who = NULL;
 	struct ast_channel *cs[2];
+	int res;
+
+	visdn_lock_both(c0, c1);
+
+	if (!visdn_chan0 || !visdn_chan1 ||
+	    !visdn_chan_can_native_bridge(visdn_chan0) ||
+	    !visdn_chan_can_native_bridge(visdn_chan1)) {
+		ast_mutex_unlock(&c1->lock);
+		ast_mutex_unlock(&c0->lock);
+
+		return AST_BRIDGE_FAILED_NOWARN;
+	}
+
+	visdn_debug("Native bridging %s (%06d) with %s (%06d)\n",
+		c0->name, visdn_chan0->node_bearer->id,
+		c1->name, visdn_chan1->node_bearer->id);
+
+	if (visdn_bridge_connect(visdn_chan0, visdn_chan1) < 0) {
+		ast_mutex_unlock(&c1->lock);
+		ast_mutex_unlock(&c0->lock);
+
+		return AST_BRIDGE_FAILED;
+	}
+
+	if (((flags & AST_BRIDGE_DTMF_CHANNEL_0) &&
+	     visdn_bridge_dtmf_enable(visdn_chan0) < 0) ||
+	    ((flags & AST_BRIDGE_DTMF_CHANNEL_1) &&
+	     visdn_bridge_dtmf_enable(visdn_chan1) < 0)) {
+
+		visdn_debug("DTMF cannot be detected in the kernel,"
+			" leaving the bridge to Asterisk\n");
+
+		visdn_bridge_dtmf_disable(visdn_chan0);
+		visdn_bridge_dtmf_disable(visdn_chan1);
+		visdn_bridge_disconnect(visdn_chan0, visdn_chan1);
+
+		ast_mutex_unlock(&c1->lock);
+		ast_mutex_unlock(&c0->lock);
+
+		return AST_BRIDGE_FAILED_NOWARN;
+	}
+
+	ast_mutex_unlock(&c1->lock);
+	ast_mutex_unlock(&c0->lock);
+
+	ast_mutex_lock(&visdn.bridges_lock);
+	visdn.bridges_active++;
+	visdn.bridges_total++;
+	ast_mutex_unlock(&visdn.bridges_lock);
+
 	cs[0] = c0;
 	cs[1] = c1;
 
-	struct ast_channel *who = NULL;
 	for (;;) {
-		int to = -1;
+		struct ast_frame *f;
+		int to = timeoutms ? timeoutms : -1;
+
+		if (to_visdn_chan(c0) != visdn_chan0 ||
+		    to_visdn_chan(c1) != visdn_chan1) {
+			/* Masqueraded */
+			res = AST_BRIDGE_RETRY;
+			break;
+		}
+
 		who = ast_waitfor_n(cs, 2, &to);
 		if (!who) {
-			ast_log(LOG_DEBUG, "Ooh, empty read...\n");
+			if (!to) {
+				res = AST_BRIDGE_RETRY;
+				break;
+			}
+
 			continue;
 		}
 
-		struct ast_frame *f;
 		f = ast_read(who);
-		if (!f)
+		if (!f ||
+		    f->frametype == AST_FRAME_CONTROL ||
+		    f->frametype == AST_FRAME_DTMF) {
+			*fo = f;
+			*rc = who;
+			res = AST_BRIDGE_COMPLETE;
 			break;
-
-		if (f->frametype == AST_FRAME_DTMF) {
-			if (((who == c0) && (flags & AST_BRIDGE_DTMF_CHANNEL_0)) ||
-			    ((who == c1) && (flags & AST_BRIDGE_DTMF_CHANNEL_1))) {
-
-				*fo = f;
-				*rc = who;
-
-				// Disconnect channels
-				return AST_BRIDGE_COMPLETE;
-			}
-
-			if (who == c0)
-				ast_write(c1, f);
-			else
-				ast_write(c0, f);
 		}
 
 		ast_frfree(f);
 
-		// Braindead anyone?
+		/* Give both channels a chance */
 		struct ast_channel *t;
 		t = cs[0];
 		cs[0] = cs[1];
 		cs[1] = t;
 	}
 
-	// Really braindead
-	*fo = NULL;
-	*rc = who;
+	visdn_lock_both(c0, c1);
+	visdn_bridge_dtmf_disable(visdn_chan0);
+	visdn_bridge_dtmf_disable(visdn_chan1);
+	visdn_bridge_disconnect(visdn_chan0, visdn_chan1);
+	ast_mutex_unlock(&c1->lock);
+	ast_mutex_unlock(&c0->lock);
 
-#endif
+	ast_mutex_lock(&visdn.bridges_lock);
+	visdn.bridges_active--;
+	ast_mutex_unlock(&visdn.bridges_lock);
+
+	visdn_debug("Native bridge of %s and %s ended\n",
+		c0->name, c1->name);
 
-	return AST_BRIDGE_COMPLETE;
+	return res;
 }
 
 struct ast_frame *visdn_exception(struct ast_channel *ast_chan)
@@ -1745,6 +2266,7 @@ static int visdn_indicate(
 
 	switch(condition) {
 	case -1:
+		visdn_chan_stop_kernel_tone(visdn_chan);
 		ast_playtones_stop(ast_chan);
 	break;
 
@@ -1955,6 +2477,13 @@ static int visdn_indicate(
 	break;
 	}
 
+	if (tone &&
+	    visdn_chan_start_kernel_tone(visdn_chan, tone->name) == 0)
+		return res;
+
+	/* A new indication supersedes the kernel's tone */
+	visdn_chan_stop_kernel_tone(visdn_chan);
+
 	if (tone)
 		ast_playtones_start(ast_chan, 0, tone->data, 1);
 
@@ -2068,12 +2597,52 @@ static int visdn_sendtext(struct ast_channel *ast, const char *text)
 	return -1;
 }
 
+static void visdn_chan_map_up_status(struct visdn_chan *visdn_chan)
+{
+	struct ksup_status *status;
+
+	status = mmap(NULL, getpagesize(), PROT_READ, MAP_SHARED,
+			visdn_chan->up_fd, 0);
+	if (status == MAP_FAILED) {
+		visdn_chan_debug_jitbuf(visdn_chan,
+			"Userport status page not available (%s),"
+			" using ioctl\n",
+			strerror(errno));
+
+		return;
+	}
+
+	if (status->version != KS_UP_STATUS_VERSION) {
+		ast_log(LOG_WARNING,
+			"Userport status page version %d unsupported\n",
+			status->version);
+
+		munmap(status, getpagesize());
+
+		return;
+	}
+
+	visdn_chan->up_status = status;
+}
+
+static void visdn_chan_unmap_up_status(struct visdn_chan *visdn_chan)
+{
+	if (!visdn_chan->up_status)
+		return;
+
+	munmap((void *)visdn_chan->up_status, getpagesize());
+	visdn_chan->up_status = NULL;
+}
+
 static void visdn_disconnect_chan_from_visdn(
 	struct visdn_chan *visdn_chan)
 {
 	if (visdn_chan->up_fd < 0)
 		return;
 
+	/* The bridge will notice the hangup and clean up the rest */
+	visdn_pipeline_unroute(&visdn_chan->pipeline_bridge);
+
 /*	if (visdn_chan->up_bearer_pipeline_id) {
 
 
@@ -2105,6 +2674,8 @@ static void visdn_disconnect_chan_from_visdn(
 	}
 #endif
 
+	visdn_chan_unmap_up_status(visdn_chan);
+
 	if (close(visdn_chan->up_fd) < 0) {
 		ast_log(LOG_ERROR,
 			"close(visdn_chan->up_fd): %s\n",
@@ -2276,6 +2847,95 @@ static int visdn_hangup(struct ast_channel *ast_chan)
 	return 0;
 }
 
+/* Returns the TX FIFO fill level in samples, read from the userport status
+ * page when mapped. The value is aged by the time elapsed since the kernel
+ * sampled it, assuming the FIFO drains at 8000 samples/s.
+ */
+static int visdn_chan_get_tx_pressure(
+	struct visdn_chan *visdn_chan,
+	longtime_t now)
+{
+	const volatile struct ksup_status *status = visdn_chan->up_status;
+	int pressure;
+
+	if (status) {
+		longtime_t stamp;
+		__u32 seq;
+
+		do {
+			seq = status->seq;
+			__sync_synchronize();
+
+			pressure = status->tx_pressure;
+			stamp = status->tx_stamp_sec * SEC +
+				status->tx_stamp_usec;
+
+			__sync_synchronize();
+		} while ((seq & 1) || seq != status->seq);
+
+		visdn_chan->jitbuf_stats.status_page_reads++;
+
+		if (pressure > 0 && now > stamp)
+			pressure -= (now - stamp) / 125;
+	} else {
+		if (ioctl(visdn_chan->up_fd, KS_UP_GET_PRESSURE, &pressure)) {
+			ast_log(LOG_ERROR, "ioctl(): %s\n", strerror(errno));
+			pressure = 0;
+		}
+
+		visdn_chan->jitbuf_stats.ioctl_reads++;
+	}
+
+	return max(pressure, 0);
+}
+
+/* Fills dst with count A-law samples ramping linearly from 'from' to 'to',
+ * so that inserted samples do not produce a click.
+ */
+static void visdn_jitbuf_interpolate(
+	__u8 *dst, int count,
+	__u8 from, __u8 to)
+{
+	int from_lin = AST_ALAW(from);
+	int to_lin = AST_ALAW(to);
+	int i;
+
+	for (i = 0; i < count; i++)
+		dst[i] = AST_LIN2A(from_lin +
+			((to_lin - from_lin) * (i + 1)) / (count + 1));
+}
+
+/* Copies src to dst leaving out 'drop' evenly spaced samples, each dropped
+ * sample is averaged into the preceding one. Returns the new length.
+ */
+static int visdn_jitbuf_shrink(
+	__u8 *dst, const __u8 *src, int len,
+	int drop)
+{
+	int step;
+	int out = 0;
+	int i;
+
+	if (drop >= len)
+		return 0;
+
+	step = len / drop;
+
+	for (i = 0; i < len; i++) {
+		if (drop && out && (i % step) == step - 1) {
+			dst[out - 1] = AST_LIN2A(
+				(AST_ALAW(dst[out - 1]) + AST_ALAW(src[i])) / 2);
+			drop--;
+
+			continue;
+		}
+
+		dst[out++] = src[i];
+	}
+
+	return out;
+}
+
 static struct ast_frame *visdn_read(struct ast_channel *ast_chan)
 {
 	struct visdn_chan *visdn_chan = to_visdn_chan(ast_chan);
@@ -2380,6 +3040,10 @@ static int visdn_write(
 	if (visdn_chan->up_fd < 0)
 		return 0;
 
+	/* While the kernel plays a tone, the frames Asterisk keeps sending
+	 * (usually silence) are dropped, the tone stops on the next
+	 * indication
+	 */
 	if (!visdn_chan->pipeline_tx)
 		return 0;
 
@@ -2394,100 +3058,104 @@ static int visdn_write(
 #endif
 
 	struct visdn_ic *ic = visdn_chan->ic;
+	struct visdn_jitbuf_stats *stats = &visdn_chan->jitbuf_stats;
 
-	int pressure;
-	if (ioctl(visdn_chan->up_fd, KS_UP_GET_PRESSURE, &pressure)) {
-		ast_log(LOG_ERROR, "ioctl(): %s\n", strerror(errno));
-	}
+	longtime_t now = longtime_now();
+
+	int pressure = visdn_chan_get_tx_pressure(visdn_chan, now);
 
 	visdn_chan->pressure_average =
 		((ic->jitbuf_average * visdn_chan->pressure_average) +
 		pressure) / (ic->jitbuf_average + 1);
 
-	longtime_t now = longtime_now();
-	if (now - visdn_chan->last_tx > frame->samples * 125 * 2) {
+	if (!stats->latency_count || pressure < stats->latency_min)
+		stats->latency_min = pressure;
+
+	if (pressure > stats->latency_max)
+		stats->latency_max = pressure;
 
-		int diff = (ic->jitbuf_high + ic->jitbuf_low) / 2;
+	stats->latency_sum += pressure;
+	stats->latency_count++;
 
-		visdn_chan->pressure_average = diff;
+	int insert = 0;
+	int drop = 0;
+
+	if (now - visdn_chan->last_tx > frame->samples * 125 * 2) {
 
-		buf = alloca(len + diff);
+		insert = (ic->jitbuf_high + ic->jitbuf_low) / 2;
 
-		if (frame->subclass == AST_FORMAT_SLINEAR)
-			memset(buf, 0x00, diff);
-		else
-			memset(buf, 0x2a, diff);
+		visdn_chan->pressure_average = insert;
 
-#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >= 10200 && ASTERISK_VERSION_NUM < 10600)
-		memcpy(buf + diff, frame->data, len);
-#else
-		memcpy(buf + diff, frame->data.ptr, len);
-#endif
-		len += diff;
+		stats->late_deliveries++;
+		stats->underruns++;
 
 		visdn_chan_debug_jitbuf(visdn_chan,
 			"TX delivery late (%lld ms), adding %d samples and"
 			" resetting pressure average\n",
 			(now - visdn_chan->last_tx) / 1000,
-			diff);
+			insert);
 
 	} else if (pressure < ic->jitbuf_hardlow) {
-		int diff = (ic->jitbuf_hardlow - pressure);
 
-		buf = alloca(len + diff);
+		insert = ic->jitbuf_hardlow - pressure;
 
-		memset(buf, 0x2a, diff);
-#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >= 10200 && ASTERISK_VERSION_NUM < 10600)
-		memcpy(buf + diff, frame->data, len);
-#else
-		memcpy(buf + diff, frame->data.ptr, len);
-#endif
-		len += diff;
+		stats->underruns++;
 
 		visdn_chan_debug_jitbuf(visdn_chan,
 			"TX under hard low-mark: added %d samples\n",
-			diff);
+			insert);
 
 	} else if (visdn_chan->pressure_average < ic->jitbuf_low &&
 					    pressure < ic->jitbuf_low) {
-		int diff = (ic->jitbuf_low - visdn_chan->pressure_average);
-
-		buf = alloca(len + diff);
 
-		memset(buf, 0x2a, diff);
-#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >= 10200 && ASTERISK_VERSION_NUM < 10600)
-		memcpy(buf + diff, frame->data, len);
-#else
-		memcpy(buf + diff, frame->data.ptr, len);
-#endif
-		len += diff;
+		insert = ic->jitbuf_low - visdn_chan->pressure_average;
 
 		visdn_chan_debug_jitbuf(visdn_chan,
 			"TX under low-mark: added %d samples\n",
-			diff);
+			insert);
+
 	} else if (pressure + len > ic->jitbuf_hardhigh) {
 
-		int drop = min(len, (pressure + len - ic->jitbuf_hardhigh));
+		drop = min(len, (pressure + len - ic->jitbuf_hardhigh));
+
+		stats->overruns++;
 
 		visdn_chan_debug_jitbuf(visdn_chan,
 			"TX %d over hard high-mark: dropped %d samples\n",
 			pressure + len - ic->jitbuf_hardhigh,
 			drop);
 
-		len = max(0, len - drop);
-
 	} else if (visdn_chan->pressure_average > ic->jitbuf_high &&
 					    pressure > ic->jitbuf_high) {
 
-		int drop = min(len, (visdn_chan->pressure_average -
+		drop = min(len, (visdn_chan->pressure_average -
 						ic->jitbuf_high));
 
 		visdn_chan_debug_jitbuf(visdn_chan,
 			"TX %d over high-mark: dropped %d samples\n",
-			visdn_chan->pressure_average > ic->jitbuf_high,
+			visdn_chan->pressure_average - ic->jitbuf_high,
 			drop);
+	}
+
+	if (insert > 0) {
+		__u8 *newbuf = alloca(len + insert);
 
-		len = max(0, len - drop);
+		visdn_jitbuf_interpolate(newbuf, insert,
+				visdn_chan->last_tx_sample, buf[0]);
+		memcpy(newbuf + insert, buf, len);
+
+		buf = newbuf;
+		len += insert;
+
+		stats->inserted_samples += insert;
+
+	} else if (drop > 0) {
+		__u8 *newbuf = alloca(len);
+
+		len = visdn_jitbuf_shrink(newbuf, buf, len, drop);
+		buf = newbuf;
+
+		stats->dropped_samples += drop;
 	}
 
 	struct visdn_intf *intf = visdn_chan->q931_call->intf->pvt;
@@ -2547,8 +3215,11 @@ static int visdn_write(
 	}
 #endif
 
-	if (write(visdn_chan->up_fd, buf, len) < 0) {
-		ast_log(LOG_ERROR, "write(): %s\n", strerror(errno));
+	if (len > 0) {
+		if (write(visdn_chan->up_fd, buf, len) < 0)
+			ast_log(LOG_ERROR, "write(): %s\n", strerror(errno));
+		else
+			visdn_chan->last_tx_sample = buf[len - 1];
 	}
 
 #if 0
@@ -2805,6 +3476,51 @@ static int visdn_mgmt_receive(struct visdn_intf *intf)
 
 static void visdn_q931_ccb_receive(void);
 
+/* The timerfd is only touched when the earliest deadline moves earlier than
+ * the one it is armed to. Later deadlines (e.g. stopped timers) just cause a
+ * spurious wakeup after which it is re-armed.
+ */
+static void visdn_timer_arm(longtime_t expires)
+{
+	ast_mutex_lock(&visdn.timer_lock);
+
+	if (!visdn.timer_armed_at || expires < visdn.timer_armed_at) {
+		struct itimerspec its;
+
+		memset(&its, 0, sizeof(its));
+
+		/* A zero it_value would disarm the timer */
+		if (expires <= 0)
+			expires = 1;
+
+		its.it_value.tv_sec = expires / SEC;
+		its.it_value.tv_nsec = (expires % SEC) * 1000;
+
+		if (timerfd_settime(visdn.timer_fd, TFD_TIMER_ABSTIME,
+							&its, NULL) < 0)
+			ast_log(LOG_WARNING, "timerfd_settime error: %s\n",
+				strerror(errno));
+		else
+			visdn.timer_armed_at = expires;
+	}
+
+	ast_mutex_unlock(&visdn.timer_lock);
+}
+
+static void visdn_timer_receive(void)
+{
+	__u64 expirations;
+
+	if (read(visdn.timer_fd, &expirations, sizeof(expirations)) < 0 &&
+	    errno != EAGAIN)
+		ast_log(LOG_WARNING, "timerfd read error: %s\n",
+			strerror(errno));
+
+	ast_mutex_lock(&visdn.timer_lock);
+	visdn.timer_armed_at = 0;
+	ast_mutex_unlock(&visdn.timer_lock);
+}
+
 static int visdn_q931_thread_do_poll()
 {
 	longtime_t usec_to_wait;
@@ -2812,13 +3528,13 @@ static int visdn_q931_thread_do_poll()
 	usec_to_wait = q931_run_timers();
 	usec_to_wait = visdn_intf_run_timers(usec_to_wait);
 
-	int msec_to_wait = (usec_to_wait < 0) ? -1 :
-				usec_to_wait / 1000 + 1;
+	if (usec_to_wait >= 0)
+		visdn_timer_arm(longtime_now() + usec_to_wait);
 
-	visdn_debug_q931("poll(%d ms)\n", msec_to_wait);
+	visdn_debug_q931("poll(%lld us)\n", usec_to_wait);
 
 	// Uhm... we should lock, copy polls and unlock before poll()
-	if (poll(visdn.polls, visdn.npolls, msec_to_wait) < 0) {
+	if (poll(visdn.polls, visdn.npolls, -1) < 0) {
 		if (errno == EINTR)
 			return TRUE;
 
@@ -2843,6 +3559,14 @@ static int visdn_q931_thread_do_poll()
 					 POLLHUP | POLLNVAL)) {
 				visdn_q931_ccb_receive();
 			}
+		} else if (visdn.poll_infos[i].type ==
+						POLL_INFO_TYPE_TIMER) {
+
+			if (visdn.polls[i].revents &
+					(POLLIN | POLLPRI | POLLERR |
+					 POLLHUP | POLLNVAL))
+				visdn_timer_receive();
+
 		} else if (visdn.poll_infos[i].type ==
 						POLL_INFO_TYPE_CCB_Q931) {
 
@@ -4452,58 +5176,6 @@ err_open:
 }
 #endif
 
-static int visdn_pipeline_set_octet_reverser(
-	struct ks_pipeline *pipeline,
-	BOOL enabled)
-{
-	/* TODO: Do this only once */
-	struct ks_feature *octet_reverser_attr;
-
-	octet_reverser_attr = ks_feature_get_by_name(ks_conn, "octet_reverser");
-	if (!octet_reverser_attr) {
-		ast_log(LOG_ERROR,
-			"Cannot find octet reverser attr\n");
-		goto err_missing_octet_reverser;
-	}
-
-	struct ks_octet_reverser_descr *octet_reverser = NULL;
-
-	int i;
-	for(i=0; i<pipeline->chans_cnt; i++) {
-		struct ks_chan *chan = pipeline->chans[i];
-		struct ks_feature_value *featval;
-
-		list_for_each_entry(featval, &chan->features, node) {
-
-			if (featval->feature == octet_reverser_attr) {
-
-				struct ks_octet_reverser_descr *descr =
-					(struct ks_octet_reverser_descr *)
-					featval->payload;
-
-				if (!octet_reverser || descr->hardware)
-					octet_reverser = descr;
-			}
-		}
-	}
-
-	if (!octet_reverser) {
-		ast_log(LOG_ERROR,
-			"Cannot find octet reverser along the pipeline\n");
-		goto err_missing_octet_reverser_in_pipeline;
-	}
-
-	octet_reverser->enabled = enabled;
-
-	return 0;
-
-err_missing_octet_reverser_in_pipeline:
-err_missing_octet_reverser:
-
-	return -1;
-}
-
-
 static void visdn_q931_connect_channel(
 	struct q931_channel *channel)
 {
@@ -4563,6 +5235,8 @@ static void visdn_q931_connect_channel(
 		goto err_get_up_node_id;
 	}
 
+	visdn_chan_map_up_status(visdn_chan);
+
 	err = ks_conn_remote_topology_lock(ks_conn);
 	if (err < 0) {
 		ast_log(LOG_ERROR,
@@ -4582,119 +5256,20 @@ static void visdn_q931_connect_channel(
 		goto err_up_node_not_found;
 	}
 
-	visdn_chan_debug(visdn_chan,
-			"Connecting userport %06d to chan %06d\n",
-			visdn_chan->node_userport->id,
-			visdn_chan->node_bearer->id);
-
-	/* Create RX pipeline */
-	visdn_chan->pipeline_rx = ks_pipeline_alloc();
-	if (!visdn_chan->pipeline_rx) {
-		ast_log(LOG_ERROR,
-			"Cannot allocate pipeline\n");
-
-		goto err_pipeline_rx_alloc;
-	}
-
-	err = ks_pipeline_autoroute(visdn_chan->pipeline_rx, ks_conn,
-				visdn_chan->node_bearer,
-				visdn_chan->node_userport);
-	if (err < 0) {
-		ast_log(LOG_ERROR,
-			"Cannot connect nodes: %s\n", strerror(-err));
-
-		goto err_pipeline_rx_connect;
-	}
-
-	err = ks_pipeline_create(visdn_chan->pipeline_rx, ks_conn);
-	if (err < 0) {
-		ast_log(LOG_ERROR,
-			"Cannot create RX pipeline: %s\n",
-			strerror(-err));
-		goto err_pipeline_rx_create;
-	}
-
-	err = visdn_pipeline_set_octet_reverser(visdn_chan->pipeline_rx, TRUE);
-	if (err < 0) {
-		ast_log(LOG_ERROR,
-			"Cannot enable RX octet reverser\n");
-		goto err_pipeline_rx_octet_reverser_enable;
-	}
-
-	err = ks_pipeline_update_chans(visdn_chan->pipeline_rx, ks_conn);
-	if (err < 0) {
-		ast_log(LOG_ERROR,
-			"Cannot update pipeline's channels\n");
-		goto err_pipeline_rx_update_chans;
-	}
-
-	/* Create TX pipeline */
-	visdn_chan->pipeline_tx = ks_pipeline_alloc();
-	if (!visdn_chan->pipeline_tx) {
-		ast_log(LOG_ERROR,
-			"Cannot allocate TX pipeline\n");
-
-		goto err_pipeline_tx_alloc;
-	}
-
-	err = ks_pipeline_autoroute(visdn_chan->pipeline_tx, ks_conn,
-				visdn_chan->node_userport,
-				visdn_chan->node_bearer);
-	if (err < 0) {
-		ast_log(LOG_ERROR,
-			"Cannot connect TX pipeline's nodes: %s\n",
-			strerror(-err));
-
-		goto err_pipeline_tx_connect;
-	}
-
-	err = ks_pipeline_create(visdn_chan->pipeline_tx, ks_conn);
-	if (err < 0) {
-		ast_log(LOG_ERROR,
-			"Cannot create pipeline: %s\n",
-			strerror(-err));
-		goto err_pipeline_tx_create;
-	}
-
 	err = ks_conn_remote_topology_unlock(ks_conn);
 	if (err < 0) {
 		ast_log(LOG_ERROR,
 			"Error unlocking kstreamer's topology\n");
 	}
 
-	err = visdn_pipeline_set_octet_reverser(visdn_chan->pipeline_tx, TRUE);
-	if (err < 0) {
-		ast_log(LOG_ERROR,
-			"Cannot enable TX octet reverser\n");
-		goto err_pipeline_tx_octet_reverser_enable;
-	}
-
-	err = ks_pipeline_update_chans(visdn_chan->pipeline_tx, ks_conn);
-	if (err < 0) {
-		ast_log(LOG_ERROR,
-			"Cannot update TX pipeline's channels\n");
-		goto err_pipeline_tx_update_chans;
-	}
-
-	/* Start RX pipelines */
-	visdn_chan->pipeline_rx->status = KS_PIPELINE_STATUS_FLOWING;
-
-	err = ks_pipeline_update(visdn_chan->pipeline_rx, ks_conn);
-	if (err < 0) {
-		ast_log(LOG_ERROR,
-			"Cannot start RX pipeline\n");
-		goto err_pipeline_rx_update;
-	}
-
-	/* Start TX pipelines */
-	visdn_chan->pipeline_tx->status = KS_PIPELINE_STATUS_FLOWING;
+	visdn_chan_debug(visdn_chan,
+			"Connecting userport %06d to chan %06d\n",
+			visdn_chan->node_userport->id,
+			visdn_chan->node_bearer->id);
 
-	err = ks_pipeline_update(visdn_chan->pipeline_tx, ks_conn);
-	if (err < 0) {
-		ast_log(LOG_ERROR,
-			"Cannot start TX pipeline\n");
-		goto err_pipeline_tx_update;
-	}
+	err = visdn_chan_connect_userport(visdn_chan);
+	if (err < 0)
+		goto err_connect_userport;
 
 		/* FIXME TODO FIXME XXX Handle return value */
 /*		if (ic->echocancel)
@@ -4706,28 +5281,13 @@ static void visdn_q931_connect_channel(
 
 	return;
 
-err_pipeline_tx_update:
-err_pipeline_rx_update:
-err_pipeline_tx_update_chans:
-err_pipeline_tx_octet_reverser_enable:
-err_pipeline_tx_create:
-err_pipeline_tx_connect:
-	ks_pipeline_put(visdn_chan->pipeline_tx);
-	visdn_chan->pipeline_tx = NULL;
-err_pipeline_tx_alloc:
-err_pipeline_rx_update_chans:
-err_pipeline_rx_octet_reverser_enable:
-err_pipeline_rx_create:
-err_pipeline_rx_connect:
-	ks_pipeline_put(visdn_chan->pipeline_rx);
-	visdn_chan->pipeline_rx = NULL;
-err_pipeline_rx_alloc:
-
 err_up_node_not_found:
 err_bearer_node_not_found:
 	ks_conn_remote_topology_unlock(ks_conn);
+err_connect_userport:
 err_kstreamer_lock:
 err_get_up_node_id:
+	visdn_chan_unmap_up_status(visdn_chan);
 	close(visdn_chan->up_fd);
 	visdn_chan->up_fd = -1;
 err_open_userport:
@@ -4817,9 +5377,25 @@ static void visdn_q931_status_management_indication(
 {
 }
 
+/* libq931 discards messages below the threshold before formatting them,
+ * keep it in sync with our debugging flags.
+ */
+static void visdn_q931_update_log_level(void)
+{
+#ifdef DEBUG_CODE
+	q931_set_log_level(visdn.debug_q931 ? Q931_LOG_DEBUG : Q931_LOG_INFO);
+#else
+	q931_set_log_level(Q931_LOG_INFO);
+#endif
+}
+
 static void visdn_logger(int level, const char *format, ...)
 {
 	va_list ap;
+
+	if (level < q931_get_log_level())
+		return;
+
 	va_start(ap, format);
 
 	char msg[200];
@@ -4852,9 +5428,16 @@ static void visdn_logger(int level, const char *format, ...)
 	}
 }
 
+/* Timers started by the q931 thread itself are picked up when it goes back
+ * to poll(), so nothing has to be done. Any other thread makes the timerfd
+ * expire immediately to have the q931 thread recompute its deadline.
+ */
 void visdn_q931_timer_update(void)
 {
-	pthread_kill(visdn.q931_thread, SIGURG);
+	if (pthread_equal(pthread_self(), visdn.q931_thread))
+		return;
+
+	visdn_timer_arm(0);
 }
 
 static void visdn_q931_ccb_receive(void)
@@ -5217,6 +5800,7 @@ static char *do_visdn_debug_q931(struct ast_cli_entry *e, int cmd, struct ast_cl
 #endif	
 
 	visdn.debug_q931 = TRUE;
+	visdn_q931_update_log_level();
 #if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
 	ast_cli(fd, "vISDN q.931 debugging enabled\n");
 	return RESULT_SUCCESS;
@@ -5264,6 +5848,7 @@ static char *do_visdn_no_debug_q931(struct ast_cli_entry *e, int cmd, struct ast
 
 #endif	
 	visdn.debug_q931 = FALSE;
+	visdn_q931_update_log_level();
 
 #if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
 	ast_cli(fd, "vISDN q.931 debugging disabled\n");
@@ -5284,6 +5869,125 @@ static struct ast_cli_entry visdn_no_debug_q931 =
 	NULL
 };
 #endif
+/*---------------------------------------------------------------------------*/
+#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
+static int do_visdn_q931_trace(int fd, int argc, char *argv[])
+#else
+static char *do_visdn_q931_trace(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+#endif
+{
+	int err;
+
+#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
+
+#else
+	int fd = a->fd;
+	int argc = a->argc;
+	char **argv = a->argv;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "visdn q931 trace";
+		e->usage =   "Usage: visdn q931 trace on [<slots>]|off|dump <file>\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+#endif
+
+	if (argc == 4 || argc == 5) {
+		if (!strcasecmp(argv[3], "on")) {
+			int nslots = VISDN_Q931_TRACE_DEFAULT_SLOTS;
+
+			if (argc == 5)
+				nslots = atoi(argv[4]);
+
+			err = q931_trace_enable(nslots);
+			if (err < 0) {
+				ast_cli(fd, "Cannot enable q.931 trace: %s\n",
+					strerror(-err));
+				goto err_failure;
+			}
+
+			ast_cli(fd, "vISDN q.931 trace enabled (%d slots)\n",
+				q931_trace_nslots());
+
+			goto success;
+
+		} else if (!strcasecmp(argv[3], "off") && argc == 4) {
+			q931_trace_disable();
+
+			ast_cli(fd, "vISDN q.931 trace disabled\n");
+
+			goto success;
+
+		} else if (!strcasecmp(argv[3], "dump") && argc == 5) {
+			FILE *f;
+			int nrecords;
+
+			f = fopen(argv[4], "w");
+			if (!f) {
+				ast_cli(fd, "Cannot open '%s': %s\n",
+					argv[4], strerror(errno));
+				goto err_failure;
+			}
+
+			nrecords = q931_trace_dump(f);
+			fclose(f);
+
+			if (nrecords < 0) {
+				ast_cli(fd, "Cannot dump q.931 trace: %s\n",
+					strerror(-nrecords));
+				goto err_failure;
+			}
+
+			ast_cli(fd, "%d frames dumped to '%s'\n",
+				nrecords, argv[4]);
+
+			goto success;
+		}
+	}
+
+#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
+	return RESULT_SHOWUSAGE;
+#else
+	return CLI_SHOWUSAGE;
+#endif
+
+err_failure:
+#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
+	return RESULT_FAILURE;
+#else
+	return CLI_FAILURE;
+#endif
+
+success:
+#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
+	return RESULT_SUCCESS;
+#else
+	return CLI_SUCCESS;
+#endif
+}
+
+#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
+static char visdn_q931_trace_help[] =
+"Usage: visdn q931 trace on [<slots>]|off|dump <file>\n"
+"\n"
+"	Record the raw q.931 frames sent and received on all interfaces\n"
+"	in a ring of <slots> entries. 'dump' writes the ring to <file>\n"
+"	in binary form to be decoded offline, it may be issued while the\n"
+"	trace is running or after it has been stopped.\n";
+
+static struct ast_cli_entry visdn_q931_trace =
+{
+	{ "visdn", "q931", "trace", NULL },
+	do_visdn_q931_trace,
+	"Controls q.931 binary frame tracing",
+	visdn_q931_trace_help,
+	NULL
+};
+#endif
+
 /*---------------------------------------------------------------------------*/
 #if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
 static int do_visdn_reload(int fd, int argc, char *argv[])
@@ -5398,6 +6102,14 @@ static int visdn_cli_print_call_list(
 	}
 	ast_rwlock_unlock(&visdn.intfs_list_lock);
 
+	ast_mutex_lock(&visdn.bridges_lock);
+	ast_cli(fd, "\nNatively bridged calls: %d (%lu since start),"
+		" %lu digits detected in kernel\n",
+		visdn.bridges_active,
+		visdn.bridges_total,
+		visdn.bridges_dtmf_digits);
+	ast_mutex_unlock(&visdn.bridges_lock);
+
 	return RESULT_SUCCESS;
 }
 
@@ -5502,6 +6214,41 @@ static void visdn_cli_print_call(int fd, struct q931_call *call)
 		if (strlen(visdn_chan->dtmf_queue))
 			ast_cli(fd, "DTMF Queue           : %s\n",
 				visdn_chan->dtmf_queue);
+
+		struct visdn_jitbuf_stats *stats = &visdn_chan->jitbuf_stats;
+
+		ast_cli(fd, "------ TX Jitter Buffer\n");
+
+		ast_cli(fd,
+			"Fill level source    : %s (%u page, %u ioctl)\n"
+			"Underruns            : %u (%u late deliveries)\n"
+			"Overruns             : %u\n"
+			"Inserted samples     : %u\n"
+			"Dropped samples      : %u\n"
+			"Current average      : %d samples\n",
+			visdn_chan->up_status ? "Status page" : "ioctl",
+			stats->status_page_reads,
+			stats->ioctl_reads,
+			stats->underruns,
+			stats->late_deliveries,
+			stats->overruns,
+			stats->inserted_samples,
+			stats->dropped_samples,
+			visdn_chan->pressure_average);
+
+		if (stats->latency_count)
+			ast_cli(fd,
+				"Latency min/avg/max  : %.1f/%.1f/%.1f ms\n",
+				stats->latency_min / 8.0,
+				stats->latency_sum / 8.0 /
+						stats->latency_count,
+				stats->latency_max / 8.0);
+
+		if (visdn_chan->up_status)
+			ast_cli(fd,
+				"RX octets            : %u (%u overruns)\n",
+				visdn_chan->up_status->rx_octets,
+				visdn_chan->up_status->rx_overruns);
 	}
 
 }
@@ -5740,6 +6487,7 @@ static struct ast_cli_entry cli_ks[] = {
 	AST_CLI_DEFINE(do_visdn_no_debug_q921, "visdn no debug q921"),
 	AST_CLI_DEFINE(do_visdn_debug_q931, "visdn debug q931 [interface]"),
 	AST_CLI_DEFINE(do_visdn_no_debug_q931, "visdn no debug q931"),
+	AST_CLI_DEFINE(do_visdn_q931_trace, "visdn q931 trace"),
 	AST_CLI_DEFINE(do_visdn_reload, "visdn reload"),
 	AST_CLI_DEFINE(visdn_show_calls_func, "visdn show calls [<interface>|<callid>]"),
 };
@@ -5759,6 +6507,8 @@ static int visdn_load_module(void)
 
 	ast_mutex_init(&visdn.state_lock);
 	ast_mutex_init(&visdn.usecnt_lock);
+	ast_mutex_init(&visdn.bridges_lock);
+	INIT_LIST_HEAD(&visdn.bridges_dtmf);
 
 	INIT_LIST_HEAD(&visdn.ccb_q931_queue);
 	ast_mutex_init(&visdn.ccb_q931_queue_lock);
@@ -5788,6 +6538,16 @@ static int visdn_load_module(void)
 	visdn.q931_ccb_queue_pipe_read = filedes[0];
 	visdn.q931_ccb_queue_pipe_write = filedes[1];
 
+	ast_mutex_init(&visdn.timer_lock);
+	visdn.timer_armed_at = 0;
+
+	visdn.timer_fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK);
+	if (visdn.timer_fd < 0) {
+		ast_log(LOG_ERROR, "Unable to create timerfd: %s\n",
+			strerror(errno));
+		goto err_timerfd_create;
+	}
+
 	ast_rwlock_init(&visdn.intfs_list_lock);
 	INIT_LIST_HEAD(&visdn.intfs_list);
 
@@ -5796,6 +6556,7 @@ static int visdn_load_module(void)
 
 	q931_init();
 	q931_set_report_func(visdn_logger);
+	visdn_q931_update_log_level();
 	q931_set_timer_update_func(visdn_q931_timer_update);
 	q931_set_queue_primitive_func(visdn_queue_primitive);
 	q931_set_is_number_complete_func(visdn_q931_is_number_complete);
@@ -5883,6 +6644,8 @@ static int visdn_load_module(void)
 		goto err_channel_register;
 	}
 
+	ks_conn_add_event_handler(ks_conn, &visdn_dtmf_event_handler);
+
 #if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >= 10200 && ASTERISK_VERSION_NUM < 10600)
 	ast_cli_register(&visdn_debug_netlink);
 	ast_cli_register(&visdn_no_debug_netlink);
@@ -5890,6 +6653,7 @@ static int visdn_load_module(void)
 	ast_cli_register(&visdn_no_debug_q921);
 	ast_cli_register(&visdn_debug_q931);
 	ast_cli_register(&visdn_no_debug_q931);
+	ast_cli_register(&visdn_q931_trace);
 	ast_cli_register(&visdn_reload);
 	ast_cli_register(&visdn_show_calls);
 #else
@@ -5910,6 +6674,8 @@ err_thread_create:
 err_bind_netlink:
 	close(visdn.netlink_socket);
 err_socket_netlink:
+	close(visdn.timer_fd);
+err_timerfd_create:
 	close(visdn.q931_ccb_queue_pipe_write);
 	close(visdn.q931_ccb_queue_pipe_read);
 err_pipe_q931_ccb:
@@ -5942,6 +6708,7 @@ static int visdn_unload_module(void)
 #if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >= 10200 && ASTERISK_VERSION_NUM < 10600)
 	ast_cli_unregister(&visdn_show_calls);
 	ast_cli_unregister(&visdn_reload);
+	ast_cli_unregister(&visdn_q931_trace);
 	ast_cli_unregister(&visdn_no_debug_q931);
 	ast_cli_unregister(&visdn_debug_q931);
 	ast_cli_unregister(&visdn_no_debug_q921);
@@ -5952,11 +6719,14 @@ static int visdn_unload_module(void)
 	ast_cli_unregister_multiple(cli_ks, ARRAY_LEN(cli_ks));
 #endif
 
+	ks_conn_del_event_handler(ks_conn, &visdn_dtmf_event_handler);
+
 	ast_channel_unregister(&visdn_tech);
 
 	q931_leave();
 
 	close(visdn.netlink_socket);
+	close(visdn.timer_fd);
 
 	return 0;
 }
@@ -36,6 +36,8 @@
 #define VISDN_CHAN_TYPE "VISDN"
 #define VISDN_CONFIG_FILE "visdn.conf"
 
+#define VISDN_Q931_TRACE_DEFAULT_SLOTS 1024
+
 enum poll_info_type
 {
 	POLL_INFO_TYPE_MGMT,
@@ -45,6 +47,7 @@ enum poll_info_type
 	POLL_INFO_TYPE_NETLINK,
 	POLL_INFO_TYPE_CCB_Q931,
 	POLL_INFO_TYPE_Q931_CCB,
+	POLL_INFO_TYPE_TIMER,
 };
 
 struct poll_info
@@ -72,6 +75,24 @@ struct visdn_suspended_call
 };
 
 
+struct visdn_jitbuf_stats
+{
+	unsigned int underruns;
+	unsigned int overruns;
+	unsigned int late_deliveries;
+
+	unsigned int inserted_samples;
+	unsigned int dropped_samples;
+
+	unsigned int latency_min;
+	unsigned int latency_max;
+	unsigned long long latency_sum;
+	unsigned int latency_count;
+
+	unsigned int status_page_reads;
+	unsigned int ioctl_reads;
+};
+
 struct visdn_chan {
 	int refcnt; /* workaround for missing asterisk refcounting */
 	ast_cond_t refcnt_decremented_cond;
@@ -92,12 +113,28 @@ struct visdn_chan {
 	int up_fd;
 	int ec_fd;
 
+	const struct ksup_status *up_status;
+
 	struct ks_node *node_userport;
 	struct ks_node *node_bearer;
 
 	struct ks_pipeline *pipeline_rx;
 	struct ks_pipeline *pipeline_tx;
 
+	/* From a ks-tonegen generator to our bearer, replaces pipeline_tx */
+	struct ks_pipeline *pipeline_tone;
+
+	/* From our bearer to the peer's, while natively bridged */
+	struct ks_pipeline *pipeline_bridge;
+
+	/* Digits detected by ks-dtmf on pipeline_bridge, in visdn.bridges_dtmf
+	 * while set
+	 */
+	int bridge_dtmf;
+	int bridge_dtmf_feature_id;
+	int bridge_dtmf_pipeline_id;
+	struct list_head bridge_dtmf_node;
+
 	int up_bearer_pipeline_started;
 
 	int sending_complete;
@@ -125,6 +162,9 @@ struct visdn_chan {
 	longtime_t last_tx;
 
 	__u16 pressure_average;
+	__u8 last_tx_sample;
+
+	struct visdn_jitbuf_stats jitbuf_stats;
 
 	struct ast_dsp *dsp;
 
@@ -154,6 +194,11 @@ struct visdn_state
 	int q931_ccb_queue_pipe_read;
 	int q931_ccb_queue_pipe_write;
 
+	/* Owned by the q931 thread, armed to the earliest timer deadline */
+	int timer_fd;
+	ast_mutex_t timer_lock;
+	longtime_t timer_armed_at;
+
 	ast_rwlock_t intfs_list_lock;
 	struct list_head intfs_list;
 
@@ -172,12 +217,20 @@ struct visdn_state
 	int debug_q931;
 	int debug_q921;
 
+	ast_mutex_t bridges_lock;
+	int bridges_active;
+	unsigned long bridges_total;
+
+	struct list_head bridges_dtmf;
+	unsigned long bridges_dtmf_digits;
+
 	struct visdn_ic *default_ic;
 };
 
 extern struct visdn_state visdn;
 
 void refresh_polls_list();
+void visdn_q931_timer_update(void);
 
 struct visdn_chan *visdn_chan_get(struct visdn_chan *visdn_chan);
 #define visdn_chan_put(chan) \
@@ -474,24 +474,19 @@ struct visdn_intf *visdn_hg_hunt(
 
 		struct q931_interface *q931_intf = hgm->intf->q931_intf;
 
-		if (q931_intf) {
-			int i;
-			for (i=0; i<q931_intf->n_channels; i++) {
-				if (q931_intf->channels[i].state ==
-						Q931_CHANSTATE_AVAILABLE) {
+		if (q931_intf &&
+		    q931_chanset_count(&q931_intf->available_chans)) {
 
-					hg->current_member = hgm;
+			hg->current_member = hgm;
 
-					visdn_hg_debug(hg,
-						"Huntgroup: found interface"
-					       	" '%s'\n", hgm->intf->name);
+			visdn_hg_debug(hg,
+				"Huntgroup: found interface"
+			       	" '%s'\n", hgm->intf->name);
 
-					ast_rwlock_unlock(
-						&visdn.huntgroups_list_lock);
+			ast_rwlock_unlock(
+				&visdn.huntgroups_list_lock);
 
-					return visdn_intf_get(hgm->intf);
-				}
-			}
+			return visdn_intf_get(hgm->intf);
 		}
 
 		hgm = visdn_hg_next_member(hg, hgm);
@@ -142,8 +142,8 @@ struct visdn_ic *visdn_ic_alloc(void)
 
 	ic->refcnt = 1;
 
-	INIT_LIST_HEAD(&ic->clip_numbers_list);
-	INIT_LIST_HEAD(&ic->trans_numbers_list);
+	visdn_numbers_list_init(&ic->clip_numbers_list);
+	visdn_numbers_list_init(&ic->trans_numbers_list);
 
 	return ic;
 }
@@ -172,6 +172,9 @@ void visdn_ic_put(struct visdn_ic *ic)
 		if (ic->intf)
 			visdn_intf_put(ic->intf);
 
+		visdn_numbers_list_flush(&ic->clip_numbers_list);
+		visdn_numbers_list_flush(&ic->trans_numbers_list);
+
 		free(ic);
 	}
 
@@ -220,6 +223,26 @@ static enum visdn_clir_mode
 	}
 }
 
+static enum q931_channel_selection
+	visdn_string_to_channel_selection(const char *str)
+{
+	if (!strcasecmp(str, "lowest"))
+		return Q931_CHANSEL_LOWEST;
+	else if (!strcasecmp(str, "highest"))
+		return Q931_CHANSEL_HIGHEST;
+	else if (!strcasecmp(str, "round_robin"))
+		return Q931_CHANSEL_ROUND_ROBIN;
+	else if (!strcasecmp(str, "lru"))
+		return Q931_CHANSEL_LRU;
+	else {
+		ast_log(LOG_ERROR,
+			"Unknown channel_selection '%s'\n",
+			str);
+
+		return Q931_CHANSEL_LOWEST;
+	}
+}
+
 static int visdn_ic_from_var(
 	struct visdn_ic *ic,
 	struct ast_variable *var)
@@ -301,10 +324,17 @@ static int visdn_ic_from_var(
 		ic->call_bumping = ast_true(var->value);
 	} else if (!strcasecmp(var->name, "autorelease_dlc")) {
 		ic->dlc_autorelease_time = atoi(var->value);
+	} else if (!strcasecmp(var->name, "channel_selection")) {
+		ic->channel_selection =
+			visdn_string_to_channel_selection(var->value);
 	} else if (!strcasecmp(var->name, "echocancel")) {
 		ic->echocancel = ast_true(var->value);
 	} else if (!strcasecmp(var->name, "echocancel_taps")) {
 		ic->echocancel_taps = atoi(var->value);
+	} else if (!strcasecmp(var->name, "native_bridge")) {
+		ic->native_bridge = ast_true(var->value);
+	} else if (!strcasecmp(var->name, "kernel_tones")) {
+		ic->kernel_tones = ast_true(var->value);
 	} else if (!strcasecmp(var->name, "jitbuf_average")) {
 		ic->jitbuf_average = atoi(var->value);
 	} else if (!strcasecmp(var->name, "jitbuf_low")) {
@@ -397,8 +427,11 @@ static void visdn_ic_copy(
 	strcpy(dst->subscriber_prefix, src->subscriber_prefix);
 	strcpy(dst->abbreviated_prefix, src->abbreviated_prefix);
 	dst->dlc_autorelease_time = src->dlc_autorelease_time;
+	dst->channel_selection = src->channel_selection;
 	dst->echocancel = src->echocancel;
 	dst->echocancel_taps = src->echocancel_taps;
+	dst->native_bridge = src->native_bridge;
+	dst->kernel_tones = src->kernel_tones;
 
 	dst->jitbuf_average = src->jitbuf_average;
 	dst->jitbuf_low = src->jitbuf_low;
@@ -483,8 +516,9 @@ static void visdn_intf_set_status(
 			intf->status_reason = NULL;
 	}
 
+	/* Have the q931 thread pick up the new timer expiration */
 	if (visdn.q931_thread != AST_PTHREADT_NULL)
-		pthread_kill(visdn.q931_thread, SIGURG);
+		visdn_q931_timer_update();
 }
 
 int visdn_intf_initialize(struct visdn_intf *intf)
@@ -513,6 +547,7 @@ int visdn_intf_initialize(struct visdn_intf *intf)
 	intf->q931_intf->network_role = ic->network_role;
 	intf->q931_intf->dlc_autorelease_time = ic->dlc_autorelease_time;
 	intf->q931_intf->enable_bumping = ic->call_bumping;
+	intf->q931_intf->channel_selection = ic->channel_selection;
 
 	intf->mgmt_fd = socket(PF_LAPD, SOCK_SEQPACKET, LAPD_SAPI_MGMT);
 	if (intf->mgmt_fd < 0) {
@@ -620,7 +655,7 @@ int visdn_intf_initialize(struct visdn_intf *intf)
 	}
 
 	if (intf->q931_intf->role == LAPD_INTF_ROLE_NT) {
-		if (list_empty(&ic->clip_numbers_list)) {
+		if (visdn_numbers_list_empty(&ic->clip_numbers_list)) {
 			ast_log(LOG_NOTICE,
 				"Interface '%s' is configured in network"
 				" mode but clip_numbers is empty\n",
@@ -741,10 +776,14 @@ void visdn_ic_setdefault(struct visdn_ic *ic)
 	strcpy(ic->abbreviated_prefix, "");
 
 	ic->dlc_autorelease_time = 10;
+	ic->channel_selection = Q931_CHANSEL_LOWEST;
 
 	ic->echocancel = FALSE;
 	ic->echocancel_taps = 256;
 
+	ic->native_bridge = TRUE;
+	ic->kernel_tones = FALSE;
+
 	ic->jitbuf_average = 5;
 	ic->jitbuf_low = 10;
 	ic->jitbuf_hardlow = 0;
@@ -942,7 +981,7 @@ static void visdn_print_intf_details(int fd, struct visdn_intf *intf)
 	ast_cli(fd, "Transparent Numbers       : ");
 	{
 	struct visdn_number *num;
-	list_for_each_entry(num, &ic->clip_numbers_list, node) {
+	list_for_each_entry(num, &ic->trans_numbers_list.numbers, node) {
 		ast_cli(fd, "%s ", num->number);
 	}
 	}
@@ -951,6 +990,8 @@ static void visdn_print_intf_details(int fd, struct visdn_intf *intf)
 	ast_cli(fd,
 		"Echo canceller            : %s\n"
 		"Echo canceller taps       : %d (%d ms)\n"
+		"Native bridging           : %s\n"
+		"Kernel tones              : %s\n"
 		"Jitter buffer average     : %d\n"
 		"Jitter buffer low-mark    : %d\n"
 		"Jitter buffer hard low-mark: %d\n"
@@ -962,6 +1003,8 @@ static void visdn_print_intf_details(int fd, struct visdn_intf *intf)
 		"Call bumping              : %s\n",
 		ic->echocancel ? "Yes" : "No",
 		ic->echocancel_taps, ic->echocancel_taps / 8,
+		ic->native_bridge ? "Yes" : "No",
+		ic->kernel_tones ? "Yes" : "No",
 		ic->jitbuf_average,
 		ic->jitbuf_low,
 		ic->jitbuf_hardlow,
@@ -978,13 +1021,15 @@ static void visdn_print_intf_details(int fd, struct visdn_intf *intf)
 		"Newtork specific prefix   : %s\n"
 		"Subscriber prefix         : %s\n"
 		"Abbreviated prefix        : %s\n"
-		"Autorelease time          : %d\n\n",
+		"Autorelease time          : %d\n"
+		"Channel selection         : %s\n\n",
 		ic->national_prefix,
 		ic->international_prefix,
 		ic->network_specific_prefix,
 		ic->subscriber_prefix,
 		ic->abbreviated_prefix,
-		ic->dlc_autorelease_time);
+		ic->dlc_autorelease_time,
+		q931_channel_selection_to_text(ic->channel_selection));
 
 	ast_cli(fd,
 		"Outbound type of number   : %s\n\n"
@@ -1012,7 +1057,7 @@ static void visdn_print_intf_details(int fd, struct visdn_intf *intf)
 	ast_cli(fd, "CLIP Numbers              : ");
 	{
 	struct visdn_number *num;
-	list_for_each_entry(num, &ic->clip_numbers_list, node) {
+	list_for_each_entry(num, &ic->clip_numbers_list.numbers, node) {
 		ast_cli(fd, "%s ", num->number);
 	}
 	}
@@ -1298,6 +1343,178 @@ static struct ast_cli_entry visdn_interface_show =
 	complete_visdn_interface_show,
 };
 #endif
+
+/*---------------------------------------------------------------------------*/
+
+#define VISDN_NUMBERS_BENCH_ROUNDS 10000
+
+static char *complete_visdn_interface_numbers(
+#if ASTERISK_VERSION_NUM < 010400 || (ASTERISK_VERSION_NUM >= 10200 && ASTERISK_VERSION_NUM < 10400)
+	char *line, char *word,
+#else
+	const char *line, const char *word,
+#endif
+	int pos, int state)
+{
+	if (pos != 3)
+		return NULL;
+
+	return visdn_intf_completion(line, word, state);
+}
+
+static int visdn_numbers_bench(
+	const struct visdn_numbers_list *list,
+	const char *number,
+	int (*match)(const struct visdn_numbers_list *list,
+			const char *number),
+	int *res)
+{
+	struct timeval start, end;
+	int i;
+
+	gettimeofday(&start, NULL);
+	for (i=0; i<VISDN_NUMBERS_BENCH_ROUNDS; i++)
+		*res = match(list, number);
+	gettimeofday(&end, NULL);
+
+	return ((end.tv_sec - start.tv_sec) * 1000000LL +
+		(end.tv_usec - start.tv_usec)) * 1000LL /
+			VISDN_NUMBERS_BENCH_ROUNDS;
+}
+
+static void visdn_print_numbers_list(
+	int fd,
+	const char *name,
+	const struct visdn_numbers_list *list,
+	const char *number)
+{
+	int count = 0;
+	int match, match_linear;
+	int ns, ns_linear;
+
+	struct visdn_number *num;
+	list_for_each_entry(num, &list->numbers, node)
+		count++;
+
+	ns = visdn_numbers_bench(list, number,
+			visdn_numbers_list_match, &match);
+	ns_linear = visdn_numbers_bench(list, number,
+			visdn_numbers_list_match_linear, &match_linear);
+
+	ast_cli(fd,
+		"%-14s: %d entries (%d not compiled), %d trie nodes"
+		" (%d bytes)\n"
+		"                match: %s, trie %d ns, linear %d ns%s\n",
+		name,
+		count,
+		list->slow_numbers,
+		list->trie_nodes,
+		visdn_numbers_list_trie_size(list),
+		match ? "yes" : "no",
+		ns,
+		ns_linear,
+		match != match_linear ? " (MISMATCH)" : "");
+}
+
+#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
+static int do_visdn_interface_numbers(int fd, int argc, char *argv[])
+#else
+static char *do_visdn_interface_numbers(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+#endif
+{
+#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
+
+#else
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "visdn interface numbers";
+		e->usage =   "Usage: visdn interface numbers <interface> <number>\n"
+			     "\n"
+			     "	Matches <number> against the interface's trans_numbers and\n"
+			     "	clip_numbers and reports the time spent and the size of the\n"
+			     "	compiled lists.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return complete_visdn_interface_numbers(a->line, a->word, a->pos, a->n);
+	}
+
+	int fd = a->fd;
+	int argc = a->argc;
+	char **argv = a->argv;
+#endif
+	struct visdn_intf *intf;
+	struct visdn_ic *ic;
+
+	if (argc != 5)
+		goto err_usage;
+
+	intf = visdn_intf_get_by_name(argv[3]);
+	if (!intf) {
+		ast_cli(fd, "Interface '%s' not found\n", argv[3]);
+		goto err_intf_not_found;
+	}
+
+	ast_mutex_lock(&intf->lock);
+	ic = intf->current_ic ? visdn_ic_get(intf->current_ic) : NULL;
+	ast_mutex_unlock(&intf->lock);
+
+	if (!ic) {
+		ast_cli(fd, "Interface '%s' is not configured\n", argv[3]);
+		goto err_no_ic;
+	}
+
+	visdn_print_numbers_list(fd, "trans_numbers",
+			&ic->trans_numbers_list, argv[4]);
+	visdn_print_numbers_list(fd, "clip_numbers",
+			&ic->clip_numbers_list, argv[4]);
+
+	visdn_ic_put(ic);
+	visdn_intf_put(intf);
+
+#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
+	return RESULT_SUCCESS;
+#else
+	return CLI_SUCCESS;
+#endif
+
+err_no_ic:
+	visdn_intf_put(intf);
+err_intf_not_found:
+#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
+	return RESULT_FAILURE;
+#else
+	return CLI_FAILURE;
+#endif
+
+err_usage:
+#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
+	return RESULT_SHOWUSAGE;
+#else
+	return CLI_SHOWUSAGE;
+#endif
+}
+
+#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
+static char visdn_interface_numbers_help[] =
+"Usage: visdn interface numbers <interface> <number>\n"
+"\n"
+"	Matches <number> against the interface's trans_numbers and\n"
+"	clip_numbers and reports the time spent and the size of the\n"
+"	compiled lists.\n";
+
+static struct ast_cli_entry visdn_interface_numbers =
+{
+	{ "visdn", "interface", "numbers", NULL },
+	do_visdn_interface_numbers,
+	"Tests vISDN's interface numbers lists",
+	visdn_interface_numbers_help,
+	complete_visdn_interface_numbers,
+};
+#else
+static struct ast_cli_entry cli_numbers[] = {
+	AST_CLI_DEFINE(do_visdn_interface_numbers, "Tests vISDN's interface numbers lists")
+	};
+#endif
 /*---------------------------------------------------------------------------*/
 
 #ifdef DEBUG_CODE
@@ -1588,8 +1805,10 @@ void visdn_intf_cli_register(void)
 {
 #if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >= 10200 && ASTERISK_VERSION_NUM < 10600)
 	ast_cli_register(&visdn_interface_show);
+	ast_cli_register(&visdn_interface_numbers);
 #else
 	ast_cli_register_multiple(cli_ksnodeb, ARRAY_LEN(cli_ksnodeb));
+	ast_cli_register_multiple(cli_numbers, ARRAY_LEN(cli_numbers));
 #endif
 
 #ifdef DEBUG_CODE
@@ -1614,8 +1833,10 @@ void visdn_intf_cli_unregister(void)
 
 #endif
 #if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >= 10200 && ASTERISK_VERSION_NUM < 10600)
+	ast_cli_unregister(&visdn_interface_numbers);
 	ast_cli_unregister(&visdn_interface_show);
 #else
+	ast_cli_unregister_multiple(cli_numbers, ARRAY_LEN(cli_numbers));
 	ast_cli_unregister_multiple(cli_ksnodeb, ARRAY_LEN(cli_ksnodeb));
 #endif
 }
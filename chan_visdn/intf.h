@@ -26,6 +26,7 @@
 
 #include "ton.h"
 #include "util.h"
+#include "numbers_list.h"
 
 #ifdef ADEBUG_CODE
 #define visdn_intf_debug(intf, format, arg...)		\
@@ -118,18 +119,22 @@ struct visdn_ic
 	int clip_override;
 	char clip_default_name[128];
 	char clip_default_number[32];
-	struct list_head clip_numbers_list;
-	struct list_head trans_numbers_list;
+	struct visdn_numbers_list clip_numbers_list;
+	struct visdn_numbers_list trans_numbers_list;
 	int clip_special_arrangement;
 	enum visdn_clir_mode clir_mode;
 	int overlap_sending;
 	int overlap_receiving;
 	int call_bumping;
 	int dlc_autorelease_time;
+	enum q931_channel_selection channel_selection;
 
 	int echocancel;
 	int echocancel_taps;
 
+	int native_bridge;
+	int kernel_tones;
+
 	int jitbuf_average;
 	int jitbuf_low;
 	int jitbuf_hardlow;
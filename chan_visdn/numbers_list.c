@@ -11,6 +11,8 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 
 #include <asterisk/version.h>
 #if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
@@ -23,38 +25,339 @@
 
 #include "util.h"
 #include "numbers_list.h"
-void visdn_numbers_list_flush(struct list_head *list)
+
+static int visdn_numbers_trie_index(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+
+	switch(c) {
+	case '*': return 10;
+	case '#': return 11;
+	case '+': return 12;
+	}
+
+	return -1;
+}
+
+static struct visdn_numbers_trie_node *visdn_numbers_trie_alloc(
+	struct visdn_numbers_list *list)
+{
+	struct visdn_numbers_trie_node *node;
+
+	node = malloc(sizeof(*node));
+	if (!node)
+		return NULL;
+
+	memset(node, 0, sizeof(*node));
+	node->refcnt = 1;
+
+	list->trie_nodes++;
+
+	return node;
+}
+
+static void visdn_numbers_trie_put(
+	struct visdn_numbers_list *list,
+	struct visdn_numbers_trie_node *node)
+{
+	int i;
+
+	if (--node->refcnt)
+		return;
+
+	for (i=0; i<VISDN_NUMBERS_TRIE_FANOUT; i++) {
+		if (node->next[i])
+			visdn_numbers_trie_put(list, node->next[i]);
+	}
+
+	free(node);
+
+	list->trie_nodes--;
+}
+
+static struct visdn_numbers_trie_node *visdn_numbers_trie_clone(
+	struct visdn_numbers_list *list,
+	struct visdn_numbers_trie_node *node)
+{
+	struct visdn_numbers_trie_node *clone;
+	int i;
+
+	clone = visdn_numbers_trie_alloc(list);
+	if (!clone)
+		return NULL;
+
+	clone->flags = node->flags;
+
+	for (i=0; i<VISDN_NUMBERS_TRIE_FANOUT; i++) {
+		clone->next[i] = node->next[i];
+
+		if (clone->next[i])
+			clone->next[i]->refcnt++;
+	}
+
+	return clone;
+}
+
+/* A compiled entry is a sequence of digit sets, possibly terminated by
+ * '.' (one or more digits) or '!' (zero or more digits)
+ */
+struct visdn_numbers_step
+{
+	int set;
+	int flags;
+};
+
+static int visdn_numbers_parse_set(
+	const char **pos,
+	int *set)
+{
+	const char *c = *pos + 1;
+
+	*set = 0;
+
+	while (*c && *c != ']') {
+		int from = visdn_numbers_trie_index(*c);
+		int to = from;
+
+		if (from < 0)
+			return -1;
+
+		if (*(c + 1) == '-' && *(c + 2) && *(c + 2) != ']') {
+			to = visdn_numbers_trie_index(*(c + 2));
+			if (to < from || to > 9)
+				return -1;
+
+			c += 2;
+		}
+
+		for (; from <= to; from++)
+			*set |= 1 << from;
+
+		c++;
+	}
+
+	if (*c != ']' || !*set)
+		return -1;
+
+	*pos = c;
+
+	return 0;
+}
+
+static int visdn_numbers_parse(
+	const char *number,
+	struct visdn_numbers_step *steps)
+{
+	const char *c;
+	int nsteps = 0;
+
+	if (number[0] != '_') {
+		for (c = number; *c; c++) {
+			int idx = visdn_numbers_trie_index(*c);
+			if (idx < 0)
+				return -1;
+
+			steps[nsteps].set = 1 << idx;
+			steps[nsteps].flags = 0;
+			nsteps++;
+		}
+
+		return nsteps;
+	}
+
+	for (c = number + 1; *c; c++) {
+		int set;
+
+		switch(toupper(*c)) {
+		case 'X':
+			set = 0x3ff;
+		break;
+
+		case 'Z':
+			set = 0x3fe;
+		break;
+
+		case 'N':
+			set = 0x3fc;
+		break;
+
+		case '[':
+			if (visdn_numbers_parse_set(&c, &set) < 0)
+				return -1;
+		break;
+
+		case '.':
+			steps[nsteps].set = 0;
+			steps[nsteps].flags = VISDN_NUMBERS_TRIE_MATCH_MORE;
+			return nsteps + 1;
+
+		case '!':
+			steps[nsteps].set = 0;
+			steps[nsteps].flags = VISDN_NUMBERS_TRIE_MATCH_ANY;
+			return nsteps + 1;
+
+		default: {
+			int idx = visdn_numbers_trie_index(*c);
+			if (idx < 0)
+				return -1;
+
+			set = 1 << idx;
+		}
+		break;
+		}
+
+		steps[nsteps].set = set;
+		steps[nsteps].flags = 0;
+		nsteps++;
+	}
+
+	return nsteps;
+}
+
+/* node must not be shared. On allocation failure the trie may contain part
+ * of the entry, which can only match a subset of what the entry matches.
+ */
+static int visdn_numbers_trie_insert(
+	struct visdn_numbers_list *list,
+	struct visdn_numbers_trie_node *node,
+	const struct visdn_numbers_step *steps,
+	int nsteps)
+{
+	struct visdn_numbers_trie_node *fresh = NULL;
+	int i;
+
+	if (!nsteps) {
+		node->flags |= VISDN_NUMBERS_TRIE_MATCH;
+		return 0;
+	}
+
+	if (!steps->set) {
+		node->flags |= steps->flags;
+		return 0;
+	}
+
+	for (i=0; i<VISDN_NUMBERS_TRIE_FANOUT; i++) {
+		if (!(steps->set & (1 << i)))
+			continue;
+
+		struct visdn_numbers_trie_node *child = node->next[i];
+
+		if (!child) {
+			/* All the previously unused digits share the same
+			 * subtree
+			 */
+			if (fresh) {
+				fresh->refcnt++;
+			} else {
+				fresh = visdn_numbers_trie_alloc(list);
+				if (!fresh)
+					return -1;
+
+				if (visdn_numbers_trie_insert(list, fresh,
+						steps + 1, nsteps - 1) < 0) {
+					visdn_numbers_trie_put(list, fresh);
+					return -1;
+				}
+			}
+
+			node->next[i] = fresh;
+
+			continue;
+		}
+
+		if (child->refcnt > 1) {
+			child = visdn_numbers_trie_clone(list, child);
+			if (!child)
+				return -1;
+
+			visdn_numbers_trie_put(list, node->next[i]);
+			node->next[i] = child;
+		}
+
+		if (visdn_numbers_trie_insert(list, child,
+				steps + 1, nsteps - 1) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static void visdn_numbers_list_compile(struct visdn_numbers_list *list)
+{
+	struct visdn_numbers_step steps[sizeof(((struct visdn_number *)0)->number)];
+	struct visdn_number *num;
+
+	if (list->trie)
+		visdn_numbers_trie_put(list, list->trie);
+
+	list->trie = visdn_numbers_trie_alloc(list);
+	list->slow_numbers = 0;
+
+	list_for_each_entry(num, &list->numbers, node) {
+		int nsteps = visdn_numbers_parse(num->number, steps);
+
+		num->slow = !list->trie || nsteps < 0 ||
+			visdn_numbers_trie_insert(list, list->trie,
+						steps, nsteps) < 0;
+
+		if (num->slow)
+			list->slow_numbers++;
+	}
+}
+
+void visdn_numbers_list_init(struct visdn_numbers_list *list)
+{
+	INIT_LIST_HEAD(&list->numbers);
+	list->trie = NULL;
+	list->trie_nodes = 0;
+	list->slow_numbers = 0;
+}
+
+void visdn_numbers_list_flush(struct visdn_numbers_list *list)
 {
 	struct visdn_number *num, *t;
-	list_for_each_entry_safe(num, t, list, node) {
+	list_for_each_entry_safe(num, t, &list->numbers, node) {
 		list_del(&num->node);
 		free(num);
 	}
+
+	if (list->trie) {
+		visdn_numbers_trie_put(list, list->trie);
+		list->trie = NULL;
+	}
+
+	list->slow_numbers = 0;
 }
 
 void visdn_numbers_list_copy(
-	struct list_head *dst,
-	const struct list_head *src)
+	struct visdn_numbers_list *dst,
+	const struct visdn_numbers_list *src)
 {
 	visdn_numbers_list_flush(dst);
 
 	struct visdn_number *num;
-	list_for_each_entry(num, src, node) {
+	list_for_each_entry(num, &src->numbers, node) {
 
 		struct visdn_number *num2;
 
 		num2 = malloc(sizeof(*num2));
-		strcpy(num2->number, num->number);
-		list_add_tail(&num2->node, dst);
+		if (!num2)
+			break;
+
+		memcpy(num2, num, sizeof(*num2));
+		list_add_tail(&num2->node, &dst->numbers);
 	}
+
+	visdn_numbers_list_compile(dst);
 }
 
-int visdn_numbers_list_match(
-	struct list_head *list,
+int visdn_numbers_list_match_linear(
+	const struct visdn_numbers_list *list,
 	const char *number)
 {
 	struct visdn_number *num;
-	list_for_each_entry(num, list, node) {
+	list_for_each_entry(num, &list->numbers, node) {
 		if (ast_extension_match(num->number, number))
 			return TRUE;
 	}
@@ -62,37 +365,81 @@ int visdn_numbers_list_match(
 	return FALSE;
 }
 
+int visdn_numbers_list_match(
+	const struct visdn_numbers_list *list,
+	const char *number)
+{
+	const struct visdn_numbers_trie_node *node = list->trie;
+	const char *c;
+
+	for (c = number; node; c++) {
+		if (node->flags & VISDN_NUMBERS_TRIE_MATCH_ANY)
+			return TRUE;
+
+		if (!*c) {
+			if (node->flags & VISDN_NUMBERS_TRIE_MATCH)
+				return TRUE;
+
+			break;
+		}
+
+		if (node->flags & VISDN_NUMBERS_TRIE_MATCH_MORE)
+			return TRUE;
+
+		int idx = visdn_numbers_trie_index(*c);
+		if (idx < 0)
+			break;
+
+		node = node->next[idx];
+	}
+
+	if (list->slow_numbers) {
+		struct visdn_number *num;
+		list_for_each_entry(num, &list->numbers, node) {
+			if (num->slow &&
+			    ast_extension_match(num->number, number))
+				return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
 void visdn_numbers_list_from_string(
-	struct list_head *list,
+	struct visdn_numbers_list *list,
 	const char *value)
 {
 	char *str = strdup(value);
 	char *strpos = str;
 	char *tok;
 
-	struct visdn_number *num, *t;
-	list_for_each_entry_safe(num, t, list, node) {
-		list_del(&num->node);
-		free(num);
-	}
+	visdn_numbers_list_flush(list);
 
 	while ((tok = strsep(&strpos, ","))) {
 		while(*tok == ' ' || *tok == '\t')
 			tok++;
 
-		while(*(tok + strlen(tok) - 1) == ' ' ||
-			*(tok + strlen(tok) - 1) == '\t')
+		while(strlen(tok) &&
+			(*(tok + strlen(tok) - 1) == ' ' ||
+			 *(tok + strlen(tok) - 1) == '\t'))
 			*(tok + strlen(tok) - 1) = '\0';
 
+		if (!strlen(tok))
+			continue;
+
 		struct visdn_number *num;
 		num = malloc(sizeof(*num));
-		memset(num, 0, sizeof(num));
+		if (!num)
+			break;
+
+		memset(num, 0, sizeof(*num));
 
-		strncpy(num->number, tok, sizeof(num->number));
+		strncpy(num->number, tok, sizeof(num->number) - 1);
 
-		list_add_tail(&num->node, list);
+		list_add_tail(&num->node, &list->numbers);
 	}
 
 	free(str);
-}
 
+	visdn_numbers_list_compile(list);
+}
@@ -13,22 +13,70 @@
 #ifndef _NUMBERS_LIST_H
 #define _NUMBERS_LIST_H
 
+/* Numbers are compiled in a digit trie whenever a list is (re)loaded so that
+ * matching an incoming number costs a single walk over its digits whatever
+ * the number of configured entries. Pattern expansions (X, Z, N, [...]) share
+ * the following node, which is cloned only when another entry diverges from
+ * it.
+ */
+
+#define VISDN_NUMBERS_TRIE_FANOUT	13
+
+#define VISDN_NUMBERS_TRIE_MATCH	(1 << 0)
+#define VISDN_NUMBERS_TRIE_MATCH_MORE	(1 << 1)
+#define VISDN_NUMBERS_TRIE_MATCH_ANY	(1 << 2)
+
+struct visdn_numbers_trie_node
+{
+	struct visdn_numbers_trie_node *next[VISDN_NUMBERS_TRIE_FANOUT];
+	int refcnt;
+	int flags;
+};
+
 struct visdn_number
 {
 	struct list_head node;
 	char number[32];
+
+	/* Not representable in the trie, matched with ast_extension_match */
+	int slow;
 };
 
-void visdn_numbers_list_flush(struct list_head *list);
+struct visdn_numbers_list
+{
+	struct list_head numbers;
+
+	struct visdn_numbers_trie_node *trie;
+	int trie_nodes;
+	int slow_numbers;
+};
+
+void visdn_numbers_list_init(struct visdn_numbers_list *list);
+void visdn_numbers_list_flush(struct visdn_numbers_list *list);
 void visdn_numbers_list_copy(
-	struct list_head *dst,
-	const struct list_head *src);
+	struct visdn_numbers_list *dst,
+	const struct visdn_numbers_list *src);
 int visdn_numbers_list_match(
-	struct list_head *list,
+	const struct visdn_numbers_list *list,
+	const char *number);
+int visdn_numbers_list_match_linear(
+	const struct visdn_numbers_list *list,
 	const char *number);
 
 void visdn_numbers_list_from_string(
-	struct list_head *list,
+	struct visdn_numbers_list *list,
 	const char *value);
 
+static inline int visdn_numbers_list_empty(
+	const struct visdn_numbers_list *list)
+{
+	return list_empty(&list->numbers);
+}
+
+static inline int visdn_numbers_list_trie_size(
+	const struct visdn_numbers_list *list)
+{
+	return list->trie_nodes * sizeof(struct visdn_numbers_trie_node);
+}
+
 #endif
@@ -78,6 +78,50 @@ void pipeline_dump_xml(struct ks_pipeline *pipeline)
 			pipeline->chans[i]->id);
 	}
 
+	printf("      <stats>\n");
+	printf("        <frames>%llu</frames>\n",
+		(unsigned long long)pipeline->stats.frames);
+	printf("        <bytes>%llu</bytes>\n",
+		(unsigned long long)pipeline->stats.bytes);
+	printf("        <drops>%llu</drops>\n",
+		(unsigned long long)pipeline->stats.drops);
+	printf("        <underruns>%llu</underruns>\n",
+		(unsigned long long)pipeline->stats.underruns);
+	printf("        <latency_sum>%llu</latency_sum>\n",
+		(unsigned long long)pipeline->stats.latency_sum);
+	printf("        <latency_samples>%llu</latency_samples>\n",
+		(unsigned long long)pipeline->stats.latency_samples);
+	printf("        <latency_max>%u</latency_max>\n",
+		pipeline->stats.latency_max);
+
+	for(i=0; i<KS_PIPELINE_LATENCY_BUCKETS; i++) {
+		printf("        <latency_bucket id=\"%d\">%u</latency_bucket>\n",
+			i, pipeline->stats.latency_hist[i]);
+	}
+
+	for(i=0; i<pipeline->hop_stats_cnt; i++) {
+		struct ks_pipeline_hop_stats *hs = &pipeline->hop_stats[i];
+
+		printf("        <hop chan_id=\"%d\">\n", hs->chan_id);
+		printf("          <frames>%llu</frames>\n",
+			(unsigned long long)hs->frames);
+		printf("          <bytes>%llu</bytes>\n",
+			(unsigned long long)hs->bytes);
+		printf("          <drops>%llu</drops>\n",
+			(unsigned long long)hs->drops);
+		printf("          <underruns>%llu</underruns>\n",
+			(unsigned long long)hs->underruns);
+		printf("          <latency_sum>%llu</latency_sum>\n",
+			(unsigned long long)hs->latency_sum);
+		printf("          <latency_samples>%llu</latency_samples>\n",
+			(unsigned long long)hs->latency_samples);
+		printf("          <latency_max>%u</latency_max>\n",
+			hs->latency_max);
+		printf("        </hop>\n");
+	}
+
+	printf("      </stats>\n");
+
 	printf("    </pipeline>\n");
 }
 
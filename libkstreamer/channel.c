@@ -26,6 +26,7 @@
 #include <libkstreamer/node.h>
 #include <libkstreamer/feature.h>
 #include <libkstreamer/req.h>
+#include <libkstreamer/path.h>
 #include <libkstreamer/logging.h>
 
 static inline struct hlist_head *ks_chan_get_hash(
@@ -34,6 +35,12 @@ static inline struct hlist_head *ks_chan_get_hash(
 	return &conn->chans_hash[id & (FEATURE_HASHSIZE - 1)];
 }
 
+static inline struct hlist_head *ks_chan_get_path_hash(
+	struct ks_conn *conn, __u32 hash)
+{
+	return &conn->chans_path_hash[hash & (PATH_HASHSIZE - 1)];
+}
+
 void ks_chan_add(struct ks_chan *chan, struct ks_conn *conn)
 {
 	chan->conn = conn;
@@ -41,11 +48,23 @@ void ks_chan_add(struct ks_chan *chan, struct ks_conn *conn)
 	hlist_add_head(
 		&ks_chan_get(chan)->node,
 		ks_chan_get_hash(conn, chan->id));
+
+	if (chan->path) {
+		chan->path_hash = ks_path_hash(chan->path);
+
+		hlist_add_head(&chan->path_node,
+			ks_chan_get_path_hash(conn, chan->path_hash));
+	}
+
+	ks_path_cache_invalidate(&conn->path_cache);
 }
 
 void ks_chan_del(struct ks_chan *chan)
 {
 	hlist_del(&chan->node);
+	hlist_del_init(&chan->path_node);
+
+	ks_path_cache_invalidate(&chan->conn->path_cache);
 
 	ks_chan_put(chan);
 }
@@ -61,9 +80,12 @@ void ks_chan_flush(struct ks_conn *conn)
 					&conn->chans_hash[i], node) {
 
 			hlist_del(&chan->node);
+			hlist_del_init(&chan->path_node);
 			ks_chan_put(chan);
 		}
 	}
+
+	ks_path_cache_invalidate(&conn->path_cache);
 }
 
 struct ks_chan *_ks_chan_get_by_id(struct ks_conn *conn, int id)
@@ -90,37 +112,46 @@ struct ks_chan *ks_chan_get_by_id(struct ks_conn *conn, int id)
 	return chan;
 }
 
-static struct ks_chan *_ks_chan_get_by_path(
+/* sys_path is canonical and relative to /sys */
+static struct ks_chan *_ks_chan_get_by_sys_path(
 	struct ks_conn *conn,
-	const char *path)
+	const char *sys_path)
 {
-	char *real_path;
-	real_path = realpath(path, NULL);
-	if (!real_path) {
-		report_conn(conn, LOG_WARNING,
-			"Cannot resolve path '%s': %s\n",
-			path, strerror(errno));
-		return NULL;
+	struct ks_chan *chan;
+	struct hlist_node *t;
+	__u32 hash = ks_path_hash(sys_path);
+
+	hlist_for_each_entry(chan, t, ks_chan_get_path_hash(conn, hash),
+								path_node) {
+		if (chan->path_hash == hash && !strcmp(chan->path, sys_path))
+			return ks_chan_get(chan);
 	}
 
-	char *sys_path = real_path + strlen("/sys");
+	return NULL;
+}
 
+static struct ks_chan *_ks_chan_get_by_path(
+	struct ks_conn *conn,
+	const char *path)
+{
 	struct ks_chan *chan;
-	struct hlist_node *t;
 
-	int i;
-	for(i=0; i<ARRAY_SIZE(conn->chans_hash); i++) {
-		hlist_for_each_entry(chan, t, &conn->chans_hash[i], node) {
-			if (!strcmp(chan->path, sys_path)) {
-				free(real_path);
-				return ks_chan_get(chan);
-			}
-		}
+	if (!strncmp(path, "/sys/", strlen("/sys/"))) {
+		chan = _ks_chan_get_by_sys_path(conn, path + strlen("/sys"));
+		if (chan)
+			return chan;
 	}
 
-	free(real_path);
+	char *sys_path;
+	sys_path = ks_path_resolve(conn, path);
+	if (!sys_path)
+		return NULL;
 
-	return NULL;
+	chan = _ks_chan_get_by_sys_path(conn, sys_path);
+
+	free(sys_path);
+
+	return chan;
 }
 
 struct ks_chan *ks_chan_get_by_path(
@@ -143,19 +174,8 @@ static struct ks_chan *_ks_chan_get_by_token(
 	struct ks_chan *chan;
 
 	switch(token->id) {
-	case TK_STRING: {
-		char *real_path;
-		real_path = realpath(token->text, NULL);
-		if (!real_path) {
-			report_conn(conn, LOG_WARNING,
-				"Cannot resolve path '%s': %s\n",
-				token->text, strerror(errno));
-			return NULL;
-		}
-
-		chan = _ks_chan_get_by_path(conn, real_path + strlen("/sys"));
-		free(real_path);
-	}
+	case TK_STRING:
+		chan = _ks_chan_get_by_path(conn, token->text);
 	break;
 
 	case TK_INTEGER:
@@ -533,25 +553,22 @@ void ks_chan_dump(
 	}
 }
 
-int ks_chan_update(struct ks_chan *chan, struct ks_conn *conn)
+/* Returns the queued request, to be waited for and put by the caller */
+struct ks_req *ks_chan_update_async(struct ks_chan *chan, struct ks_conn *conn)
 {
 	int err;
 
 	struct ks_req *req;
 	req = ks_req_alloc(conn);
-	if (!req) {
-		err = -ENOMEM;
+	if (!req)
 		goto err_req_alloc;
-	}
 
 	req->type = KS_NETLINK_CHAN_SET;
 	req->flags = NLM_F_REQUEST;
 
 	req->skb = alloc_skb(4096, GFP_KERNEL);
-	if (!req->skb) {
-		err = -ENOMEM;
+	if (!req->skb)
 		goto err_skb_alloc;
-	}
 
 	err = ks_netlink_put_attr(req->skb, KS_CHANATTR_ID,
 			&chan->id,
@@ -573,19 +590,8 @@ int ks_chan_update(struct ks_chan *chan, struct ks_conn *conn)
 	ks_conn_queue_request(conn, req);
 	ks_conn_flush_requests(conn);
 
-	ks_req_wait(req);
-	if (req->err < 0) {
-		err = req->err;
-		ks_req_put(req);
-
-		goto err_request_failed;
-	}
-
-	ks_req_put(req);
-
-	return 0;
+	return req;
 
-err_request_failed:
 err_put_attr_features:
 err_put_attr_id:
 	/* skb is freed in req_put */
@@ -593,5 +599,21 @@ err_skb_alloc:
 	ks_req_put(req);
 err_req_alloc:
 
-	return err;
+	return NULL;
+}
+
+int ks_chan_update(struct ks_chan *chan, struct ks_conn *conn)
+{
+	int err;
+
+	struct ks_req *req;
+	req = ks_chan_update_async(chan, conn);
+	if (!req)
+		return -ENOMEM;
+
+	ks_req_wait(req);
+	err = req->err;
+	ks_req_put(req);
+
+	return err < 0 ? err : 0;
 }
@@ -118,6 +118,8 @@ static const char *ks_conn_message_type_to_string(
 		return "PIPELINE_DEL";
 	case KS_NETLINK_PIPELINE_SET:
 		return "PIPELINE_SET";
+	case KS_NETLINK_EVENT:
+		return "EVENT";
 	}
 
 	return "*INVALID*";
@@ -308,12 +310,16 @@ struct ks_conn *ks_conn_create(void)
 
 	pthread_mutex_init(&conn->requests_lock, NULL);
 	INIT_LIST_HEAD(&conn->requests_pending);
-	INIT_LIST_HEAD(&conn->requests_waiting_ack);
-	INIT_LIST_HEAD(&conn->requests_multi);
+	INIT_LIST_HEAD(&conn->requests_inflight);
 
 	pthread_mutex_init(&conn->refcnt_lock, NULL);
 	pthread_rwlock_init(&conn->topology_lock, NULL);
 
+	ks_path_cache_init(&conn->path_cache);
+
+	pthread_mutex_init(&conn->event_handlers_lock, NULL);
+	INIT_LIST_HEAD(&conn->event_handlers);
+
 	ks_timerset_init(&conn->timerset, ks_conn_timers_updated);
 	ks_timer_create(&conn->timer, &conn->timerset, "ks_conn",
 		ks_conn_timer);
@@ -598,67 +604,131 @@ int ks_conn_sendmsg(struct ks_conn *conn, struct sk_buff *skb)
 	return 0;
 }
 
-static void ks_conn_receive_acknowledge(
-	struct ks_conn *conn,
-	struct nlmsghdr *nlh)
+/* The upper 16 bits of the sequence number identify the request, the lower
+ * ones the part of a multipart response
+ */
+static inline int ks_conn_req_slot(__u32 seq)
 {
-	pthread_mutex_lock(&conn->requests_lock);
+	return (seq >> 16) & (KS_CONN_REQ_RING_SIZE - 1);
+}
 
-	if (list_empty(&conn->requests_waiting_ack)) {
-		pthread_mutex_unlock(&conn->requests_lock);
+static struct ks_req *ks_conn_req_lookup(struct ks_conn *conn, __u32 seq)
+{
+	struct ks_req *req = conn->requests_ring[ks_conn_req_slot(seq)];
+
+	if (!req || (req->id >> 16) != (seq >> 16))
+		return NULL;
+
+	return req;
+}
+
+static void ks_conn_req_inflight(struct ks_conn *conn, struct ks_req *req)
+{
+	conn->requests_ring[ks_conn_req_slot(req->id)] = req;
+
+	/* All requests have the same timeout, appending keeps the list
+	 * ordered
+	 */
+	req->deadline = longtime_now() + KS_CONN_REQ_TIMEOUT;
+	list_add_tail(&req->node, &conn->requests_inflight);
+}
+
+/* Multipart responses restart the timeout at every part */
+static void ks_conn_req_touch(struct ks_conn *conn, struct ks_req *req)
+{
+	req->deadline = longtime_now() + KS_CONN_REQ_TIMEOUT;
+	list_move_tail(&req->node, &conn->requests_inflight);
+}
+
+static void ks_conn_req_done(struct ks_conn *conn, struct ks_req *req, int err)
+{
+	conn->requests_ring[ks_conn_req_slot(req->id)] = NULL;
+	list_del(&req->node);
+
+	ks_req_complete(req, err);
+	ks_req_put(req);
+}
+
+static int ks_conn_nlmsg_error(struct ks_conn *conn, struct nlmsghdr *nlh)
+{
+	if (NLMSG_PAYLOAD(nlh, 0) < sizeof(__u32)) {
 		report_conn(conn, LOG_ERR,
-			"Received ACK with no requests waiting for ACK\n");
-		return;
+			"Error in error message: missing error code.\n");
+		return -EIO;
 	}
 
-	struct ks_req *req;
-	struct ks_req *t;
-	list_for_each_entry_safe(req, t, &conn->requests_waiting_ack, node) {
-		if (req->id == nlh->nlmsg_seq)
-			goto found;
-	}
+	return -*((__u32 *)NLMSG_DATA(nlh));
+}
 
-	return;
+/* Fails the requests whose deadline has passed and returns the time until
+ * the next one expires, -1 if there are none
+ */
+static longtime_t ks_conn_requests_sweep(struct ks_conn *conn)
+{
+	longtime_t now = longtime_now();
+	struct ks_req *req, *t;
 
-found:
-	list_del(&req->node);
+	list_for_each_entry_safe(req, t, &conn->requests_inflight, node) {
+		if (req->deadline > now)
+			return req->deadline - now;
 
-	assert(!req->response_payload);
-	assert(!req->response_payload_size);
+		report_conn(conn, LOG_ERR,
+			"Timeout waiting for request %08x processing!\n",
+			req->id);
 
-	if (nlh->nlmsg_type == NLMSG_ERROR) {
-		pthread_mutex_unlock(&conn->requests_lock);
+		conn->stats.req_timeouts++;
+
+		ks_conn_req_done(conn, req, -ETIMEDOUT);
+	}
+
+	return -1;
+}
 
-		if (NLMSG_PAYLOAD(nlh, 0) < sizeof(__u32)) {
+static void ks_conn_receive_acknowledge(
+	struct ks_conn *conn,
+	struct nlmsghdr *nlh)
+{
+	struct ks_req *req;
+
+	req = ks_conn_req_lookup(conn, nlh->nlmsg_seq);
+	if (!req || req->id != nlh->nlmsg_seq) {
+
+		/* Requests sent with KS_NLM_F_NOACK are forgotten as soon as
+		 * they are sent, only their errors come back
+		 */
+		if (nlh->nlmsg_type == NLMSG_ERROR &&
+		    NLMSG_PAYLOAD(nlh, 0) >= sizeof(__u32)) {
 			report_conn(conn, LOG_ERR,
-				"Error in error message: missing error code.");
+				"Request %08x failed: %s\n",
+				nlh->nlmsg_seq,
+				strerror(*((__u32 *)NLMSG_DATA(nlh))));
 		} else {
-			ks_req_complete(req,
-				-*((__u32 *)NLMSG_DATA(nlh)));
+			ks_conn_debug_netlink(conn,
+				"Dropping ACK %08x not associated to a"
+				" request\n",
+				nlh->nlmsg_seq);
 		}
 
-		ks_req_put(req);
-		req = NULL;
+		return;
+	}
 
+	assert(!req->response_payload);
+	assert(!req->response_payload_size);
+
+	if (nlh->nlmsg_type == NLMSG_ERROR) {
+		ks_conn_req_done(conn, req, ks_conn_nlmsg_error(conn, nlh));
 		return;
 	}
 
 	ks_req_resp_append_payload(req, nlh);
 
 	if (nlh->nlmsg_flags & NLM_F_MULTI) {
-		list_add_tail(&req->node, &conn->requests_multi);
-		ks_timer_start_delta(&req->timer, 5 * SEC, req);
-		pthread_mutex_unlock(&conn->requests_lock);
+		ks_conn_req_touch(conn, req);
 
 		return;
 	}
 
-	pthread_mutex_unlock(&conn->requests_lock);
-
-	ks_req_complete(req, 0);
-
-	ks_req_put(req);
-	req = NULL;
+	ks_conn_req_done(conn, req, 0);
 }
 
 static void ks_conn_receive_multi(
@@ -666,64 +736,45 @@ static void ks_conn_receive_multi(
 	struct nlmsghdr *nlh)
 {
 	struct ks_req *req;
-	pthread_mutex_lock(&conn->requests_lock);
-
-	struct ks_req *t;
-	list_for_each_entry_safe(req, t, &conn->requests_multi, node) {
-
-		if ((req->id >> 16) == (nlh->nlmsg_seq >> 16)) {
 
-			if ((nlh->nlmsg_seq & 0xffff) != req->multi_seq) {
-				report_conn(conn, LOG_ERR,
-					"Out of sequence frame, expecting seq"
-					" %04x, received %04x\n",
-					nlh->nlmsg_seq & 0xffff,
-					req->multi_seq);
-
-				ks_req_complete(req, -EIO);
-			}
-
-			if (nlh->nlmsg_type == NLMSG_ERROR) {
-				pthread_mutex_unlock(&conn->requests_lock);
-
-				if (NLMSG_PAYLOAD(nlh, 0) < sizeof(__u32)) {
-					report_conn(conn, LOG_ERR,
-						"Error in error message:"
-						" missing error code.");
-				} else {
-					ks_req_complete(req,
-						-*((__u32 *)NLMSG_DATA(nlh)));
-				}
+	req = ks_conn_req_lookup(conn, nlh->nlmsg_seq);
+	if (!req) {
+		report_conn(conn, LOG_ERR,
+			"Dropping frame %08x not associated to an active"
+			" request\n",
+			nlh->nlmsg_seq);
+		return;
+	}
 
-				ks_req_put(req);
-				req = NULL;
+	if ((nlh->nlmsg_seq & 0xffff) != req->multi_seq) {
+		report_conn(conn, LOG_ERR,
+			"Out of sequence frame, expecting seq"
+			" %04x, received %04x\n",
+			req->multi_seq,
+			nlh->nlmsg_seq & 0xffff);
 
-				return;
-			}
+		ks_conn_req_done(conn, req, -EIO);
+		return;
+	}
 
-			ks_req_resp_append_payload(req, nlh);
+	if (nlh->nlmsg_type == NLMSG_ERROR) {
+		ks_conn_req_done(conn, req, ks_conn_nlmsg_error(conn, nlh));
+		return;
+	}
 
-			req->multi_seq++;
+	ks_req_resp_append_payload(req, nlh);
 
-			if (nlh->nlmsg_type == NLMSG_DONE) {
-				ks_conn_debug_netlink(conn,
-					"Multipart response DONE!\n");
+	req->multi_seq++;
 
-				list_del(&req->node);
-				ks_req_complete(req, 0);
-				ks_req_put(req);
-			}
+	if (nlh->nlmsg_type == NLMSG_DONE) {
+		ks_conn_debug_netlink(conn,
+			"Multipart response DONE!\n");
 
-			pthread_mutex_unlock(&conn->requests_lock);
-			return;
-		}
+		ks_conn_req_done(conn, req, 0);
+		return;
 	}
 
-	pthread_mutex_unlock(&conn->requests_lock);
-
-	report_conn(conn, LOG_ERR,
-		"Dropping frame %04x not associated to an active request\n",
-		nlh->nlmsg_seq);
+	ks_conn_req_touch(conn, req);
 }
 
 static void ks_conn_receive_unicast(
@@ -744,6 +795,75 @@ static void ks_conn_receive_unicast(
 		"Don't know how to handle non-ack, non-multi packet\n");
 }
 
+void ks_conn_add_event_handler(
+	struct ks_conn *conn,
+	struct ks_event_handler *handler)
+{
+	pthread_mutex_lock(&conn->event_handlers_lock);
+	list_add_tail(&handler->node, &conn->event_handlers);
+	pthread_mutex_unlock(&conn->event_handlers_lock);
+}
+
+void ks_conn_del_event_handler(
+	struct ks_conn *conn,
+	struct ks_event_handler *handler)
+{
+	pthread_mutex_lock(&conn->event_handlers_lock);
+	list_del(&handler->node);
+	pthread_mutex_unlock(&conn->event_handlers_lock);
+}
+
+/* Events have their own multicast group and do not take part in the
+ * topology sequence numbering
+ */
+static void ks_conn_receive_event(
+	struct ks_conn *conn,
+	struct nlmsghdr *nlh)
+{
+	struct ks_event_handler *handler;
+	struct ks_event event;
+	struct ks_attr *attr;
+	int attrs_len = KS_PAYLOAD(nlh);
+
+	if (nlh->nlmsg_type != KS_NETLINK_EVENT) {
+		report_conn(conn, LOG_ERR,
+			"Unexpected message %d in the events group\n",
+			nlh->nlmsg_type);
+		return;
+	}
+
+	memset(&event, 0, sizeof(event));
+
+	for (attr = KS_ATTRS(nlh);
+	     KS_ATTR_OK(attr, attrs_len);
+	     attr = KS_ATTR_NEXT(attr, attrs_len)) {
+
+		switch(attr->type) {
+		case KS_EVENTATTR_FEATURE_ID:
+			event.feature_id = *(__u32 *)KS_ATTR_DATA(attr);
+		break;
+
+		case KS_EVENTATTR_CHAN_ID:
+			event.chan_id = *(__u32 *)KS_ATTR_DATA(attr);
+		break;
+
+		case KS_EVENTATTR_PIPELINE_ID:
+			event.pipeline_id = *(__u32 *)KS_ATTR_DATA(attr);
+		break;
+
+		case KS_EVENTATTR_PAYLOAD:
+			event.payload = KS_ATTR_DATA(attr);
+			event.payload_len = KS_ATTR_PAYLOAD(attr);
+		break;
+		}
+	}
+
+	pthread_mutex_lock(&conn->event_handlers_lock);
+	list_for_each_entry(handler, &conn->event_handlers, node)
+		handler->func(conn, &event, handler->data);
+	pthread_mutex_unlock(&conn->event_handlers_lock);
+}
+
 static void ks_conn_receive_multicast(
 	struct ks_conn *conn,
 	struct nlmsghdr *nlh)
@@ -776,76 +896,231 @@ static void ks_conn_receive_msg(
 	if (conn->debug_netlink)
 		ks_conn_nlmsg_dump(conn, nlh, "RX");
 
-	if (src_sa->nl_groups)
+	if (src_sa->nl_groups & KS_NETLINK_GROUP_EVENTS)
+		ks_conn_receive_event(conn, nlh);
+	else if (src_sa->nl_groups)
 		ks_conn_receive_multicast(conn, nlh);
 	else
 		ks_conn_receive_unicast(conn, nlh);
 
 }
 
-static int ks_conn_receive(struct ks_conn *conn)
+struct ks_conn_rx
 {
-	int buf_size = NLMSG_SPACE(8192);
-	void *buf = malloc(buf_size);
-	memset(buf, 0, buf_size);
+	struct mmsghdr msgs[KS_CONN_RX_BATCH];
+	struct iovec iovs[KS_CONN_RX_BATCH];
+	struct sockaddr_nl sas[KS_CONN_RX_BATCH];
 
-	struct sockaddr_nl src_sa;
+	int no_recvmmsg;
 
-	struct iovec iov;
-	iov.iov_base = buf;
-	iov.iov_len = buf_size;
+	__u8 bufs[KS_CONN_RX_BATCH][KS_CONN_RX_BUFSIZE];
+};
 
-	struct msghdr msg = {};
-	msg.msg_name = &src_sa;
-	msg.msg_namelen = sizeof(src_sa);
-	msg.msg_iov = &iov;
-	msg.msg_iovlen = 1;
-	msg.msg_flags = 0;
+static struct ks_conn_rx *ks_conn_rx_alloc(void)
+{
+	struct ks_conn_rx *rx;
+	int i;
 
-	int len = recvmsg(conn->sock, &msg, 0);
-	if(len < 0) {
-		report_conn(conn, LOG_ERR,
-			"recvmsg() error: %s\n", strerror(errno));
-		free(buf);
-		return -errno;
+	rx = malloc(sizeof(*rx));
+	if (!rx)
+		return NULL;
+
+	memset(rx, 0, sizeof(*rx));
+
+	for (i=0; i<KS_CONN_RX_BATCH; i++) {
+		rx->iovs[i].iov_base = rx->bufs[i];
+		rx->iovs[i].iov_len = KS_CONN_RX_BUFSIZE;
+
+		rx->msgs[i].msg_hdr.msg_name = &rx->sas[i];
+		rx->msgs[i].msg_hdr.msg_iov = &rx->iovs[i];
+		rx->msgs[i].msg_hdr.msg_iovlen = 1;
 	}
 
-	ks_conn_debug_netlink(conn,
-		"RX========= Received packet len=%-3d groups=%d =========\n"
-		,len, src_sa.nl_groups);
+	return rx;
+}
 
-	struct nlmsghdr *nlh;
-	int len_left = len;
+/* SO_RCVBUFFORCE lets us go beyond rmem_max if we have CAP_NET_ADMIN */
+static void ks_conn_set_rcvbuf(struct ks_conn *conn, int size)
+{
+	conn->rcvbuf_target = size;
+	conn->stats.rcvbuf_forced = FALSE;
 
-	for (nlh = buf;
-	     NLMSG_OK(nlh, len_left);
-	     nlh = NLMSG_NEXT(nlh, len_left))
-		ks_conn_receive_msg(conn, nlh, &src_sa);
+#ifdef SO_RCVBUFFORCE
+	if (setsockopt(conn->sock, SOL_SOCKET, SO_RCVBUFFORCE,
+			&size, sizeof(size)) >= 0)
+		conn->stats.rcvbuf_forced = TRUE;
+	else
+#endif
+	if (setsockopt(conn->sock, SOL_SOCKET, SO_RCVBUF,
+			&size, sizeof(size)) < 0) {
+		report_conn(conn, LOG_WARNING,
+			"Cannot set socket receive buffer size: %s\n",
+			strerror(errno));
+	}
 
-	free(buf);
+	socklen_t optlen = sizeof(conn->stats.rcvbuf_size);
+	if (getsockopt(conn->sock, SOL_SOCKET, SO_RCVBUF,
+			&conn->stats.rcvbuf_size, &optlen) < 0) {
+		report_conn(conn, LOG_WARNING,
+			"Cannot get socket receive buffer size: %s\n",
+			strerror(errno));
+	}
 
 	ks_conn_debug_netlink(conn,
-		"RX====================================================\n");
+		"Socket receive buffer %d bytes (requested %d%s)\n",
+		conn->stats.rcvbuf_size, size,
+		conn->stats.rcvbuf_forced ? ", forced" : "");
+}
 
-	return 0;
+/* The kernel dropped messages for us, whatever multicast was lost cannot
+ * be recovered without a resync and unicast responses will time out
+ */
+static void ks_conn_overrun(struct ks_conn *conn)
+{
+	conn->stats.rx_overruns++;
+
+	report_conn(conn, LOG_ERR,
+		"Netlink socket overrun, topology marked invalid\n");
+
+	pthread_rwlock_wrlock(&conn->topology_lock);
+	ks_conn_set_topology_state(conn, KS_TOPOLOGY_STATE_INVALID);
+	pthread_rwlock_unlock(&conn->topology_lock);
+
+	conn->multicast_seqnum = 0;
+
+	if (conn->rcvbuf_target < KS_CONN_RCVBUF_MAX)
+		ks_conn_set_rcvbuf(conn,
+			min(conn->rcvbuf_target * 2, KS_CONN_RCVBUF_MAX));
 }
 
+/* Returns the number of datagrams received, recvmmsg() may be missing in
+ * the running kernel, in which case we fall back to one at a time
+ */
+static int ks_conn_receive_batch(struct ks_conn *conn)
+{
+	struct ks_conn_rx *rx = conn->rx;
+	int len;
+
+#ifdef MSG_WAITFORONE
+	if (!rx->no_recvmmsg) {
+		int i;
+
+		for (i=0; i<KS_CONN_RX_BATCH; i++)
+			rx->msgs[i].msg_hdr.msg_namelen = sizeof(rx->sas[i]);
+
+		int n = recvmmsg(conn->sock, rx->msgs, KS_CONN_RX_BATCH,
+							MSG_DONTWAIT, NULL);
+		if (n >= 0)
+			return n;
+
+		if (errno != ENOSYS)
+			return -errno;
+
+		rx->no_recvmmsg = TRUE;
+	}
+#endif
+
+	rx->msgs[0].msg_hdr.msg_namelen = sizeof(rx->sas[0]);
+
+	len = recvmsg(conn->sock, &rx->msgs[0].msg_hdr, MSG_DONTWAIT);
+	if (len < 0)
+		return -errno;
+
+	rx->msgs[0].msg_len = len;
+
+	return 1;
+}
+
+static int ks_conn_receive(struct ks_conn *conn)
+{
+	struct ks_conn_rx *rx = conn->rx;
+	int n;
+	int i;
 
+	do {
+		n = ks_conn_receive_batch(conn);
+		if (n < 0) {
+			if (n == -EAGAIN || n == -EINTR)
+				return 0;
+
+			if (n == -ENOBUFS) {
+				ks_conn_overrun(conn);
+				continue;
+			}
+
+			report_conn(conn, LOG_ERR,
+				"recvmmsg() error: %s\n", strerror(-n));
+
+			return n;
+		}
+
+		if (!n)
+			return 0;
+
+		conn->stats.rx_batches++;
+		conn->stats.rx_datagrams += n;
+		conn->stats.rx_batch_hist[n - 1]++;
+
+		if (n > conn->stats.rx_batch_max)
+			conn->stats.rx_batch_max = n;
+
+		for (i=0; i<n; i++) {
+			struct sockaddr_nl *src_sa = &rx->sas[i];
+			int len = rx->msgs[i].msg_len;
+
+			ks_conn_debug_netlink(conn,
+				"RX========= Received packet len=%-3d"
+				" groups=%d =========\n",
+				len, src_sa->nl_groups);
+
+			struct nlmsghdr *nlh;
+			int len_left = len;
+
+			for (nlh = (struct nlmsghdr *)rx->bufs[i];
+			     NLMSG_OK(nlh, len_left);
+			     nlh = NLMSG_NEXT(nlh, len_left))
+				ks_conn_receive_msg(conn, nlh, src_sa);
+
+			ks_conn_debug_netlink(conn,
+				"RX===================================="
+				"================\n");
+		}
+
+	/* A short batch means the socket has been drained */
+	} while (n < 0 || n == KS_CONN_RX_BATCH);
+
+	return 0;
+}
 
 static int ks_conn_send_requests(struct ks_conn *conn)
 {
 	struct ks_req *req;
 	struct sk_buff *skb = NULL;
+	LIST_HEAD(noack);
+	int err = 0;
 
 	pthread_mutex_lock(&conn->requests_lock);
 	struct ks_req *t;
 	list_for_each_entry_safe(req, t, &conn->requests_pending, node) {
+
+		/* Requests are sent in order, the following ones wait too */
+		if (!(req->flags & KS_NLM_F_NOACK) &&
+		    conn->requests_ring[ks_conn_req_slot(req->id)]) {
+			if (!req->ring_full_counted) {
+				conn->stats.tx_ring_full++;
+				req->ring_full_counted = TRUE;
+			}
+
+			break;
+		}
 retry:
 		if (!skb)
 			skb = alloc_skb(4096, GFP_KERNEL);
 
-		if (!skb)
-			return -ENOMEM;
+		if (!skb) {
+			err = -ENOMEM;
+			break;
+		}
 
 		void *oldtail = skb->tail;
 
@@ -860,12 +1135,6 @@ retry:
 		}
 
 		if (req->skb) {
-			if (!skb)
-				skb = alloc_skb(4096, GFP_KERNEL);
-
-			if (!skb)
-				return -ENOMEM;
-
 			if (req->skb->len >= skb_tailroom(skb)) {
 				skb_trim(skb, oldtail - skb->data);
 
@@ -882,9 +1151,11 @@ retry:
 		nlh->nlmsg_len = skb->tail - oldtail;
 
 		list_del(&req->node);
-		list_add_tail(&req->node, &conn->requests_waiting_ack);
 
-		ks_timer_start_delta(&req->timer, 5 * SEC, req);
+		if (req->flags & KS_NLM_F_NOACK)
+			list_add_tail(&req->node, &noack);
+		else
+			ks_conn_req_inflight(conn, req);
 	}
 	pthread_mutex_unlock(&conn->requests_lock);
 
@@ -893,7 +1164,34 @@ retry:
 		skb = NULL;
 	}
 
-	return 0;
+	list_for_each_entry_safe(req, t, &noack, node) {
+		list_del(&req->node);
+
+		conn->stats.tx_noack++;
+
+		ks_req_complete(req, 0);
+		ks_req_put(req);
+	}
+
+	return err;
+}
+
+/* Called once the protocol thread is gone */
+static void ks_conn_abort_requests(struct ks_conn *conn, int err)
+{
+	struct ks_req *req, *t;
+
+	list_for_each_entry_safe(req, t, &conn->requests_inflight, node)
+		ks_conn_req_done(conn, req, err);
+
+	pthread_mutex_lock(&conn->requests_lock);
+	list_for_each_entry_safe(req, t, &conn->requests_pending, node) {
+		list_del(&req->node);
+
+		ks_req_complete(req, err);
+		ks_req_put(req);
+	}
+	pthread_mutex_unlock(&conn->requests_lock);
 }
 
 void ks_conn_send_message(
@@ -974,6 +1272,11 @@ void *ks_protocol_thread_main(void *data)
 		ks_timerset_run(&conn->timerset);
 
 		longtime_t timeout = ks_timerset_next(&conn->timerset);
+		longtime_t req_timeout = ks_conn_requests_sweep(conn);
+
+		if (req_timeout != -1 &&
+		    (timeout == -1 || req_timeout < timeout))
+			timeout = req_timeout;
 
 		int timeout_ms;
 		if (timeout == -1)
@@ -1051,6 +1354,14 @@ int ks_conn_establish(struct ks_conn *conn)
 	conn->cmd_read = filedes[0];
 	conn->cmd_write = filedes[1];
 
+	conn->rx = ks_conn_rx_alloc();
+	if (!conn->rx) {
+		report_conn(conn, LOG_ERR,
+			"Cannot allocate receive buffers\n");
+		err = -ENOMEM;
+		goto err_rx_alloc;
+	}
+
 	conn->sock = socket(AF_NETLINK, SOCK_DGRAM, NETLINK_KSTREAMER);
 	if (conn->sock < 0) {
 		report_conn(conn, LOG_ERR,
@@ -1060,11 +1371,14 @@ int ks_conn_establish(struct ks_conn *conn)
 		goto err_socket;
 	}
 
+	ks_conn_set_rcvbuf(conn, KS_CONN_RCVBUF_MIN);
+
 	struct sockaddr_nl bind_sa;
 	memset(&bind_sa, 0, sizeof(bind_sa));
 	bind_sa.nl_family = AF_NETLINK;
 	bind_sa.nl_pid = getpid();
-	bind_sa.nl_groups = KS_NETLINK_GROUP_TOPOLOGY;
+	bind_sa.nl_groups = KS_NETLINK_GROUP_TOPOLOGY |
+				KS_NETLINK_GROUP_EVENTS;
 
 	if (bind(conn->sock, (struct sockaddr *)&bind_sa,
 						sizeof(bind_sa)) < 0) {
@@ -1127,6 +1441,9 @@ err_pthread_attr_init:
 err_bind:
 	close(conn->sock);
 err_socket:
+	free(conn->rx);
+	conn->rx = NULL;
+err_rx_alloc:
 err_fcntl_1:
 err_fcntl_0:
 	close(conn->cmd_read);
@@ -1154,6 +1471,11 @@ void ks_conn_disconnect(struct ks_conn *conn)
 	close(conn->cmd_write);
 	close(conn->sock);
 
+	ks_conn_abort_requests(conn, -ENOTCONN);
+
+	free(conn->rx);
+	conn->rx = NULL;
+
 	ks_pipeline_flush(conn);
 	ks_chan_flush(conn);
 	ks_node_flush(conn);
@@ -1172,6 +1494,9 @@ void ks_conn_destroy(struct ks_conn *conn)
 	pthread_mutex_destroy(&conn->requests_lock);
 	pthread_rwlock_destroy(&conn->topology_lock);
 	pthread_mutex_destroy(&conn->refcnt_lock);
+	pthread_mutex_destroy(&conn->event_handlers_lock);
+
+	ks_path_cache_destroy(&conn->path_cache);
 
 	free(conn);
 }
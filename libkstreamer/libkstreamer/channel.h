@@ -31,6 +31,8 @@ struct ks_conn;
 struct ks_chan
 {
 	struct hlist_node node;
+	struct hlist_node path_node;
+	__u32 path_hash;
 
 	int refcnt;
 
@@ -81,6 +83,7 @@ void ks_chan_del(struct ks_chan *chan);
 void ks_chan_flush(struct ks_conn *conn);
 
 int ks_chan_update(struct ks_chan *chan, struct ks_conn *conn);
+struct ks_req *ks_chan_update_async(struct ks_chan *chan, struct ks_conn *conn);
 
 void ks_chan_handle_topology_update(
 	struct ks_conn *conn,
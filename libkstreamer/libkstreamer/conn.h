@@ -24,6 +24,7 @@
 #include "node.h"
 #include "channel.h"
 #include "pipeline.h"
+#include "path.h"
 #include "timer.h"
 
 enum ks_conn_message_type
@@ -55,6 +56,34 @@ enum ks_topology_state
 	KS_TOPOLOGY_STATE_INVALID,
 };
 
+/* Event multicasted by a kernel soft feature, e.g. a detected DTMF digit.
+ * chan_id and pipeline_id are 0 when not applicable, the payload is
+ * defined by the feature and only valid during the handler's call.
+ */
+struct ks_event
+{
+	__u32 feature_id;
+	__u32 chan_id;
+	__u32 pipeline_id;
+
+	void *payload;
+	int payload_len;
+};
+
+struct ks_conn;
+
+struct ks_event_handler
+{
+	struct list_head node;
+
+	/* Called from the protocol thread */
+	void (*func)(
+		struct ks_conn *conn,
+		struct ks_event *event,
+		void *data);
+	void *data;
+};
+
 #define FEATURE_HASHBITS 8
 #define FEATURE_HASHSIZE ((1 << FEATURE_HASHBITS) - 1)
 
@@ -67,6 +96,50 @@ enum ks_topology_state
 #define NODE_HASHBITS 8
 #define NODE_HASHSIZE ((1 << NODE_HASHBITS) - 1)
 
+#define PATH_HASHBITS 10
+#define PATH_HASHSIZE (1 << PATH_HASHBITS)
+
+/* Requests in flight, a request whose slot is still busy waits in the
+ * pending queue
+ */
+#define KS_CONN_REQ_RING_BITS 8
+#define KS_CONN_REQ_RING_SIZE (1 << KS_CONN_REQ_RING_BITS)
+
+#define KS_CONN_REQ_TIMEOUT (5 * SEC)
+
+/* Datagrams fetched by a single recvmmsg() */
+#define KS_CONN_RX_BATCH 16
+#define KS_CONN_RX_BUFSIZE NLMSG_SPACE(8192)
+
+/* The socket's receive buffer starts at KS_CONN_RCVBUF_MIN and is doubled
+ * at each overrun, up to KS_CONN_RCVBUF_MAX
+ */
+#define KS_CONN_RCVBUF_MIN (256 * 1024)
+#define KS_CONN_RCVBUF_MAX (8 * 1024 * 1024)
+
+/* Updated by the protocol thread only, readers may see slightly stale
+ * values
+ */
+struct ks_conn_stats
+{
+	unsigned long rx_batches;
+	unsigned long rx_datagrams;
+	int rx_batch_max;
+
+	/* Indexed by the number of datagrams in the batch minus one */
+	unsigned long rx_batch_hist[KS_CONN_RX_BATCH];
+
+	unsigned long rx_overruns;
+	int rcvbuf_size;
+	int rcvbuf_forced;
+
+	unsigned long tx_noack;
+	unsigned long tx_ring_full;
+	unsigned long req_timeouts;
+};
+
+struct ks_conn_rx;
+
 struct ks_conn
 {
 	pthread_mutex_t refcnt_lock;
@@ -80,7 +153,20 @@ struct ks_conn
 	struct hlist_head nodes_hash[NODE_HASHSIZE];
 	struct hlist_head pipelines_hash[PIPELINE_HASHSIZE];
 
+	/* Same objects, keyed by their sysfs path */
+	struct hlist_head chans_path_hash[PATH_HASHSIZE];
+	struct hlist_head nodes_path_hash[PATH_HASHSIZE];
+	struct hlist_head pipelines_path_hash[PATH_HASHSIZE];
+
+	struct ks_path_cache path_cache;
+
 	int sock;
+	int rcvbuf_target;
+
+	/* Used by the protocol thread only */
+	struct ks_conn_rx *rx;
+
+	struct ks_conn_stats stats;
 
 	struct ks_netlink_version_response version;
 
@@ -99,8 +185,13 @@ struct ks_conn
 
 	pthread_mutex_t requests_lock;
 	struct list_head requests_pending;
-	struct list_head requests_waiting_ack;
-	struct list_head requests_multi;
+
+	/* Owned by the protocol thread: requests sent and not yet completed,
+	 * indexed by sequence number and ordered by deadline
+	 */
+	struct ks_req *requests_ring[KS_CONN_REQ_RING_SIZE];
+	struct list_head requests_inflight;
+
 	struct sk_buff *out_skb;
 
 	struct ks_timerset timerset;
@@ -113,6 +204,9 @@ struct ks_conn
 		struct ks_conn *conn,
 		int message_type,
 		void *object);
+
+	pthread_mutex_t event_handlers_lock;
+	struct list_head event_handlers;
 };
 
 struct ks_req;
@@ -139,6 +233,13 @@ int ks_conn_remote_topology_lock(struct ks_conn *conn);
 int ks_conn_remote_topology_trylock(struct ks_conn *conn);
 int ks_conn_remote_topology_unlock(struct ks_conn *conn);
 
+void ks_conn_add_event_handler(
+	struct ks_conn *conn,
+	struct ks_event_handler *handler);
+void ks_conn_del_event_handler(
+	struct ks_conn *conn,
+	struct ks_event_handler *handler);
+
 #ifdef _LIBKSTREAMER_PRIVATE_
 
 #include <linux/types.h>
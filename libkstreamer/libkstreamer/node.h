@@ -28,6 +28,8 @@ struct ks_conn;
 struct ks_node
 {
 	struct hlist_node node;
+	struct hlist_node path_node;
+	__u32 path_hash;
 
 	int refcnt;
 
@@ -0,0 +1,72 @@
+/*
+ * Userland Kstreamer interface, path to sysfs node lookup cache
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#ifndef _LIBKSTREAMER_PATH_H
+#define _LIBKSTREAMER_PATH_H
+
+#include <pthread.h>
+
+#include <linux/types.h>
+
+#define KS_PATH_CACHE_BITS 6
+#define KS_PATH_CACHE_SIZE (1 << KS_PATH_CACHE_BITS)
+
+struct ks_conn;
+
+/* Maps a path as the user wrote it (possibly thru sysfs symlinks) to the
+ * canonical sysfs path of nodes and channels, without the leading "/sys"
+ */
+struct ks_path_cache_entry
+{
+	int generation;
+	__u32 hash;
+
+	char *path;
+	char *sys_path;
+};
+
+struct ks_path_cache
+{
+	pthread_mutex_t lock;
+
+	/* Entries of older generations are stale */
+	int generation;
+
+	unsigned long hits;
+	unsigned long misses;
+
+	struct ks_path_cache_entry entries[KS_PATH_CACHE_SIZE];
+};
+
+static inline __u32 ks_path_hash(const char *path)
+{
+	__u32 hash = 2166136261U;
+
+	while(*path) {
+		hash ^= (unsigned char)*path++;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+#ifdef _LIBKSTREAMER_PRIVATE_
+
+void ks_path_cache_init(struct ks_path_cache *cache);
+void ks_path_cache_destroy(struct ks_path_cache *cache);
+void ks_path_cache_invalidate(struct ks_path_cache *cache);
+
+char *ks_path_resolve(struct ks_conn *conn, const char *path);
+
+#endif
+
+#endif
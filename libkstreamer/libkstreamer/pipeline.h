@@ -30,6 +30,8 @@ struct ks_conn;
 struct ks_pipeline
 {
 	struct hlist_node node;
+	struct hlist_node path_node;
+	__u32 path_hash;
 
 	struct ks_conn *conn;
 
@@ -43,6 +45,11 @@ struct ks_pipeline
 
 	struct ks_chan *chans[32];
 	int chans_cnt;
+
+	/* As of the last message received, see ks_pipeline_update_stats() */
+	struct ks_pipeline_stats stats;
+	struct ks_pipeline_hop_stats hop_stats[32];
+	int hop_stats_cnt;
 };
 
 struct ks_pipeline *ks_pipeline_alloc(void);
@@ -66,13 +73,26 @@ void ks_pipeline_dump(
 
 int ks_pipeline_create(struct ks_pipeline *pipeline, struct ks_conn *conn);
 int ks_pipeline_update(struct ks_pipeline *pipeline, struct ks_conn *conn);
+
+struct ks_req;
+struct ks_req *ks_pipeline_update_async(
+	struct ks_pipeline *pipeline,
+	struct ks_conn *conn,
+	int (*callback)(struct ks_req *req),
+	void *data);
+
 int ks_pipeline_restart(struct ks_pipeline *pipeline, struct ks_conn *conn);
 int ks_pipeline_destroy(struct ks_pipeline *pipeline, struct ks_conn *conn);
+int ks_pipeline_destroy_noack(
+	struct ks_pipeline *pipeline,
+	struct ks_conn *conn);
 
 int ks_pipeline_update_chans(
 	struct ks_pipeline *pipeline,
 	struct ks_conn *conn);
 
+int ks_pipeline_update_stats(struct ks_conn *conn);
+
 struct ks_node;
 int ks_pipeline_autoroute(
 	struct ks_pipeline *pipeline,
@@ -16,6 +16,7 @@
 #include <pthread.h>
 
 #include <list.h>
+#include <longtime.h>
 
 #include <libkstreamer/util.h>
 
@@ -23,6 +24,7 @@ struct ks_conn;
 
 struct ks_req
 {
+	/* In conn's requests_pending, then in requests_inflight */
 	struct list_head node;
 
 	struct ks_conn *conn;
@@ -32,7 +34,11 @@ struct ks_req
 	__u32 id;
 	int multi_seq;
 
-	struct ks_timer timer;
+	/* Swept by the protocol thread once in flight */
+	longtime_t deadline;
+
+	/* Already accounted in tx_ring_full while waiting for its slot */
+	KSBOOL ring_full_counted;
 
 	pthread_mutex_t completed_lock;
 	pthread_cond_t completed_cond;
@@ -41,6 +47,10 @@ struct ks_req
 	int err;
 
 	struct sk_buff *skb;
+
+	/* Called by the protocol thread on completion, after waiters have
+	 * been woken up. It must not wait for other requests.
+	 */
 	int (*response_callback)(struct ks_req *req);
 	void *response_data;
 
@@ -57,6 +67,7 @@ struct ks_req *ks_req_alloc(struct ks_conn *conn);
 struct ks_req *ks_req_get(struct ks_req *req);
 void ks_req_put(struct ks_req *req);
 void ks_req_wait(struct ks_req *req);
+KSBOOL ks_req_completed(struct ks_req *req);
 void ks_req_complete(struct ks_req *req, int err);
 
 #ifdef _LIBKSTREAMER_PRIVATE_
@@ -22,6 +22,7 @@
 #include <libkstreamer/libkstreamer.h>
 #include <libkstreamer/node.h>
 #include <libkstreamer/conn.h>
+#include <libkstreamer/path.h>
 #include <libkstreamer/feature.h>
 #include <libkstreamer/util.h>
 #include <libkstreamer/logging.h>
@@ -35,6 +36,12 @@ static inline struct hlist_head *ks_node_get_hash(
 	return &conn->nodes_hash[id & (NODE_HASHSIZE - 1)];
 }
 
+static inline struct hlist_head *ks_node_get_path_hash(
+	struct ks_conn *conn, __u32 hash)
+{
+	return &conn->nodes_path_hash[hash & (PATH_HASHSIZE - 1)];
+}
+
 void ks_node_add(struct ks_node *node, struct ks_conn *conn)
 {
 	node->conn = conn;
@@ -42,11 +49,23 @@ void ks_node_add(struct ks_node *node, struct ks_conn *conn)
 	hlist_add_head(
 		&ks_node_get(node)->node,
 		ks_node_get_hash(conn, node->id));
+
+	if (node->path) {
+		node->path_hash = ks_path_hash(node->path);
+
+		hlist_add_head(&node->path_node,
+			ks_node_get_path_hash(conn, node->path_hash));
+	}
+
+	ks_path_cache_invalidate(&conn->path_cache);
 }
 
 void ks_node_del(struct ks_node *node)
 {
 	hlist_del(&node->node);
+	hlist_del_init(&node->path_node);
+
+	ks_path_cache_invalidate(&node->conn->path_cache);
 
 	ks_node_put(node);
 }
@@ -62,9 +81,12 @@ void ks_node_flush(struct ks_conn *conn)
 					&conn->nodes_hash[i], node) {
 
 			hlist_del(&node->node);
+			hlist_del_init(&node->path_node);
 			ks_node_put(node);
 		}
 	}
+
+	ks_path_cache_invalidate(&conn->path_cache);
 }
 
 struct ks_node *_ks_node_get_by_id(
@@ -95,37 +117,49 @@ struct ks_node *ks_node_get_by_id(
 	return node;
 }
 
-static struct ks_node *_ks_node_get_by_path(
+/* sys_path is canonical and relative to /sys */
+static struct ks_node *_ks_node_get_by_sys_path(
 	struct ks_conn *conn,
-	const char *path)
+	const char *sys_path)
 {
-	char *real_path;
-	real_path = realpath(path, NULL);
-	if (!real_path) {
-		report_conn(conn, LOG_WARNING,
-			"Cannot resolve path '%s': %s\n",
-			path, strerror(errno));
-		return NULL;
+	struct ks_node *node;
+	struct hlist_node *t;
+	__u32 hash = ks_path_hash(sys_path);
+
+	hlist_for_each_entry(node, t, ks_node_get_path_hash(conn, hash),
+								path_node) {
+		if (node->path_hash == hash && !strcmp(node->path, sys_path))
+			return ks_node_get(node);
 	}
 
-	char *sys_path = real_path + strlen("/sys");
+	return NULL;
+}
 
+static struct ks_node *_ks_node_get_by_path(
+	struct ks_conn *conn,
+	const char *path)
+{
 	struct ks_node *node;
-	struct hlist_node *t;
 
-	int i;
-	for(i=0; i<ARRAY_SIZE(conn->nodes_hash); i++) {
-		hlist_for_each_entry(node, t, &conn->nodes_hash[i], node) {
-			if (!strcmp(node->path, sys_path)) {
-				free(real_path);
-				return ks_node_get(node);
-			}
-		}
+	/* A node's path is canonical, if it matches there is nothing to
+	 * resolve
+	 */
+	if (!strncmp(path, "/sys/", strlen("/sys/"))) {
+		node = _ks_node_get_by_sys_path(conn, path + strlen("/sys"));
+		if (node)
+			return node;
 	}
 
-	free(real_path);
+	char *sys_path;
+	sys_path = ks_path_resolve(conn, path);
+	if (!sys_path)
+		return NULL;
+
+	node = _ks_node_get_by_sys_path(conn, sys_path);
 
-	return NULL;
+	free(sys_path);
+
+	return node;
 }
 
 struct ks_node *ks_node_get_by_path(
@@ -0,0 +1,125 @@
+/*
+ * Userland Kstreamer interface, path to sysfs node lookup cache
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <libkstreamer/libkstreamer.h>
+#include <libkstreamer/conn.h>
+#include <libkstreamer/path.h>
+#include <libkstreamer/logging.h>
+
+void ks_path_cache_init(struct ks_path_cache *cache)
+{
+	memset(cache, 0, sizeof(*cache));
+
+	pthread_mutex_init(&cache->lock, NULL);
+
+	/* Zeroed entries must not look valid */
+	cache->generation = 1;
+}
+
+static void ks_path_cache_entry_release(struct ks_path_cache_entry *entry)
+{
+	if (entry->path)
+		free(entry->path);
+
+	if (entry->sys_path)
+		free(entry->sys_path);
+
+	memset(entry, 0, sizeof(*entry));
+}
+
+void ks_path_cache_destroy(struct ks_path_cache *cache)
+{
+	int i;
+
+	for(i=0; i<ARRAY_SIZE(cache->entries); i++)
+		ks_path_cache_entry_release(&cache->entries[i]);
+
+	pthread_mutex_destroy(&cache->lock);
+}
+
+/* Symlinks may point elsewhere once a node or channel has gone away, we
+ * do not try to figure out which ones
+ */
+void ks_path_cache_invalidate(struct ks_path_cache *cache)
+{
+	pthread_mutex_lock(&cache->lock);
+	cache->generation++;
+	pthread_mutex_unlock(&cache->lock);
+}
+
+/* Returns the canonical path relative to /sys, to be freed by the caller */
+char *ks_path_resolve(struct ks_conn *conn, const char *path)
+{
+	struct ks_path_cache *cache = &conn->path_cache;
+	struct ks_path_cache_entry *entry;
+	__u32 hash = ks_path_hash(path);
+	char *sys_path;
+
+	entry = &cache->entries[hash & (KS_PATH_CACHE_SIZE - 1)];
+
+	pthread_mutex_lock(&cache->lock);
+	if (entry->generation == cache->generation &&
+	    entry->hash == hash &&
+	    !strcmp(entry->path, path)) {
+		sys_path = strdup(entry->sys_path);
+		cache->hits++;
+		pthread_mutex_unlock(&cache->lock);
+
+		return sys_path;
+	}
+
+	cache->misses++;
+	pthread_mutex_unlock(&cache->lock);
+
+	char *real_path;
+	real_path = realpath(path, NULL);
+	if (!real_path) {
+		report_conn(conn, LOG_WARNING,
+			"Cannot resolve path '%s': %s\n",
+			path, strerror(errno));
+		return NULL;
+	}
+
+	if (strncmp(real_path, "/sys/", strlen("/sys/"))) {
+		report_conn(conn, LOG_WARNING,
+			"Path '%s' is not in sysfs\n", path);
+		free(real_path);
+		return NULL;
+	}
+
+	sys_path = strdup(real_path + strlen("/sys"));
+	free(real_path);
+
+	if (!sys_path)
+		return NULL;
+
+	pthread_mutex_lock(&cache->lock);
+	ks_path_cache_entry_release(entry);
+
+	entry->path = strdup(path);
+	entry->sys_path = strdup(sys_path);
+
+	if (entry->path && entry->sys_path) {
+		entry->hash = hash;
+		entry->generation = cache->generation;
+	} else
+		ks_path_cache_entry_release(entry);
+
+	pthread_mutex_unlock(&cache->lock);
+
+	return sys_path;
+}
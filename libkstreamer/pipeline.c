@@ -28,6 +28,7 @@
 #include <libkstreamer/node.h>
 #include <libkstreamer/feature.h>
 #include <libkstreamer/req.h>
+#include <libkstreamer/path.h>
 #include <libkstreamer/router.h>
 #include <libkstreamer/logging.h>
 
@@ -37,6 +38,12 @@ static inline struct hlist_head *ks_pipeline_get_hash(
 	return &conn->pipelines_hash[id & (PIPELINE_HASHSIZE - 1)];
 }
 
+static inline struct hlist_head *ks_pipeline_get_path_hash(
+	struct ks_conn *conn, __u32 hash)
+{
+	return &conn->pipelines_path_hash[hash & (PATH_HASHSIZE - 1)];
+}
+
 void ks_pipeline_add(struct ks_pipeline *pipeline, struct ks_conn *conn)
 {
 	pipeline->conn = conn;
@@ -44,11 +51,19 @@ void ks_pipeline_add(struct ks_pipeline *pipeline, struct ks_conn *conn)
 	hlist_add_head(
 		&ks_pipeline_get(pipeline)->node,
 		ks_pipeline_get_hash(conn, pipeline->id));
+
+	if (pipeline->path) {
+		pipeline->path_hash = ks_path_hash(pipeline->path);
+
+		hlist_add_head(&pipeline->path_node,
+			ks_pipeline_get_path_hash(conn, pipeline->path_hash));
+	}
 }
 
 void ks_pipeline_del(struct ks_pipeline *pipeline)
 {
 	hlist_del(&pipeline->node);
+	hlist_del_init(&pipeline->path_node);
 
 	int i;
 	for (i=0; i<pipeline->chans_cnt; i++)
@@ -68,6 +83,7 @@ void ks_pipeline_flush(struct ks_conn *conn)
 					&conn->pipelines_hash[i], node) {
 
 			hlist_del(&pipeline->node);
+			hlist_del_init(&pipeline->path_node);
 			ks_pipeline_put(pipeline);
 		}
 	}
@@ -108,14 +124,13 @@ static struct ks_pipeline *_ks_pipeline_get_by_path(
 {
 	struct ks_pipeline *pipeline;
 	struct hlist_node *t;
+	__u32 hash = ks_path_hash(path);
 
-	int i;
-	for(i=0; i<ARRAY_SIZE(conn->pipelines_hash); i++) {
-		hlist_for_each_entry(pipeline, t, &conn->pipelines_hash[i],
-								node) {
-			if (!strcmp(pipeline->path, path))
-				return ks_pipeline_get(pipeline);
-		}
+	hlist_for_each_entry(pipeline, t,
+			ks_pipeline_get_path_hash(conn, hash), path_node) {
+		if (pipeline->path_hash == hash &&
+		    !strcmp(pipeline->path, path))
+			return ks_pipeline_get(pipeline);
 	}
 
 	return NULL;
@@ -202,6 +217,10 @@ const char *ks_netlink_pipeline_attr_to_string(
 		return "Status";
 	case KS_PIPELINEATTR_CHAN_ID:
 		return "Chan ID";
+	case KS_PIPELINEATTR_STATS:
+		return "Stats";
+	case KS_PIPELINEATTR_HOP_STATS:
+		return "Hop stats";
 	}
 
 	return "UNKNOWN";
@@ -272,6 +291,45 @@ static const char *ks_pipeline_status_to_string(
 	return "*INVALID*";
 }
 
+static void ks_pipeline_stats_from_nlmsg(
+	struct ks_pipeline *pipeline,
+	struct nlmsghdr *nlh)
+{
+	struct ks_attr *attr;
+	int attrs_len = KS_PAYLOAD(nlh);
+
+	pipeline->hop_stats_cnt = 0;
+
+	for (attr = KS_ATTRS(nlh);
+	     KS_ATTR_OK(attr, attrs_len);
+	     attr = KS_ATTR_NEXT(attr, attrs_len)) {
+
+		switch(attr->type) {
+		case KS_PIPELINEATTR_STATS:
+			if (KS_ATTR_PAYLOAD(attr) < sizeof(pipeline->stats))
+				break;
+
+			memcpy(&pipeline->stats, KS_ATTR_DATA(attr),
+					sizeof(pipeline->stats));
+		break;
+
+		case KS_PIPELINEATTR_HOP_STATS:
+			if (KS_ATTR_PAYLOAD(attr) <
+					sizeof(pipeline->hop_stats[0]) ||
+			    pipeline->hop_stats_cnt >=
+					ARRAY_SIZE(pipeline->hop_stats))
+				break;
+
+			memcpy(&pipeline->hop_stats[pipeline->hop_stats_cnt],
+				KS_ATTR_DATA(attr),
+				sizeof(pipeline->hop_stats[0]));
+
+			pipeline->hop_stats_cnt++;
+		break;
+		}
+	}
+}
+
 static struct ks_pipeline *ks_pipeline_create_from_nlmsg(
 	struct ks_conn *conn,
 	struct nlmsghdr *nlh)
@@ -325,6 +383,10 @@ static struct ks_pipeline *ks_pipeline_create_from_nlmsg(
 		}
 		break;
 
+		case KS_PIPELINEATTR_STATS:
+		case KS_PIPELINEATTR_HOP_STATS:
+		break;
+
 		default:
 			report_conn(conn, LOG_ERR, "   Attribute '%s'\n",
 				ks_netlink_pipeline_attr_to_string(
@@ -332,6 +394,8 @@ static struct ks_pipeline *ks_pipeline_create_from_nlmsg(
 		}
 	}
 
+	ks_pipeline_stats_from_nlmsg(pipeline, nlh);
+
 	return pipeline;
 }
 
@@ -359,12 +423,28 @@ static void ks_pipeline_update_from_nlmsg(
 			        *(__u32 *)KS_ATTR_DATA(attr);
 		break;
 
-		case KS_PIPELINEATTR_PATH:
+		case KS_PIPELINEATTR_PATH: {
+			int hashed = !hlist_unhashed(&pipeline->path_node);
+
+			if (hashed)
+				hlist_del_init(&pipeline->path_node);
+
 			if (pipeline->path)
 				free(pipeline->path);
 
 			pipeline->path = strndup(KS_ATTR_DATA(attr),
 					KS_ATTR_PAYLOAD(attr));
+
+			if (hashed && pipeline->path) {
+				pipeline->path_hash =
+					ks_path_hash(pipeline->path);
+
+				hlist_add_head(&pipeline->path_node,
+					ks_pipeline_get_path_hash(
+						pipeline->conn,
+						pipeline->path_hash));
+			}
+		}
 		break;
 
 		case KS_PIPELINEATTR_CHAN_ID: {
@@ -411,12 +491,18 @@ static void ks_pipeline_update_from_nlmsg(
 		}
 		break;
 
+		case KS_PIPELINEATTR_STATS:
+		case KS_PIPELINEATTR_HOP_STATS:
+		break;
+
 		default:
 			report_conn(conn, LOG_ERR, "   Attribute '%s'\n",
 				ks_netlink_pipeline_attr_to_string(
 					attr->type));
 		}
 	}
+
+	ks_pipeline_stats_from_nlmsg(pipeline, nlh);
 }
 
 void ks_pipeline_handle_topology_update(
@@ -430,6 +516,8 @@ void ks_pipeline_handle_topology_update(
 		pipeline = _ks_pipeline_get_by_id(conn,
 				ks_pipeline_nlh_to_id(conn, nlh));
 		if (pipeline) {
+			/* Pipelines are dumped again to refresh the stats */
+			ks_pipeline_stats_from_nlmsg(pipeline, nlh);
 			ks_pipeline_put(pipeline);
 			break;
 		}
@@ -520,6 +608,37 @@ void ks_pipeline_nlmsg_dump(
 				*(__u32 *)KS_ATTR_DATA(attr));
 		break;
 
+		case KS_PIPELINEATTR_STATS: {
+			struct ks_pipeline_stats stats;
+
+			memcpy(&stats, KS_ATTR_DATA(attr), sizeof(stats));
+
+			report_conn(conn, LOG_DEBUG,
+				"%s  Stats : %llu frames %llu bytes"
+				" %llu drops %llu underruns\n", prefix,
+				(unsigned long long)stats.frames,
+				(unsigned long long)stats.bytes,
+				(unsigned long long)stats.drops,
+				(unsigned long long)stats.underruns);
+		}
+		break;
+
+		case KS_PIPELINEATTR_HOP_STATS: {
+			struct ks_pipeline_hop_stats hop_stats;
+
+			memcpy(&hop_stats, KS_ATTR_DATA(attr),
+					sizeof(hop_stats));
+
+			report_conn(conn, LOG_DEBUG,
+				"%s  Hop   : 0x%08x %llu frames"
+				" %llu drops %llu underruns\n", prefix,
+				hop_stats.chan_id,
+				(unsigned long long)hop_stats.frames,
+				(unsigned long long)hop_stats.drops,
+				(unsigned long long)hop_stats.underruns);
+		}
+		break;
+
 		default:
 			report_conn(conn, LOG_ERR,
 				"%s  Attribute '%s'\n", prefix,
@@ -539,6 +658,32 @@ void ks_pipeline_dump(
 	report_conn(conn, level, "  Status: %s\n",
 		ks_pipeline_status_to_string(pipeline->status));
 
+	report_conn(conn, level,
+		"  Stats : %llu frames, %llu bytes, %llu drops,"
+		" %llu underruns\n",
+		(unsigned long long)pipeline->stats.frames,
+		(unsigned long long)pipeline->stats.bytes,
+		(unsigned long long)pipeline->stats.drops,
+		(unsigned long long)pipeline->stats.underruns);
+
+	if (pipeline->stats.latency_samples) {
+		report_conn(conn, level,
+			"  Latency: avg %lluns max %uns\n",
+			(unsigned long long)(pipeline->stats.latency_sum /
+				pipeline->stats.latency_samples),
+			pipeline->stats.latency_max);
+
+		char hist[KS_PIPELINE_LATENCY_BUCKETS * 11 + 1] = "";
+		int pos = 0;
+		int j;
+
+		for(j=0; j<KS_PIPELINE_LATENCY_BUCKETS; j++)
+			pos += snprintf(hist + pos, sizeof(hist) - pos,
+				" %u", pipeline->stats.latency_hist[j]);
+
+		report_conn(conn, level, "  Latency histogram:%s\n", hist);
+	}
+
 	int i;
 	for(i=0; i<pipeline->chans_cnt; i++) {
 
@@ -549,6 +694,27 @@ void ks_pipeline_dump(
 			chan->path,
 			chan->to->path);
 
+		int j;
+		for(j=0; j<pipeline->hop_stats_cnt; j++) {
+			struct ks_pipeline_hop_stats *hs =
+						&pipeline->hop_stats[j];
+
+			if (hs->chan_id != chan->id)
+				continue;
+
+			report_conn(conn, level,
+				"  Hop   : %llu frames, %llu drops,"
+				" %llu underruns, latency avg %lluns"
+				" max %uns\n",
+				(unsigned long long)hs->frames,
+				(unsigned long long)hs->drops,
+				(unsigned long long)hs->underruns,
+				(unsigned long long)(hs->latency_samples ?
+					hs->latency_sum / hs->latency_samples :
+					0),
+				hs->latency_max);
+		}
+
 		struct ks_feature_value *featval;
 		list_for_each_entry(featval, &chan->features, node) {
 			report_conn(conn, level,
@@ -624,25 +790,31 @@ err_req_alloc:
 	return err;
 }
 
-int ks_pipeline_update(struct ks_pipeline *pipeline, struct ks_conn *conn)
+/* Queues the request and returns it without waiting, the callback, if
+ * any, is called by the protocol thread on completion with data in
+ * req->response_data. The returned request is to be put by the caller.
+ */
+struct ks_req *ks_pipeline_update_async(
+	struct ks_pipeline *pipeline,
+	struct ks_conn *conn,
+	int (*callback)(struct ks_req *req),
+	void *data)
 {
 	int err;
 
 	struct ks_req *req;
 	req = ks_req_alloc(conn);
-	if (!req) {
-		err = -ENOMEM;
+	if (!req)
 		goto err_req_alloc;
-	}
 
 	req->type = KS_NETLINK_PIPELINE_SET;
 	req->flags = NLM_F_REQUEST;
+	req->response_callback = callback;
+	req->response_data = data;
 
 	req->skb = alloc_skb(4096, GFP_KERNEL);
-	if (!req->skb) {
-		err = -ENOMEM;
+	if (!req->skb)
 		goto err_skb_alloc;
-	}
 
 	err = ks_netlink_put_attr(req->skb, KS_PIPELINEATTR_ID,
 			&pipeline->id,
@@ -659,19 +831,8 @@ int ks_pipeline_update(struct ks_pipeline *pipeline, struct ks_conn *conn)
 	ks_conn_queue_request(conn, req);
 	ks_conn_flush_requests(conn);
 
-	ks_req_wait(req);
-	if (req->err < 0) {
-		err = req->err;
-		ks_req_put(req);
-
-		goto err_request_failed;
-	}
-
-	ks_req_put(req);
-
-	return 0;
+	return req;
 
-err_request_failed:
 err_put_attr_status:
 err_put_attr_id:
 	/* skb is freed in req_put */
@@ -679,7 +840,23 @@ err_skb_alloc:
 	ks_req_put(req);
 err_req_alloc:
 
-	return err;
+	return NULL;
+}
+
+int ks_pipeline_update(struct ks_pipeline *pipeline, struct ks_conn *conn)
+{
+	int err;
+
+	struct ks_req *req;
+	req = ks_pipeline_update_async(pipeline, conn, NULL, NULL);
+	if (!req)
+		return -ENOMEM;
+
+	ks_req_wait(req);
+	err = req->err;
+	ks_req_put(req);
+
+	return err < 0 ? err : 0;
 }
 
 int ks_pipeline_restart(struct ks_pipeline *pipeline, struct ks_conn *conn)
@@ -744,25 +921,140 @@ err_req_alloc:
 	return err;
 }
 
-int ks_pipeline_update_chans(
+/* Does not wait for the kernel, which only answers in case of error */
+int ks_pipeline_destroy_noack(
 	struct ks_pipeline *pipeline,
 	struct ks_conn *conn)
 {
 	int err;
 
-	int i;
-	for(i=0; i<pipeline->chans_cnt; i++) {
+	struct ks_req *req;
+	req = ks_req_alloc(conn);
+	if (!req) {
+		err = -ENOMEM;
+		goto err_req_alloc;
+	}
 
-		struct ks_chan *chan = pipeline->chans[i];
+	req->type = KS_NETLINK_PIPELINE_DEL;
+	req->flags = NLM_F_REQUEST | KS_NLM_F_NOACK;
 
-		err = ks_chan_update(chan, conn);
-		if (err < 0)
-			goto err_update_failed;
+	req->skb = alloc_skb(4096, GFP_KERNEL);
+	if (!req->skb) {
+		err = -ENOMEM;
+		goto err_skb_alloc;
 	}
 
+	err = ks_netlink_put_attr(req->skb, KS_PIPELINEATTR_ID,
+			&pipeline->id,
+			sizeof(pipeline->id));
+	if (err < 0)
+		goto err_put_attr_id;
+
+	ks_conn_queue_request(conn, req);
+	ks_conn_flush_requests(conn);
+
+	ks_req_put(req);
+
 	return 0;
 
-err_update_failed:
+err_put_attr_id:
+	/* skb is freed in req_put */
+err_skb_alloc:
+	ks_req_put(req);
+err_req_alloc:
+
+	return err;
+}
+
+/* Dumps the pipelines again, refreshing the stats of the known ones */
+int ks_pipeline_update_stats(struct ks_conn *conn)
+{
+	int err;
+
+	struct ks_req *req;
+	req = ks_req_alloc(conn);
+	if (!req) {
+		err = -ENOMEM;
+		goto err_req_alloc;
+	}
+
+	req->type = KS_NETLINK_PIPELINE_GET;
+	req->flags = NLM_F_REQUEST;
+
+	ks_conn_queue_request(conn, req);
+	ks_conn_flush_requests(conn);
+
+	ks_req_wait(req);
+	if (req->err < 0) {
+		err = req->err;
+		goto err_request_failed;
+	}
+
+	pthread_rwlock_wrlock(&conn->topology_lock);
+
+	{
+	struct nlmsghdr *nlh;
+	int len_left = req->response_payload_size;
+
+	for (nlh = req->response_payload;
+	     NLMSG_OK(nlh, len_left);
+	     nlh = NLMSG_NEXT(nlh, len_left)) {
+		struct ks_pipeline *pipeline;
+
+		if (nlh->nlmsg_type != KS_NETLINK_PIPELINE_NEW)
+			continue;
+
+		pipeline = _ks_pipeline_get_by_id(conn,
+				ks_pipeline_nlh_to_id(conn, nlh));
+		if (!pipeline)
+			continue;
+
+		ks_pipeline_stats_from_nlmsg(pipeline, nlh);
+		ks_pipeline_put(pipeline);
+	}
+	}
+
+	pthread_rwlock_unlock(&conn->topology_lock);
+
+	ks_req_put(req);
+
+	return 0;
+
+err_request_failed:
+	ks_req_put(req);
+err_req_alloc:
+
+	return err;
+}
+
+int ks_pipeline_update_chans(
+	struct ks_pipeline *pipeline,
+	struct ks_conn *conn)
+{
+	struct ks_req *reqs[ARRAY_SIZE(pipeline->chans)];
+	int err = 0;
+	int i;
+
+	/* All the updates are in flight at once, the kernel processes them in
+	 * order anyway
+	 */
+	for(i=0; i<pipeline->chans_cnt; i++)
+		reqs[i] = ks_chan_update_async(pipeline->chans[i], conn);
+
+	for(i=0; i<pipeline->chans_cnt; i++) {
+		if (!reqs[i]) {
+			if (!err)
+				err = -ENOMEM;
+
+			continue;
+		}
+
+		ks_req_wait(reqs[i]);
+		if (reqs[i]->err < 0 && !err)
+			err = reqs[i]->err;
+
+		ks_req_put(reqs[i]);
+	}
 
 	return err;
 }
@@ -16,6 +16,7 @@
 #include <errno.h>
 #include <assert.h>
 
+#include <libkstreamer/libkstreamer.h>
 #include <libkstreamer/conn.h>
 #include <libkstreamer/util.h>
 #include <libkstreamer/req.h>
@@ -28,33 +29,6 @@ struct ks_req ks_nomem_request =
 	.err = -ENOMEM,
 };
 
-void ks_req_timer(struct ks_timer *timer, enum ks_timer_action action, void *start_data)
-{
-	struct ks_req *req = timer->data;
-
-	switch(action) {
-	case KS_TIMER_STOPPED:
-		ks_req_put(req);
-		timer->data = NULL;
-	break;
-
-	case KS_TIMER_STARTED:
-		req = start_data;
-		timer->data = req;
-		ks_req_get(req);
-	break;
-
-	case KS_TIMER_FIRED:
-		report_conn(req->conn, LOG_ERR,
-			"Timeout waiting for request processing!\n");
-
-		ks_req_complete(req, -ETIMEDOUT);
-		ks_req_put(req);
-		timer->data = NULL;
-	break;
-	}
-}
-
 struct ks_req *ks_req_alloc(struct ks_conn *conn)
 {
 	struct ks_req *req;
@@ -70,8 +44,6 @@ struct ks_req *ks_req_alloc(struct ks_conn *conn)
 	req->id = 0;
 	req->multi_seq = 1;
 
-	ks_timer_create(&req->timer, &conn->timerset, "ks_req", ks_req_timer);
-
 	pthread_mutex_init(&req->completed_lock, NULL);
 	pthread_cond_init(&req->completed_cond, NULL);
 
@@ -82,8 +54,11 @@ struct ks_req *ks_req_get(struct ks_req *req)
 {
 	assert(req->refcnt > 0);
 
-	if (req)
+	if (req) {
+		pthread_mutex_lock(&refcnt_lock);
 		req->refcnt++;
+		pthread_mutex_unlock(&refcnt_lock);
+	}
 
 	return req;
 }
@@ -92,9 +67,11 @@ void ks_req_put(struct ks_req *req)
 {
 	assert(req->refcnt > 0);
 
-	req->refcnt--;
+	pthread_mutex_lock(&refcnt_lock);
+	int refcnt = --req->refcnt;
+	pthread_mutex_unlock(&refcnt_lock);
 
-	if (!req->refcnt) {
+	if (!refcnt) {
 
 		pthread_mutex_destroy(&req->completed_lock);
 		pthread_cond_destroy(&req->completed_cond);
@@ -115,8 +92,6 @@ void ks_req_complete(struct ks_req *req, int err)
 {
 	req->err = err;
 
-	ks_timer_stop(&req->timer);
-
 	pthread_mutex_lock(&req->completed_lock);
 	req->completed = TRUE;
 	pthread_mutex_unlock(&req->completed_lock);
@@ -135,6 +110,17 @@ void ks_req_wait(struct ks_req *req)
 	pthread_mutex_unlock(&req->completed_lock);
 }
 
+KSBOOL ks_req_completed(struct ks_req *req)
+{
+	KSBOOL completed;
+
+	pthread_mutex_lock(&req->completed_lock);
+	completed = req->completed;
+	pthread_mutex_unlock(&req->completed_lock);
+
+	return completed;
+}
+
 int ks_req_resp_append_payload(
 	struct ks_req *req,
 	struct nlmsghdr *nlh)
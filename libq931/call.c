@@ -686,37 +686,29 @@ static int q931_channel_select_response(
 		// Ok, we did not indicate a channel so, attempt to use what
 		// other party requests in his response
 
-		int i;
-		for (i=0; ci->chanset.nchans; i++) {
-			if (ci->chanset.chans[i]->state ==
-					Q931_CHANSTATE_AVAILABLE) {
-				// Nice, the channel is available
-
-				report_call(call, LOG_DEBUG,
-					"No channel proposed in setup, "
-					"using indicated channel B%d\n",
-					ci->chanset.chans[i]->id+1);
+		struct q931_channel *chan =
+			q931_channel_hunt(call->intf, &ci->chanset);
+		if (chan) {
+			// Nice, the channel is available
 
-				call->channel = ci->chanset.chans[i];
-				call->channel->call = call;
+			report_call(call, LOG_DEBUG,
+				"No channel proposed in setup, "
+				"using indicated channel B%d\n",
+				chan->id+1);
 
-				q931_channel_set_state(call->channel,
-						Q931_CHANSTATE_SELECTED);
+			call->channel = chan;
+			call->channel->call = call;
 
-				return TRUE;
-			} else {
-				report_call(call, LOG_DEBUG,
-					"No channel proposed in setup, "
-					"but indicated channel B%d is "
-					"unavailable\n",
-					ci->chanset.chans[i]->id+1);
-			}
+			q931_channel_set_state(call->channel,
+					Q931_CHANSTATE_SELECTED);
 
-			report_call(call, LOG_DEBUG,
-				"No channel proposed in setup, "
-				"but no indicated channel is unavailable\n");
+			return TRUE;
 		}
 
+		report_call(call, LOG_DEBUG,
+			"No channel proposed in setup, "
+			"but no indicated channel is available\n");
+
 		struct q931_ie_cause *cause = q931_ie_cause_alloc();
 		cause->coding_standard = Q931_IE_C_CS_CCITT;
 		cause->location = q931_ie_cause_location_call(call);
@@ -748,23 +740,19 @@ static int q931_channel_select_response(
 		 * and use her choice.
 		 */
 
-		int i;
-		for (i=0; ci->chanset.nchans; i++) {
-			if (ci->chanset.chans[i]->state ==
-					Q931_CHANSTATE_AVAILABLE) {
-
-				if (call->channel)
-					q931_channel_release(call->channel);
-
-				call->channel = ci->chanset.chans[i];
-				call->channel->call = call;
+		struct q931_channel *chan =
+			q931_channel_hunt(call->intf, &ci->chanset);
+		if (chan) {
+			if (call->channel)
+				q931_channel_release(call->channel);
 
-				q931_channel_set_state(call->channel,
-						Q931_CHANSTATE_SELECTED);
+			call->channel = chan;
+			call->channel->call = call;
 
-				return TRUE;
-			}
+			q931_channel_set_state(call->channel,
+					Q931_CHANSTATE_SELECTED);
 
+			return TRUE;
 		}
 
 		// The other channel is not available too
@@ -818,13 +806,10 @@ static struct q931_channel *q931_channel_select_setup(
 			"No channel identification IE,"
 			" assuming any channel available\n");
 
-		int i;
-		for (i=0; i<call->intf->n_channels; i++) {
-			if (call->intf->channels[i].state ==
-					Q931_CHANSTATE_AVAILABLE) {
-				return &call->intf->channels[i];
-			}
-		}
+		struct q931_channel *chan =
+			q931_channel_hunt(call->intf, NULL);
+		if (chan)
+			return chan;
 
 		report_call(call, LOG_DEBUG,
 			"No channel identification IE,"
@@ -839,53 +824,49 @@ static struct q931_channel *q931_channel_select_setup(
 		return NULL;
 	}
 
-	if (!ci->chanset.nchans) {
+	if (!q931_chanset_count(&ci->chanset)) {
 		*bumping_needed = TRUE;
 		return NULL;
 	}
 
-	for (i=0; i<ci->chanset.nchans; i++) {
-		if (ci->chanset.chans[i]->state == Q931_CHANSTATE_AVAILABLE) {
-			report_call(call, LOG_DEBUG,
-				"Requested channel B%d available\n",
-				ci->chanset.chans[i]->id+1);
+	struct q931_channel *chan;
+	chan = q931_channel_hunt(call->intf, &ci->chanset);
+	if (chan) {
+		report_call(call, LOG_DEBUG,
+			"Requested channel B%d available\n",
+			chan->id+1);
 
-			return ci->chanset.chans[i];
-		}
+		return chan;
+	}
 
-		// The party indicated an unavailable channel
+	// The party indicated only unavailable channels
 
-		if (ci->preferred_exclusive == Q931_IE_CI_PE_EXCLUSIVE) {
-			// Uuops, the party offers no alternative
+	if (ci->preferred_exclusive == Q931_IE_CI_PE_EXCLUSIVE) {
+		// Uuops, the party offers no alternative
 
-			report_call(call, LOG_DEBUG,
-				"Requested channel B%d unavailable and no "
-				"alternatives offered\n",
-				ci->chanset.chans[i]->id+1);
+		report_call(call, LOG_DEBUG,
+			"Requested channels unavailable and no "
+			"alternatives offered\n");
 
-			struct q931_ie_cause *cause = q931_ie_cause_alloc();
-			cause->coding_standard = Q931_IE_C_CS_CCITT;
-			cause->location = q931_ie_cause_location_call(call);
-			cause->value =
-				Q931_IE_C_CV_REQUESTED_CIRCUIT_CHANNEL_NOT_AVAILABLE;
-			q931_ies_add_put(causes, &cause->ie);
+		struct q931_ie_cause *cause = q931_ie_cause_alloc();
+		cause->coding_standard = Q931_IE_C_CS_CCITT;
+		cause->location = q931_ie_cause_location_call(call);
+		cause->value =
+			Q931_IE_C_CV_REQUESTED_CIRCUIT_CHANNEL_NOT_AVAILABLE;
+		q931_ies_add_put(causes, &cause->ie);
 
-			return NULL;
-		}
+		return NULL;
 	}
 
 	// Let's see any alternative is ok
-	for (i=0; i<call->intf->n_channels; i++) {
-		if (call->intf->channels[i].state ==
-				Q931_CHANSTATE_AVAILABLE) {
-
-			report_call(call, LOG_DEBUG,
-				"Requested channel unavailable but "
-				"alternative B%d is ok\n",
-				call->intf->channels[i].id+1);
+	chan = q931_channel_hunt(call->intf, NULL);
+	if (chan) {
+		report_call(call, LOG_DEBUG,
+			"Requested channel unavailable but "
+			"alternative B%d is ok\n",
+			chan->id+1);
 
-			return &call->intf->channels[i];
-		}
+		return chan;
 	}
 
 	report_call(call, LOG_DEBUG, "No channel available\n");
@@ -1799,22 +1780,14 @@ static void q931_channel_acquire(struct q931_call *call)
 	assert(call->intf);
 	assert(!call->channel);
 
-	int i;
-	for(i=0; i<call->intf->n_channels; i++) {
-		if (call->intf->channels[i].state ==
-		      Q931_CHANSTATE_AVAILABLE) {
-
-			struct q931_channel *chan =
-				&call->intf->channels[i];
-
-			chan->call = call;
-			chan->call->channel = chan;
+	struct q931_channel *chan;
+	chan = q931_channel_hunt(call->intf, NULL);
+	if (chan) {
+		chan->call = call;
+		chan->call->channel = chan;
 
-			q931_channel_set_state(call->channel,
-					Q931_CHANSTATE_SELECTED);
-
-			break;
-		}
+		q931_channel_set_state(call->channel,
+				Q931_CHANSTATE_SELECTED);
 	}
 }
 
@@ -4354,6 +4327,9 @@ static void q931_handle_setup(
 		} else {
 			call->channel->call = call;
 
+			q931_channel_set_state(call->channel,
+					Q931_CHANSTATE_SELECTED);
+
 			q931_ies_copy(&call->setup_ies, &msg->ies);
 
 			q931_call_set_state(call, U6_CALL_PRESENT);
@@ -31,28 +31,82 @@
 		q931_queue_primitive(NULL, primitive, NULL,	\
 			(unsigned long)channel, par1)
 
-struct q931_channel *q931_channel_alloc(struct q931_call *call)
+/* Picks an available channel among candidates (or among all the channels if
+ * candidates is NULL) according to the interface's selection strategy.
+ * The channel state is not changed.
+ */
+struct q931_channel *q931_channel_hunt(
+	struct q931_interface *intf,
+	const struct q931_chanset *candidates)
 {
-	assert(call);
-	assert(call->intf);
+	struct q931_chanset cs;
+	struct q931_channel *chan;
+	struct q931_channel *best;
+	__u32 map;
 
-	int i;
-	for(i=0; i<call->intf->n_channels; i++) {
-		if (call->intf->channels[i].state ==
-		      Q931_CHANSTATE_AVAILABLE) {
+	q931_chanset_copy(&cs, &intf->available_chans);
+
+	if (candidates)
+		q931_chanset_intersect(&cs, candidates);
+
+	if (!cs.map)
+		return NULL;
+
+	switch(intf->channel_selection) {
+	case Q931_CHANSEL_LOWEST:
+		return q931_chanset_first(&cs);
+
+	case Q931_CHANSEL_HIGHEST:
+		return q931_chanset_last(&cs);
 
-			call->intf->channels[i].state =
-				Q931_CHANSTATE_SELECTED;
+	case Q931_CHANSEL_ROUND_ROBIN:
+		assert(intf->channel_selection_next >= 0 &&
+			intf->channel_selection_next < Q931_CHANSET_MAX_SIZE);
 
-			call->intf->channels[i].call = call;
+		map = cs.map & (~0U << intf->channel_selection_next);
+		if (!map)
+			map = cs.map;
 
-			return &call->intf->channels[i];
+		chan = cs.chans[ffs(map) - 1];
+
+		intf->channel_selection_next =
+			(chan->id + 1) % Q931_CHANSET_MAX_SIZE;
+
+		return chan;
+
+	case Q931_CHANSEL_LRU:
+		best = NULL;
+
+		q931_chanset_for_each(&cs, chan, map) {
+			if (!best || chan->released_at < best->released_at)
+				best = chan;
 		}
+
+		return best;
 	}
 
+	assert(0);
+
 	return NULL;
 }
 
+struct q931_channel *q931_channel_alloc(struct q931_call *call)
+{
+	struct q931_channel *chan;
+
+	assert(call);
+	assert(call->intf);
+
+	chan = q931_channel_hunt(call->intf, NULL);
+	if (!chan)
+		return NULL;
+
+	q931_channel_set_state(chan, Q931_CHANSTATE_SELECTED);
+	chan->call = call;
+
+	return chan;
+}
+
 struct q931_channel *get_channel_by_id(
 	struct q931_interface *intf,
 	int chan_id)
@@ -86,6 +140,23 @@ const char *q931_channel_state_to_text(enum q931_channel_state state)
 	assert(0);
 }
 
+const char *q931_channel_selection_to_text(
+	enum q931_channel_selection selection)
+{
+	switch(selection) {
+	case Q931_CHANSEL_LOWEST:
+		return "lowest";
+	case Q931_CHANSEL_HIGHEST:
+		return "highest";
+	case Q931_CHANSEL_ROUND_ROBIN:
+		return "round_robin";
+	case Q931_CHANSEL_LRU:
+		return "lru";
+	}
+
+	assert(0);
+}
+
 void q931_channel_set_state(
 	struct q931_channel *channel,
 	enum q931_channel_state state)
@@ -95,6 +166,15 @@ void q931_channel_set_state(
 		q931_channel_state_to_text(channel->state),
 		q931_channel_state_to_text(state));
 
+	if (state == Q931_CHANSTATE_AVAILABLE) {
+		if (channel->state != Q931_CHANSTATE_AVAILABLE)
+			channel->released_at = longtime_now();
+
+		q931_chanset_add(&channel->intf->available_chans, channel);
+	} else {
+		q931_chanset_del(&channel->intf->available_chans, channel);
+	}
+
 	channel->state = state;
 }
 
@@ -188,4 +268,7 @@ void q931_channel_init(
 	channel->intf = intf;
 	channel->state = Q931_CHANSTATE_AVAILABLE;
 	channel->call = NULL;
+	channel->released_at = 0;
+
+	q931_chanset_add(&intf->available_chans, channel);
 }
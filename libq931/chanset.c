@@ -20,23 +20,30 @@
 
 #include <libq931/lib.h>
 #include <libq931/chanset.h>
+#include <libq931/channel.h>
 
 void q931_chanset_init(
 	struct q931_chanset *chanset)
 {
 	assert(chanset);
 
-	chanset->nchans = 0;
+	chanset->map = 0;
 }
 
 void q931_chanset_copy(
 	struct q931_chanset *chanset,
 	const struct q931_chanset *src_chanset)
 {
+	struct q931_channel *chan;
+	__u32 map;
+
 	assert(chanset);
 	assert(src_chanset);
 
-	memcpy(chanset, src_chanset, sizeof(*chanset));
+	chanset->map = src_chanset->map;
+
+	q931_chanset_for_each(src_chanset, chan, map)
+		chanset->chans[chan->id] = chan;
 }
 
 void q931_chanset_add(
@@ -44,18 +51,11 @@ void q931_chanset_add(
 	struct q931_channel *channel)
 {
 	assert(chanset);
-	assert(chanset->nchans < Q931_CHANSET_MAX_SIZE);
 	assert(channel);
+	assert(channel->id >= 0 && channel->id < Q931_CHANSET_MAX_SIZE);
 
-	// Avoid inserting duplicated
-	int i;
-	for (i=0; i<chanset->nchans; i++) {
-		if (chanset->chans[i] == channel)
-			return;
-	}
-
-	chanset->chans[chanset->nchans] = channel;
-	chanset->nchans++;
+	chanset->map |= 1U << channel->id;
+	chanset->chans[channel->id] = channel;
 }
 
 void q931_chanset_del(
@@ -63,64 +63,52 @@ void q931_chanset_del(
 	const struct q931_channel *channel)
 {
 	assert(chanset);
-	assert(chanset->nchans);
 	assert(channel);
+	assert(channel->id >= 0 && channel->id < Q931_CHANSET_MAX_SIZE);
 
-	int i;
-	for (i=0; i<chanset->nchans; i++) {
-		if (chanset->chans[i] == channel) {
-			int j;
-			for (j=i; j<chanset->nchans - 1; j++) {
-				chanset->chans[j] = chanset->chans[j+1];
-			}
-
-			chanset->nchans--;
-
-			break;
-		}
-	}
+	chanset->map &= ~(1U << channel->id);
 }
 
 void q931_chanset_merge(
 	struct q931_chanset *chanset,
 	const struct q931_chanset *src_chanset)
 {
-	int i;
-	for (i=0; i<src_chanset->nchans; i++) {
-		int j;
-		for (j=0; j<chanset->nchans; j++) {
-			if (chanset->chans[j] == src_chanset->chans[i])
-				goto chan_found;
-		}
-
-		q931_chanset_add(chanset, src_chanset->chans[i]);
-
-chan_found:
-	;
-	}
+	struct q931_channel *chan;
+	__u32 map;
+
+	q931_chanset_for_each(src_chanset, chan, map)
+		q931_chanset_add(chanset, chan);
 }
 
 int q931_chanset_contains(
 	const struct q931_chanset *chanset,
 	const struct q931_channel *channel)
 {
-	int i;
-	for (i=0; i<chanset->nchans; i++) {
-		if (chanset->chans[i] == channel)
-			return TRUE;
-	}
+	assert(channel->id >= 0 && channel->id < Q931_CHANSET_MAX_SIZE);
 
-	return FALSE;
+	return (chanset->map & (1U << channel->id)) &&
+		chanset->chans[channel->id] == channel;
 }
 
 int q931_chanset_equal(
 	const struct q931_chanset *chanset,
 	const struct q931_chanset *chanset2)
 {
+	struct q931_channel *chan;
+	__u32 map;
+
 	assert(chanset);
 	assert(chanset2);
 
-	return !memcmp(chanset, chanset2, sizeof(*chanset));
+	if (chanset->map != chanset2->map)
+		return FALSE;
+
+	q931_chanset_for_each(chanset, chan, map) {
+		if (chanset2->chans[chan->id] != chan)
+			return FALSE;
+	}
+
+	return TRUE;
 }
 
 void q931_chanset_intersect(
@@ -130,17 +118,5 @@ void q931_chanset_intersect(
 	assert(chanset);
 	assert(chanset2);
 
-	int i;
-	for (i=0; i<chanset->nchans; i++) {
-		int j;
-		for (j=0; j<chanset2->nchans; j++) {
-			if (chanset2->chans[j] == chanset->chans[i])
-				goto chan_found;
-		}
-
-		q931_chanset_del(chanset, chanset->chans[i]);
-
-chan_found:
-	;
-	}
+	chanset->map &= chanset2->map;
 }
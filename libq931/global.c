@@ -349,15 +349,14 @@ static void q931_global_handle_restart(
 					struct q931_ie_channel_identification,
 						ie);
 
-				int j;
-				for (j=0; j<q931_chanset_count(&ci->chanset);
-									j++) {
+				struct q931_channel *chan;
+				__u32 map;
+				q931_chanset_for_each(&ci->chanset, chan, map) {
 					if (q931_channel_is_restartable(
-							ci->chanset.chans[j],
-							msg->dlc)) {
+							chan, msg->dlc)) {
 						q931_chanset_add(
 							&gc->restart_reqd_chans,
-							ci->chanset.chans[j]);
+							chan);
 					}
 				}
 			} else if (msg->ies.ies[i]->cls->id ==
@@ -396,11 +395,13 @@ static void q931_global_handle_restart(
 			q931_chanset_init(&cs);
 			q931_chanset_copy(&cs, &gc->restart_reqd_chans);
 			
-			for (i=0;i<q931_chanset_count(&cs); i++) {
+			struct q931_channel *chan;
+			__u32 map;
+			q931_chanset_for_each(&cs, chan, map) {
 
-				if (cs.chans[i]->call) {
+				if (chan->call) {
 					q931_restart_request(
-						cs.chans[i]->call,
+						chan->call,
 						&msg->ies);
 
 					if (!q931_global_timer_running(gc,
@@ -410,7 +411,7 @@ static void q931_global_handle_restart(
 				} else {
 					q931_global_restart_confirm(gc,
 						msg->dlc,
-						cs.chans[i]);
+						chan);
 				}
 			}
 		} else {
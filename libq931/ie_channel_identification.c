@@ -218,28 +218,29 @@ int q931_ie_channel_identification_write_to_buf_bra(
 	if (ie->any_channel) {
 		oct_3->info_channel_selection = Q931_IE_CI_ICS_BRA_ANY;
 	} else {
-		if (ie->chanset.nchans == 0) {
+		int nchans = q931_chanset_count(&ie->chanset);
+
+		if (nchans == 0) {
 
 			oct_3->info_channel_selection =
 				Q931_IE_CI_ICS_BRA_NO_CHANNEL;
 
-		} else if (ie->chanset.nchans == 1) {
+		} else if (nchans == 1) {
+			struct q931_channel *chan =
+				q931_chanset_first(&ie->chanset);
 
-			if (ie->chanset.chans[0]->id == 0)
+			if (chan->id == 0)
 				oct_3->info_channel_selection =
 					Q931_IE_CI_ICS_BRA_B1;
-			else if (ie->chanset.chans[0]->id == 1)
+			else if (chan->id == 1)
 				oct_3->info_channel_selection =
 					Q931_IE_CI_ICS_BRA_B2;
 			else
 				assert(0);
 
-		} else if (ie->chanset.nchans == 2) {
+		} else if (nchans == 2) {
 
-			assert(ie->chanset.chans[0]->id == 0 ||
-				ie->chanset.chans[0]->id == 1);
-			assert(ie->chanset.chans[1]->id == 0 ||
-				ie->chanset.chans[1]->id == 1);
+			assert(ie->chanset.map == 0x3);
 
 			oct_3->info_channel_selection = Q931_IE_CI_ICS_BRA_ANY;
 		} else {
@@ -271,7 +272,7 @@ static int q931_ie_channel_identification_write_to_buf_pra(
 
 	if (ie->any_channel)
 		oct_3->info_channel_selection = Q931_IE_CI_ICS_PRA_ANY;
-	else if (ie->chanset.nchans == 0)
+	else if (!q931_chanset_count(&ie->chanset))
 		oct_3->info_channel_selection = Q931_IE_CI_ICS_PRA_NO_CHANNEL;
 	else
 		oct_3->info_channel_selection = Q931_IE_CI_ICS_PRA_INDICATED;
@@ -291,14 +292,15 @@ static int q931_ie_channel_identification_write_to_buf_pra(
 	len++;
 
 	if (oct_3->info_channel_selection == Q931_IE_CI_ICS_PRA_INDICATED) {
-		int i;
-		for (i=0; i<ie->chanset.nchans; i++) {
+		struct q931_channel *chan;
+		__u32 map;
+		q931_chanset_for_each(&ie->chanset, chan, map) {
 			struct q931_ie_channel_identification_onwire_3d *oct_3d =
 				(struct q931_ie_channel_identification_onwire_3d *)
 				(buf + len);
 			oct_3d->raw = 0;
 			oct_3d->ext = 1;
-			oct_3d->channel_number = ie->chanset.chans[i]->id;
+			oct_3d->channel_number = chan->id;
 			len++;
 		}
 	}
@@ -482,11 +484,12 @@ void q931_ie_channel_identification_dump(
 
 	char chanlist[128] = "";
 
-	int i;
-	for (i=0; i<ie->chanset.nchans; i++) {
+	struct q931_channel *chan;
+	__u32 map;
+	q931_chanset_for_each(&ie->chanset, chan, map) {
 		sprintf(chanlist + strlen(chanlist),
 			"B%d ",
-			ie->chanset.chans[i]->id + 1);
+			chan->id + 1);
 	}
 
 	report_ie_dump(abstract_ie,
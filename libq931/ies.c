@@ -14,11 +14,13 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <assert.h>
 
 #define Q931_PRIVATE
 
 #include <libq931/lib.h>
+#include <libq931/logging.h>
 #include <libq931/ies.h>
 
 #include <libq931/ie_cause.h>
@@ -41,7 +43,17 @@ void q931_ies_destroy(struct q931_ies *ies)
 	q931_ies_flush(ies);
 }
 
-void q931_ies_add(
+/* IEs are kept ordered by codeset and ID as they are added, so that the
+ * encoder can walk the array as is. Repeated IEs keep their relative
+ * order. Most callers add IEs in ascending order already, so the scan
+ * from the tail usually stops immediately.
+ */
+static inline int q931_ies_key(const struct q931_ie *ie)
+{
+	return (ie->cls->codeset << 8) | ie->cls->id;
+}
+
+static void q931_ies_insert(
 	struct q931_ies *ies,
 	struct q931_ie *ie)
 {
@@ -49,17 +61,29 @@ void q931_ies_add(
 	assert(ies->count < Q931_IES_NUM_IES);
 	assert(ie);
 
-	ies->ies[ies->count] = q931_ie_get(ie);
+	int key = q931_ies_key(ie);
+	int i;
+
+	for (i=ies->count; i>0 && q931_ies_key(ies->ies[i-1]) > key; i--)
+		ies->ies[i] = ies->ies[i-1];
 
+	ies->ies[i] = ie;
 	ies->count++;
 }
 
+void q931_ies_add(
+	struct q931_ies *ies,
+	struct q931_ie *ie)
+{
+	q931_ies_insert(ies, q931_ie_get(ie));
+}
+
+/* The caller's reference is handed over to the set */
 void q931_ies_add_put(
 	struct q931_ies *ies,
 	struct q931_ie *ie)
 {
-	q931_ies_add(ies, ie);
-	q931_ie_put(ie);
+	q931_ies_insert(ies, ie);
 }
 
 void q931_ies_del(
@@ -74,7 +98,7 @@ void q931_ies_del(
 		if (ies->ies[i] == ie) {
 			int j;
 			for (j=i; j<ies->count-1; j++)
-				ies->ies[i] = ies->ies[i+1];
+				ies->ies[j] = ies->ies[j+1];
 
 			q931_ie_put(ie);
 
@@ -139,17 +163,83 @@ void q931_ies_copy(
 		q931_ies_add(ies, src_ies->ies[i]);
 }
 
-static int q931_ies_compare(const void *a, const void *b)
+/* Sets are kept sorted on insertion, this only checks the invariant */
+void q931_ies_sort(
+	struct q931_ies *ies)
 {
-	return q931_intcmp((*((struct q931_ie **)a))->cls->id,
-	                   (*((struct q931_ie **)b))->cls->id);
+#ifndef NDEBUG
+	int i;
+	for (i=1; i<ies->count; i++)
+		assert(q931_ies_key(ies->ies[i-1]) <=
+			q931_ies_key(ies->ies[i]));
+#endif
 }
 
-void q931_ies_sort(
-	struct q931_ies *ies)
+/* Encodes the set in wire format straight into buf, in a single pass over
+ * the (already ordered) array. No copy is made and no reference is taken.
+ *
+ * Returns the number of bytes written or -EMSGSIZE if the IEs don't fit.
+ */
+int q931_ies_write(
+	const struct q931_ies *ies,
+	void *buf,
+	int max_size)
 {
-	qsort(ies->ies,
-	      ies->count,
-	      sizeof(*ies->ies),
-	      q931_ies_compare);
+	__u8 *pos = buf;
+	__u8 *end = pos + max_size;
+	int report = q931_log_enabled(LOG_DEBUG);
+
+	assert(ies);
+
+	int i;
+	for (i=0; i<ies->count; i++) {
+		const struct q931_ie *ie = ies->ies[i];
+
+		assert(ie->cls->write_to_buf);
+
+		if (ie->cls->type == Q931_IE_TYPE_VL) {
+			if (end - pos < 2)
+				return -EMSGSIZE;
+
+			/* Payload first, then backfill id and length */
+			int ie_len = ie->cls->write_to_buf(ie,
+						pos + 2, end - pos - 2);
+			if (ie_len < 0 || ie_len > 255 ||
+			    ie_len > end - pos - 2)
+				return -EMSGSIZE;
+
+			pos[0] = ie->cls->id;
+			pos[1] = ie_len;
+			pos += 2 + ie_len;
+
+			if (report)
+				q931_report(LOG_DEBUG,
+					"->  VL IE %d ===> %u (%s) --"
+					" length %u\n",
+					i,
+					ie->cls->id,
+					ie->cls->name,
+					ie_len);
+		} else {
+			if (end - pos < 1)
+				return -EMSGSIZE;
+
+			int res = ie->cls->write_to_buf(ie, pos, end - pos);
+			assert(res > 0);
+
+			pos++;
+
+			if (report)
+				q931_report(LOG_DEBUG,
+					"->  SO IE %d ===> %u (%s)\n",
+					i,
+					ie->cls->id,
+					ie->cls->name);
+		}
+
+		if (report && ie->cls->dump)
+			ie->cls->dump(ie, q931_report, "->    ");
+	}
+
+	return pos - (__u8 *)buf;
 }
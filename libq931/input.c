@@ -38,6 +38,7 @@
 #include <libq931/dummy.h>
 #include <libq931/ces.h>
 #include <libq931/call.h>
+#include <libq931/trace.h>
 #include <libq931/intf.h>
 #include <libq931/proto.h>
 
@@ -420,7 +421,7 @@ static void q931_decode_ie(
 		}
 
 
-		if (ie->cls->dump)
+		if (ie->cls->dump && q931_log_enabled(LOG_DEBUG))
 			ie->cls->dump(ie, q931_report, "<-    ");
 
 
@@ -924,6 +925,8 @@ int q931_receive(struct q931_dlc *dlc)
 		goto primitive_received;
 	}
 
+	q931_trace_record(dlc, Q931_TRACE_RX, msg->raw, msg->rawlen);
+
 	/* DLC assignment is delayed to avoid get_dlc/put_dlc without a real
 	 * message present, otherwise the autorelease timer gets reset by
 	 * DL-RELEASE-CONFIRM primitives
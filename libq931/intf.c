@@ -269,6 +269,8 @@ struct q931_interface *q931_intf_open(
 	intf->name = strdup(name);
 	intf->dlc_autorelease_time = 0;
 	intf->enable_bumping = TRUE;
+	intf->channel_selection = Q931_CHANSEL_LOWEST;
+	intf->channel_selection_next = 0;
 
 	intf->flags = flags;
 	intf->tei = tei;
@@ -342,6 +344,8 @@ struct q931_interface *q931_intf_open(
 		(rand() &
 		((1 << ((intf->call_reference_len * 8) - 1)) - 2)) + 1;
 
+	q931_chanset_init(&intf->available_chans);
+
 	int i;
 	for (i=0; i<intf->n_channels; i++)
 		q931_channel_init(&intf->channels[i], i, intf);
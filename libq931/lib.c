@@ -38,6 +38,7 @@
 #include <libq931/call.h>
 #include <libq931/intf.h>
 #include <libq931/proto.h>
+#include <libq931/trace.h>
 
 #include <libq931/ie_cause.h>
 #include <libq931/ie_channel_identification.h>
@@ -56,6 +57,7 @@ static void q931_default_report(int level, const char *format, ...)
 }
 
 void (*q931_report)(int level, const char *format, ...) = q931_default_report;
+enum q931_log_level q931_log_level = Q931_LOG_DEBUG;
 void (*q931_timer_update)() = NULL;
 void (*q931_queue_primitive)(
 	struct q931_call *call,
@@ -73,6 +75,17 @@ void q931_set_report_func(
 	q931_report = report_func;
 }
 
+/* Messages below level are discarded without being formatted */
+void q931_set_log_level(enum q931_log_level level)
+{
+	q931_log_level = level;
+}
+
+enum q931_log_level q931_get_log_level(void)
+{
+	return q931_log_level;
+}
+
 void q931_set_timer_update_func(
 	void (*timer_update_func)(void))
 {
@@ -108,4 +121,5 @@ void q931_init()
 
 void q931_leave()
 {
+	q931_trace_free();
 }
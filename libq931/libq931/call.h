@@ -192,14 +192,18 @@ void q931_call_release_reference(struct q931_call *call);
 struct q931_call *q931_call_alloc(struct q931_interface *intf);
 
 #define report_call(call, lvl, format, arg...)				\
-	q931_report((lvl),						\
-		"%s:CALL[%u.%c]: "					\
-		format,							\
-		(call)->intf->name,					\
-		(call)->call_reference,					\
-		((call)->direction ==					\
-			Q931_CALL_DIRECTION_OUTBOUND ? 'O' : 'I'),	\
-		## arg)
+	do {								\
+		if (q931_log_enabled(lvl))				\
+			q931_report((lvl),				\
+				"%s:CALL[%u.%c]: "			\
+				format,					\
+				(call)->intf->name,			\
+				(call)->call_reference,			\
+				((call)->direction ==			\
+				 Q931_CALL_DIRECTION_OUTBOUND ?		\
+								'O' : 'I'),\
+				## arg);				\
+	} while(0)
 
 struct q931_call *q931_call_alloc_in(
 	struct q931_interface *intf,
@@ -39,13 +39,16 @@
 		q931_timer_pending(&(ces)->timer)	\
 
 #define report_ces(ces, lvl, format, arg...)		\
-		q931_report(				\
-			(lvl),				\
-			"%s:CES[%d]: "			\
-			format,				\
-			(ces)->dlc->intf->name,		\
-			(ces)->dlc->tei,		\
-			## arg)
+	do {						\
+		if (q931_log_enabled(lvl))		\
+			q931_report(			\
+				(lvl),			\
+				"%s:CES[%d]: "		\
+				format,			\
+				(ces)->dlc->intf->name,	\
+				(ces)->dlc->tei,	\
+				## arg);		\
+	} while(0)
 
 enum q931_ces_state
 {
@@ -13,6 +13,10 @@
 #ifndef _LIBQ931_CHANNEL_H
 #define _LIBQ931_CHANNEL_H
 
+#include <longtime.h>
+
+#include <libq931/chanset.h>
+
 enum q931_channel_state
 {
 	Q931_CHANSTATE_MAINTAINANCE,
@@ -31,6 +35,15 @@ enum q931_tone_type
 	Q931_TONE_FAILURE,
 };
 
+/* How a free channel is chosen when we are the one selecting it */
+enum q931_channel_selection
+{
+	Q931_CHANSEL_LOWEST,
+	Q931_CHANSEL_HIGHEST,
+	Q931_CHANSEL_ROUND_ROBIN,
+	Q931_CHANSEL_LRU,
+};
+
 struct q931_channel
 {
 	int id;
@@ -38,9 +51,17 @@ struct q931_channel
 	struct q931_call *call;
 	struct q931_interface *intf;
 	void *pvt;
+
+	longtime_t released_at;
 };
 
 struct q931_channel *q931_channel_alloc(struct q931_call *call);
+struct q931_channel *q931_channel_hunt(
+	struct q931_interface *intf,
+	const struct q931_chanset *candidates);
+
+const char *q931_channel_selection_to_text(
+	enum q931_channel_selection selection);
 struct q931_channel *get_channel_by_id(
 	struct q931_interface *intf,
 	int chan_id);
@@ -55,12 +76,15 @@ void q931_channel_release(struct q931_channel *channel);
 #ifdef Q931_PRIVATE
 
 #define report_chan(chan, lvl, format, arg...)		\
-	q931_report((lvl),				\
-		"%s[B%d]: "				\
-		format,					\
-		(chan)->intf->name,			\
-		(chan)->id + 1,				\
-		## arg)
+	do {						\
+		if (q931_log_enabled(lvl))		\
+			q931_report((lvl),		\
+				"%s[B%d]: "		\
+				format,			\
+				(chan)->intf->name,	\
+				(chan)->id + 1,		\
+				## arg);		\
+	} while(0)
 
 void q931_channel_set_state(
 	struct q931_channel *channel,
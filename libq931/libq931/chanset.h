@@ -13,15 +13,29 @@
 #ifndef _LIBQ931_CHANSET_H
 #define _LIBQ931_CHANSET_H
 
+#include <strings.h>
+#include <linux/types.h>
+
 #define Q931_CHANSET_MAX_SIZE	32
 
-// This is not the best implementation (it sucks, actually).
+/* Channels are indexed by their id, an entry of chans[] is meaningful only
+ * if the corresponding bit in map is set.
+ */
 struct q931_chanset
 {
-	int nchans;
+	__u32 map;
 	struct q931_channel *chans[Q931_CHANSET_MAX_SIZE];
 };
 
+/* Iterates over the channels in ascending id order, __map is a __u32
+ * scratch variable provided by the caller.
+ */
+#define q931_chanset_for_each(chanset, chan, __map)			\
+	for ((__map) = (chanset)->map;					\
+	     (__map) &&							\
+		((chan) = (chanset)->chans[ffs(__map) - 1], 1);		\
+	     (__map) &= (__map) - 1)
+
 void q931_chanset_init(
 	struct q931_chanset *chanset);
 
@@ -56,7 +70,20 @@ void q931_chanset_copy(
 static inline int q931_chanset_count(
 	const struct q931_chanset *chanset)
 {
-	return chanset->nchans;
+	return __builtin_popcount(chanset->map);
+}
+
+static inline struct q931_channel *q931_chanset_first(
+	const struct q931_chanset *chanset)
+{
+	return chanset->map ? chanset->chans[ffs(chanset->map) - 1] : NULL;
+}
+
+static inline struct q931_channel *q931_chanset_last(
+	const struct q931_chanset *chanset)
+{
+	return chanset->map ?
+		chanset->chans[31 - __builtin_clz(chanset->map)] : NULL;
 }
 
 #endif
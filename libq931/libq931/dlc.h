@@ -17,13 +17,16 @@
 #include <libq931/timer.h>
 
 #define report_dlc(dlc, lvl, format, arg...)				\
-		q931_report(						\
-			(lvl),						\
-			"%s:TEI[%d]: "					\
-			format,						\
-			(dlc)->intf->name,				\
-			(dlc)->tei,					\
-			## arg)
+	do {								\
+		if (q931_log_enabled(lvl))				\
+			q931_report(					\
+				(lvl),					\
+				"%s:TEI[%d]: "				\
+				format,					\
+				(dlc)->intf->name,			\
+				(dlc)->tei,				\
+				## arg);				\
+	} while(0)
 
 enum q931_dlc_status
 {
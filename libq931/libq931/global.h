@@ -49,8 +49,12 @@ struct q931_global_call
 #ifdef Q931_PRIVATE
 
 #define report_gc(cr, lvl, format, arg...)		\
-	q931_report((lvl), "Global Call: " format,	\
-			## arg)
+	do {						\
+		if (q931_log_enabled(lvl))		\
+			q931_report((lvl),		\
+				"Global Call: " format,	\
+				## arg);		\
+	} while(0)
 
 #define q931_global_start_timer(cr, timer)		\
 	do {						\
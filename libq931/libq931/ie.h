@@ -26,7 +26,8 @@
 #endif
 
 #define report_ie(ie, lev, fmt, args...)	\
-		if (report_func)		\
+		if (report_func &&		\
+		    q931_log_enabled(lev))	\
 			report_func(		\
 				(lev),		\
 				"%s: "		\
@@ -64,4 +64,9 @@ static inline int q931_ies_count(
 void q931_ies_sort(
 	struct q931_ies *ies);
 
+int q931_ies_write(
+	const struct q931_ies *ies,
+	void *buf,
+	int max_size);
+
 #endif
@@ -26,11 +26,14 @@
 #include <libq931/global.h>
 
 #define report_intf(intf, lvl, format, arg...)		\
-	q931_report((lvl),				\
-		"%s: "					\
-		format,					\
-		(intf)->name,				\
-		## arg)
+	do {						\
+		if (q931_log_enabled(lvl))		\
+			q931_report((lvl),		\
+				"%s: "			\
+				format,			\
+				(intf)->name,		\
+				## arg);		\
+	} while(0)
 
 enum q931_interface_network_role
 {
@@ -82,6 +85,11 @@ struct q931_interface
 	struct q931_channel channels[32];
 	int n_channels;
 
+	/* Channels in AVAILABLE state, kept by q931_channel_set_state() */
+	struct q931_chanset available_chans;
+	enum q931_channel_selection channel_selection;
+	int channel_selection_next;
+
 	struct q931_global_call global_call;
 
 	longtime_t T301;
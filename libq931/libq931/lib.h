@@ -30,6 +30,9 @@ enum q931_mode
 void q931_set_report_func(
 	void (*report_func)(int level, const char *format, ...));
 
+void q931_set_log_level(enum q931_log_level level);
+enum q931_log_level q931_get_log_level(void);
+
 void q931_set_timer_update_func(
 	void (*timer_update_func)(void));
 
@@ -36,6 +36,13 @@ enum q931_log_level
 #define LOG_ALERT	Q931_LOG_ALERT
 #define LOG_EMERG	Q931_LOG_EMERG
 
+extern enum q931_log_level q931_log_level;
+
+/* Checked by all the report_* macros before evaluating their arguments, so
+ * disabled messages cost a comparison and no formatting at all.
+ */
+#define q931_log_enabled(lvl) ((lvl) >= q931_log_level)
+
 #endif
 
 #endif
@@ -47,6 +47,9 @@ struct q931_message
 
 #define report_msg(msg, lvl, format, arg...)				\
 	do {								\
+		if (!q931_log_enabled(lvl))				\
+			break;						\
+									\
 	       	if ((msg)->dlc)						\
 			report_dlc((msg)->dlc, (lvl),			\
 				format,					\
@@ -58,9 +61,12 @@ struct q931_message
 	} while(0)
 
 #define report_msg_cont(msg, lvl, format, arg...)			\
-	q931_report((lvl),						\
-			format,						\
-			## arg)
+	do {								\
+		if (q931_log_enabled(lvl))				\
+			q931_report((lvl),				\
+				format,					\
+				## arg);				\
+	} while(0)
 
 struct q931_message *q931_msg_get(struct q931_message *msg);
 void _q931_msg_put(struct q931_message *msg);
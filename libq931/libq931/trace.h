@@ -0,0 +1,96 @@
+/*
+ * vISDN DSSS-1/q.931 signalling library
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#ifndef _LIBQ931_TRACE_H
+#define _LIBQ931_TRACE_H
+
+#include <stdio.h>
+#include <linux/types.h>
+
+/* Binary trace of the raw frames exchanged with LAPD.
+ *
+ * Frames are recorded in an in-memory ring by the q.931 thread without any
+ * formatting or locking, the ring may be dumped from any other thread at any
+ * time. Slots being overwritten while dumping are simply skipped.
+ *
+ * Disabling the trace only stops recording, the ring is kept (and may still
+ * be dumped) until q931_leave() so that no thread may ever find it freed.
+ *
+ * The dump file is a q931_trace_file_header followed by records, each one
+ * being a q931_trace_record_header followed by "len" octets of frame. All
+ * fields are in host byte order.
+ */
+
+#define Q931_TRACE_MAGIC	0x51393354 /* "Q93T" */
+#define Q931_TRACE_VERSION	1
+
+#define Q931_TRACE_MAX_FRAME	512
+#define Q931_TRACE_INTF_NAME	16
+
+enum q931_trace_direction
+{
+	Q931_TRACE_RX,
+	Q931_TRACE_TX,
+	Q931_TRACE_TX_BC,
+};
+
+struct q931_trace_file_header
+{
+	__u32 magic;
+	__u16 version;
+	__u16 record_header_size;
+};
+
+struct q931_trace_record_header
+{
+	__u32 tv_sec;
+	__u32 tv_usec;
+	__u16 len;
+	__u8 direction;
+	__u8 pad;
+	__s32 tei;
+	char intf_name[Q931_TRACE_INTF_NAME];
+};
+
+int q931_trace_enable(int nslots);
+void q931_trace_disable(void);
+int q931_trace_enabled(void);
+int q931_trace_nslots(void);
+int q931_trace_dump(FILE *f);
+
+#ifdef Q931_PRIVATE
+
+#include <libq931/dlc.h>
+
+extern volatile int q931_trace_active;
+
+void q931_trace_free(void);
+
+void _q931_trace_record(
+	struct q931_dlc *dlc,
+	enum q931_trace_direction direction,
+	const void *frame,
+	int len);
+
+static inline void q931_trace_record(
+	struct q931_dlc *dlc,
+	enum q931_trace_direction direction,
+	const void *frame,
+	int len)
+{
+	if (q931_trace_active)
+		_q931_trace_record(dlc, direction, frame, len);
+}
+
+#endif
+
+#endif
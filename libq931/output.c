@@ -37,6 +37,7 @@
 #include <libq931/intf.h>
 #include <libq931/proto.h>
 #include <libq931/callref.h>
+#include <libq931/trace.h>
 
 static int q931_prepare_header(
 	const struct q931_call *call,
@@ -134,6 +135,8 @@ int q931_send_frame(struct q931_dlc *dlc, void *frame, int size)
 	iov.iov_base = frame;
 	iov.iov_len = size;
 
+	q931_trace_record(dlc, Q931_TRACE_TX, frame, size);
+
 	if (sendmsg(dlc->socket, &msghdr, 0) < 0) {
 		report_dlc(dlc, LOG_ERR, "sendmsg error: %s\n",
 		strerror(errno));
@@ -160,6 +163,8 @@ int q931_send_frame_bc(struct q931_dlc *dlc, void *frame, int size)
 	iov.iov_base = frame;
 	iov.iov_len = size;
 
+	q931_trace_record(dlc, Q931_TRACE_TX_BC, frame, size);
+
 	if (sendmsg(dlc->socket, &msg, MSG_OOB) < 0) {
 		report_dlc(dlc, LOG_ERR, "sendmsg error: %s\n",
 			strerror(errno));
@@ -187,65 +192,14 @@ void q931_flush_outgoing_queue(
 
 static void q931_write_ies(
 	struct q931_message *msg,
-	const struct q931_ies *user_ies)
+	const struct q931_ies *ies)
 {
-	Q931_DECLARE_IES(ies);
-	q931_ies_copy(&ies, user_ies);
-	q931_ies_sort(&ies);
-
-	int i;
-	for (i=0; i<ies.count; i++) {
-		assert(ies.ies[i]->cls->write_to_buf);
-
-		if (ies.ies[i]->cls->type == Q931_IE_TYPE_VL) {
-			/* Write container */
-			*(__u8 *)(msg->raw + msg->rawlen) =
-				ies.ies[i]->cls->id;
-			msg->rawlen++;
-
-			/* Write payload before len */
-			int ie_len = ies.ies[i]->cls->write_to_buf(
-					ies.ies[i],
-					msg->raw + msg->rawlen + 1,
-					sizeof(msg->raw) - msg->rawlen);
-			assert(ie_len >= 0);
-
-			/* Now write len */
-			*(__u8 *)(msg->raw + msg->rawlen) = ie_len;
-			msg->rawlen++;
-
-			/* Finally jump len */
-			msg->rawlen += ie_len;
-
-			report_msg_cont(msg, LOG_DEBUG,
-				"->  VL IE %d ===> %u (%s) --"
-				" length %u\n",
-				i,
-				ies.ies[i]->cls->id,
-				ies.ies[i]->cls->name,
-				ie_len);
-		} else {
-			int res = ies.ies[i]->cls->write_to_buf(ies.ies[i],
-				msg->raw + msg->rawlen,
-				sizeof(msg->raw) - msg->rawlen);
-			assert(res > 0);
-
-			msg->rawlen++;
-
-			report_msg_cont(msg, LOG_DEBUG,
-				"->  SO IE %d ===> %u (%s)\n",
-				i,
-				ies.ies[i]->cls->id,
-				ies.ies[i]->cls->name);
-		}
-
-		if (ies.ies[i]->cls->dump)
-			ies.ies[i]->cls->dump(
-				ies.ies[i],
-				q931_report, "->    ");
-	}
+	int len = q931_ies_write(ies,
+			msg->raw + msg->rawlen,
+			sizeof(msg->raw) - msg->rawlen);
+	assert(len >= 0);
 
-	Q931_UNDECLARE_IES(ies);
+	msg->rawlen += len;
 }
 
 static int q931_send_message(
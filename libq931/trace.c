@@ -0,0 +1,189 @@
+/*
+ * vISDN DSSS-1/q.931 signalling library
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <linux/types.h>
+
+#define Q931_PRIVATE
+
+#include <libq931/lib.h>
+#include <libq931/intf.h>
+#include <libq931/dlc.h>
+#include <libq931/trace.h>
+#include <libq931/util.h>
+
+/* A slot is consistent when its sequence is even. The writer makes it odd
+ * while filling the slot, readers copy the slot and retry nothing: if the
+ * sequence changed in the meantime the record is dropped from the dump.
+ */
+struct q931_trace_slot
+{
+	volatile unsigned int seq;
+
+	struct q931_trace_record_header hdr;
+	__u8 data[Q931_TRACE_MAX_FRAME];
+};
+
+volatile int q931_trace_active = FALSE;
+
+static struct q931_trace_slot *q931_trace_ring = NULL;
+static int q931_trace_ring_size;
+static volatile unsigned long q931_trace_head;
+
+/* The ring is allocated on first use, later calls just resume recording in
+ * the existing ring, whatever nslots is.
+ */
+int q931_trace_enable(int nslots)
+{
+	struct q931_trace_slot *ring;
+
+	if (!q931_trace_ring) {
+		if (nslots <= 0)
+			return -EINVAL;
+
+		ring = calloc(nslots, sizeof(*ring));
+		if (!ring)
+			return -ENOMEM;
+
+		q931_trace_ring_size = nslots;
+		q931_trace_head = 0;
+
+		__sync_synchronize();
+
+		q931_trace_ring = ring;
+	}
+
+	__sync_synchronize();
+	q931_trace_active = TRUE;
+
+	return 0;
+}
+
+void q931_trace_disable(void)
+{
+	q931_trace_active = FALSE;
+}
+
+int q931_trace_enabled(void)
+{
+	return q931_trace_active;
+}
+
+/* Called by q931_leave(), no other thread may use the library anymore */
+void q931_trace_free(void)
+{
+	q931_trace_active = FALSE;
+
+	free(q931_trace_ring);
+	q931_trace_ring = NULL;
+}
+
+int q931_trace_nslots(void)
+{
+	return q931_trace_ring ? q931_trace_ring_size : 0;
+}
+
+void _q931_trace_record(
+	struct q931_dlc *dlc,
+	enum q931_trace_direction direction,
+	const void *frame,
+	int len)
+{
+	struct q931_trace_slot *slot;
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	if (len > Q931_TRACE_MAX_FRAME)
+		len = Q931_TRACE_MAX_FRAME;
+
+	slot = &q931_trace_ring[q931_trace_head % q931_trace_ring_size];
+
+	slot->seq++;
+	__sync_synchronize();
+
+	slot->hdr.tv_sec = tv.tv_sec;
+	slot->hdr.tv_usec = tv.tv_usec;
+	slot->hdr.len = len;
+	slot->hdr.direction = direction;
+	slot->hdr.tei = dlc->tei;
+
+	strncpy(slot->hdr.intf_name, dlc->intf->name,
+		sizeof(slot->hdr.intf_name));
+	slot->hdr.intf_name[sizeof(slot->hdr.intf_name) - 1] = '\0';
+
+	memcpy(slot->data, frame, len);
+
+	__sync_synchronize();
+	slot->seq++;
+
+	q931_trace_head++;
+}
+
+int q931_trace_dump(FILE *f)
+{
+	struct q931_trace_file_header fhdr;
+	struct q931_trace_slot *ring = q931_trace_ring;
+	struct q931_trace_slot copy;
+	unsigned long head;
+	unsigned long pos;
+	int nrecords = 0;
+
+	if (!ring)
+		return -ENOENT;
+
+	fhdr.magic = Q931_TRACE_MAGIC;
+	fhdr.version = Q931_TRACE_VERSION;
+	fhdr.record_header_size = sizeof(struct q931_trace_record_header);
+
+	if (fwrite(&fhdr, sizeof(fhdr), 1, f) != 1)
+		return -errno;
+
+	head = q931_trace_head;
+	__sync_synchronize();
+
+	pos = head > q931_trace_ring_size ? head - q931_trace_ring_size : 0;
+
+	for (; pos < head; pos++) {
+		struct q931_trace_slot *slot =
+				&ring[pos % q931_trace_ring_size];
+		unsigned int seq;
+
+		seq = slot->seq;
+		__sync_synchronize();
+
+		if (seq & 1)
+			continue;
+
+		memcpy(&copy.hdr, &slot->hdr, sizeof(copy.hdr));
+		if (copy.hdr.len > Q931_TRACE_MAX_FRAME)
+			continue;
+
+		memcpy(copy.data, slot->data, copy.hdr.len);
+
+		__sync_synchronize();
+		if (slot->seq != seq)
+			continue;
+
+		if (fwrite(&copy.hdr, sizeof(copy.hdr), 1, f) != 1 ||
+		    fwrite(copy.data, copy.hdr.len, 1, f) != 1)
+			return -errno;
+
+		nrecords++;
+	}
+
+	return nrecords;
+}
@@ -0,0 +1,124 @@
+/*
+ * kstreamer N-party conference mixer
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#ifndef _KS_CONFERENCE_H
+#define _KS_CONFERENCE_H
+
+#ifdef __KERNEL__
+
+#include <linux/spinlock.h>
+#include <linux/ktime.h>
+
+#include <linux/kstreamer/node.h>
+#include <linux/kstreamer/channel.h>
+#include <linux/kstreamer/softswitch.h>
+
+#define kconf_MODULE_NAME "ks-conference"
+#define kconf_MODULE_PREFIX kconf_MODULE_NAME ": "
+#define kconf_MODULE_DESCR "kstreamer conference mixer"
+
+#define KCONF_RX_SCHED_FREQUENCY 50
+#define KCONF_SAMPLE_RATE 8000
+
+/* Upper bound of a tick, whatever HZ is */
+#define KCONF_MAX_TICK_SAMPLES 512
+
+/* Linear samples buffered per party between two ticks */
+#define KCONF_IN_BUF_SIZE 1024
+
+#define KCONF_MAX_PARTIES 256
+
+struct kconf_conference;
+
+/* Each party is a node with a "tx" ks_chan, receiving the companded audio
+ * of the participant, and an "rx" ks_chan sending back the mix of all the
+ * other parties. The rx side is drained by the conference's RX scheduler,
+ * which mixes once per tick.
+ */
+struct kconf_party
+{
+	struct kconf_conference *conf;
+	int id;
+
+	struct ks_node ks_node;
+
+	struct ks_chan tx_chan;
+	struct ks_chan rx_chan;
+
+	struct kss_rx_sched_entry sched_entry;
+
+	int mu_law;
+
+	/* Ring of decoded samples received since the last tick */
+	s16 in_buf[KCONF_IN_BUF_SIZE];
+	int in_head;
+	int in_len;
+
+	/* Contribution of the party to the current tick */
+	s16 tick[KCONF_MAX_TICK_SAMPLES];
+	int talking;
+
+	unsigned long in_octets;
+	unsigned long in_overruns;
+	unsigned long in_slips;
+	unsigned long out_octets;
+	unsigned long underruns;
+};
+
+struct kconf_conference
+{
+	spinlock_t lock;
+	int id;
+
+	struct kss_rx_sched rx_sched;
+	int tick_samples;
+
+	s32 mix[KCONF_MAX_TICK_SAMPLES];
+
+	int num_parties;
+	struct kconf_party **parties;
+
+	/* Updated by the RX scheduler, under lock */
+	ktime_t tick_start;
+	unsigned long ticks;
+	u64 time_ns;
+	unsigned long max_time_ns;
+	int talkers;
+	int max_talkers;
+};
+
+#if defined(DEBUG_CODE) && defined(DEBUG_DEFAULTS)
+#define kconf_debug(dbglevel, format, arg...)			\
+	if (debug_level >= dbglevel)				\
+		printk(KERN_DEBUG kconf_MODULE_PREFIX		\
+			format,					\
+			## arg)
+#else
+#define kconf_debug(format, arg...) do {} while (0)
+#endif
+
+#define kconf_msg(level, format, arg...)			\
+	printk(level kconf_MODULE_PREFIX			\
+		format,						\
+		## arg)
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#endif
+
+#endif
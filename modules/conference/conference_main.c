@@ -0,0 +1,958 @@
+/*
+ * kstreamer N-party conference mixer
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/list.h>
+#include <linux/slab.h>
+#include <linux/hrtimer.h>
+#include <asm/div64.h>
+
+#include <linux/kstreamer/kstreamer.h>
+#include <linux/kstreamer/node.h>
+#include <linux/kstreamer/pipeline.h>
+#include <linux/kstreamer/streamframe.h>
+#include <linux/kstreamer/softswitch.h>
+
+#include "conference.h"
+
+#ifdef DEBUG_CODE
+#ifdef DEBUG_DEFAULTS
+int debug_level = 3;
+#else
+int debug_level = 0;
+#endif
+#endif
+
+static int num_conferences = 1;
+static int max_parties = 32;
+static int mu_law;
+
+static struct kconf_conference **kconf_conferences;
+
+/*---------------------------------------------------------------------------*/
+
+/* G.711 companding, through tables built at load time. Encoding is indexed
+ * by the 14 most significant bits of the linear sample, which is all the
+ * resolution µ-law has (and more than A-law needs).
+ */
+
+#define KCONF_ENC_BITS 14
+#define KCONF_ENC_SIZE (1 << KCONF_ENC_BITS)
+
+static s16 kconf_alaw_dec[256];
+static s16 kconf_ulaw_dec[256];
+static u8 kconf_alaw_enc[KCONF_ENC_SIZE];
+static u8 kconf_ulaw_enc[KCONF_ENC_SIZE];
+
+static s16 __init kconf_alaw_to_linear(u8 a_val)
+{
+	int t;
+	int seg;
+
+	a_val ^= 0x55;
+
+	t = (a_val & 0x0f) << 4;
+	seg = (a_val & 0x70) >> 4;
+
+	switch(seg) {
+	case 0:
+		t += 8;
+	break;
+
+	case 1:
+		t += 0x108;
+	break;
+
+	default:
+		t += 0x108;
+		t <<= seg - 1;
+	}
+
+	return (a_val & 0x80) ? t : -t;
+}
+
+static s16 __init kconf_ulaw_to_linear(u8 u_val)
+{
+	int t;
+
+	u_val = ~u_val;
+
+	t = ((u_val & 0x0f) << 3) + 0x84;
+	t <<= (u_val & 0x70) >> 4;
+
+	return (u_val & 0x80) ? (0x84 - t) : (t - 0x84);
+}
+
+static int __init kconf_segment(int val, int first_end)
+{
+	int seg;
+
+	for (seg = 0; seg < 8; seg++, first_end = (first_end << 1) | 1) {
+		if (val <= first_end)
+			return seg;
+	}
+
+	return 8;
+}
+
+static u8 __init kconf_linear_to_alaw(int pcm_val)
+{
+	int mask;
+	int seg;
+	u8 aval;
+
+	pcm_val >>= 3;
+
+	if (pcm_val >= 0) {
+		mask = 0xd5;
+	} else {
+		mask = 0x55;
+		pcm_val = -pcm_val - 1;
+	}
+
+	seg = kconf_segment(pcm_val, 0x1f);
+	if (seg >= 8)
+		return 0x7f ^ mask;
+
+	aval = seg << 4;
+
+	if (seg < 2)
+		aval |= (pcm_val >> 1) & 0x0f;
+	else
+		aval |= (pcm_val >> seg) & 0x0f;
+
+	return aval ^ mask;
+}
+
+static u8 __init kconf_linear_to_ulaw(int pcm_val)
+{
+	int mask;
+	int seg;
+
+	pcm_val >>= 2;
+
+	if (pcm_val < 0) {
+		pcm_val = -pcm_val;
+		mask = 0x7f;
+	} else {
+		mask = 0xff;
+	}
+
+	if (pcm_val > 8159)
+		pcm_val = 8159;
+
+	pcm_val += 0x84 >> 2;
+
+	seg = kconf_segment(pcm_val, 0x3f);
+	if (seg >= 8)
+		return 0x7f ^ mask;
+
+	return ((seg << 4) | ((pcm_val >> (seg + 1)) & 0x0f)) ^ mask;
+}
+
+static void __init kconf_build_tables(void)
+{
+	int i;
+
+	for (i = 0; i < 256; i++) {
+		kconf_alaw_dec[i] = kconf_alaw_to_linear(i);
+		kconf_ulaw_dec[i] = kconf_ulaw_to_linear(i);
+	}
+
+	for (i = 0; i < KCONF_ENC_SIZE; i++) {
+		int linear = (i - KCONF_ENC_SIZE / 2) << (16 - KCONF_ENC_BITS);
+
+		kconf_alaw_enc[i] = kconf_linear_to_alaw(linear);
+		kconf_ulaw_enc[i] = kconf_linear_to_ulaw(linear);
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+/* Unrolled on contiguous buffers, which is as far as vectorization goes
+ * here: SIMD registers are not usable in softirq context without
+ * kernel_fpu_begin(), which costs more than a whole tick of mixing.
+ */
+static inline void kconf_accumulate(s32 *mix, const s16 *in, int n)
+{
+	int i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		mix[i] += in[i];
+		mix[i + 1] += in[i + 1];
+		mix[i + 2] += in[i + 2];
+		mix[i + 3] += in[i + 3];
+	}
+
+	for (; i < n; i++)
+		mix[i] += in[i];
+}
+
+static inline u8 kconf_encode(const u8 *enc_table, s32 val)
+{
+	if (val > 32767)
+		val = 32767;
+	else if (val < -32768)
+		val = -32768;
+
+	return enc_table[(val >> (16 - KCONF_ENC_BITS)) + KCONF_ENC_SIZE / 2];
+}
+
+/* Conference lock must be held */
+static int kconf_party_take_tick(struct kconf_party *party, int n)
+{
+	int avail = min(party->in_len, n);
+	int first = min(avail, KCONF_IN_BUF_SIZE - party->in_head);
+
+	if (!avail)
+		return FALSE;
+
+	memcpy(party->tick, party->in_buf + party->in_head,
+		first * sizeof(*party->tick));
+	memcpy(party->tick + first, party->in_buf,
+		(avail - first) * sizeof(*party->tick));
+
+	if (avail < n) {
+		memset(party->tick + avail, 0,
+			(n - avail) * sizeof(*party->tick));
+		party->underruns++;
+	}
+
+	party->in_head = (party->in_head + avail) % KCONF_IN_BUF_SIZE;
+	party->in_len -= avail;
+
+	/* Do not let jitter accumulate as latency, keep at most one tick */
+	if (party->in_len > n) {
+		int drop = party->in_len - n;
+
+		party->in_head = (party->in_head + drop) % KCONF_IN_BUF_SIZE;
+		party->in_len = n;
+		party->in_slips++;
+	}
+
+	return TRUE;
+}
+
+/* Conference lock must be held */
+static void kconf_party_reset(struct kconf_party *party)
+{
+	party->in_head = 0;
+	party->in_len = 0;
+	party->talking = FALSE;
+}
+
+/*---------------------------------------------------------------------------*/
+
+static ssize_t kconf_show_mu_law(
+	struct ks_node *ks_node,
+	struct ks_node_attribute *attr,
+	char *buf)
+{
+	struct kconf_party *party =
+		container_of(ks_node, struct kconf_party, ks_node);
+
+	return snprintf(buf, PAGE_SIZE, "%d\n", party->mu_law);
+}
+
+static ssize_t kconf_store_mu_law(
+	struct ks_node *ks_node,
+	struct ks_node_attribute *attr,
+	const char *buf,
+	size_t count)
+{
+	struct kconf_party *party =
+		container_of(ks_node, struct kconf_party, ks_node);
+
+	int value;
+	if (sscanf(buf, "%d", &value) < 1)
+		return -EINVAL;
+
+	spin_lock_bh(&party->conf->lock);
+	party->mu_law = !!value;
+	kconf_party_reset(party);
+	spin_unlock_bh(&party->conf->lock);
+
+	return count;
+}
+
+static KS_NODE_ATTR(mu_law, S_IRUGO | S_IWUSR,
+		kconf_show_mu_law,
+		kconf_store_mu_law);
+
+static ssize_t kconf_show_counters(
+	struct ks_node *ks_node,
+	struct ks_node_attribute *attr,
+	char *buf)
+{
+	struct kconf_party *party =
+		container_of(ks_node, struct kconf_party, ks_node);
+	ssize_t len;
+
+	spin_lock_bh(&party->conf->lock);
+	len = snprintf(buf, PAGE_SIZE,
+		"in_octets: %lu\n"
+		"in_overruns: %lu\n"
+		"in_slips: %lu\n"
+		"out_octets: %lu\n"
+		"underruns: %lu\n",
+		party->in_octets,
+		party->in_overruns,
+		party->in_slips,
+		party->out_octets,
+		party->underruns);
+	spin_unlock_bh(&party->conf->lock);
+
+	return len;
+}
+
+static KS_NODE_ATTR(counters, S_IRUGO,
+		kconf_show_counters,
+		NULL);
+
+static ssize_t kconf_show_mixer(
+	struct ks_node *ks_node,
+	struct ks_node_attribute *attr,
+	char *buf)
+{
+	struct kconf_party *party =
+		container_of(ks_node, struct kconf_party, ks_node);
+	struct kconf_conference *conf = party->conf;
+	unsigned long ticks;
+	unsigned long max_time_ns;
+	u64 time_ns;
+	int talkers;
+	int max_talkers;
+
+	spin_lock_bh(&conf->lock);
+	ticks = conf->ticks;
+	time_ns = conf->time_ns;
+	max_time_ns = conf->max_time_ns;
+	talkers = conf->talkers;
+	max_talkers = conf->max_talkers;
+	spin_unlock_bh(&conf->lock);
+
+	if (ticks)
+		do_div(time_ns, ticks);
+
+	return snprintf(buf, PAGE_SIZE,
+		"parties: %d\n"
+		"tick_samples: %d\n"
+		"ticks: %lu\n"
+		"talkers: %d\n"
+		"max_talkers: %d\n"
+		"avg_tick_time_ns: %llu\n"
+		"max_tick_time_ns: %lu\n",
+		conf->num_parties,
+		conf->tick_samples,
+		ticks,
+		talkers,
+		max_talkers,
+		(unsigned long long)time_ns,
+		max_time_ns);
+}
+
+static KS_NODE_ATTR(mixer, S_IRUGO,
+		kconf_show_mixer,
+		NULL);
+
+static ssize_t kconf_show_rx_sched(
+	struct ks_node *ks_node,
+	struct ks_node_attribute *attr,
+	char *buf)
+{
+	struct kconf_party *party =
+		container_of(ks_node, struct kconf_party, ks_node);
+
+	return kss_rx_sched_show_stats(&party->conf->rx_sched, buf);
+}
+
+static KS_NODE_ATTR(rx_sched, S_IRUGO,
+		kconf_show_rx_sched,
+		NULL);
+
+/*---------------------------------------------------------------------------*/
+
+static void kconf_node_release(struct ks_node *ks_node)
+{
+	kconf_debug(3, "kconf_node_release()\n");
+}
+
+static struct ks_node_ops kconf_party_node_ops = {
+	.owner		= THIS_MODULE,
+
+	.release	= kconf_node_release,
+};
+
+/*---------------------------------------------------------------------------*/
+
+static void kconf_tx_chan_release(struct ks_chan *ks_chan)
+{
+	kconf_debug(3, "kconf_tx_chan_release()\n");
+}
+
+static int kconf_tx_chan_connect(struct ks_chan *ks_chan)
+{
+	kconf_debug(3, "kconf_tx_chan_connect()\n");
+
+	return 0;
+}
+
+static void kconf_tx_chan_disconnect(struct ks_chan *ks_chan)
+{
+	kconf_debug(3, "kconf_tx_chan_disconnect()\n");
+}
+
+static int kconf_tx_chan_open(struct ks_chan *ks_chan)
+{
+	kconf_debug(3, "kconf_tx_chan_open()\n");
+
+	return 0;
+}
+
+static void kconf_tx_chan_close(struct ks_chan *ks_chan)
+{
+	kconf_debug(3, "kconf_tx_chan_close()\n");
+}
+
+static int kconf_tx_chan_start(struct ks_chan *ks_chan)
+{
+	kconf_debug(3, "kconf_tx_chan_start()\n");
+
+	return 0;
+}
+
+static void kconf_tx_chan_stop(struct ks_chan *ks_chan)
+{
+	struct kconf_party *party =
+		container_of(ks_chan, struct kconf_party, tx_chan);
+
+	kconf_debug(3, "kconf_tx_chan_stop()\n");
+
+	spin_lock_bh(&party->conf->lock);
+	kconf_party_reset(party);
+	spin_unlock_bh(&party->conf->lock);
+}
+
+static struct ks_chan_ops kconf_tx_chan_ops = {
+	.owner		= THIS_MODULE,
+
+	.release	= kconf_tx_chan_release,
+	.connect	= kconf_tx_chan_connect,
+	.disconnect	= kconf_tx_chan_disconnect,
+	.open		= kconf_tx_chan_open,
+	.close		= kconf_tx_chan_close,
+	.start		= kconf_tx_chan_start,
+	.stop		= kconf_tx_chan_stop,
+};
+
+static int kconf_tx_chan_push_raw(
+	struct ks_chan *ks_chan,
+	struct ks_streamframe *sf)
+{
+	struct kconf_party *party =
+		container_of(ks_chan, struct kconf_party, tx_chan);
+	const s16 *dec_table;
+	int tail;
+	int len;
+	int i;
+
+	spin_lock_bh(&party->conf->lock);
+
+	dec_table = party->mu_law ? kconf_ulaw_dec : kconf_alaw_dec;
+
+	len = min_t(int, sf->len, KCONF_IN_BUF_SIZE - party->in_len);
+	if (len < sf->len)
+		party->in_overruns++;
+
+	tail = (party->in_head + party->in_len) % KCONF_IN_BUF_SIZE;
+
+	for (i = 0; i < len; i++) {
+		party->in_buf[tail] = dec_table[sf->data[i]];
+
+		if (++tail == KCONF_IN_BUF_SIZE)
+			tail = 0;
+	}
+
+	party->in_len += len;
+	party->in_octets += len;
+
+	spin_unlock_bh(&party->conf->lock);
+
+	return 0;
+}
+
+static int kconf_tx_chan_get_pressure(struct ks_chan *ks_chan)
+{
+	struct kconf_party *party =
+		container_of(ks_chan, struct kconf_party, tx_chan);
+	int pressure;
+
+	spin_lock_bh(&party->conf->lock);
+	pressure = party->in_len;
+	spin_unlock_bh(&party->conf->lock);
+
+	return pressure;
+}
+
+static struct kss_chan_from_ops kconf_tx_chan_node_ops = {
+	.push_raw	= kconf_tx_chan_push_raw,
+	.get_pressure	= kconf_tx_chan_get_pressure,
+};
+
+/*---------------------------------------------------------------------------*/
+
+static void kconf_rx_chan_release(struct ks_chan *ks_chan)
+{
+	kconf_debug(3, "kconf_rx_chan_release()\n");
+}
+
+static int kconf_rx_chan_connect(struct ks_chan *ks_chan)
+{
+	kconf_debug(3, "kconf_rx_chan_connect()\n");
+
+	return 0;
+}
+
+static void kconf_rx_chan_disconnect(struct ks_chan *ks_chan)
+{
+	kconf_debug(3, "kconf_rx_chan_disconnect()\n");
+}
+
+static int kconf_rx_chan_open(struct ks_chan *ks_chan)
+{
+	kconf_debug(3, "kconf_rx_chan_open()\n");
+
+	return 0;
+}
+
+static void kconf_rx_chan_close(struct ks_chan *ks_chan)
+{
+	kconf_debug(3, "kconf_rx_chan_close()\n");
+}
+
+static int kconf_rx_chan_start(struct ks_chan *ks_chan)
+{
+	struct kconf_party *party =
+		container_of(ks_chan, struct kconf_party, rx_chan);
+
+	kconf_debug(3, "kconf_rx_chan_start()\n");
+
+	kss_rx_sched_add(&party->conf->rx_sched, &party->sched_entry,
+								ks_chan);
+
+	return 0;
+}
+
+static void kconf_rx_chan_stop(struct ks_chan *ks_chan)
+{
+	struct kconf_party *party =
+		container_of(ks_chan, struct kconf_party, rx_chan);
+
+	kconf_debug(3, "kconf_rx_chan_stop()\n");
+
+	kss_rx_sched_del(&party->conf->rx_sched, &party->sched_entry);
+}
+
+static struct ks_chan_ops kconf_rx_chan_ops = {
+	.owner		= THIS_MODULE,
+
+	.release	= kconf_rx_chan_release,
+	.connect	= kconf_rx_chan_connect,
+	.disconnect	= kconf_rx_chan_disconnect,
+	.open		= kconf_rx_chan_open,
+	.close		= kconf_rx_chan_close,
+	.start		= kconf_rx_chan_start,
+	.stop		= kconf_rx_chan_stop,
+};
+
+/*---------------------------------------------------------------------------*/
+
+static void kconf_rx_sched_lock(struct kss_rx_sched *sched)
+{
+	struct kconf_conference *conf = sched->driver_data;
+
+	spin_lock_bh(&conf->lock);
+}
+
+/* The tick's CPU time spans from prepare to here, so that it includes
+ * the per-party N-1 encoding done in drain
+ */
+static void kconf_rx_sched_unlock(struct kss_rx_sched *sched)
+{
+	struct kconf_conference *conf = sched->driver_data;
+	unsigned long elapsed;
+
+	elapsed = ktime_to_ns(ktime_sub(ktime_get(), conf->tick_start));
+
+	conf->ticks++;
+	conf->time_ns += elapsed;
+
+	if (elapsed > conf->max_time_ns)
+		conf->max_time_ns = elapsed;
+
+	spin_unlock_bh(&conf->lock);
+}
+
+/* Sums all the talking parties once per tick, each party then hears the sum
+ * minus its own contribution
+ */
+static void kconf_rx_sched_prepare(struct kss_rx_sched *sched)
+{
+	struct kconf_conference *conf = sched->driver_data;
+	int n = conf->tick_samples;
+	int talkers = 0;
+	int i;
+
+	conf->tick_start = ktime_get();
+
+	memset(conf->mix, 0, n * sizeof(*conf->mix));
+
+	for (i = 0; i < conf->num_parties; i++) {
+		struct kconf_party *party = conf->parties[i];
+
+		party->talking = kconf_party_take_tick(party, n);
+		if (!party->talking)
+			continue;
+
+		kconf_accumulate(conf->mix, party->tick, n);
+		talkers++;
+	}
+
+	conf->talkers = talkers;
+
+	if (talkers > conf->max_talkers)
+		conf->max_talkers = talkers;
+}
+
+static void kconf_rx_sched_drain(
+	struct kss_rx_sched *sched,
+	struct ks_chan *ks_chan,
+	struct ks_streamframe *sf)
+{
+	struct kconf_conference *conf = sched->driver_data;
+	struct kconf_party *party =
+		container_of(ks_chan, struct kconf_party, rx_chan);
+	const u8 *enc_table = party->mu_law ? kconf_ulaw_enc : kconf_alaw_enc;
+	int n = min_t(int, conf->tick_samples, sf->size);
+	int i;
+
+	if (party->talking) {
+		for (i = 0; i < n; i++)
+			sf->data[i] = kconf_encode(enc_table,
+					conf->mix[i] - party->tick[i]);
+	} else {
+		for (i = 0; i < n; i++)
+			sf->data[i] = kconf_encode(enc_table, conf->mix[i]);
+	}
+
+	sf->len = n;
+
+	party->out_octets += n;
+}
+
+static struct kss_rx_sched_ops kconf_rx_sched_ops = {
+	.lock		= kconf_rx_sched_lock,
+	.unlock		= kconf_rx_sched_unlock,
+	.prepare	= kconf_rx_sched_prepare,
+	.drain		= kconf_rx_sched_drain,
+};
+
+/*---------------------------------------------------------------------------*/
+
+static struct kconf_party *kconf_party_create(
+	struct kconf_conference *conf,
+	int id)
+{
+	struct kconf_party *party;
+
+	party = kmalloc(sizeof(*party), GFP_KERNEL);
+	if (!party)
+		return NULL;
+
+	memset(party, 0, sizeof(*party));
+
+	party->conf = conf;
+	party->id = id;
+	party->mu_law = mu_law;
+
+	ks_node_create(&party->ks_node, &kconf_party_node_ops, "conference",
+			&ks_system_device.kobj);
+	kobject_set_name(&party->ks_node.kobj, "conference%d-%d",
+			conf->id, id);
+
+	ks_chan_create(&party->tx_chan, &kconf_tx_chan_ops, "tx", NULL,
+			&party->ks_node.kobj,
+			&kss_softswitch.ks_node,
+			&party->ks_node);
+	party->tx_chan.from_ops = &kconf_tx_chan_node_ops;
+
+	ks_chan_create(&party->rx_chan, &kconf_rx_chan_ops, "rx", NULL,
+			&party->ks_node.kobj,
+			&party->ks_node,
+			&kss_softswitch.ks_node);
+
+	return party;
+}
+
+static void kconf_party_destroy(struct kconf_party *party)
+{
+	kfree(party);
+}
+
+static int kconf_party_register(struct kconf_party *party)
+{
+	int err;
+
+	err = ks_node_register(&party->ks_node);
+	if (err < 0)
+		goto err_node_register;
+
+	err = ks_node_create_file(&party->ks_node, &ks_node_attr_mu_law);
+	if (err < 0)
+		goto err_create_file_mu_law;
+
+	err = ks_node_create_file(&party->ks_node, &ks_node_attr_counters);
+	if (err < 0)
+		goto err_create_file_counters;
+
+	err = ks_node_create_file(&party->ks_node, &ks_node_attr_mixer);
+	if (err < 0)
+		goto err_create_file_mixer;
+
+	err = ks_node_create_file(&party->ks_node, &ks_node_attr_rx_sched);
+	if (err < 0)
+		goto err_create_file_rx_sched;
+
+	err = ks_chan_register(&party->tx_chan);
+	if (err < 0)
+		goto err_tx_chan_register;
+
+	err = ks_chan_register(&party->rx_chan);
+	if (err < 0)
+		goto err_rx_chan_register;
+
+	return 0;
+
+	ks_chan_unregister(&party->rx_chan);
+err_rx_chan_register:
+	ks_chan_unregister(&party->tx_chan);
+err_tx_chan_register:
+	ks_node_remove_file(&party->ks_node, &ks_node_attr_rx_sched);
+err_create_file_rx_sched:
+	ks_node_remove_file(&party->ks_node, &ks_node_attr_mixer);
+err_create_file_mixer:
+	ks_node_remove_file(&party->ks_node, &ks_node_attr_counters);
+err_create_file_counters:
+	ks_node_remove_file(&party->ks_node, &ks_node_attr_mu_law);
+err_create_file_mu_law:
+	ks_node_unregister(&party->ks_node);
+err_node_register:
+
+	return err;
+}
+
+static void kconf_party_unregister(struct kconf_party *party)
+{
+	ks_chan_unregister(&party->rx_chan);
+	ks_chan_unregister(&party->tx_chan);
+
+	ks_node_remove_file(&party->ks_node, &ks_node_attr_rx_sched);
+	ks_node_remove_file(&party->ks_node, &ks_node_attr_mixer);
+	ks_node_remove_file(&party->ks_node, &ks_node_attr_counters);
+	ks_node_remove_file(&party->ks_node, &ks_node_attr_mu_law);
+
+	ks_node_unregister(&party->ks_node);
+}
+
+/*---------------------------------------------------------------------------*/
+
+static struct kconf_conference *kconf_conference_create(
+	int id,
+	int num_parties)
+{
+	struct kconf_conference *conf;
+	int i;
+
+	conf = kmalloc(sizeof(*conf), GFP_KERNEL);
+	if (!conf)
+		goto err_alloc_conf;
+
+	memset(conf, 0, sizeof(*conf));
+
+	spin_lock_init(&conf->lock);
+	conf->id = id;
+
+	conf->parties = kmalloc(sizeof(*conf->parties) * num_parties,
+								GFP_KERNEL);
+	if (!conf->parties)
+		goto err_alloc_parties;
+
+	for (i = 0; i < num_parties; i++) {
+		conf->parties[i] = kconf_party_create(conf, i);
+		if (!conf->parties[i])
+			goto err_party_create;
+
+		conf->num_parties++;
+	}
+
+	kss_rx_sched_init(&conf->rx_sched, &kconf_rx_sched_ops,
+			KCONF_RX_SCHED_FREQUENCY, conf);
+
+	conf->tick_samples = KCONF_SAMPLE_RATE * conf->rx_sched.interval / HZ;
+	if (conf->tick_samples > KCONF_MAX_TICK_SAMPLES)
+		conf->tick_samples = KCONF_MAX_TICK_SAMPLES;
+
+	return conf;
+
+err_party_create:
+	for (i = 0; i < conf->num_parties; i++)
+		kconf_party_destroy(conf->parties[i]);
+
+	kfree(conf->parties);
+err_alloc_parties:
+	kfree(conf);
+err_alloc_conf:
+
+	return NULL;
+}
+
+static void kconf_conference_destroy(struct kconf_conference *conf)
+{
+	int i;
+
+	kss_rx_sched_destroy(&conf->rx_sched);
+
+	for (i = 0; i < conf->num_parties; i++)
+		kconf_party_destroy(conf->parties[i]);
+
+	kfree(conf->parties);
+	kfree(conf);
+}
+
+static int kconf_conference_register(struct kconf_conference *conf)
+{
+	int err;
+	int i;
+
+	for (i = 0; i < conf->num_parties; i++) {
+		err = kconf_party_register(conf->parties[i]);
+		if (err < 0)
+			goto err_party_register;
+	}
+
+	return 0;
+
+err_party_register:
+	while (--i >= 0)
+		kconf_party_unregister(conf->parties[i]);
+
+	return err;
+}
+
+static void kconf_conference_unregister(struct kconf_conference *conf)
+{
+	int i;
+
+	for (i = conf->num_parties - 1; i >= 0; i--)
+		kconf_party_unregister(conf->parties[i]);
+}
+
+/******************************************
+ * Module stuff
+ ******************************************/
+
+static int __init kconf_init_module(void)
+{
+	int err;
+	int i;
+
+	kconf_msg(KERN_INFO, kconf_MODULE_DESCR " loading\n");
+
+	if (num_conferences < 1 ||
+	    max_parties < 2 || max_parties > KCONF_MAX_PARTIES) {
+		err = -EINVAL;
+		goto err_params;
+	}
+
+	kconf_build_tables();
+
+	kconf_conferences = kmalloc(sizeof(*kconf_conferences) *
+					num_conferences, GFP_KERNEL);
+	if (!kconf_conferences) {
+		err = -ENOMEM;
+		goto err_alloc_conferences;
+	}
+
+	for (i = 0; i < num_conferences; i++) {
+		kconf_conferences[i] = kconf_conference_create(i, max_parties);
+		if (!kconf_conferences[i]) {
+			err = -ENOMEM;
+			goto err_conference_create;
+		}
+
+		err = kconf_conference_register(kconf_conferences[i]);
+		if (err < 0) {
+			kconf_conference_destroy(kconf_conferences[i]);
+			goto err_conference_register;
+		}
+	}
+
+	return 0;
+
+err_conference_register:
+err_conference_create:
+	while (--i >= 0) {
+		kconf_conference_unregister(kconf_conferences[i]);
+		kconf_conference_destroy(kconf_conferences[i]);
+	}
+
+	kfree(kconf_conferences);
+err_alloc_conferences:
+err_params:
+
+	return err;
+}
+
+module_init(kconf_init_module);
+
+static void __exit kconf_module_exit(void)
+{
+	int i;
+
+	for (i = num_conferences - 1; i >= 0; i--) {
+		kconf_conference_unregister(kconf_conferences[i]);
+		kconf_conference_destroy(kconf_conferences[i]);
+	}
+
+	kfree(kconf_conferences);
+
+	kconf_msg(KERN_INFO, kconf_MODULE_DESCR " unloaded\n");
+}
+
+module_exit(kconf_module_exit);
+
+MODULE_DESCRIPTION(kconf_MODULE_DESCR);
+MODULE_AUTHOR("vstuff contributors");
+MODULE_LICENSE("GPL");
+
+module_param(num_conferences, int, 0444);
+MODULE_PARM_DESC(num_conferences, "Number of conferences");
+module_param(max_parties, int, 0444);
+MODULE_PARM_DESC(max_parties, "Maximum number of parties per conference");
+module_param(mu_law, int, 0444);
+MODULE_PARM_DESC(mu_law, "Parties default to mu-law instead of A-law");
+
+#ifdef DEBUG_CODE
+module_param(debug_level, int, 0444);
+MODULE_PARM_DESC(debug_level, "Initial debug level");
+#endif
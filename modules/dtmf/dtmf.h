@@ -0,0 +1,64 @@
+/*
+ * kstreamer DTMF detector
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#ifndef _KS_DTMF_H
+#define _KS_DTMF_H
+
+#ifdef __KERNEL__
+
+#include <linux/list.h>
+
+#include <linux/kstreamer/channel.h>
+#include <linux/kstreamer/softswitch.h>
+#include <linux/kstreamer/dtmf_detector.h>
+
+#include "dtmf_detect.h"
+
+#define kdtmf_MODULE_NAME "ks-dtmf"
+#define kdtmf_MODULE_PREFIX kdtmf_MODULE_NAME ": "
+#define kdtmf_MODULE_DESCR "kstreamer DTMF detector"
+
+/* A detector attached to a channel entering the softswitch. Created and
+ * destroyed by setting the dtmf_detector feature of the channel, with the
+ * topology lock held.
+ */
+struct kdtmf_chan
+{
+	struct list_head node;
+
+	struct ks_chan *chan;
+	struct kss_tap tap;
+
+	struct ks_dtmf_detector_descr descr;
+	const s16 *dec_table;
+
+	struct kdtmf_detector det;
+};
+
+#if defined(DEBUG_CODE) && defined(DEBUG_DEFAULTS)
+#define kdtmf_debug(dbglevel, format, arg...)			\
+	if (debug_level >= dbglevel)				\
+		printk(KERN_DEBUG kdtmf_MODULE_PREFIX		\
+			format,					\
+			## arg)
+#else
+#define kdtmf_debug(format, arg...) do {} while (0)
+#endif
+
+#define kdtmf_msg(level, format, arg...)			\
+	printk(level kdtmf_MODULE_PREFIX			\
+		format,						\
+		## arg)
+
+#endif
+
+#endif
@@ -0,0 +1,208 @@
+/*
+ * kstreamer DTMF detector
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+/* Block Goertzel detector. Every KDTMF_BLOCK_SIZE samples the power of the
+ * eight DTMF frequencies is evaluated and the block is classified as either
+ * a digit or nothing. A digit begins after KDTMF_BEGIN_HITS consecutive
+ * blocks classified as the same digit and ends after KDTMF_END_MISSES
+ * blocks which are not; a single missing block is thus bridged.
+ *
+ * With 12.75 ms blocks a 40 ms tone always covers two whole blocks and at
+ * least 57% of a third one while a 20 ms tone never covers more than one
+ * whole block plus 57% split between its neighbours, so requiring three
+ * hits and accepting edge blocks carrying 57% of tone but not those carrying
+ * 28% separates the two regardless of alignment (Q.24).
+ */
+
+#ifdef __KERNEL__
+#include <linux/kernel.h>
+#include <linux/string.h>
+#else
+#include <string.h>
+#endif
+
+#include "dtmf_detect.h"
+
+#define KDTMF_BEGIN_HITS 3
+#define KDTMF_END_MISSES 2
+
+/* (A * N / 2)^2 of a -35 dBm0 tone, 0 dBm0 being a 22706 peak sine */
+#define KDTMF_MIN_POWER 424000000LL
+
+/* 8 dB of normal and reverse twist, times 10 */
+#define KDTMF_MAX_TWIST_X10 63
+
+/* Other tones of the same group must be at least 3 dB below the peak. Rows
+ * are about one bin apart and a block only partially covered by the tone
+ * has a proportionally wider main lobe, anything stricter loses the edge
+ * blocks of short digits.
+ */
+#define KDTMF_RELATIVE_PEAK 2
+
+/* Percentage of the block energy which has to be found in the two tones,
+ * a block entirely filled by a DTMF signal scores 100
+ */
+#define KDTMF_MIN_TONE_RATIO 40
+
+/* 2 * cos(2 * pi * f / 8000) in Q14 */
+static const __s32 kdtmf_coefs[KDTMF_TONES] =
+{
+	27980,	/*  697 Hz */
+	26956,	/*  770 Hz */
+	25701,	/*  852 Hz */
+	24219,	/*  941 Hz */
+	19073,	/* 1209 Hz */
+	16325,	/* 1336 Hz */
+	13085,	/* 1477 Hz */
+	9315,	/* 1633 Hz */
+};
+
+static const char kdtmf_digits[16] = "123A456B789C*0#D";
+
+static inline __s64 kdtmf_power(__s32 s1, __s32 s2, __s32 coef)
+{
+	return (__s64)s1 * s1 + (__s64)s2 * s2 -
+		(((__s64)coef * s1) >> 14) * s2;
+}
+
+static char kdtmf_classify_block(struct kdtmf_detector *det)
+{
+	__s64 p[KDTMF_TONES];
+	int row = 0;
+	int col = 4;
+	int i;
+
+	for (i=0; i<KDTMF_TONES; i++)
+		p[i] = kdtmf_power(det->s1[i], det->s2[i], kdtmf_coefs[i]);
+
+	for (i=1; i<4; i++) {
+		if (p[i] > p[row])
+			row = i;
+	}
+
+	for (i=5; i<8; i++) {
+		if (p[i] > p[col])
+			col = i;
+	}
+
+	if (p[row] < KDTMF_MIN_POWER || p[col] < KDTMF_MIN_POWER)
+		return 0;
+
+	if (p[col] * 10 > p[row] * KDTMF_MAX_TWIST_X10 ||
+	    p[row] * 10 > p[col] * KDTMF_MAX_TWIST_X10)
+		return 0;
+
+	for (i=0; i<KDTMF_TONES; i++) {
+		if (i == row || i == col)
+			continue;
+
+		if (p[i] * KDTMF_RELATIVE_PEAK > p[i < 4 ? row : col])
+			return 0;
+	}
+
+	/* Pure tones give 2 * (Pr + Pc) == N * E */
+	if ((p[row] + p[col]) * 2 * 100 <
+			det->energy * KDTMF_BLOCK_SIZE * KDTMF_MIN_TONE_RATIO)
+		return 0;
+
+	return kdtmf_digits[(row << 2) + col - 4];
+}
+
+static void kdtmf_end_block(struct kdtmf_detector *det)
+{
+	char hit = kdtmf_classify_block(det);
+
+	det->blocks++;
+
+	if (hit && hit == det->candidate)
+		det->hits++;
+	else {
+		det->candidate = hit;
+		det->hits = hit ? 1 : 0;
+	}
+
+	if (det->digit) {
+		if (hit == det->digit) {
+			det->digit_blocks += det->misses + 1;
+			det->misses = 0;
+		} else if (++det->misses >= KDTMF_END_MISSES) {
+			det->event(det->data, KDTMF_EVENT_END, det->digit,
+				det->digit_blocks * KDTMF_BLOCK_SIZE * 1000 /
+							KDTMF_SAMPLE_RATE);
+
+			det->digit = 0;
+		}
+	}
+
+	if (!det->digit && det->candidate &&
+	    det->hits >= KDTMF_BEGIN_HITS) {
+		det->digit = det->candidate;
+		det->digit_blocks = det->hits;
+		det->misses = 0;
+		det->digits++;
+
+		det->event(det->data, KDTMF_EVENT_BEGIN, det->digit, 0);
+	}
+
+	memset(det->s1, 0, sizeof(det->s1));
+	memset(det->s2, 0, sizeof(det->s2));
+	det->energy = 0;
+	det->samples = 0;
+}
+
+void kdtmf_detector_process(
+	struct kdtmf_detector *det,
+	const __s16 *samples,
+	int len)
+{
+	int i;
+	int j;
+
+	for (i=0; i<len; i++) {
+		__s32 x = samples[i];
+
+		det->energy += x * x;
+
+		for (j=0; j<KDTMF_TONES; j++) {
+			__s32 s0 = x - det->s2[j] +
+				(((__s64)kdtmf_coefs[j] * det->s1[j]) >> 14);
+
+			det->s2[j] = det->s1[j];
+			det->s1[j] = s0;
+		}
+
+		if (++det->samples == KDTMF_BLOCK_SIZE)
+			kdtmf_end_block(det);
+	}
+}
+
+void kdtmf_detector_reset(struct kdtmf_detector *det)
+{
+	kdtmf_event_func_t event = det->event;
+	void *data = det->data;
+
+	memset(det, 0, sizeof(*det));
+
+	det->event = event;
+	det->data = data;
+}
+
+void kdtmf_detector_init(
+	struct kdtmf_detector *det,
+	kdtmf_event_func_t event,
+	void *data)
+{
+	memset(det, 0, sizeof(*det));
+
+	det->event = event;
+	det->data = data;
+}
@@ -0,0 +1,77 @@
+/*
+ * kstreamer DTMF detector
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#ifndef _KDTMF_DETECT_H
+#define _KDTMF_DETECT_H
+
+/* The detector only depends on linux/types.h so that the very same code
+ * runs in the ks-dtmf module and in the userspace test vectors (tests/).
+ */
+
+#include <linux/types.h>
+
+#define KDTMF_SAMPLE_RATE 8000
+
+/* 102 samples = 12.75 ms, bins are 78.4 Hz apart */
+#define KDTMF_BLOCK_SIZE 102
+
+#define KDTMF_TONES 8
+
+enum kdtmf_event_type
+{
+	KDTMF_EVENT_BEGIN,
+	KDTMF_EVENT_END,
+};
+
+struct kdtmf_detector;
+
+typedef void (*kdtmf_event_func_t)(
+	void *data,
+	enum kdtmf_event_type type,
+	char digit,
+	int duration_ms);
+
+struct kdtmf_detector
+{
+	/* Goertzel state of rows (0-3) and columns (4-7) */
+	__s32 s1[KDTMF_TONES];
+	__s32 s2[KDTMF_TONES];
+	__s64 energy;
+	int samples;
+
+	/* Candidate digit of the previous blocks and its run length */
+	char candidate;
+	int hits;
+
+	/* Digit currently reported, 0 if none */
+	char digit;
+	int misses;
+	int digit_blocks;
+
+	kdtmf_event_func_t event;
+	void *data;
+
+	unsigned long blocks;
+	unsigned long digits;
+};
+
+void kdtmf_detector_init(
+	struct kdtmf_detector *det,
+	kdtmf_event_func_t event,
+	void *data);
+void kdtmf_detector_reset(struct kdtmf_detector *det);
+void kdtmf_detector_process(
+	struct kdtmf_detector *det,
+	const __s16 *samples,
+	int len);
+
+#endif
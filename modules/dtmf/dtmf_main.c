@@ -0,0 +1,343 @@
+/*
+ * kstreamer DTMF detector
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+/* Registers the "dtmf_detector" soft feature on every channel entering the
+ * softswitch. Enabling it taps the channel's streamframes into a Goertzel
+ * detector and every recognized digit is multicasted as a KS_NETLINK_EVENT
+ * to the libkstreamer subscribers, so that calls may stay switched in the
+ * kernel while digits are still received.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/list.h>
+#include <linux/slab.h>
+
+#include <linux/kstreamer/kstreamer.h>
+#include <linux/kstreamer/channel.h>
+#include <linux/kstreamer/feature.h>
+#include <linux/kstreamer/netlink.h>
+#include <linux/kstreamer/streamframe.h>
+#include <linux/kstreamer/softswitch.h>
+
+#include "dtmf.h"
+
+#ifdef DEBUG_CODE
+#ifdef DEBUG_DEFAULTS
+int debug_level = 3;
+#else
+int debug_level = 0;
+#endif
+#endif
+
+static struct ks_feature *kdtmf_feature;
+
+/* Protected by the topology lock */
+static LIST_HEAD(kdtmf_chans);
+
+/* Indexed by (mu_mode << 1) | reversed */
+static s16 kdtmf_dec[4][256];
+
+static s16 __init kdtmf_alaw_to_linear(u8 a_val)
+{
+	int t;
+	int seg;
+
+	a_val ^= 0x55;
+
+	t = (a_val & 0x0f) << 4;
+	seg = (a_val & 0x70) >> 4;
+
+	switch(seg) {
+	case 0:
+		t += 8;
+	break;
+
+	case 1:
+		t += 0x108;
+	break;
+
+	default:
+		t += 0x108;
+		t <<= seg - 1;
+	}
+
+	return (a_val & 0x80) ? t : -t;
+}
+
+static s16 __init kdtmf_ulaw_to_linear(u8 u_val)
+{
+	int t;
+
+	u_val = ~u_val;
+
+	t = ((u_val & 0x0f) << 3) + 0x84;
+	t <<= (u_val & 0x70) >> 4;
+
+	return (u_val & 0x80) ? (0x84 - t) : (t - 0x84);
+}
+
+static u8 __init kdtmf_reverse(u8 val)
+{
+	u8 res = 0;
+	int i;
+
+	for (i=0; i<8; i++) {
+		res = (res << 1) | (val & 1);
+		val >>= 1;
+	}
+
+	return res;
+}
+
+static void __init kdtmf_build_tables(void)
+{
+	int i;
+
+	for (i=0; i<256; i++) {
+		kdtmf_dec[0][i] = kdtmf_alaw_to_linear(i);
+		kdtmf_dec[1][i] = kdtmf_alaw_to_linear(kdtmf_reverse(i));
+		kdtmf_dec[2][i] = kdtmf_ulaw_to_linear(i);
+		kdtmf_dec[3][i] = kdtmf_ulaw_to_linear(kdtmf_reverse(i));
+	}
+}
+
+static struct kdtmf_chan *kdtmf_chan_search(struct ks_chan *chan)
+{
+	struct kdtmf_chan *dchan;
+
+	list_for_each_entry(dchan, &kdtmf_chans, node) {
+		if (dchan->chan == chan)
+			return dchan;
+	}
+
+	return NULL;
+}
+
+static void kdtmf_event(
+	void *data,
+	enum kdtmf_event_type type,
+	char digit,
+	int duration_ms)
+{
+	struct kdtmf_chan *dchan = data;
+	struct ks_dtmf_event event;
+	int err;
+
+	memset(&event, 0, sizeof(event));
+	event.type = type == KDTMF_EVENT_BEGIN ?
+			KS_DTMF_EVENT_BEGIN : KS_DTMF_EVENT_END;
+	event.digit = digit;
+	event.duration = duration_ms;
+
+	kdtmf_debug(2, "chan %d: digit '%c' %s %d ms\n",
+		dchan->chan->id, digit,
+		type == KDTMF_EVENT_BEGIN ? "begin" : "end",
+		duration_ms);
+
+	err = ks_netlink_event_send(kdtmf_feature, dchan->chan,
+					&event, sizeof(event));
+	if (err < 0)
+		kdtmf_debug(1, "Cannot send event: %d\n", err);
+}
+
+static void kdtmf_tap_process(struct kss_tap *tap, struct ks_streamframe *sf)
+{
+	struct kdtmf_chan *dchan = tap->data;
+	const s16 *dec_table = dchan->dec_table;
+	s16 buf[64];
+	int pos;
+
+	for (pos=0; pos<sf->len; pos += ARRAY_SIZE(buf)) {
+		int len = min_t(int, sf->len - pos, ARRAY_SIZE(buf));
+		int i;
+
+		for (i=0; i<len; i++)
+			buf[i] = dec_table[sf->data[pos + i]];
+
+		kdtmf_detector_process(&dchan->det, buf, len);
+	}
+}
+
+static struct kss_tap_ops kdtmf_tap_ops =
+{
+	.process	= kdtmf_tap_process,
+};
+
+static void kdtmf_chan_configure(
+	struct kdtmf_chan *dchan,
+	struct ks_dtmf_detector_descr *descr)
+{
+	dchan->descr.mu_mode = descr->mu_mode;
+	dchan->descr.reversed = descr->reversed;
+
+	dchan->dec_table = kdtmf_dec[(descr->mu_mode << 1) | descr->reversed];
+}
+
+static int kdtmf_chan_enable(
+	struct ks_chan *chan,
+	struct ks_dtmf_detector_descr *descr)
+{
+	struct kdtmf_chan *dchan;
+
+	dchan = kmalloc(sizeof(*dchan), GFP_KERNEL);
+	if (!dchan)
+		return -ENOMEM;
+
+	memset(dchan, 0, sizeof(*dchan));
+
+	dchan->chan = ks_chan_get(chan);
+	dchan->descr.enabled = 1;
+	kdtmf_chan_configure(dchan, descr);
+
+	kdtmf_detector_init(&dchan->det, kdtmf_event, dchan);
+
+	list_add_tail(&dchan->node, &kdtmf_chans);
+
+	kss_tap_add(&dchan->tap, &kdtmf_tap_ops, chan, dchan);
+
+	kdtmf_debug(1, "Detector enabled on chan %d\n", chan->id);
+
+	return 0;
+}
+
+static void kdtmf_chan_disable(struct kdtmf_chan *dchan)
+{
+	kss_tap_del(&dchan->tap);
+
+	list_del(&dchan->node);
+
+	kdtmf_debug(1, "Detector disabled on chan %d\n", dchan->chan->id);
+
+	ks_chan_put(dchan->chan);
+	kfree(dchan);
+}
+
+static int kdtmf_feature_get(
+	struct ks_feature *feature,
+	struct ks_chan *chan,
+	void *buf,
+	int *len)
+{
+	struct ks_dtmf_detector_descr *descr = buf;
+	struct kdtmf_chan *dchan;
+
+	if (chan->to != &kss_softswitch.ks_node)
+		return -ENOENT;
+
+	if (*len < sizeof(*descr))
+		return -ENOSPC;
+
+	*len = sizeof(*descr);
+
+	dchan = kdtmf_chan_search(chan);
+	if (dchan)
+		memcpy(descr, &dchan->descr, sizeof(*descr));
+	else
+		memset(descr, 0, sizeof(*descr));
+
+	return 0;
+}
+
+static int kdtmf_feature_set(
+	struct ks_feature *feature,
+	struct ks_chan *chan,
+	void *buf,
+	int len)
+{
+	struct ks_dtmf_detector_descr *descr = buf;
+	struct kdtmf_chan *dchan;
+
+	if (chan->to != &kss_softswitch.ks_node)
+		return -EINVAL;
+
+	if (len < sizeof(*descr))
+		return -EINVAL;
+
+	dchan = kdtmf_chan_search(chan);
+
+	if (descr->enabled) {
+		if (dchan)
+			kdtmf_chan_configure(dchan, descr);
+		else
+			return kdtmf_chan_enable(chan, descr);
+	} else if (dchan)
+		kdtmf_chan_disable(dchan);
+
+	return 0;
+}
+
+static struct ks_feature_ops kdtmf_feature_ops =
+{
+	.get	= kdtmf_feature_get,
+	.set	= kdtmf_feature_set,
+};
+
+/******************************************
+ * Module stuff
+ ******************************************/
+
+static int __init kdtmf_init_module(void)
+{
+	int err;
+
+	kdtmf_msg(KERN_INFO, kdtmf_MODULE_DESCR " loading\n");
+
+	kdtmf_build_tables();
+
+	kdtmf_feature = ks_feature_register_soft("dtmf_detector",
+							&kdtmf_feature_ops);
+	if (!kdtmf_feature) {
+		err = -ENOMEM;
+		goto err_register_feature;
+	}
+
+	return 0;
+
+	ks_feature_unregister(kdtmf_feature);
+err_register_feature:
+
+	return err;
+}
+
+module_init(kdtmf_init_module);
+
+static void __exit kdtmf_module_exit(void)
+{
+	struct kdtmf_chan *dchan, *t;
+
+	/* Once unregistered the feature cannot be set anymore, keep it
+	 * around for the events of the taps still running
+	 */
+	ks_feature_get(kdtmf_feature);
+	ks_feature_unregister(kdtmf_feature);
+
+	ks_topology_lock();
+	list_for_each_entry_safe(dchan, t, &kdtmf_chans, node)
+		kdtmf_chan_disable(dchan);
+	ks_topology_unlock();
+
+	ks_feature_put(kdtmf_feature);
+
+	kdtmf_msg(KERN_INFO, kdtmf_MODULE_DESCR " unloaded\n");
+}
+
+module_exit(kdtmf_module_exit);
+
+MODULE_DESCRIPTION(kdtmf_MODULE_DESCR);
+MODULE_AUTHOR("vstuff contributors");
+MODULE_LICENSE("GPL");
+
+#ifdef DEBUG_CODE
+module_param(debug_level, int, 0444);
+MODULE_PARM_DESC(debug_level, "Initial debug level");
+#endif
@@ -521,6 +521,95 @@ static DEVICE_ATTR(dip_switches, S_IRUGO,
 		hfc_show_dip_switches,
 		NULL);
 
+static ssize_t hfc_show_rx_sched(
+	struct device *device,
+	DEVICE_ATTR_COMPAT
+	char *buf)
+{
+	struct pci_dev *pci_dev = to_pci_dev(device);
+	struct hfc_card *card = pci_get_drvdata(pci_dev);
+
+	return kss_rx_sched_show_stats(&card->rx_sched, buf);
+}
+
+static DEVICE_ATTR(rx_sched, S_IRUGO,
+		hfc_show_rx_sched,
+		NULL);
+
+//----------------------------------------------------------------------------
+
+static ssize_t hfc_show_irq_moderation(
+	struct device *device,
+	DEVICE_ATTR_COMPAT
+	char *buf)
+{
+	struct pci_dev *pci_dev = to_pci_dev(device);
+	struct hfc_card *card = pci_get_drvdata(pci_dev);
+
+	return snprintf(buf, PAGE_SIZE, "%d\n",
+		card->irq_moderation < 0 ? 0 :
+			250 << card->irq_moderation);
+}
+
+static ssize_t hfc_store_irq_moderation(
+	struct device *device,
+	DEVICE_ATTR_COMPAT
+	const char *buf,
+	size_t count)
+{
+	struct pci_dev *pci_dev = to_pci_dev(device);
+	struct hfc_card *card = pci_get_drvdata(pci_dev);
+	int moderation;
+
+	int value;
+	if (sscanf(buf, "%d", &value) < 1)
+		return -EINVAL;
+
+	if (value < 0 || value > 250 << 15)
+		return -EINVAL;
+
+	/* Round up to the next period supported by the timer */
+	if (value) {
+		moderation = 0;
+		while (250 << moderation < value)
+			moderation++;
+	} else
+		moderation = -1;
+
+	hfc_card_lock(card);
+	card->irq_moderation = moderation;
+	hfc_card_update_r_ti_wd(card);
+	hfc_card_update_r_irq_ctrl(card);
+	hfc_card_unlock(card);
+
+	/* Service whatever was pending while switching mode */
+	hfc_irq_batch_poll(&card->irq_batch);
+	tasklet_schedule(&card->irq_tasklet);
+
+	return count;
+}
+
+static DEVICE_ATTR(irq_moderation, S_IRUGO | S_IWUSR,
+		hfc_show_irq_moderation,
+		hfc_store_irq_moderation);
+
+static ssize_t hfc_show_irq_stats(
+	struct device *device,
+	DEVICE_ATTR_COMPAT
+	char *buf)
+{
+	struct pci_dev *pci_dev = to_pci_dev(device);
+	struct hfc_card *card = pci_get_drvdata(pci_dev);
+
+	return hfc_irq_batch_show_stats(&card->irq_batch, buf);
+}
+
+static DEVICE_ATTR(irq_stats, S_IRUGO,
+		hfc_show_irq_stats,
+		NULL);
+
+//----------------------------------------------------------------------------
+
 static struct device_attribute *hfc_card_attributes[] =
 {
 	&dev_attr_double_clock,
@@ -537,6 +626,9 @@ static struct device_attribute *hfc_card_attributes[] =
 	&dev_attr_bert_cnt,
 	&dev_attr_pwm0,
 	&dev_attr_pwm1,
+	&dev_attr_rx_sched,
+	&dev_attr_irq_moderation,
+	&dev_attr_irq_stats,
 	NULL
 };
 
@@ -590,6 +682,23 @@ void hfc_card_sysfs_delete_files(
  * HW routines
  ******************************************/
 
+static void hfc_card_rx_sched_lock(struct kss_rx_sched *sched)
+{
+	hfc_card_lock(sched->driver_data);
+}
+
+static void hfc_card_rx_sched_unlock(struct kss_rx_sched *sched)
+{
+	hfc_card_unlock(sched->driver_data);
+}
+
+static struct kss_rx_sched_ops hfc_card_rx_sched_ops =
+{
+	.lock	= hfc_card_rx_sched_lock,
+	.unlock	= hfc_card_rx_sched_unlock,
+	.drain	= hfc_sys_chan_rx_drain,
+};
+
 void hfc_card_softreset(struct hfc_card *card)
 {
 	hfc_msg_card(card, KERN_INFO, "resetting\n");
@@ -704,6 +813,27 @@ void hfc_card_update_st_sync(struct hfc_card *card)
 			hfc_R_ST_SYNC_V_AUTO_SYNC_DISABLED);
 }
 
+void hfc_card_update_r_ti_wd(struct hfc_card *card)
+{
+	if (card->irq_moderation >= 0)
+		hfc_outb(card, hfc_R_TI_WD,
+			hfc_R_TI_WD_V_EV_TS_250_US + card->irq_moderation);
+	else
+		hfc_outb(card, hfc_R_TI_WD,
+			hfc_R_TI_WD_V_EV_TS_8_192_S);
+}
+
+void hfc_card_update_r_irq_ctrl(struct hfc_card *card)
+{
+	u8 irq_ctrl = hfc_R_IRQ_CTRL_V_GLOB_IRQ_EN |
+			hfc_R_IRQ_CTRL_V_IRQ_POL_LOW;
+
+	if (card->irq_moderation < 0)
+		irq_ctrl |= hfc_R_IRQ_CTRL_V_FIFO_IRQ;
+
+	hfc_outb(card, hfc_R_IRQ_CTRL, irq_ctrl);
+}
+
 void hfc_card_update_bert_wd_md(struct hfc_card *card, u8 otherbits)
 {
 	hfc_outb(card, hfc_R_BERT_WD_MD,
@@ -732,9 +862,7 @@ void hfc_card_initialize_hw(struct hfc_card *card)
 	hfc_outb(card, hfc_R_PWM1, card->pwm1);
 
 	// Timer setup
-	hfc_outb(card, hfc_R_TI_WD,
-		hfc_R_TI_WD_V_EV_TS_8_192_S);
-//		hfc_R_TI_WD_V_EV_TS_1_MS);
+	hfc_card_update_r_ti_wd(card);
 
 	hfc_card_update_pcm_md0(card, 0);
 	hfc_card_update_pcm_md1(card);
@@ -790,30 +918,49 @@ void hfc_card_initialize_hw(struct hfc_card *card)
 	}
 
 	/* Enable interrupts */
-	hfc_outb(card, hfc_R_IRQ_CTRL,
-		hfc_R_IRQ_CTRL_V_FIFO_IRQ|
-		hfc_R_IRQ_CTRL_V_GLOB_IRQ_EN|
-		hfc_R_IRQ_CTRL_V_IRQ_POL_LOW);
+	hfc_card_update_r_irq_ctrl(card);
 }
 
 /******************************************
  * Interrupt Handler
  ******************************************/
 
-static inline void hfc_handle_fifo_tx_interrupt(struct hfc_sys_chan *chan)
+static int hfc_card_fifo_service(void *data, int fifo, int rx)
 {
-	if (test_and_clear_bit(HFC_SYS_CHAN_TX_STATUS_STOPPED,
-					&chan->tx.status))
-		tasklet_schedule(&chan->tx.wake_tasklet);
+	struct hfc_card *card = data;
+	struct hfc_sys_chan *chan = &card->sys_port.chans[fifo];
+
+	if (rx)
+		return hfc_sys_chan_rx_service(&chan->rx);
+	else
+		return hfc_sys_chan_tx_service(&chan->tx);
 }
 
-static inline void hfc_handle_fifo_rx_interrupt(struct hfc_sys_chan *chan)
+/* Services all the FIFOs collected by the interrupt handler since the last
+ * run, with a single acquisition of the card lock
+ */
+static void hfc_card_irq_tasklet(unsigned long data)
 {
-	tasklet_schedule(&chan->rx.tasklet);
+	struct hfc_card *card = (struct hfc_card *)data;
+	int again;
+
+	hfc_card_lock(card);
+	again = hfc_irq_batch_dispatch(&card->irq_batch,
+				hfc_card_fifo_service, card);
+	hfc_card_unlock(card);
+
+	if (again)
+		tasklet_schedule(&card->irq_tasklet);
 }
 
-static inline void hfc_handle_timer_interrupt(struct hfc_card *card)
+static inline int hfc_handle_timer_interrupt(struct hfc_card *card)
 {
+	if (card->irq_moderation < 0)
+		return FALSE;
+
+	hfc_irq_batch_poll(&card->irq_batch);
+
+	return TRUE;
 }
 
 static inline void hfc_handle_state_interrupt(struct hfc_st_port *port)
@@ -821,43 +968,11 @@ static inline void hfc_handle_state_interrupt(struct hfc_st_port *port)
 	schedule_delayed_work(&port->state_change_work, 0);
 }
 
-static inline void hfc_handle_fifo_block_interrupt(
+static inline int hfc_handle_fifo_block_interrupt(
 	struct hfc_card *card, int block)
 {
-	u8 fifo_irq = hfc_inb(card,
-		hfc_R_IRQ_FIFO_BL0 + block);
-
-	if (fifo_irq & (1 << 0))
-		hfc_handle_fifo_tx_interrupt(
-			&card->sys_port.chans[block * 4 + 0]);
-
-	if (fifo_irq & (1 << 1))
-		hfc_handle_fifo_rx_interrupt(
-			&card->sys_port.chans[block * 4 + 0]);
-
-	if (fifo_irq & (1 << 2))
-		hfc_handle_fifo_tx_interrupt(
-			&card->sys_port.chans[block * 4 + 1]);
-
-	if (fifo_irq & (1 << 3))
-		hfc_handle_fifo_rx_interrupt(
-			&card->sys_port.chans[block * 4 + 1]);
-
-	if (fifo_irq & (1 << 4))
-		hfc_handle_fifo_tx_interrupt(
-			&card->sys_port.chans[block * 4 + 2]);
-
-	if (fifo_irq & (1 << 5))
-		hfc_handle_fifo_rx_interrupt(
-			&card->sys_port.chans[block * 4 + 2]);
-
-	if (fifo_irq & (1 << 6))
-		hfc_handle_fifo_tx_interrupt(
-			&card->sys_port.chans[block * 4 + 3]);
-
-	if (fifo_irq & (1 << 7))
-		hfc_handle_fifo_rx_interrupt(
-			&card->sys_port.chans[block * 4 + 3]);
+	return hfc_irq_batch_collect(&card->irq_batch, block,
+			hfc_inb(card, hfc_R_IRQ_FIFO_BL0 + block));
 }
 
 /*
@@ -876,6 +991,8 @@ static irqreturn_t hfc_interrupt(int irq, void *dev_id)
 #endif
 {
 	struct hfc_card *card = dev_id;
+	int fifos_pending = FALSE;
+	ktime_t start = ktime_get();
 
 	u8 status = hfc_inb(card, hfc_R_STATUS);
 	u8 irq_sci = hfc_inb(card, hfc_R_SCI);
@@ -891,7 +1008,8 @@ static irqreturn_t hfc_interrupt(int irq, void *dev_id)
 		u8 irq_misc = hfc_inb(card, hfc_R_IRQ_MISC);
 
 		if (irq_misc & hfc_R_IRQ_MISC_V_TI_IRQ) {
-			hfc_handle_timer_interrupt(card);
+			if (hfc_handle_timer_interrupt(card))
+				fifos_pending = TRUE;
 		}
 	}
 
@@ -901,11 +1019,17 @@ static irqreturn_t hfc_interrupt(int irq, void *dev_id)
 		int i;
 		for (i=0; i<8; i++) {
 			if (irq_oview & (1 << i)) {
-				hfc_handle_fifo_block_interrupt(card, i);
+				if (hfc_handle_fifo_block_interrupt(card, i))
+					fifos_pending = TRUE;
 			}
 		}
 	}
 
+	hfc_irq_batch_interrupt(&card->irq_batch, start);
+
+	if (fifos_pending)
+		tasklet_schedule(&card->irq_tasklet);
+
 	if (irq_sci) {
 		int i;
 		for (i=0; i<card->num_st_ports; i++) {
@@ -940,6 +1064,14 @@ struct hfc_card *hfc_card_create(
 
 	spin_lock_init(&card->lock);
 
+	kss_rx_sched_init(&card->rx_sched, &hfc_card_rx_sched_ops,
+				HFC_RX_SCHED_FREQUENCY, card);
+
+	hfc_irq_batch_init(&card->irq_batch);
+	tasklet_init(&card->irq_tasklet, hfc_card_irq_tasklet,
+				(unsigned long)card);
+	card->irq_moderation = -1;
+
 	card->pci_dev = pci_dev;
 
 	card->config = card_config;
@@ -1206,6 +1338,7 @@ void hfc_card_remove(struct hfc_card *card)
 
 	pci_write_config_word(card->pci_dev, PCI_COMMAND, 0);
 	free_irq(card->pci_dev->irq, card);
+	tasklet_kill(&card->irq_tasklet);
 	iounmap(card->io_mem);
 	pci_release_regions(card->pci_dev);
 	pci_disable_device(card->pci_dev);
@@ -1220,6 +1353,8 @@ void hfc_card_destroy(struct hfc_card *card)
 	 * kernel creates hidden kobj->parent reference.
 	 */
 
+	kss_rx_sched_destroy(&card->rx_sched);
+
 	hfc_pcm_port_destroy(&card->pcm_port);
 	hfc_sys_port_destroy(&card->sys_port);
 
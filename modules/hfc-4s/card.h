@@ -15,9 +15,13 @@
 
 #include <linux/delay.h>
 #include <linux/pci.h>
+#include <linux/interrupt.h>
 
 #include <linux/kstreamer/kstreamer.h>
 #include <linux/kstreamer/node.h>
+#include <linux/kstreamer/softswitch.h>
+
+#include <hfc/irq_batch.h>
 
 #include "module.h"
 #include "st_port.h"
@@ -72,6 +76,10 @@
 		dev_name(&((card)->pci_dev->dev)), 	\
 		## arg)
 #endif
+
+/* Streaming RX FIFOs are drained by the card's scheduler at this rate */
+#define HFC_RX_SCHED_FREQUENCY 50
+
 struct hfc_card_config
 {
 	u8 double_clock;
@@ -115,6 +123,17 @@ struct hfc_card
 	struct hfc_pcm_port pcm_port;
 	struct hfc_sys_port sys_port;
 
+	struct kss_rx_sched rx_sched;
+
+	/* FIFO interrupts are collected here and serviced by irq_tasklet */
+	struct hfc_irq_batch irq_batch;
+	struct tasklet_struct irq_tasklet;
+
+	/* When >= 0 FIFO interrupts are disabled and FIFOs are polled by the
+	 * timer interrupt, every 250us << irq_moderation
+	 */
+	int irq_moderation;
+
 	struct hfc_led leds[4];
 	u8 gpio_out;
 	u8 gpio_en;
@@ -154,6 +173,8 @@ void hfc_card_update_bert_wd_md(struct hfc_card *card, u8 otherbits);
 void hfc_card_update_r_ctrl(struct hfc_card *card);
 void hfc_card_update_r_brg_pcm_cfg(struct hfc_card *card);
 void hfc_card_update_r_ram_misc(struct hfc_card *card);
+void hfc_card_update_r_ti_wd(struct hfc_card *card);
+void hfc_card_update_r_irq_ctrl(struct hfc_card *card);
 
 
 
@@ -13,6 +13,8 @@
 #ifndef _HFC_FIFO_INLINE_H
 #define _HFC_FIFO_INLINE_H
 
+#include <hfc/fifo_burst.h>
+
 #include "card.h"
 
 static inline void hfc_fifo_next_frame(struct hfc_fifo *fifo)
@@ -169,27 +171,7 @@ static inline int hfc_fifo_mem_read(
 {
 	struct hfc_card *card = fifo->card;
 
-#if 0
-	int i;
-	for (i=0; i<size; i++) {
-		((u8 *)data)[i] = hfc_inb(card, hfc_A_FIFO_DATA0);
-	}
-#endif
-
-	union { u32 l; u8 b[4]; } word;
-
-	// Would unaligned write be better?
-	int pos = 0;
-	while (pos < size - 3) {
-		word.l = hfc_inl(card, hfc_A_FIFO_DATA2);
-		memcpy(data + pos, word.b, 4);
-		pos += 4;
-	}
-
-	while (pos < size) {
-		*((u8 *)(data + pos)) = hfc_inb(card, hfc_A_FIFO_DATA0);
-		pos++;
-	}
+	hfc_fifo_burst_read(card->io_mem + hfc_A_FIFO_DATA0, data, size);
 
 	return size;
 }
@@ -200,17 +182,11 @@ static inline int hfc_fifo_mem_read_dword(
 {
 	struct hfc_card *card = fifo->card;
 
-	union { u32 l; u8 b[4]; } word;
+	size &= ~3;
 
-	// Would unaligned write be better?
-	int pos = 0;
-	while (pos < size - 3) {
-		word.l = hfc_inl(card, hfc_A_FIFO_DATA2);
-		memcpy(data + pos, word.b, 4);
-		pos += 4;
-	}
+	hfc_fifo_burst_read(card->io_mem + hfc_A_FIFO_DATA2, data, size);
 
-	return pos;
+	return size;
 }
 
 static inline int hfc_fifo_mem_read_to_user(
@@ -218,67 +194,53 @@ static inline int hfc_fifo_mem_read_to_user(
 	void __user *data, int size)
 {
 	struct hfc_card *card = fifo->card;
-	int err;
-
-	int i;
-	for (i=0; i<size; i++) {
-		err = put_user(hfc_inb(card, hfc_A_FIFO_DATA0),
-				(u8 *)(data + i));
-
-		if (err < 0)
-			return err;
-	}
 
-	return size;
+	return hfc_fifo_burst_read_to_user(card->io_mem + hfc_A_FIFO_DATA0,
+						data, size);
 }
 
+/* Dword writes to the TX FIFOs have only been run against the simulated
+ * card (modules/hfc-sim), the driver used to write octet by octet on
+ * purpose. They stay off until validated on real hardware.
+ */
 static inline void hfc_fifo_mem_write(
 	struct hfc_fifo *fifo,
 	const void *data, int size)
 {
 	struct hfc_card *card = fifo->card;
-
-#if 1
 	int i;
-	for (i=0; i<size; i++) {
-		hfc_outb(card,
-			hfc_A_FIFO_DATA0,
-			((u8 *)data)[i]);
-	}
-
-#else
-
-	union { u32 l; u8 b[4]; } word;
 
-	int pos = 0;
-	while (pos < size - 3) {
-		memcpy(word.b, data + pos, 4);
-		hfc_outl(card, hfc_A_FIFO_DATA2, word.l);
-		pos += 4;
+	if (tx_dword_writes) {
+		hfc_fifo_burst_write(card->io_mem + hfc_A_FIFO_DATA0,
+					data, size);
+		return;
 	}
 
-	while (pos < size) {
-		hfc_outb(card, hfc_A_FIFO_DATA0, *((u8 *)data + pos));
-		pos++;
-	}
-#endif
+	for (i=0; i<size; i++)
+		hfc_outb(card, hfc_A_FIFO_DATA0, ((u8 *)data)[i]);
 }
 
-static inline void hfc_fifo_mem_write_from_user(
+static inline int hfc_fifo_mem_write_from_user(
 	struct hfc_fifo *fifo,
 	const void __user *data, int size)
 {
 	struct hfc_card *card = fifo->card;
-
 	int i;
+
+	if (tx_dword_writes)
+		return hfc_fifo_burst_write_from_user(
+				card->io_mem + hfc_A_FIFO_DATA0, data, size);
+
 	for (i=0; i<size; i++) {
 		u8 val;
-		get_user(val, (u8 *)(data + i));
 
-		hfc_outb(card,
-			hfc_A_FIFO_DATA0,
-			val);
+		if (get_user(val, (u8 __user *)(data + i)))
+			return -EFAULT;
+
+		hfc_outb(card, hfc_A_FIFO_DATA0, val);
 	}
+
+	return size;
 }
 
 #endif
@@ -37,6 +37,8 @@ int debug_level = 0;
 #endif
 #endif
 
+int tx_dword_writes;
+
 #ifndef PCI_DEVICE_ID_CCD_HFC_4S
 #define PCI_DEVICE_ID_CCD_HFC_4S	0x08b4
 #endif
@@ -380,6 +382,10 @@ MODULE_DESCRIPTION(hfc_DRIVER_DESCR);
 MODULE_AUTHOR("Daniele (Vihai) Orlandi <daniele@orlandi.com>");
 MODULE_LICENSE("GPL");
 
+module_param(tx_dword_writes, int, 0644);
+MODULE_PARM_DESC(tx_dword_writes,
+	"Write to the TX FIFOs a dword at a time (not validated on hardware)");
+
 #ifdef DEBUG_CODE
 module_param(debug_level, int, 0444);
 MODULE_PARM_DESC(debug_level, "Initial debug level");
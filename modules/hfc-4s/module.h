@@ -18,5 +18,6 @@
 #define hfc_DRIVER_DESCR "HFC-4S HFC-8S Driver"
 
 extern atomic_t module_refcnt;
+extern int tx_dword_writes;
 
 #endif
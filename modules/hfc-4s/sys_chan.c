@@ -497,6 +497,13 @@ static int hfc_sys_chan_rx_chan_start(struct ks_chan *ks_chan)
 
 	hfc_card_unlock(card);
 
+	/* Framed FIFOs are served by the card's interrupt bottom half */
+	if (!chan_rx->fifo.framer_enabled) {
+		kss_rx_sched_add(&card->rx_sched, &chan_rx->sched_entry,
+								ks_chan);
+		chan_rx->scheduled = TRUE;
+	}
+
 	hfc_debug_sys_chan(chan, 1, "RX channel started\n");
 
 	return 0;
@@ -508,6 +515,11 @@ static void hfc_sys_chan_rx_chan_stop(struct ks_chan *ks_chan)
 	struct hfc_sys_chan *chan = chan_rx->chan;
 	struct hfc_card *card = chan->port->card;
 
+	if (chan_rx->scheduled) {
+		kss_rx_sched_del(&card->rx_sched, &chan_rx->sched_entry);
+		chan_rx->scheduled = FALSE;
+	}
+
 	hfc_card_lock(card);
 
 	chan_rx->fifo.enabled = FALSE;
@@ -521,22 +533,16 @@ static void hfc_sys_chan_rx_chan_stop(struct ks_chan *ks_chan)
 	hfc_debug_sys_chan(chan, 1, "RX channel stopped\n");
 }
 
-static void hfc_sys_chan_rx_chan_stimulus(struct ks_chan *ks_chan)
+/* Called by the card's RX scheduler with the card lock held */
+void hfc_sys_chan_rx_drain(
+	struct kss_rx_sched *sched,
+	struct ks_chan *ks_chan,
+	struct ks_streamframe *sf)
 {
 	struct hfc_sys_chan_rx *chan_rx = to_sys_chan_rx(ks_chan);
-	struct hfc_sys_chan *chan = chan_rx->chan;
-	struct hfc_card *card = chan->port->card;
 	int copied_octets;
 	int available_octets;
 
-	struct ks_streamframe *sf;
-
-	sf = ks_sf_alloc();
-	if (!sf)
-		return;
-
-	hfc_card_lock(card);
-
 	hfc_fifo_select(&chan_rx->fifo);
 
 	available_octets = hfc_fifo_used(&chan_rx->fifo);
@@ -554,12 +560,6 @@ static void hfc_sys_chan_rx_chan_stimulus(struct ks_chan *ks_chan)
 
 	hfc_fifo_mem_read(&chan_rx->fifo, sf->data, copied_octets);
 	sf->len = copied_octets;
-
-	hfc_card_unlock(card);
-
-	kss_chan_push_raw(ks_chan, sf);
-
-	ks_sf_put(sf);
 }
 
 static int hfc_sys_chan_rx_chan_get_attr_count(struct ks_chan *chan)
@@ -659,7 +659,6 @@ static struct ks_chan_ops hfc_sys_chan_rx_chan_ops =
 	.close		= hfc_sys_chan_rx_chan_close,
 	.start		= hfc_sys_chan_rx_chan_start,
 	.stop		= hfc_sys_chan_rx_chan_stop,
-	.stimulus	= hfc_sys_chan_rx_chan_stimulus,
 	.get_attr_count	= hfc_sys_chan_rx_chan_get_attr_count,
 	.get_attr	= hfc_sys_chan_rx_chan_get_attr,
 	.set_attr	= hfc_sys_chan_rx_chan_set_attr,
@@ -919,6 +918,8 @@ static int hfc_sys_chan_tx_chan_push_raw(
 
 	hfc_card_unlock(card);
 
+	ks_sf_delivered(sf);
+
 	return copied_octets;
 }
 
@@ -1059,17 +1060,19 @@ struct ks_duplex_ops hfc_sys_chan_duplex_ops =
 
 /*---------------------------------------------------------------------------*/
 
-static void hfc_sys_chan_rx_tasklet(unsigned long data)
+/* Called by the card's interrupt bottom half with the card lock held,
+ * receives one frame.
+ */
+int hfc_sys_chan_rx_service(struct hfc_sys_chan_rx *chan_rx)
 {
-	struct hfc_sys_chan_rx *chan_rx = (struct hfc_sys_chan_rx *)data;
 	struct hfc_sys_chan *chan = chan_rx->chan;
-	struct hfc_card *card = chan->port->card;
 	struct hfc_fifo *fifo = &chan->rx.fifo;
 	int frame_size;
 	struct sk_buff *skb;
 	u8 stat;
 
-	hfc_card_lock(card);
+	if (!fifo->enabled || !fifo->framer_enabled)
+		return 0;
 
 	// FIFO selection has to be done for each frame to clear
 	// internal buffer (see specs 4.4.4).
@@ -1190,9 +1193,9 @@ all_went_well:
 	hfc_fifo_refresh_fz_cache(fifo);
 
 	if (hfc_fifo_has_frames(fifo))
-		tasklet_schedule(&chan_rx->tasklet);
+		return HFC_IRQ_BATCH_SERVICED | HFC_IRQ_BATCH_AGAIN;
 
-	hfc_card_unlock(card);
+	return HFC_IRQ_BATCH_SERVICED;
 }
 
 static void hfc_sys_chan_rx_create(
@@ -1214,27 +1217,26 @@ static void hfc_sys_chan_rx_create(
 	hfc_fifo_init(&chan_rx->fifo, chan->port->card, fifo_hwid, RX);
 
 	chan_rx->ks_chan.mtu = -1;
-
-	tasklet_init(&chan_rx->tasklet,
-		hfc_sys_chan_rx_tasklet,
-		(unsigned long)chan_rx);
 }
 
-static void hfc_sys_chan_tx_wake_tasklet(unsigned long data)
+/* Called by the card's interrupt bottom half with the card lock held */
+int hfc_sys_chan_tx_service(struct hfc_sys_chan_tx *chan_tx)
 {
-	struct hfc_sys_chan_tx *chan_tx = (struct hfc_sys_chan_tx *)data;
-	struct hfc_sys_chan *chan = chan_tx->chan;
-	struct hfc_card *card = chan->port->card;
-
-	hfc_card_lock(card);
+	if (!test_bit(HFC_SYS_CHAN_TX_STATUS_STOPPED, &chan_tx->status))
+		return 0;
 
 	hfc_fifo_select(&chan_tx->fifo);
 
+	/* Stay stopped until there is room, the next TX interrupt will
+	 * bring us here again
+	 */
 	if (hfc_fifo_free_frames(&chan_tx->fifo) &&
-	    hfc_fifo_free_tx(&chan_tx->fifo) > 20)
+	    hfc_fifo_free_tx(&chan_tx->fifo) > 20) {
+		clear_bit(HFC_SYS_CHAN_TX_STATUS_STOPPED, &chan_tx->status);
 		kss_chan_wake_queue(&chan_tx->ks_chan);
+	}
 
-	hfc_card_unlock(card);
+	return HFC_IRQ_BATCH_SERVICED;
 }
 
 static void hfc_sys_chan_tx_create(
@@ -1258,10 +1260,6 @@ static void hfc_sys_chan_tx_create(
 	chan_tx->ks_chan.mtu = -1;
 
 	hfc_fifo_init(&chan_tx->fifo, chan->port->card, fifo_hwid, TX);
-
-	tasklet_init(&chan_tx->wake_tasklet,
-		hfc_sys_chan_tx_wake_tasklet,
-		(unsigned long)chan_tx);
 }
 
 struct hfc_sys_chan *hfc_sys_chan_create(
@@ -19,10 +19,14 @@
 #include <linux/kstreamer/channel.h>
 #include <linux/kstreamer/feature.h>
 #include <linux/kstreamer/duplex.h>
+#include <linux/kstreamer/streamframe.h>
+#include <linux/kstreamer/softswitch.h>
 
 #include <linux/kstreamer/hdlc_framer.h>
 #include <linux/kstreamer/octet_reverser.h>
 
+#include <hfc/irq_batch.h>
+
 #include "util.h"
 #include "fifo.h"
 
@@ -71,7 +75,8 @@ struct hfc_sys_chan_rx
 	struct hfc_fifo fifo;
 	int fifo_enabled;
 
-	struct tasklet_struct tasklet;
+	struct kss_rx_sched_entry sched_entry;
+	int scheduled;
 };
 
 #define HFC_SYS_CHAN_TX_STATUS_STOPPED (1 << 0)
@@ -94,8 +99,6 @@ struct hfc_sys_chan_tx
 	int fifo_cycles;
 	int fifo_min;
 	int fifo_max;
-
-	struct tasklet_struct wake_tasklet;
 };
 
 struct hfc_sys_port;
@@ -129,6 +132,14 @@ static inline void hfc_sys_chan_put(struct hfc_sys_chan *chan)
 	ks_duplex_put(&chan->ks_duplex);
 }
 
+extern void hfc_sys_chan_rx_drain(
+	struct kss_rx_sched *sched,
+	struct ks_chan *ks_chan,
+	struct ks_streamframe *sf);
+
+extern int hfc_sys_chan_rx_service(struct hfc_sys_chan_rx *chan_rx);
+extern int hfc_sys_chan_tx_service(struct hfc_sys_chan_tx *chan_tx);
+
 extern int hfc_sys_chan_register(
 	struct hfc_sys_chan *chan);
 extern void hfc_sys_chan_unregister(
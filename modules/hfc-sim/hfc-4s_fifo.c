@@ -0,0 +1,423 @@
+/*
+ * HFC simulated card and FIFO test module
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+/* Runs the HFC-4S driver's own inline FIFO code (selection, Z/F counters,
+ * free/used space, frame boundaries, data port) against the simulated
+ * card, the same way sys_chan.c uses it for transparent and HDLC channels.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/pci.h>
+
+#include "sim_io.h"
+
+#include "../hfc-4s/fifo.h"
+#include "../hfc-4s/fifo_inline.h"
+#include "../hfc-4s/card.h"
+
+#include "sim.h"
+
+int tx_dword_writes;
+
+/* Zone of the HFC-4S in 32 FIFOs mode with 32K of RAM */
+#define HFC_SIM_4S_Z_MIN	0x0080
+#define HFC_SIM_4S_Z_MAX	0x01ff
+#define HFC_SIM_4S_F_MIN	0x00
+#define HFC_SIM_4S_F_MAX	0x0f
+
+#define HFC_SIM_4S_ITERATIONS	2000
+#define HFC_SIM_4S_MAX_CHUNK	300
+
+struct hfc_sim_4s
+{
+	struct hfc_sim_card *sim;
+	struct hfc_card *card;
+	struct hfc_fifo fifo;
+
+	u32 seed;
+
+	u8 buf[HFC_SIM_4S_MAX_CHUNK + 8];
+	u8 out[HFC_SIM_4S_MAX_CHUNK + 8];
+};
+
+static int hfc_sim_4s_rand(struct hfc_sim_4s *t, int max)
+{
+	t->seed = t->seed * 1103515245 + 12345;
+
+	return (t->seed >> 16) % max;
+}
+
+/* Same as hfc_fifo_init() plus the zone set up by sys_port.c */
+static void hfc_sim_4s_fifo_init(
+	struct hfc_sim_4s *t,
+	int hw_index,
+	enum hfc_direction direction,
+	int hdlc)
+{
+	struct hfc_fifo *fifo = &t->fifo;
+
+	memset(fifo, 0, sizeof(*fifo));
+
+	fifo->card = t->card;
+	fifo->hw_index = hw_index;
+	fifo->direction = direction;
+	fifo->enabled = TRUE;
+	fifo->framer_enabled = hdlc;
+
+	fifo->f_min = HFC_SIM_4S_F_MIN;
+	fifo->f_max = HFC_SIM_4S_F_MAX;
+	fifo->f_num = HFC_SIM_4S_F_MAX - HFC_SIM_4S_F_MIN + 1;
+
+	fifo->z_min = HFC_SIM_4S_Z_MIN;
+	fifo->z_max = HFC_SIM_4S_Z_MAX;
+	fifo->size = HFC_SIM_4S_Z_MAX - HFC_SIM_4S_Z_MIN + 1;
+
+	hfc_sim_fifo_configure(
+		&t->sim->fifos[hw_index][direction == TX ? 0 : 1],
+		HFC_SIM_4S_Z_MIN, HFC_SIM_4S_Z_MAX,
+		HFC_SIM_4S_F_MIN, HFC_SIM_4S_F_MAX,
+		hdlc);
+
+	hfc_fifo_select(fifo);
+	hfc_fifo_reset(fifo);
+
+	memset(&t->sim->stats, 0, sizeof(t->sim->stats));
+}
+
+static int hfc_sim_4s_check_bus(struct hfc_sim_4s *t, const char *stage)
+{
+	if (t->sim->stats.overruns || t->sim->stats.underruns) {
+		hfc_sim_msg(KERN_ERR,
+			"%s: %lu overruns, %lu underruns\n",
+			stage,
+			t->sim->stats.overruns,
+			t->sim->stats.underruns);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+/* As hfc_sys_chan_rx_drain() */
+static int hfc_sim_4s_test_rx_trans(struct hfc_sim_4s *t)
+{
+	struct hfc_fifo *fifo = &t->fifo;
+	struct hfc_sim_fifo *sim_fifo;
+	u8 fed_seq = 0, read_seq = 0;
+	int outstanding = 0;
+	int i, j;
+
+	hfc_sim_4s_fifo_init(t, 4, RX, FALSE);
+	sim_fifo = &t->sim->fifos[4][1];
+
+	for (i = 0; i < HFC_SIM_4S_ITERATIONS; i++) {
+		int chunk = hfc_sim_4s_rand(t, 200);
+		int align = hfc_sim_4s_rand(t, 4);
+		int available, copied;
+
+		for (j = 0; j < chunk; j++)
+			t->buf[j] = fed_seq + j;
+
+		chunk = hfc_sim_fifo_feed(sim_fifo, t->buf, chunk);
+		fed_seq += chunk;
+		outstanding += chunk;
+
+		hfc_fifo_select(fifo);
+		available = hfc_fifo_used(fifo);
+
+		if (available != outstanding) {
+			hfc_sim_msg(KERN_ERR,
+				"4S RX transparent: %d octets used,"
+				" %d expected\n",
+				available, outstanding);
+			return -EIO;
+		}
+
+		copied = min(available,
+			hfc_sim_4s_rand(t, HFC_SIM_4S_MAX_CHUNK));
+
+		hfc_fifo_mem_read(fifo, t->out + align, copied);
+		outstanding -= copied;
+
+		for (j = 0; j < copied; j++, read_seq++) {
+			if (t->out[align + j] != read_seq) {
+				hfc_sim_msg(KERN_ERR,
+					"4S RX transparent: data mismatch"
+					" at iteration %d\n", i);
+				return -EIO;
+			}
+		}
+	}
+
+	return hfc_sim_4s_check_bus(t, "4S RX transparent");
+}
+
+/* As hfc_sys_chan_tx_chan_push_raw() */
+static int hfc_sim_4s_test_tx_trans(struct hfc_sim_4s *t)
+{
+	struct hfc_fifo *fifo = &t->fifo;
+	struct hfc_sim_fifo *sim_fifo;
+	u8 written_seq = 0, sent_seq = 0;
+	int i, j;
+
+	hfc_sim_4s_fifo_init(t, 6, TX, FALSE);
+	sim_fifo = &t->sim->fifos[6][0];
+
+	for (i = 0; i < HFC_SIM_4S_ITERATIONS; i++) {
+		int len = hfc_sim_4s_rand(t, HFC_SIM_4S_MAX_CHUNK);
+		int align = hfc_sim_4s_rand(t, 4);
+		int available, copied, sent;
+
+		hfc_fifo_select(fifo);
+		available = hfc_fifo_free_tx(fifo);
+
+		if (available != fifo->size - 1 -
+				hfc_sim_fifo_used(sim_fifo)) {
+			hfc_sim_msg(KERN_ERR,
+				"4S TX transparent: %d octets free,"
+				" %d expected\n",
+				available,
+				fifo->size - 1 - hfc_sim_fifo_used(sim_fifo));
+			return -EIO;
+		}
+
+		copied = min(available, len);
+
+		for (j = 0; j < copied; j++)
+			t->buf[align + j] = written_seq++;
+
+		hfc_fifo_mem_write(fifo, t->buf + align, copied);
+
+		/* FIFO reselection is mandatory, otherwise Z1 is not updated */
+		hfc_fifo_select(fifo);
+
+		sent = hfc_sim_fifo_drain(sim_fifo, t->out,
+				hfc_sim_4s_rand(t, 200));
+
+		for (j = 0; j < sent; j++, sent_seq++) {
+			if (t->out[j] != sent_seq) {
+				hfc_sim_msg(KERN_ERR,
+					"4S TX transparent: data mismatch"
+					" at iteration %d\n", i);
+				return -EIO;
+			}
+		}
+	}
+
+	return hfc_sim_4s_check_bus(t, "4S TX transparent");
+}
+
+/* As hfc_sys_chan_rx_service(), including frames dropped unread */
+static int hfc_sim_4s_test_rx_hdlc(struct hfc_sim_4s *t)
+{
+	struct hfc_fifo *fifo = &t->fifo;
+	struct hfc_sim_fifo *sim_fifo;
+	int fed_frames = 0, rx_frames = 0;
+	int i, j;
+
+	hfc_sim_4s_fifo_init(t, 2, RX, TRUE);
+	sim_fifo = &t->sim->fifos[2][1];
+
+	for (i = 0; i < HFC_SIM_4S_ITERATIONS; i++) {
+		int feed = hfc_sim_4s_rand(t, 4);
+
+		for (; feed; feed--) {
+			int len = 1 + hfc_sim_4s_rand(t, 150);
+			u8 stat = fed_frames % 11 == 10 ? 0xff : 0x00;
+
+			for (j = 0; j < len; j++)
+				t->buf[j] = fed_frames + j;
+
+			if (hfc_sim_fifo_feed_frame(sim_fifo,
+					t->buf, len, stat) < 0)
+				break;
+
+			fed_frames++;
+		}
+
+		hfc_fifo_select(fifo);
+
+		while (hfc_fifo_has_frames(fifo)) {
+			int frame_size = hfc_fifo_get_frame_size(fifo);
+			u8 stat;
+
+			/* Sizes are not recorded, the payload tells them */
+			if (frame_size < 4) {
+				hfc_sim_msg(KERN_ERR,
+					"4S RX HDLC: frame %d of %d octets\n",
+					rx_frames, frame_size);
+				return -EIO;
+			}
+
+			if (rx_frames % 7 == 6) {
+				/* Dropped without reading it */
+				hfc_fifo_next_frame(fifo);
+				hfc_fifo_refresh_fz_cache(fifo);
+				rx_frames++;
+				continue;
+			}
+
+			hfc_fifo_mem_read(fifo, t->out, frame_size - 1);
+			hfc_fifo_mem_read(fifo, &stat, sizeof(stat));
+
+			for (j = 0; j < frame_size - 3; j++) {
+				if (t->out[j] != (u8)(rx_frames + j))
+					goto err_data;
+			}
+
+			if (t->out[frame_size - 3] != 0x00 ||
+			    t->out[frame_size - 2] != 0x00 ||
+			    stat != (rx_frames % 11 == 10 ? 0xff : 0x00))
+				goto err_data;
+
+			hfc_fifo_next_frame(fifo);
+			hfc_fifo_refresh_fz_cache(fifo);
+			rx_frames++;
+		}
+	}
+
+	if (rx_frames != fed_frames) {
+		hfc_sim_msg(KERN_ERR,
+			"4S RX HDLC: %d frames received, %d fed\n",
+			rx_frames, fed_frames);
+		return -EIO;
+	}
+
+	return hfc_sim_4s_check_bus(t, "4S RX HDLC");
+
+err_data:
+	hfc_sim_msg(KERN_ERR, "4S RX HDLC: frame %d mismatch\n", rx_frames);
+
+	return -EIO;
+}
+
+/* As hfc_sys_chan_tx_chan_push_frame() */
+static int hfc_sim_4s_test_tx_hdlc(struct hfc_sim_4s *t)
+{
+	struct hfc_fifo *fifo = &t->fifo;
+	struct hfc_sim_fifo *sim_fifo;
+	int tx_frames = 0, sent_frames = 0;
+	int i, j;
+
+	hfc_sim_4s_fifo_init(t, 3, TX, TRUE);
+	sim_fifo = &t->sim->fifos[3][0];
+
+	for (i = 0; i < HFC_SIM_4S_ITERATIONS; i++) {
+		int frame_len = 1 + hfc_sim_4s_rand(t, 260);
+		int align = hfc_sim_4s_rand(t, 4);
+		int sent;
+
+		hfc_fifo_select(fifo);
+
+		if (hfc_fifo_free_frames(fifo) > 1 &&
+		    hfc_fifo_free_tx(fifo) >= frame_len) {
+			for (j = 0; j < frame_len; j++)
+				t->buf[align + j] = tx_frames + j;
+
+			hfc_fifo_mem_write(fifo, t->buf + align, frame_len);
+			hfc_fifo_next_frame(fifo);
+
+			tx_frames++;
+		}
+
+		while (hfc_sim_4s_rand(t, 3)) {
+			sent = hfc_sim_fifo_drain_frame(sim_fifo,
+					t->out, sizeof(t->out));
+			if (sent < 0)
+				break;
+
+			for (j = 0; j < sent; j++) {
+				if (t->out[j] != (u8)(sent_frames + j)) {
+					hfc_sim_msg(KERN_ERR,
+						"4S TX HDLC: frame %d"
+						" mismatch\n", sent_frames);
+					return -EIO;
+				}
+			}
+
+			sent_frames++;
+		}
+	}
+
+	while (hfc_sim_fifo_drain_frame(sim_fifo,
+			t->out, sizeof(t->out)) >= 0)
+		sent_frames++;
+
+	if (sent_frames != tx_frames || hfc_sim_fifo_used(sim_fifo)) {
+		hfc_sim_msg(KERN_ERR,
+			"4S TX HDLC: %d frames sent, %d written,"
+			" %d octets left\n",
+			sent_frames, tx_frames, hfc_sim_fifo_used(sim_fifo));
+		return -EIO;
+	}
+
+	return hfc_sim_4s_check_bus(t, "4S TX HDLC");
+}
+
+int hfc_sim_test_hfc4s_fifo(struct hfc_sim_card *sim)
+{
+	struct hfc_sim_4s *t;
+	int err;
+
+	t = kmalloc(sizeof(*t), GFP_KERNEL);
+	if (!t) {
+		err = -ENOMEM;
+		goto err_alloc_test;
+	}
+
+	memset(t, 0, sizeof(*t));
+	t->sim = sim;
+	t->seed = 1;
+
+	t->card = kmalloc(sizeof(*t->card), GFP_KERNEL);
+	if (!t->card) {
+		err = -ENOMEM;
+		goto err_alloc_card;
+	}
+
+	memset(t->card, 0, sizeof(*t->card));
+	t->card->io_mem = hfc_sim_io_mem(sim);
+
+	err = hfc_sim_4s_test_rx_trans(t);
+	if (err < 0)
+		goto err_test;
+
+	err = hfc_sim_4s_test_rx_hdlc(t);
+	if (err < 0)
+		goto err_test;
+
+	/* Both the octet and the dword TX paths */
+	for (tx_dword_writes = 0; tx_dword_writes < 2; tx_dword_writes++) {
+		err = hfc_sim_4s_test_tx_trans(t);
+		if (err < 0)
+			goto err_test;
+
+		err = hfc_sim_4s_test_tx_hdlc(t);
+		if (err < 0)
+			goto err_test;
+	}
+
+	kfree(t->card);
+	kfree(t);
+
+	return 0;
+
+err_test:
+	kfree(t->card);
+err_alloc_card:
+	kfree(t);
+err_alloc_test:
+
+	return err;
+}
@@ -0,0 +1,457 @@
+/*
+ * HFC simulated card and FIFO test module
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+/* Loading the module runs the FIFO transfer regression tests and the
+ * HFC-4S driver's FIFO code against the simulated card and benchmarks the
+ * transfers, then feeds synthetic FIFO interrupt status to the interrupt
+ * batching dispatcher; it refuses to load if a test fails. Results are
+ * logged.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/time.h>
+
+#include "sim_io.h"
+
+#include <hfc/fifo_burst.h>
+#include <hfc/irq_batch.h>
+
+static int bench_iterations = 10000;
+static int access_ns;
+
+#define HFC_SIM_TEST_MAX_SIZE 300
+
+static void hfc_sim_fifo_prepare(
+	struct hfc_sim_card *card,
+	int fifo_num, int tx)
+{
+	void __iomem *io_mem = hfc_sim_io_mem(card);
+
+	hfc_sim_outb(io_mem + hfc_sim_R_FIFO,
+		(fifo_num << 1) | (tx ? 0 : hfc_sim_R_FIFO_V_FIFO_DIR_RX));
+	hfc_sim_outb(io_mem + hfc_sim_A_INC_RES_FIFO,
+		hfc_sim_A_INC_RES_FIFO_V_RES_F);
+
+	memset(&card->stats, 0, sizeof(card->stats));
+}
+
+/* Byte-per-cycle transfers, as the drivers used to do, for reference */
+static void hfc_sim_bytewise_read(void __iomem *port, void *data, int size)
+{
+	int i;
+
+	for (i=0; i<size; i++)
+		((u8 *)data)[i] = hfc_sim_inb(port);
+}
+
+static void hfc_sim_bytewise_write(void __iomem *port,
+	const void *data, int size)
+{
+	int i;
+
+	for (i=0; i<size; i++)
+		hfc_sim_outb(port, ((u8 *)data)[i]);
+}
+
+static int hfc_sim_test_read(struct hfc_sim_card *card)
+{
+	void __iomem *port = hfc_sim_io_mem(card) + hfc_sim_A_FIFO_DATA;
+	struct hfc_sim_fifo *fifo = &card->fifos[3][1];
+	u8 pattern[HFC_SIM_TEST_MAX_SIZE];
+	u8 buf[HFC_SIM_TEST_MAX_SIZE + 8];
+	int size, align, i;
+
+	for (size = 0; size <= HFC_SIM_TEST_MAX_SIZE; size++) {
+	for (align = 0; align < 4; align++) {
+		for (i=0; i<size; i++)
+			pattern[i] = size * 7 + i;
+
+		hfc_sim_fifo_prepare(card, 3, 0);
+		hfc_sim_fifo_feed(fifo, pattern, size);
+
+		memset(buf, 0xaa, sizeof(buf));
+		hfc_fifo_burst_read(port, buf + align, size);
+
+		if (memcmp(buf + align, pattern, size)) {
+			hfc_sim_msg(KERN_ERR,
+				"read size %d align %d: data mismatch\n",
+				size, align);
+			return -EIO;
+		}
+
+		for (i=0; i<align; i++) {
+			if (buf[i] != 0xaa)
+				goto overrun;
+		}
+
+		for (i=align + size; i<sizeof(buf); i++) {
+			if (buf[i] != 0xaa)
+				goto overrun;
+		}
+
+		if (hfc_sim_fifo_used(fifo)) {
+			hfc_sim_msg(KERN_ERR,
+				"read size %d align %d: %d bytes left\n",
+				size, align, hfc_sim_fifo_used(fifo));
+			return -EIO;
+		}
+
+		if (card->stats.inl != size / 4 ||
+		    card->stats.inb != size % 4) {
+			hfc_sim_msg(KERN_ERR,
+				"read size %d align %d: %lu+%lu bus cycles\n",
+				size, align,
+				card->stats.inl, card->stats.inb);
+			return -EIO;
+		}
+	}
+	}
+
+	return 0;
+
+overrun:
+	hfc_sim_msg(KERN_ERR, "read size %d align %d: buffer overrun\n",
+		size, align);
+
+	return -EIO;
+}
+
+static int hfc_sim_test_write(struct hfc_sim_card *card)
+{
+	void __iomem *port = hfc_sim_io_mem(card) + hfc_sim_A_FIFO_DATA;
+	struct hfc_sim_fifo *fifo = &card->fifos[5][0];
+	u8 buf[HFC_SIM_TEST_MAX_SIZE + 8];
+	u8 out[HFC_SIM_TEST_MAX_SIZE];
+	int size, align, i;
+
+	for (size = 0; size <= HFC_SIM_TEST_MAX_SIZE; size++) {
+	for (align = 0; align < 4; align++) {
+		for (i=0; i<size; i++)
+			buf[align + i] = size * 3 + i;
+
+		hfc_sim_fifo_prepare(card, 5, 1);
+
+		hfc_fifo_burst_write(port, buf + align, size);
+
+		if (hfc_sim_fifo_drain(fifo, out, sizeof(out)) != size ||
+		    memcmp(out, buf + align, size)) {
+			hfc_sim_msg(KERN_ERR,
+				"write size %d align %d: data mismatch\n",
+				size, align);
+			return -EIO;
+		}
+
+		if (card->stats.outl != size / 4 ||
+		    card->stats.outb != size % 4) {
+			hfc_sim_msg(KERN_ERR,
+				"write size %d align %d: %lu+%lu bus cycles\n",
+				size, align,
+				card->stats.outl, card->stats.outb);
+			return -EIO;
+		}
+	}
+	}
+
+	return 0;
+}
+
+struct hfc_sim_irq_test
+{
+	int serviced[HFC_IRQ_BATCH_BLOCKS * 4][2];
+	int again[HFC_IRQ_BATCH_BLOCKS * 4][2];
+};
+
+static int hfc_sim_irq_service(void *data, int fifo, int rx)
+{
+	struct hfc_sim_irq_test *test = data;
+
+	test->serviced[fifo][rx]++;
+
+	if (test->again[fifo][rx]) {
+		test->again[fifo][rx]--;
+		return HFC_IRQ_BATCH_SERVICED | HFC_IRQ_BATCH_AGAIN;
+	}
+
+	return HFC_IRQ_BATCH_SERVICED;
+}
+
+static int hfc_sim_irq_check(
+	struct hfc_sim_irq_test *test,
+	u8 *expected,
+	const char *stage)
+{
+	int fifo, rx;
+
+	for (fifo = 0; fifo < HFC_IRQ_BATCH_BLOCKS * 4; fifo++) {
+		for (rx = 0; rx < 2; rx++) {
+			int bit = (fifo % 4) * 2 + rx;
+			int want = (expected[fifo / 4] >> bit) & 1;
+
+			if (test->serviced[fifo][rx] != want) {
+				hfc_sim_msg(KERN_ERR,
+					"%s: FIFO %d %s serviced %d times,"
+					" expected %d\n",
+					stage, fifo, rx ? "RX" : "TX",
+					test->serviced[fifo][rx], want);
+				return -EIO;
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int hfc_sim_test_irq_batch(void)
+{
+	struct hfc_irq_batch batch;
+	struct hfc_sim_irq_test test;
+	u8 expected[HFC_IRQ_BATCH_BLOCKS];
+	u32 seed = 1;
+	int runs;
+	int i, block;
+
+	hfc_irq_batch_init(&batch);
+	memset(&test, 0, sizeof(test));
+
+	/* Three interrupts before the bottom half gets to run */
+	hfc_irq_batch_interrupt(&batch, ktime_get());
+	if (!hfc_irq_batch_collect(&batch, 0, 0x02))
+		goto err_coalesce;
+
+	hfc_irq_batch_interrupt(&batch, ktime_get());
+	if (hfc_irq_batch_collect(&batch, 0, 0x02))
+		goto err_coalesce;
+	if (!hfc_irq_batch_collect(&batch, 1, 0x04))
+		goto err_coalesce;
+
+	hfc_irq_batch_interrupt(&batch, ktime_get());
+	if (!hfc_irq_batch_collect(&batch, 7, 0x80))
+		goto err_coalesce;
+
+	/* FIFO 31 RX has two more frames queued */
+	test.again[31][1] = 2;
+
+	for (runs = 1; hfc_irq_batch_dispatch(&batch,
+				hfc_sim_irq_service, &test); runs++) {
+		if (runs > 10) {
+			hfc_sim_msg(KERN_ERR,
+				"irq batch: dispatcher does not settle\n");
+			return -EIO;
+		}
+	}
+
+	if (test.serviced[0][1] != 1 ||
+	    test.serviced[5][0] != 1 ||
+	    test.serviced[31][1] != 3 ||
+	    batch.runs != 3 ||
+	    batch.interrupts != 3 ||
+	    batch.fifo_events != 4 ||
+	    batch.fifos_serviced != 5 ||
+	    batch.max_fifos_per_run != 3) {
+		hfc_sim_msg(KERN_ERR,
+			"irq batch: unexpected service pattern, runs %lu,"
+			" interrupts %lu, events %lu, serviced %lu\n",
+			batch.runs, batch.interrupts,
+			batch.fifo_events, batch.fifos_serviced);
+		return -EIO;
+	}
+
+	/* Random status from several interrupts per run: every FIFO
+	 * signalled is serviced exactly once
+	 */
+	for (i = 0; i < 1000; i++) {
+		int irqs;
+
+		memset(&test, 0, sizeof(test));
+		memset(expected, 0, sizeof(expected));
+
+		for (irqs = 0; irqs < 1 + i % 5; irqs++) {
+			seed = seed * 1103515245 + 12345;
+			block = (seed >> 16) % HFC_IRQ_BATCH_BLOCKS;
+
+			seed = seed * 1103515245 + 12345;
+			expected[block] |= seed >> 16;
+			hfc_irq_batch_collect(&batch, block, seed >> 16);
+		}
+
+		if (hfc_irq_batch_dispatch(&batch,
+				hfc_sim_irq_service, &test)) {
+			hfc_sim_msg(KERN_ERR, "irq batch: spurious again\n");
+			return -EIO;
+		}
+
+		if (hfc_sim_irq_check(&test, expected, "irq batch random"))
+			return -EIO;
+	}
+
+	/* Polling marks every FIFO */
+	memset(&test, 0, sizeof(test));
+	memset(expected, 0xff, sizeof(expected));
+
+	hfc_irq_batch_poll(&batch);
+	hfc_irq_batch_dispatch(&batch, hfc_sim_irq_service, &test);
+
+	if (hfc_sim_irq_check(&test, expected, "irq batch poll"))
+		return -EIO;
+
+	return 0;
+
+err_coalesce:
+	hfc_sim_msg(KERN_ERR,
+		"irq batch: wrong coalescing of pending status\n");
+
+	return -EIO;
+}
+
+static long hfc_sim_elapsed_ns(struct timeval *start, int iterations)
+{
+	struct timeval end;
+	do_gettimeofday(&end);
+
+	return ((end.tv_sec - start->tv_sec) * 1000000L +
+		(end.tv_usec - start->tv_usec)) * 1000L / iterations;
+}
+
+static void hfc_sim_bench(struct hfc_sim_card *card, int size)
+{
+	void __iomem *port = hfc_sim_io_mem(card) + hfc_sim_A_FIFO_DATA;
+	struct hfc_sim_fifo *rx_fifo = &card->fifos[0][1];
+	struct hfc_sim_fifo *tx_fifo = &card->fifos[1][0];
+	u8 frame[HFC_SIM_TEST_MAX_SIZE] __attribute__((aligned(4)));
+	unsigned long bytewise_cycles, burst_cycles;
+	long bytewise_ns, burst_ns;
+	long bytewise_write_ns, burst_write_ns;
+	struct timeval start;
+	int i;
+
+	memset(frame, 0x55, sizeof(frame));
+
+	hfc_sim_fifo_prepare(card, 0, 0);
+	do_gettimeofday(&start);
+	for (i=0; i<bench_iterations; i++) {
+		rx_fifo->z1 = size;
+		rx_fifo->z2 = 0;
+		hfc_sim_bytewise_read(port, frame, size);
+	}
+	bytewise_ns = hfc_sim_elapsed_ns(&start, bench_iterations);
+	bytewise_cycles = card->stats.inb / bench_iterations;
+
+	hfc_sim_fifo_prepare(card, 0, 0);
+	do_gettimeofday(&start);
+	for (i=0; i<bench_iterations; i++) {
+		rx_fifo->z1 = size;
+		rx_fifo->z2 = 0;
+		hfc_fifo_burst_read(port, frame, size);
+	}
+	burst_ns = hfc_sim_elapsed_ns(&start, bench_iterations);
+	burst_cycles = (card->stats.inb + card->stats.inl) / bench_iterations;
+
+	hfc_sim_fifo_prepare(card, 1, 1);
+	do_gettimeofday(&start);
+	for (i=0; i<bench_iterations; i++) {
+		tx_fifo->z1 = 0;
+		hfc_sim_bytewise_write(port, frame, size);
+	}
+	bytewise_write_ns = hfc_sim_elapsed_ns(&start, bench_iterations);
+
+	hfc_sim_fifo_prepare(card, 1, 1);
+	do_gettimeofday(&start);
+	for (i=0; i<bench_iterations; i++) {
+		tx_fifo->z1 = 0;
+		hfc_fifo_burst_write(port, frame, size);
+	}
+	burst_write_ns = hfc_sim_elapsed_ns(&start, bench_iterations);
+
+	hfc_sim_msg(KERN_INFO,
+		"%3d bytes: read %lu -> %lu cycles, %ld -> %ld ns;"
+		" write %ld -> %ld ns\n",
+		size,
+		bytewise_cycles, burst_cycles,
+		bytewise_ns, burst_ns,
+		bytewise_write_ns, burst_write_ns);
+}
+
+static int __init hfc_sim_init_module(void)
+{
+	struct hfc_sim_card *card;
+	int err;
+
+	hfc_sim_msg(KERN_INFO, hfc_sim_MODULE_DESCR " loading\n");
+
+	card = hfc_sim_card_alloc();
+	if (!card) {
+		err = -ENOMEM;
+		goto err_card_alloc;
+	}
+
+	err = hfc_sim_test_read(card);
+	if (err < 0)
+		goto err_test;
+
+	err = hfc_sim_test_write(card);
+	if (err < 0)
+		goto err_test;
+
+	hfc_sim_msg(KERN_INFO, "FIFO transfer tests passed\n");
+
+	err = hfc_sim_test_hfc4s_fifo(card);
+	if (err < 0)
+		goto err_test;
+
+	hfc_sim_msg(KERN_INFO, "HFC-4S FIFO tests passed\n");
+
+	err = hfc_sim_test_irq_batch();
+	if (err < 0)
+		goto err_test;
+
+	hfc_sim_msg(KERN_INFO, "Interrupt batching tests passed\n");
+
+	if (bench_iterations > 0) {
+		card->access_ns = access_ns;
+
+		hfc_sim_bench(card, 8);
+		hfc_sim_bench(card, 64);
+		hfc_sim_bench(card, 260);
+	}
+
+	hfc_sim_card_free(card);
+
+	return 0;
+
+err_test:
+	hfc_sim_card_free(card);
+err_card_alloc:
+
+	return err;
+}
+
+module_init(hfc_sim_init_module);
+
+static void __exit hfc_sim_module_exit(void)
+{
+	hfc_sim_msg(KERN_INFO, hfc_sim_MODULE_DESCR " unloaded\n");
+}
+
+module_exit(hfc_sim_module_exit);
+
+MODULE_DESCRIPTION(hfc_sim_MODULE_DESCR);
+MODULE_AUTHOR("vstuff contributors");
+MODULE_LICENSE("GPL");
+
+module_param(bench_iterations, int, 0444);
+MODULE_PARM_DESC(bench_iterations,
+	"Transfers per benchmark run, 0 to skip benchmarks");
+module_param(access_ns, int, 0444);
+MODULE_PARM_DESC(access_ns,
+	"Simulated bus latency of every register access, in ns");
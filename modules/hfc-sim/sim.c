@@ -0,0 +1,458 @@
+/*
+ * Register-level simulation of a Cologne Chip HFC FIFO engine
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/mm.h>
+#include <linux/delay.h>
+
+#include "sim.h"
+
+/* Only the FIFO engine is simulated: selection, Z/F counters, the
+ * auto-incrementing data port and frame increment/reset. Reads of a TX
+ * FIFO and writes to an RX FIFO are ignored, as everything else.
+ *
+ * Z counters read back as the driver expects them after selection: z1 and
+ * z2 as they are, except for an HDLC RX FIFO holding complete frames where
+ * z1 points to the last octet (the STAT octet) of frame F2.
+ */
+
+void hfc_sim_fifo_configure(
+	struct hfc_sim_fifo *fifo,
+	u16 z_min, u16 z_max,
+	u8 f_min, u8 f_max,
+	int hdlc)
+{
+	BUG_ON(z_max >= HFC_SIM_FIFO_SIZE || z_min >= z_max);
+	BUG_ON(f_max >= HFC_SIM_FIFO_FRAMES || f_min >= f_max);
+
+	fifo->z_min = z_min;
+	fifo->z_max = z_max;
+	fifo->f_min = f_min;
+	fifo->f_max = f_max;
+	fifo->hdlc = hdlc;
+
+	fifo->z1 = fifo->z2 = z_min;
+	fifo->f1 = fifo->f2 = f_min;
+}
+EXPORT_SYMBOL(hfc_sim_fifo_configure);
+
+struct hfc_sim_card *hfc_sim_card_alloc(void)
+{
+	struct hfc_sim_card *card;
+	int i;
+
+	BUILD_BUG_ON(HFC_SIM_IO_SIZE > PAGE_SIZE);
+
+	card = (struct hfc_sim_card *)__get_free_pages(GFP_KERNEL,
+					get_order(sizeof(*card)));
+	if (!card)
+		return NULL;
+
+	memset(card, 0, sizeof(*card));
+
+	for (i = 0; i < HFC_SIM_FIFOS * 2; i++)
+		hfc_sim_fifo_configure(&card->fifos[0][0] + i,
+			0, HFC_SIM_FIFO_SIZE - 1,
+			0, HFC_SIM_FIFO_FRAMES - 1, 0);
+
+	card->selected = &card->fifos[0][0];
+
+	return card;
+}
+EXPORT_SYMBOL(hfc_sim_card_alloc);
+
+void hfc_sim_card_free(struct hfc_sim_card *card)
+{
+	free_pages((unsigned long)card, get_order(sizeof(*card)));
+}
+EXPORT_SYMBOL(hfc_sim_card_free);
+
+static inline struct hfc_sim_card *hfc_sim_card_from_addr(
+	void __iomem *addr, int *offset)
+{
+	*offset = (unsigned long)addr & ~PAGE_MASK;
+
+	WARN_ON(*offset >= HFC_SIM_IO_SIZE);
+
+	return (struct hfc_sim_card *)((unsigned long)addr & PAGE_MASK);
+}
+
+static inline void hfc_sim_bus_cycle(struct hfc_sim_card *card)
+{
+	if (card->access_ns)
+		ndelay(card->access_ns);
+}
+
+void hfc_sim_select(struct hfc_sim_card *card, int fifo, int tx)
+{
+	card->selected = &card->fifos[fifo % HFC_SIM_FIFOS][tx ? 0 : 1];
+}
+EXPORT_SYMBOL(hfc_sim_select);
+
+static inline int hfc_sim_fifo_is_rx(
+	struct hfc_sim_card *card,
+	struct hfc_sim_fifo *fifo)
+{
+	return (fifo - &card->fifos[0][0]) & 1;
+}
+
+static inline int hfc_sim_fifo_size(struct hfc_sim_fifo *fifo)
+{
+	return fifo->z_max - fifo->z_min + 1;
+}
+
+static inline u16 hfc_sim_z_inc(struct hfc_sim_fifo *fifo, u16 z)
+{
+	return z == fifo->z_max ? fifo->z_min : z + 1;
+}
+
+static inline u16 hfc_sim_z_dec(struct hfc_sim_fifo *fifo, u16 z)
+{
+	return z == fifo->z_min ? fifo->z_max : z - 1;
+}
+
+static inline u8 hfc_sim_f_inc(struct hfc_sim_fifo *fifo, u8 f)
+{
+	return f == fifo->f_max ? fifo->f_min : f + 1;
+}
+
+int hfc_sim_fifo_used(struct hfc_sim_fifo *fifo)
+{
+	int size = hfc_sim_fifo_size(fifo);
+
+	return (fifo->z1 - fifo->z2 + size) % size;
+}
+EXPORT_SYMBOL(hfc_sim_fifo_used);
+
+static int hfc_sim_fifo_free(struct hfc_sim_fifo *fifo)
+{
+	return hfc_sim_fifo_size(fifo) - 1 - hfc_sim_fifo_used(fifo);
+}
+
+static int hfc_sim_fifo_free_frames(struct hfc_sim_fifo *fifo)
+{
+	int f_num = fifo->f_max - fifo->f_min + 1;
+
+	return f_num - 1 - (fifo->f1 - fifo->f2 + f_num) % f_num;
+}
+
+static inline void hfc_sim_fifo_put(struct hfc_sim_fifo *fifo, u8 value)
+{
+	fifo->mem[fifo->z1] = value;
+	fifo->z1 = hfc_sim_z_inc(fifo, fifo->z1);
+}
+
+static inline u8 hfc_sim_fifo_get(struct hfc_sim_fifo *fifo)
+{
+	u8 value = fifo->mem[fifo->z2];
+
+	fifo->z2 = hfc_sim_z_inc(fifo, fifo->z2);
+
+	return value;
+}
+
+int hfc_sim_fifo_feed(struct hfc_sim_fifo *fifo, const void *data, int size)
+{
+	int i;
+
+	size = min(size, hfc_sim_fifo_free(fifo));
+
+	for (i=0; i<size; i++)
+		hfc_sim_fifo_put(fifo, ((u8 *)data)[i]);
+
+	return size;
+}
+EXPORT_SYMBOL(hfc_sim_fifo_feed);
+
+int hfc_sim_fifo_drain(struct hfc_sim_fifo *fifo, void *data, int size)
+{
+	int i;
+
+	size = min(size, hfc_sim_fifo_used(fifo));
+
+	for (i=0; i<size; i++)
+		((u8 *)data)[i] = hfc_sim_fifo_get(fifo);
+
+	return size;
+}
+EXPORT_SYMBOL(hfc_sim_fifo_drain);
+
+/* Appends a received frame, its two CRC octets and the STAT octet as the
+ * HDLC deframer does
+ */
+int hfc_sim_fifo_feed_frame(
+	struct hfc_sim_fifo *fifo,
+	const void *data, int size,
+	u8 stat)
+{
+	int i;
+
+	if (hfc_sim_fifo_free(fifo) < size + 3 ||
+	    !hfc_sim_fifo_free_frames(fifo))
+		return -ENOSPC;
+
+	for (i=0; i<size; i++)
+		hfc_sim_fifo_put(fifo, ((u8 *)data)[i]);
+
+	hfc_sim_fifo_put(fifo, 0x00);
+	hfc_sim_fifo_put(fifo, 0x00);
+	hfc_sim_fifo_put(fifo, stat);
+
+	fifo->frame_end[fifo->f1] = fifo->z1;
+	fifo->f1 = hfc_sim_f_inc(fifo, fifo->f1);
+
+	return size;
+}
+EXPORT_SYMBOL(hfc_sim_fifo_feed_frame);
+
+/* Takes the oldest complete frame from a TX FIFO, as the HDLC framer does */
+int hfc_sim_fifo_drain_frame(struct hfc_sim_fifo *fifo, void *data, int size)
+{
+	int len = 0;
+
+	if (fifo->f1 == fifo->f2)
+		return -EAGAIN;
+
+	while (fifo->z2 != fifo->frame_end[fifo->f2]) {
+		u8 value = hfc_sim_fifo_get(fifo);
+
+		if (len < size)
+			((u8 *)data)[len] = value;
+
+		len++;
+	}
+
+	fifo->f2 = hfc_sim_f_inc(fifo, fifo->f2);
+
+	return len;
+}
+EXPORT_SYMBOL(hfc_sim_fifo_drain_frame);
+
+static u8 hfc_sim_data_read(struct hfc_sim_card *card)
+{
+	struct hfc_sim_fifo *fifo = card->selected;
+
+	if (!hfc_sim_fifo_is_rx(card, fifo))
+		return 0;
+
+	if (!hfc_sim_fifo_used(fifo)) {
+		card->stats.underruns++;
+		return 0xff;
+	}
+
+	return hfc_sim_fifo_get(fifo);
+}
+
+static void hfc_sim_data_write(struct hfc_sim_card *card, u8 value)
+{
+	struct hfc_sim_fifo *fifo = card->selected;
+
+	if (hfc_sim_fifo_is_rx(card, fifo))
+		return;
+
+	if (!hfc_sim_fifo_free(fifo)) {
+		card->stats.overruns++;
+		return;
+	}
+
+	hfc_sim_fifo_put(fifo, value);
+}
+
+static u32 hfc_sim_read_z12(struct hfc_sim_card *card)
+{
+	struct hfc_sim_fifo *fifo = card->selected;
+	u16 z1 = fifo->z1;
+
+	if (hfc_sim_fifo_is_rx(card, fifo) && fifo->hdlc &&
+	    fifo->f1 != fifo->f2)
+		z1 = hfc_sim_z_dec(fifo, fifo->frame_end[fifo->f2]);
+
+	return z1 | fifo->z2 << 16;
+}
+
+static void hfc_sim_inc_f(struct hfc_sim_card *card)
+{
+	struct hfc_sim_fifo *fifo = card->selected;
+
+	if (hfc_sim_fifo_is_rx(card, fifo)) {
+		if (fifo->f1 == fifo->f2)
+			return;
+
+		/* Whatever has not been read of the frame is skipped */
+		fifo->z2 = fifo->frame_end[fifo->f2];
+		fifo->f2 = hfc_sim_f_inc(fifo, fifo->f2);
+	} else {
+		if (!hfc_sim_fifo_free_frames(fifo)) {
+			card->stats.overruns++;
+			return;
+		}
+
+		fifo->frame_end[fifo->f1] = fifo->z1;
+		fifo->f1 = hfc_sim_f_inc(fifo, fifo->f1);
+	}
+}
+
+u8 hfc_sim_inb(void __iomem *addr)
+{
+	int offset;
+	struct hfc_sim_card *card = hfc_sim_card_from_addr(addr, &offset);
+
+	card->stats.inb++;
+	hfc_sim_bus_cycle(card);
+
+	switch(offset) {
+	case hfc_sim_A_FIFO_DATA:
+		return hfc_sim_data_read(card);
+
+	case hfc_sim_R_STATUS:
+		return 0;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(hfc_sim_inb);
+
+u16 hfc_sim_inw(void __iomem *addr)
+{
+	int offset;
+	struct hfc_sim_card *card = hfc_sim_card_from_addr(addr, &offset);
+
+	card->stats.inw++;
+	hfc_sim_bus_cycle(card);
+
+	switch(offset) {
+	case hfc_sim_A_F12:
+		return card->selected->f1 | card->selected->f2 << 8;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(hfc_sim_inw);
+
+u32 hfc_sim_inl(void __iomem *addr)
+{
+	int offset;
+	struct hfc_sim_card *card = hfc_sim_card_from_addr(addr, &offset);
+	u32 value;
+
+	card->stats.inl++;
+	hfc_sim_bus_cycle(card);
+
+	switch(offset) {
+	case hfc_sim_A_Z12:
+		return hfc_sim_read_z12(card);
+
+	case hfc_sim_A_FIFO_DATA:
+		/* Little endian, as on the PCI bus */
+		value = hfc_sim_data_read(card);
+		value |= hfc_sim_data_read(card) << 8;
+		value |= hfc_sim_data_read(card) << 16;
+		value |= hfc_sim_data_read(card) << 24;
+
+		return value;
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(hfc_sim_inl);
+
+/* String accessors keep the bus byte order in memory */
+void hfc_sim_inl_rep(void __iomem *addr, void *buf, unsigned long count)
+{
+	u8 *p = buf;
+
+	while (count--) {
+		u32 value = hfc_sim_inl(addr);
+
+		p[0] = value;
+		p[1] = value >> 8;
+		p[2] = value >> 16;
+		p[3] = value >> 24;
+		p += 4;
+	}
+}
+EXPORT_SYMBOL(hfc_sim_inl_rep);
+
+void hfc_sim_outb(void __iomem *addr, u8 value)
+{
+	int offset;
+	struct hfc_sim_card *card = hfc_sim_card_from_addr(addr, &offset);
+	struct hfc_sim_fifo *fifo = card->selected;
+
+	card->stats.outb++;
+	hfc_sim_bus_cycle(card);
+
+	switch(offset) {
+	case hfc_sim_A_FIFO_DATA:
+		hfc_sim_data_write(card, value);
+	break;
+
+	case hfc_sim_R_FIFO:
+		hfc_sim_select(card, (value >> 1) & 0x1f,
+			!(value & hfc_sim_R_FIFO_V_FIFO_DIR_RX));
+	break;
+
+	case hfc_sim_A_INC_RES_FIFO:
+		if (value & hfc_sim_A_INC_RES_FIFO_V_RES_F) {
+			fifo->z1 = fifo->z2 = fifo->z_min;
+			fifo->f1 = fifo->f2 = fifo->f_min;
+		}
+
+		if (value & hfc_sim_A_INC_RES_FIFO_V_INC_F)
+			hfc_sim_inc_f(card);
+	break;
+	}
+}
+EXPORT_SYMBOL(hfc_sim_outb);
+
+void hfc_sim_outw(void __iomem *addr, u16 value)
+{
+	int offset;
+	struct hfc_sim_card *card = hfc_sim_card_from_addr(addr, &offset);
+
+	card->stats.outw++;
+	hfc_sim_bus_cycle(card);
+}
+EXPORT_SYMBOL(hfc_sim_outw);
+
+void hfc_sim_outl(void __iomem *addr, u32 value)
+{
+	int offset;
+	struct hfc_sim_card *card = hfc_sim_card_from_addr(addr, &offset);
+
+	card->stats.outl++;
+	hfc_sim_bus_cycle(card);
+
+	switch(offset) {
+	case hfc_sim_A_FIFO_DATA:
+		hfc_sim_data_write(card, value);
+		hfc_sim_data_write(card, value >> 8);
+		hfc_sim_data_write(card, value >> 16);
+		hfc_sim_data_write(card, value >> 24);
+	break;
+	}
+}
+EXPORT_SYMBOL(hfc_sim_outl);
+
+void hfc_sim_outl_rep(void __iomem *addr, const void *buf,
+			unsigned long count)
+{
+	const u8 *p = buf;
+
+	while (count--) {
+		hfc_sim_outl(addr,
+			p[0] | p[1] << 8 | p[2] << 16 | p[3] << 24);
+		p += 4;
+	}
+}
+EXPORT_SYMBOL(hfc_sim_outl_rep);
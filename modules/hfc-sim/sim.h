@@ -0,0 +1,128 @@
+/*
+ * Register-level simulation of a Cologne Chip HFC FIFO engine
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#ifndef _HFC_SIM_H
+#define _HFC_SIM_H
+
+#include <linux/types.h>
+
+#define hfc_sim_MODULE_NAME "visdn-hfc-sim"
+#define hfc_sim_MODULE_PREFIX hfc_sim_MODULE_NAME ": "
+#define hfc_sim_MODULE_DESCR "HFC simulated card and FIFO test module"
+
+/* Registers shared by HFC-4S/8S and HFC-E1 */
+#define hfc_sim_A_Z12		0x04
+#define hfc_sim_A_F12		0x0C
+#define hfc_sim_A_INC_RES_FIFO	0x0E
+#define hfc_sim_A_INC_RES_FIFO_V_INC_F	(1 << 0)
+#define hfc_sim_A_INC_RES_FIFO_V_RES_F	(1 << 1)
+#define hfc_sim_R_FIFO		0x0F
+#define hfc_sim_R_FIFO_V_FIFO_DIR_RX	(1 << 0)
+#define hfc_sim_R_STATUS	0x1C
+#define hfc_sim_A_FIFO_DATA	0x80
+
+#define HFC_SIM_IO_SIZE		0x100
+
+#define HFC_SIM_FIFOS		32
+#define HFC_SIM_FIFO_SIZE	512
+#define HFC_SIM_FIFO_FRAMES	32
+
+/* z1 is where the next octet is written and z2 where the next one is read,
+ * by the host on TX FIFOs and by the line on RX FIFOs. frame_end[f] is the
+ * Z following the last octet of frame f. Counters wrap from z_max/f_max to
+ * z_min/f_min as on the chip.
+ */
+struct hfc_sim_fifo
+{
+	u16 z1;
+	u16 z2;
+	u8 f1;
+	u8 f2;
+
+	u16 z_min;
+	u16 z_max;
+	u8 f_min;
+	u8 f_max;
+
+	int hdlc;
+
+	u16 frame_end[HFC_SIM_FIFO_FRAMES];
+	u8 mem[HFC_SIM_FIFO_SIZE];
+};
+
+struct hfc_sim_stats
+{
+	unsigned long inb;
+	unsigned long inw;
+	unsigned long inl;
+	unsigned long outb;
+	unsigned long outw;
+	unsigned long outl;
+
+	unsigned long overruns;
+	unsigned long underruns;
+};
+
+/* The card is allocated page-aligned and its address is used as io_mem
+ * cookie, so that accessors find it back from any register address.
+ * Registers are never dereferenced.
+ */
+struct hfc_sim_card
+{
+	struct hfc_sim_fifo fifos[HFC_SIM_FIFOS][2];
+
+	struct hfc_sim_fifo *selected;
+
+	/* Simulated bus latency of a single access */
+	int access_ns;
+
+	struct hfc_sim_stats stats;
+};
+
+struct hfc_sim_card *hfc_sim_card_alloc(void);
+void hfc_sim_card_free(struct hfc_sim_card *card);
+
+static inline void __iomem *hfc_sim_io_mem(struct hfc_sim_card *card)
+{
+	return (void __iomem *)card;
+}
+
+void hfc_sim_select(struct hfc_sim_card *card, int fifo, int tx);
+void hfc_sim_fifo_configure(struct hfc_sim_fifo *fifo,
+	u16 z_min, u16 z_max, u8 f_min, u8 f_max, int hdlc);
+int hfc_sim_fifo_used(struct hfc_sim_fifo *fifo);
+
+/* Line side of the FIFOs */
+int hfc_sim_fifo_feed(struct hfc_sim_fifo *fifo, const void *data, int size);
+int hfc_sim_fifo_drain(struct hfc_sim_fifo *fifo, void *data, int size);
+int hfc_sim_fifo_feed_frame(struct hfc_sim_fifo *fifo,
+	const void *data, int size, u8 stat);
+int hfc_sim_fifo_drain_frame(struct hfc_sim_fifo *fifo, void *data, int size);
+
+u8 hfc_sim_inb(void __iomem *addr);
+u16 hfc_sim_inw(void __iomem *addr);
+u32 hfc_sim_inl(void __iomem *addr);
+void hfc_sim_inl_rep(void __iomem *addr, void *buf, unsigned long count);
+void hfc_sim_outb(void __iomem *addr, u8 value);
+void hfc_sim_outw(void __iomem *addr, u16 value);
+void hfc_sim_outl(void __iomem *addr, u32 value);
+void hfc_sim_outl_rep(void __iomem *addr, const void *buf,
+			unsigned long count);
+
+int hfc_sim_test_hfc4s_fifo(struct hfc_sim_card *sim);
+
+#define hfc_sim_msg(level, format, arg...)			\
+	printk(level hfc_sim_MODULE_PREFIX			\
+		format,						\
+		## arg)
+
+#endif
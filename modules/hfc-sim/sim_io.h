@@ -0,0 +1,42 @@
+/*
+ * Register-level simulation of a Cologne Chip HFC FIFO engine
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#ifndef _HFC_SIM_IO_H
+#define _HFC_SIM_IO_H
+
+#include <asm/io.h>
+
+#include "sim.h"
+
+/* Route the bus accessors of the code under test, the shared FIFO helpers
+ * and the drivers' inline FIFO functions, to the simulated card. Must be
+ * included before any of them.
+ */
+#undef ioread8
+#undef ioread16
+#undef ioread32
+#undef ioread32_rep
+#undef iowrite8
+#undef iowrite16
+#undef iowrite32
+#undef iowrite32_rep
+
+#define ioread8(addr)			hfc_sim_inb(addr)
+#define ioread16(addr)			hfc_sim_inw(addr)
+#define ioread32(addr)			hfc_sim_inl(addr)
+#define ioread32_rep(addr, buf, count)	hfc_sim_inl_rep(addr, buf, count)
+#define iowrite8(value, addr)		hfc_sim_outb(addr, value)
+#define iowrite16(value, addr)		hfc_sim_outw(addr, value)
+#define iowrite32(value, addr)		hfc_sim_outl(addr, value)
+#define iowrite32_rep(addr, buf, count)	hfc_sim_outl_rep(addr, buf, count)
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ * Cologne Chip's HFC FIFO burst transfers, shared by the HFC-4S/8S and
+ * HFC-E1 drivers
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#ifndef _HFC_FIFO_BURST_H
+#define _HFC_FIFO_BURST_H
+
+#include <linux/kernel.h>
+#include <asm/io.h>
+#include <asm/uaccess.h>
+#include <asm/unaligned.h>
+#include <asm/byteorder.h>
+
+/* The FIFO data port auto-increments Z on every access, whatever its width,
+ * so the cost of a transfer is the number of bus cycles: as many dwords as
+ * possible, then at most three bytes. Dwords go straight to/from the buffer
+ * with the string accessors when it is aligned, which preserve the FIFO
+ * byte order on any endianness.
+ *
+ * modules/hfc-sim runs these helpers, and the drivers' FIFO code built on
+ * them, against a simulated card by redirecting the bus accessors.
+ */
+
+/* Stack buffer used for user space transfers, a whole D-channel frame
+ * usually fits
+ */
+#define HFC_FIFO_BURST_BOUNCE_SIZE 256
+
+static inline void hfc_fifo_burst_read(
+	void __iomem *port,
+	void *data, int size)
+{
+	u8 *p = data;
+	int dwords = size >> 2;
+
+	if (likely(!((unsigned long)p & 3))) {
+		ioread32_rep(port, p, dwords);
+		p += dwords << 2;
+	} else {
+		for (; dwords; dwords--, p += 4)
+			put_unaligned(cpu_to_le32(ioread32(port)),
+				(u32 *)p);
+	}
+
+	switch(size & 3) {
+	case 3: *p++ = ioread8(port);
+	case 2: *p++ = ioread8(port);
+	case 1: *p++ = ioread8(port);
+	}
+}
+
+static inline void hfc_fifo_burst_write(
+	void __iomem *port,
+	const void *data, int size)
+{
+	const u8 *p = data;
+	int dwords = size >> 2;
+
+	if (likely(!((unsigned long)p & 3))) {
+		iowrite32_rep(port, p, dwords);
+		p += dwords << 2;
+	} else {
+		for (; dwords; dwords--, p += 4)
+			iowrite32(le32_to_cpu(get_unaligned((u32 *)p)),
+				port);
+	}
+
+	switch(size & 3) {
+	case 3: iowrite8(*p++, port);
+	case 2: iowrite8(*p++, port);
+	case 1: iowrite8(*p++, port);
+	}
+}
+
+/* Data is consumed from the FIFO even if copying to user space fails */
+static inline int hfc_fifo_burst_read_to_user(
+	void __iomem *port,
+	void __user *data, int size)
+{
+	u32 bounce[HFC_FIFO_BURST_BOUNCE_SIZE / sizeof(u32)];
+	int pos;
+
+	for (pos = 0; pos < size; pos += sizeof(bounce)) {
+		int chunk = min_t(int, size - pos, sizeof(bounce));
+
+		hfc_fifo_burst_read(port, bounce, chunk);
+
+		if (copy_to_user(data + pos, bounce, chunk))
+			return -EFAULT;
+	}
+
+	return size;
+}
+
+static inline int hfc_fifo_burst_write_from_user(
+	void __iomem *port,
+	const void __user *data, int size)
+{
+	u32 bounce[HFC_FIFO_BURST_BOUNCE_SIZE / sizeof(u32)];
+	int pos;
+
+	for (pos = 0; pos < size; pos += sizeof(bounce)) {
+		int chunk = min_t(int, size - pos, sizeof(bounce));
+
+		if (copy_from_user(bounce, data + pos, chunk))
+			return -EFAULT;
+
+		hfc_fifo_burst_write(port, bounce, chunk);
+	}
+
+	return size;
+}
+
+#endif
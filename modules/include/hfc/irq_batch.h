@@ -0,0 +1,233 @@
+/*
+ * Cologne Chip's HFC FIFO interrupt batching, shared by the HFC drivers
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#ifndef _HFC_IRQ_BATCH_H
+#define _HFC_IRQ_BATCH_H
+
+#include <linux/kernel.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/bitops.h>
+#include <linux/hrtimer.h>
+#include <asm/div64.h>
+
+/* The interrupt handler only collects the R_IRQ_FIFO_BLx status bits in the
+ * pending mask; a single bottom half per card then services all the pending
+ * FIFOs in one pass, under one acquisition of the card lock.
+ *
+ * Bit n of block b refers to FIFO b * 4 + n / 2, TX if n is even, RX if odd,
+ * as in the hardware registers.
+ */
+
+#define HFC_IRQ_BATCH_BLOCKS 8
+
+/* Returned by the service callback */
+#define HFC_IRQ_BATCH_SERVICED	(1 << 0)
+#define HFC_IRQ_BATCH_AGAIN	(1 << 1)
+
+typedef int (*hfc_irq_batch_service_t)(void *data, int fifo, int rx);
+
+struct hfc_irq_batch
+{
+	spinlock_t lock;
+
+	u8 pending[HFC_IRQ_BATCH_BLOCKS];
+
+	/* Updated in interrupt context, under lock */
+	unsigned long interrupts;
+	unsigned long fifo_events;
+	u64 irq_time_ns;
+	unsigned long max_irq_time_ns;
+
+	/* Updated by the bottom half only */
+	unsigned long runs;
+	unsigned long fifos_serviced;
+	unsigned long max_fifos_per_run;
+	u64 bh_time_ns;
+	unsigned long max_bh_time_ns;
+};
+
+static inline void hfc_irq_batch_init(struct hfc_irq_batch *batch)
+{
+	memset(batch, 0, sizeof(*batch));
+
+	spin_lock_init(&batch->lock);
+}
+
+/* Called by the interrupt handler once the FIFO status has been collected,
+ * start being the time the handler was entered
+ */
+static inline void hfc_irq_batch_interrupt(
+	struct hfc_irq_batch *batch,
+	ktime_t start)
+{
+	unsigned long elapsed = ktime_to_ns(ktime_sub(ktime_get(), start));
+	unsigned long flags;
+
+	spin_lock_irqsave(&batch->lock, flags);
+	batch->interrupts++;
+	batch->irq_time_ns += elapsed;
+
+	if (elapsed > batch->max_irq_time_ns)
+		batch->max_irq_time_ns = elapsed;
+	spin_unlock_irqrestore(&batch->lock, flags);
+}
+
+/* Safe from any context. Returns nonzero if there is something new to
+ * service, in which case the caller should schedule the bottom half.
+ */
+static inline int hfc_irq_batch_collect(
+	struct hfc_irq_batch *batch,
+	int block, u8 status)
+{
+	unsigned long flags;
+	u8 new_bits;
+
+	if (!status)
+		return 0;
+
+	spin_lock_irqsave(&batch->lock, flags);
+	new_bits = status & ~batch->pending[block];
+	batch->pending[block] |= status;
+	batch->fifo_events += hweight8(status);
+	spin_unlock_irqrestore(&batch->lock, flags);
+
+	return new_bits;
+}
+
+/* Marks all the FIFOs as pending, when they are polled on a timer instead
+ * of raising their own interrupts. Services must cope with idle FIFOs.
+ */
+static inline void hfc_irq_batch_poll(struct hfc_irq_batch *batch)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&batch->lock, flags);
+	memset(batch->pending, 0xff, sizeof(batch->pending));
+	spin_unlock_irqrestore(&batch->lock, flags);
+}
+
+/* Must not run concurrently with itself, as a tasklet does not. Returns
+ * nonzero if some FIFO asked to be serviced again and the bottom half has
+ * to be rescheduled.
+ */
+static inline int hfc_irq_batch_dispatch(
+	struct hfc_irq_batch *batch,
+	hfc_irq_batch_service_t service,
+	void *data)
+{
+	u8 pending[HFC_IRQ_BATCH_BLOCKS];
+	u8 again[HFC_IRQ_BATCH_BLOCKS];
+	unsigned long serviced = 0;
+	unsigned long flags;
+	unsigned long elapsed;
+	ktime_t start;
+	int need_again = 0;
+	int block, bit;
+
+	start = ktime_get();
+
+	spin_lock_irqsave(&batch->lock, flags);
+	memcpy(pending, batch->pending, sizeof(pending));
+	memset(batch->pending, 0, sizeof(batch->pending));
+	spin_unlock_irqrestore(&batch->lock, flags);
+
+	memset(again, 0, sizeof(again));
+
+	for (block = 0; block < HFC_IRQ_BATCH_BLOCKS; block++) {
+		if (!pending[block])
+			continue;
+
+		for (bit = 0; bit < 8; bit++) {
+			int res;
+
+			if (!(pending[block] & (1 << bit)))
+				continue;
+
+			res = service(data, block * 4 + bit / 2, bit & 1);
+
+			if (res & HFC_IRQ_BATCH_SERVICED)
+				serviced++;
+
+			if (res & HFC_IRQ_BATCH_AGAIN) {
+				again[block] |= 1 << bit;
+				need_again = 1;
+			}
+		}
+	}
+
+	if (need_again) {
+		spin_lock_irqsave(&batch->lock, flags);
+		for (block = 0; block < HFC_IRQ_BATCH_BLOCKS; block++)
+			batch->pending[block] |= again[block];
+		spin_unlock_irqrestore(&batch->lock, flags);
+	}
+
+	elapsed = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	batch->runs++;
+	batch->fifos_serviced += serviced;
+	batch->bh_time_ns += elapsed;
+
+	if (serviced > batch->max_fifos_per_run)
+		batch->max_fifos_per_run = serviced;
+
+	if (elapsed > batch->max_bh_time_ns)
+		batch->max_bh_time_ns = elapsed;
+
+	return need_again;
+}
+
+static inline ssize_t hfc_irq_batch_show_stats(
+	struct hfc_irq_batch *batch,
+	char *buf)
+{
+	unsigned long runs = batch->runs;
+	unsigned long interrupts = batch->interrupts;
+	unsigned long fifos_serviced = batch->fifos_serviced;
+	u64 irq_time_ns = batch->irq_time_ns;
+	u64 bh_time_ns = batch->bh_time_ns;
+
+	/* Hundredths of FIFO per interrupt */
+	unsigned long fifos_per_irq = interrupts ?
+			fifos_serviced * 100 / interrupts : 0;
+
+	if (interrupts)
+		do_div(irq_time_ns, interrupts);
+
+	if (runs)
+		do_div(bh_time_ns, runs);
+
+	return snprintf(buf, PAGE_SIZE,
+		"interrupts: %lu\n"
+		"fifo_events: %lu\n"
+		"runs: %lu\n"
+		"fifos_serviced: %lu\n"
+		"fifos_per_interrupt: %lu.%02lu\n"
+		"max_fifos_per_run: %lu\n"
+		"avg_irq_time_ns: %llu\n"
+		"max_irq_time_ns: %lu\n"
+		"avg_bh_time_ns: %llu\n"
+		"max_bh_time_ns: %lu\n",
+		interrupts,
+		batch->fifo_events,
+		runs,
+		fifos_serviced,
+		fifos_per_irq / 100, fifos_per_irq % 100,
+		batch->max_fifos_per_run,
+		(unsigned long long)irq_time_ns,
+		batch->max_irq_time_ns,
+		(unsigned long long)bh_time_ns,
+		batch->max_bh_time_ns);
+}
+
+#endif
@@ -0,0 +1 @@
+../../../kstreamer/dtmf_detector.h
\ No newline at end of file
@@ -285,6 +285,10 @@ int ks_chan_write_to_nlmsg(
 					goto err_put_attr;
 			}
 		}
+
+		err = ks_feature_soft_write_attrs(chan, skb);
+		if (err < 0)
+			goto err_put_attr;
 	}
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,22)
@@ -319,10 +323,20 @@ static int ks_chan_update_from_nlmsg(struct ks_chan *chan, struct nlmsghdr *nlh)
 			/* Are updates to these allowed? */
 		break;
 
-		default:
-			if (chan->ops->set_attr) {
-				int err;
+		default: {
+			int err;
+
+			err = ks_feature_soft_set(chan, attr->type,
+						KS_ATTR_DATA(attr),
+						KS_ATTR_PAYLOAD(attr));
+			if (err != -ENOENT) {
+				if (err < 0)
+					return err;
+
+				break;
+			}
 
+			if (chan->ops->set_attr) {
 				err = chan->ops->set_attr(chan, attr->type,
 							KS_ATTR_DATA(attr),
 							KS_ATTR_PAYLOAD(attr));
@@ -331,6 +345,7 @@ static int ks_chan_update_from_nlmsg(struct ks_chan *chan, struct nlmsghdr *nlh)
 					return err;
 			}
 		}
+		}
 	}
 
 	return 0;
@@ -366,6 +381,9 @@ static int ks_chan_netlink_respond(
 {
 	int err;
 
+	if (!ks_netlink_wants_ack(req_nlh))
+		return 0;
+
 retry:
 	ks_netlink_need_skb(state);
 	if (!state->out_skb)
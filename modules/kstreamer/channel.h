@@ -34,6 +34,7 @@ enum ks_chan_attribute_type
 extern struct kset *ks_chans_kset;
 
 struct ks_chan;
+struct ks_pipeline_hop;
 
 struct ks_chan_ops
 {
@@ -81,6 +82,9 @@ struct ks_chan
 
 	struct list_head pipeline_entry;
 
+	/* RCU protected, our hop in the compiled pipeline while FLOWING */
+	struct ks_pipeline_hop *hop;
+
 	void *driver_data;
 };
 
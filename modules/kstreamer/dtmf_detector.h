@@ -0,0 +1,44 @@
+/*
+ * Kstreamer DTMF detector feature, shared by detectors and their users
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#ifndef _DTMF_DETECTOR_H
+#define _DTMF_DETECTOR_H
+
+#include <linux/types.h>
+
+struct ks_dtmf_detector_descr
+{
+	__u8 hardware:1;
+	__u8 enabled:1;
+	__u8 mu_mode:1;
+	__u8 reversed:1;
+	__u32 :28;
+};
+
+enum ks_dtmf_event_type
+{
+	KS_DTMF_EVENT_BEGIN,
+	KS_DTMF_EVENT_END,
+};
+
+/* Payload of the KS_NETLINK_EVENT messages of the dtmf_detector feature */
+struct ks_dtmf_event
+{
+	__u8 type;
+	__u8 digit;
+	__u16 reserved;
+
+	/* Only in KS_DTMF_EVENT_END */
+	__u32 duration;
+};
+
+#endif
@@ -24,6 +24,9 @@
 static struct hlist_head ks_features_hash[KS_FEATURE_HASHSIZE];
 static rwlock_t ks_features_list_lock = RW_LOCK_UNLOCKED;
 
+/* Protected by ks_topology_lock */
+static LIST_HEAD(ks_soft_features);
+
 struct ks_feature *ks_feature_get(struct ks_feature *feature)
 {
 	atomic_inc(&feature->refcnt);
@@ -226,6 +229,7 @@ static struct ks_feature *ks_feature_register_no_topology_lock(const char *name)
 	memset(feature, 0, sizeof(*feature));
 
 	atomic_set(&feature->refcnt, 1);
+	INIT_LIST_HEAD(&feature->soft_node);
 
 	strncpy(feature->name, name, sizeof(feature->name));
 
@@ -251,8 +255,38 @@ struct ks_feature *ks_feature_register(const char *name)
 }
 EXPORT_SYMBOL(ks_feature_register);
 
+struct ks_feature *ks_feature_register_soft(
+	const char *name,
+	struct ks_feature_ops *ops)
+{
+	struct ks_feature *feature;
+
+	ks_topology_lock();
+	feature = ks_feature_register_no_topology_lock(name);
+	if (feature) {
+		if (feature->ops) {
+			ks_feature_put(feature);
+			feature = NULL;
+		} else {
+			feature->ops = ops;
+			list_add_tail(&feature->soft_node, &ks_soft_features);
+		}
+	}
+	ks_topology_unlock();
+
+	return feature;
+}
+EXPORT_SYMBOL(ks_feature_register_soft);
+
 void ks_feature_unregister(struct ks_feature *feature)
 {
+	if (feature->ops) {
+		ks_topology_lock();
+		list_del_init(&feature->soft_node);
+		feature->ops = NULL;
+		ks_topology_unlock();
+	}
+
 	if (atomic_read(&feature->refcnt) == 1) {
 		ks_topology_lock();
 		hlist_del(&feature->node);
@@ -265,3 +299,50 @@ void ks_feature_unregister(struct ks_feature *feature)
 	ks_feature_put(feature);
 }
 EXPORT_SYMBOL(ks_feature_unregister);
+
+/* Appends the value of every soft feature applicable to chan, called with
+ * the topology lock held while composing a chan message
+ */
+int ks_feature_soft_write_attrs(
+	struct ks_chan *chan,
+	struct sk_buff *skb)
+{
+	struct ks_feature *feature;
+	int err;
+
+	list_for_each_entry(feature, &ks_soft_features, soft_node) {
+		u8 buf[32];
+		int len = sizeof(buf);
+
+		err = feature->ops->get(feature, chan, buf, &len);
+		if (err == -ENOENT)
+			continue;
+		else if (err < 0)
+			return err;
+
+		err = ks_netlink_put_attr(skb, feature->id, buf, len);
+		if (err < 0)
+			return err;
+	}
+
+	return 0;
+}
+
+/* Returns -ENOENT if type is not a soft feature, leaving the attribute to
+ * the channel's driver
+ */
+int ks_feature_soft_set(
+	struct ks_chan *chan,
+	u16 type,
+	void *buf,
+	int len)
+{
+	struct ks_feature *feature;
+
+	list_for_each_entry(feature, &ks_soft_features, soft_node) {
+		if (feature->id == type)
+			return feature->ops->set(feature, chan, buf, len);
+	}
+
+	return -ENOENT;
+}
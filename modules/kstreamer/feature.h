@@ -27,6 +27,23 @@ enum ks_feature_attribute_type
 
 #include "netlink.h"
 
+struct ks_chan;
+struct ks_feature;
+
+/* Soft features are implemented in software by a module other than the
+ * channel's driver and are made available on every channel the module
+ * accepts; they are read and written through these ops instead of the
+ * channel's get_attr/set_attr. Both are called with the topology lock held.
+ * get() returns -ENOENT for channels the feature does not apply to.
+ */
+struct ks_feature_ops
+{
+	int (*get)(struct ks_feature *feature, struct ks_chan *chan,
+			void *buf, int *len);
+	int (*set)(struct ks_feature *feature, struct ks_chan *chan,
+			void *buf, int len);
+};
+
 struct ks_feature
 {
 	struct hlist_node node;
@@ -35,6 +52,9 @@ struct ks_feature
 
 	u32 id;
 	char name[32];
+
+	struct ks_feature_ops *ops;
+	struct list_head soft_node;
 };
 
 struct ks_feature_value
@@ -52,8 +72,20 @@ int ks_feature_cmd_get(
 	struct nlmsghdr *nlh);
 
 extern struct ks_feature *ks_feature_register(const char *name);
+extern struct ks_feature *ks_feature_register_soft(
+	const char *name,
+	struct ks_feature_ops *ops);
 extern void ks_feature_unregister(struct ks_feature *feature);
 
+int ks_feature_soft_write_attrs(
+	struct ks_chan *chan,
+	struct sk_buff *skb);
+int ks_feature_soft_set(
+	struct ks_chan *chan,
+	u16 type,
+	void *buf,
+	int len);
+
 extern struct ks_feature *ks_feature_get(struct ks_feature *feature);
 extern void ks_feature_put(struct ks_feature *feature);
 
@@ -26,6 +26,37 @@ extern struct device ks_system_device;
 
 void ks_kobj_waitref(struct kobject *kobj);
 
+/* Pipeline instrumentation (source timestamps, latencies, underruns) is
+ * switched by /sys/devices/ks-system/stats. Where the kernel provides jump
+ * labels (2.6.37 onwards) the disabled test is a patched-out jump, on older
+ * kernels it is a plain load of a __read_mostly flag.
+ */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,3,0)
+#include <linux/jump_label.h>
+
+DECLARE_STATIC_KEY_FALSE(ks_stats_key);
+#define ks_stats_enabled() static_branch_unlikely(&ks_stats_key)
+#define ks_stats_key_inc() static_branch_inc(&ks_stats_key)
+#define ks_stats_key_dec() static_branch_dec(&ks_stats_key)
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(3,3,0)
+#include <linux/jump_label.h>
+
+extern struct static_key ks_stats_key;
+#define ks_stats_enabled() static_key_false(&ks_stats_key)
+#define ks_stats_key_inc() static_key_slow_inc(&ks_stats_key)
+#define ks_stats_key_dec() static_key_slow_dec(&ks_stats_key)
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,37)
+#include <linux/jump_label.h>
+
+extern struct jump_label_key ks_stats_key;
+#define ks_stats_enabled() static_branch(&ks_stats_key)
+#define ks_stats_key_inc() jump_label_inc(&ks_stats_key)
+#define ks_stats_key_dec() jump_label_dec(&ks_stats_key)
+#else
+extern int ks_stats_on;
+#define ks_stats_enabled() unlikely(ks_stats_on)
+#endif
+
 #if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,25)
 static struct kset *kset_create(const char *name,
 	const struct kset_uevent_ops *uevent_ops,
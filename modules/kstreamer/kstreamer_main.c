@@ -18,6 +18,7 @@
 #include <linux/kdev_t.h>
 #include <linux/device.h>
 #include <linux/notifier.h>
+#include <linux/mutex.h>
 
 #include <kernel_config.h>
 
@@ -29,6 +30,7 @@
 #include "channel.h"
 #include "duplex.h"
 #include "pipeline.h"
+#include "streamframe.h"
 #include "netlink.h"
 
 #ifdef DEBUG_CODE
@@ -99,6 +101,66 @@ static void ks_system_device_release(struct device *cd)
 struct device ks_system_device;
 EXPORT_SYMBOL(ks_system_device);
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,3,0)
+DEFINE_STATIC_KEY_FALSE(ks_stats_key);
+EXPORT_SYMBOL(ks_stats_key);
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(3,3,0)
+struct static_key ks_stats_key = STATIC_KEY_INIT_FALSE;
+EXPORT_SYMBOL(ks_stats_key);
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,37)
+struct jump_label_key ks_stats_key;
+EXPORT_SYMBOL(ks_stats_key);
+#else
+int ks_stats_on __read_mostly;
+EXPORT_SYMBOL(ks_stats_on);
+#endif
+
+/* Jump label keys are reference counted, only move them on a change */
+static int ks_stats_state;
+
+static DEFINE_MUTEX(ks_stats_mutex);
+
+static ssize_t ks_system_show_stats(
+	struct device *device,
+	struct device_attribute *attr,
+	char *buf)
+{
+	return snprintf(buf, PAGE_SIZE, "%d\n", ks_stats_enabled() ? 1 : 0);
+}
+
+static ssize_t ks_system_store_stats(
+	struct device *device,
+	struct device_attribute *attr,
+	const char *buf,
+	size_t count)
+{
+	unsigned int value;
+
+	if (sscanf(buf, "%u", &value) < 1)
+		return -EINVAL;
+
+	mutex_lock(&ks_stats_mutex);
+	if (!!value != ks_stats_state) {
+		ks_stats_state = !!value;
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,37)
+		if (ks_stats_state)
+			ks_stats_key_inc();
+		else
+			ks_stats_key_dec();
+#else
+		ks_stats_on = ks_stats_state;
+#endif
+	}
+	mutex_unlock(&ks_stats_mutex);
+
+	return count;
+}
+
+static DEVICE_ATTR(stats, S_IRUGO | S_IWUSR,
+		ks_system_show_stats,
+		ks_system_store_stats);
+
 void ks_kobj_waitref(struct kobject *kobj)
 {
 	if (atomic_read(&kobj->kref.refcount) > 1) {
@@ -184,6 +246,10 @@ static int __init ks_init_module(void)
 	if (err < 0)
 		goto err_system_device_register;
 
+	err = device_create_file(&ks_system_device, &dev_attr_stats);
+	if (err < 0)
+		goto err_create_file_stats;
+
 	err = ks_node_modinit();
 	if (err < 0)
 		goto err_node_modinit;
@@ -200,6 +266,10 @@ static int __init ks_init_module(void)
 	if (err < 0)
 		goto err_duplex_modinit;
 
+	err = ks_sf_modinit();
+	if (err < 0)
+		goto err_sf_modinit;
+
 	err = ks_netlink_modinit();
 	if (err < 0)
 		goto err_netlink_modinit;
@@ -208,6 +278,8 @@ static int __init ks_init_module(void)
 
 	ks_netlink_modexit();
 err_netlink_modinit:
+	ks_sf_modexit();
+err_sf_modinit:
 	ks_duplex_modexit();
 err_duplex_modinit:
 	ks_pipeline_modexit();
@@ -216,6 +288,8 @@ err_pipeline_modinit:
 err_chan_modinit:
 	ks_node_modexit();
 err_node_modinit:
+	device_remove_file(&ks_system_device, &dev_attr_stats);
+err_create_file_stats:
 	device_unregister(&ks_system_device);
 err_system_device_register:
 	kobject_del(&kstreamer_kobj);
@@ -231,11 +305,13 @@ module_init(ks_init_module);
 static void __exit ks_module_exit(void)
 {
 	ks_netlink_modexit();
+	ks_sf_modexit();
 	ks_duplex_modexit();
 	ks_pipeline_modexit();
 	ks_chan_modexit();
 	ks_node_modexit();
 
+	device_remove_file(&ks_system_device, &dev_attr_stats);
 	device_unregister(&ks_system_device);
 
 	kobject_del(&kstreamer_kobj);
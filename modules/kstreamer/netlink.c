@@ -11,6 +11,7 @@
  */
 
 #include <linux/kernel.h>
+#include <linux/module.h>
 #include <linux/delay.h>
 #include <linux/fs.h>
 #include <linux/kobject.h>
@@ -223,6 +224,79 @@ static void ks_netlink_mcast_flush(struct ks_netlink_state *state)
 	}
 }
 
+/* Events are not part of the topology, they are sent immediately and may
+ * be generated in atomic context, e.g. by a softswitch tap
+ */
+int ks_netlink_event_send(
+	struct ks_feature *feature,
+	struct ks_chan *chan,
+	void *payload,
+	int payload_len)
+{
+	struct ks_pipeline *pipeline;
+	struct sk_buff *skb;
+	struct nlmsghdr *nlh;
+	int err;
+
+	skb = alloc_skb(NLMSG_SPACE(KS_ATTR_SPACE(sizeof(u32)) * 3 +
+				KS_ATTR_SPACE(payload_len)), GFP_ATOMIC);
+	if (!skb)
+		return -ENOMEM;
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,20)
+	NETLINK_CB(skb).dst_pid = 0;
+#endif
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,14)
+	NETLINK_CB(skb).dst_groups = (1 << KS_NETLINK_GROUP_EVENTS);
+#else
+	NETLINK_CB(skb).dst_group = KS_NETLINK_GROUP_EVENTS;
+#endif
+
+	nlh = NLMSG_PUT(skb, 0, 0, KS_NETLINK_EVENT, 0);
+
+	err = ks_netlink_put_attr(skb, KS_EVENTATTR_FEATURE_ID,
+				&feature->id, sizeof(feature->id));
+	if (err < 0)
+		goto err_put_attr;
+
+	err = ks_netlink_put_attr(skb, KS_EVENTATTR_CHAN_ID,
+				&chan->id, sizeof(chan->id));
+	if (err < 0)
+		goto err_put_attr;
+
+	pipeline = chan->pipeline;
+	if (pipeline) {
+		err = ks_netlink_put_attr(skb, KS_EVENTATTR_PIPELINE_ID,
+				&pipeline->id, sizeof(pipeline->id));
+		if (err < 0)
+			goto err_put_attr;
+	}
+
+	err = ks_netlink_put_attr(skb, KS_EVENTATTR_PAYLOAD,
+				payload, payload_len);
+	if (err < 0)
+		goto err_put_attr;
+
+	nlh->nlmsg_len = skb->len;
+
+	err = netlink_broadcast(ksnl, skb, 0, KS_NETLINK_GROUP_EVENTS,
+								GFP_ATOMIC);
+
+	/* Nobody listening */
+	if (err == -ESRCH)
+		err = 0;
+
+	return err;
+
+err_put_attr:
+nlmsg_failure:
+	kfree_skb(skb);
+
+	return -ENOBUFS;
+}
+EXPORT_SYMBOL(ks_netlink_event_send);
+
 int ks_cmd_done(
 	struct ks_netlink_state *state,
 	struct ks_command *cmd,
@@ -348,7 +422,7 @@ retry:
 	vr = (struct ks_netlink_version_response *)NLMSG_DATA(nlh);
 	vr->reserved = 0;
 	vr->major = 1;
-	vr->minor = 0;
+	vr->minor = 1;
 	vr->service = 0;
 
 	return 0;
@@ -433,6 +507,10 @@ int ks_netlink_send_ack(
 {
 	struct nlmsghdr *nlh;
 
+	/* Dumps are always answered, they'd be pointless otherwise */
+	if (!(flags & NLM_F_MULTI) && !ks_netlink_wants_ack(req_nlh))
+		return 0;
+
 retry:
 	ks_netlink_need_skb(state);
 	if (!state->out_skb)
@@ -55,11 +55,31 @@ enum ks_netlink_message_type
 	KS_NETLINK_PIPELINE_DEL,
 	KS_NETLINK_PIPELINE_GET,
 	KS_NETLINK_PIPELINE_SET,
+
+	KS_NETLINK_EVENT,
 };
 
+/* Set by the requester when it does not need the response to a request,
+ * errors are reported anyway
+ */
+#define KS_NLM_F_NOACK 0x1000
+
 enum ks_netlink_groups
 {
 	KS_NETLINK_GROUP_TOPOLOGY = 1 << 0,
+	KS_NETLINK_GROUP_EVENTS = 1 << 1,
+};
+
+/* Events are multicasted by soft features on KS_NETLINK_GROUP_EVENTS,
+ * outside of the topology sequence numbering. The payload is defined by
+ * the feature.
+ */
+enum ks_event_attribute_type
+{
+	KS_EVENTATTR_FEATURE_ID = 1,
+	KS_EVENTATTR_CHAN_ID,
+	KS_EVENTATTR_PIPELINE_ID,
+	KS_EVENTATTR_PAYLOAD,
 };
 
 struct ks_netlink_version_response
@@ -197,6 +217,19 @@ void ks_netlink_mcast_need_another_skb(struct ks_netlink_state *state);
 void ks_topology_lock(void);
 void ks_topology_unlock(void);
 
+struct ks_feature;
+struct ks_chan;
+int ks_netlink_event_send(
+	struct ks_feature *feature,
+	struct ks_chan *chan,
+	void *payload,
+	int payload_len);
+
+static inline int ks_netlink_wants_ack(struct nlmsghdr *req_nlh)
+{
+	return !(req_nlh->nlmsg_flags & KS_NLM_F_NOACK);
+}
+
 int ks_netlink_send_done(
 	struct ks_netlink_state *state,
 	struct nlmsghdr *req_nlh,
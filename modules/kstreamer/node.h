@@ -29,6 +29,7 @@ extern struct kset *ks_nodes_kset;
 
 struct ks_chan;
 struct ks_pipeline;
+struct ks_pipeline_hop;
 
 struct ks_node;
 struct ks_node_ops
@@ -72,6 +73,13 @@ struct ks_node_ops
 		struct ks_node *node,
 		struct ks_chan *link1,
 		struct ks_chan *link2);
+
+	/* Optional, resolves the fast path of a hop entering the node; called
+	 * with ks_connection_lock held, must not sleep
+	 */
+	void (*compile)(
+		struct ks_node *node,
+		struct ks_pipeline_hop *hop);
 };
 
 struct ks_duplex;
@@ -115,6 +115,88 @@ static void ks_pipeline_set_status(
 	pipeline->status = status;
 }
 
+static void ks_pipeline_stats_add(
+	struct ks_pipeline_stats *dst,
+	const struct ks_pipeline_stats *src)
+{
+	int i;
+
+	dst->frames += src->frames;
+	dst->bytes += src->bytes;
+	dst->drops += src->drops;
+	dst->underruns += src->underruns;
+
+	dst->latency_sum += src->latency_sum;
+	dst->latency_samples += src->latency_samples;
+
+	if (src->latency_max > dst->latency_max)
+		dst->latency_max = src->latency_max;
+
+	for (i = 0; i < KS_PIPELINE_LATENCY_BUCKETS; i++)
+		dst->latency_hist[i] += src->latency_hist[i];
+}
+
+/* Totals of every hop, including the ones of past FLOWING periods */
+void ks_pipeline_get_stats(
+	struct ks_pipeline *pipeline,
+	struct ks_pipeline_stats *stats)
+{
+	struct ks_pipeline_compiled *compiled;
+	int i;
+
+	spin_lock_bh(&pipeline->stats_lock);
+	*stats = pipeline->stats;
+	spin_unlock_bh(&pipeline->stats_lock);
+
+	rcu_read_lock();
+	compiled = rcu_dereference(pipeline->compiled);
+	if (compiled) {
+		for (i = 0; i < compiled->num_hops; i++)
+			ks_pipeline_stats_add(stats,
+					&compiled->hops[i].stats);
+	}
+	rcu_read_unlock();
+}
+EXPORT_SYMBOL(ks_pipeline_get_stats);
+
+static int ks_pipeline_put_hop_stats(
+	struct ks_pipeline *pipeline,
+	struct sk_buff *skb)
+{
+	struct ks_pipeline_compiled *compiled;
+	struct ks_pipeline_hop_stats hop_stats;
+	int err = 0;
+	int i;
+
+	rcu_read_lock();
+	compiled = rcu_dereference(pipeline->compiled);
+	if (!compiled)
+		goto out;
+
+	for (i = 0; i < compiled->num_hops; i++) {
+		struct ks_pipeline_hop *hop = &compiled->hops[i];
+
+		hop_stats.chan_id = hop->chan->id;
+		hop_stats.latency_max = hop->stats.latency_max;
+		hop_stats.frames = hop->stats.frames;
+		hop_stats.bytes = hop->stats.bytes;
+		hop_stats.drops = hop->stats.drops;
+		hop_stats.underruns = hop->stats.underruns;
+		hop_stats.latency_sum = hop->stats.latency_sum;
+		hop_stats.latency_samples = hop->stats.latency_samples;
+
+		err = ks_netlink_put_attr(skb, KS_PIPELINEATTR_HOP_STATS,
+					&hop_stats, sizeof(hop_stats));
+		if (err < 0)
+			goto out;
+	}
+
+out:
+	rcu_read_unlock();
+
+	return err;
+}
+
 int ks_pipeline_write_to_nlmsg(
 	struct ks_pipeline *pipeline,
 	struct sk_buff *skb,
@@ -163,6 +245,21 @@ int ks_pipeline_write_to_nlmsg(
 				goto err_put_attr;
 			}
 		}
+
+		{
+		struct ks_pipeline_stats stats;
+
+		ks_pipeline_get_stats(pipeline, &stats);
+
+		err = ks_netlink_put_attr(skb, KS_PIPELINEATTR_STATS,
+						&stats, sizeof(stats));
+		if (err < 0)
+			goto err_put_attr;
+		}
+
+		err = ks_pipeline_put_hop_stats(pipeline, skb);
+		if (err < 0)
+			goto err_put_attr;
 	}
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,22)
@@ -210,6 +307,9 @@ static int ks_pipeline_netlink_respond(
 {
 	int err;
 
+	if (!ks_netlink_wants_ack(req_nlh))
+		return 0;
+
 retry:
 	ks_netlink_need_skb(state);
 	if (!state->out_skb)
@@ -557,6 +657,49 @@ static KS_PIPELINE_ATTR(status, S_IRUGO,
 		ks_pipeline_show_status,
 		NULL);
 
+/*---------------------------------------------------------------------------*/
+
+static ssize_t ks_pipeline_show_counters(
+	struct ks_pipeline *pipeline,
+	struct ks_pipeline_attribute *attr,
+	char *buf)
+{
+	struct ks_pipeline_stats stats;
+	ssize_t len;
+	int i;
+
+	ks_pipeline_get_stats(pipeline, &stats);
+
+	len = snprintf(buf, PAGE_SIZE,
+		"frames: %llu\n"
+		"bytes: %llu\n"
+		"drops: %llu\n"
+		"underruns: %llu\n"
+		"latency_sum: %llu\n"
+		"latency_samples: %llu\n"
+		"latency_max: %u\n"
+		"latency_hist:",
+		(unsigned long long)stats.frames,
+		(unsigned long long)stats.bytes,
+		(unsigned long long)stats.drops,
+		(unsigned long long)stats.underruns,
+		(unsigned long long)stats.latency_sum,
+		(unsigned long long)stats.latency_samples,
+		stats.latency_max);
+
+	for (i = 0; i < KS_PIPELINE_LATENCY_BUCKETS; i++)
+		len += snprintf(buf + len, PAGE_SIZE - len,
+				" %u", stats.latency_hist[i]);
+
+	len += snprintf(buf + len, PAGE_SIZE - len, "\n");
+
+	return len;
+}
+
+static KS_PIPELINE_ATTR(counters, S_IRUGO,
+		ks_pipeline_show_counters,
+		NULL);
+
 
 /*---------------------------------------------------------------------------*/
 
@@ -564,6 +707,7 @@ static struct attribute *ks_pipeline_default_attrs[] =
 {
 	&ks_pipeline_attr_mtu.attr,
 	&ks_pipeline_attr_status.attr,
+	&ks_pipeline_attr_counters.attr,
 	NULL,
 };
 
@@ -653,6 +797,8 @@ struct ks_pipeline *ks_pipeline_create(struct ks_pipeline *pipeline)
 
 	INIT_LIST_HEAD(&pipeline->entries);
 
+	spin_lock_init(&pipeline->stats_lock);
+
 	pipeline->status = KS_PIPELINE_STATUS_NULL;
 
 	return pipeline;
@@ -979,6 +1125,96 @@ failed:
 
 /* -------------------------- OPEN <=> FLOWING -----------------------------*/
 
+static int ks_pipeline_compile(struct ks_pipeline *pipeline)
+{
+	struct ks_pipeline_compiled *compiled;
+	struct ks_chan *chan;
+	int num_hops = 0;
+	int i;
+
+	/* Entries do not change while the topology is locked */
+	read_lock_bh(&ks_connection_lock);
+	list_for_each_entry(chan, &pipeline->entries, pipeline_entry)
+		num_hops++;
+	read_unlock_bh(&ks_connection_lock);
+
+	compiled = kmalloc(sizeof(*compiled) +
+			sizeof(*compiled->hops) * num_hops, GFP_KERNEL);
+	if (!compiled)
+		return -ENOMEM;
+
+	memset(compiled, 0, sizeof(*compiled) +
+			sizeof(*compiled->hops) * num_hops);
+
+	compiled->pipeline = ks_pipeline_get(pipeline);
+	compiled->num_hops = num_hops;
+
+	i = 0;
+	read_lock_bh(&ks_connection_lock);
+	list_for_each_entry(chan, &pipeline->entries, pipeline_entry) {
+		struct ks_pipeline_hop *hop = &compiled->hops[i];
+
+		hop->chan = chan;
+		hop->next = ks_pipeline_next(chan);
+
+		if (i == 0)
+			hop->flags |= KS_PIPELINE_HOP_FIRST;
+
+		if (!hop->next)
+			hop->flags |= KS_PIPELINE_HOP_LAST;
+
+		if (chan->to->ops->compile)
+			chan->to->ops->compile(chan->to, hop);
+
+		i++;
+	}
+
+	for (i = 0; i < num_hops; i++)
+		rcu_assign_pointer(compiled->hops[i].chan->hop,
+					&compiled->hops[i]);
+
+	rcu_assign_pointer(pipeline->compiled, compiled);
+	read_unlock_bh(&ks_connection_lock);
+
+	return 0;
+}
+
+/* Fast paths may still be running on the hops, their counters are folded
+ * into the pipeline's once they are done
+ */
+static void ks_pipeline_compiled_free(struct rcu_head *head)
+{
+	struct ks_pipeline_compiled *compiled =
+		container_of(head, struct ks_pipeline_compiled, rcu);
+	struct ks_pipeline *pipeline = compiled->pipeline;
+	int i;
+
+	spin_lock(&pipeline->stats_lock);
+	for (i = 0; i < compiled->num_hops; i++)
+		ks_pipeline_stats_add(&pipeline->stats,
+					&compiled->hops[i].stats);
+	spin_unlock(&pipeline->stats_lock);
+
+	ks_pipeline_put(pipeline);
+	kfree(compiled);
+}
+
+static void ks_pipeline_decompile(struct ks_pipeline *pipeline)
+{
+	struct ks_pipeline_compiled *compiled = pipeline->compiled;
+	int i;
+
+	if (!compiled)
+		return;
+
+	for (i = 0; i < compiled->num_hops; i++)
+		rcu_assign_pointer(compiled->hops[i].chan->hop, NULL);
+
+	rcu_assign_pointer(pipeline->compiled, NULL);
+
+	call_rcu(&compiled->rcu, ks_pipeline_compiled_free);
+}
+
 static void ks_pipeline_flowing_to_open(
 	struct ks_pipeline *pipeline,
 	struct ks_chan *stop_at)
@@ -986,6 +1222,8 @@ static void ks_pipeline_flowing_to_open(
 	struct ks_chan *chan;
 	struct ks_chan *prev_chan = NULL;
 
+	ks_pipeline_decompile(pipeline);
+
 	read_lock_bh(&ks_connection_lock);
 	list_for_each_entry(chan, &pipeline->entries, pipeline_entry) {
 
@@ -1020,6 +1258,11 @@ static int ks_pipeline_open_to_flowing(struct ks_pipeline *pipeline)
 	struct ks_chan *prev_chan = NULL;
 	int err;
 
+	/* Channels may push frames as soon as they are started */
+	err = ks_pipeline_compile(pipeline);
+	if (err < 0)
+		return err;
+
 	read_lock_bh(&ks_connection_lock);
 	list_for_each_entry(chan, &pipeline->entries, pipeline_entry) {
 
@@ -1210,6 +1453,28 @@ void ks_pipeline_stimulate(struct ks_pipeline *pipeline)
 }
 EXPORT_SYMBOL(ks_pipeline_stimulate);
 
+/* Returns nonzero if any element of the pipeline relies on being
+ * periodically stimulated to move data
+ */
+int ks_pipeline_needs_stimulus(struct ks_pipeline *pipeline)
+{
+	struct ks_chan *chan;
+	int res = 0;
+
+	read_lock_bh(&ks_connection_lock);
+	list_for_each_entry(chan, &pipeline->entries, pipeline_entry) {
+		if (chan->ops->stimulus || chan->from->ops->stimulus ||
+		    chan->to->ops->stimulus) {
+			res = 1;
+			break;
+		}
+	}
+	read_unlock_bh(&ks_connection_lock);
+
+	return res;
+}
+EXPORT_SYMBOL(ks_pipeline_needs_stimulus);
+
 struct ks_chan *ks_pipeline_prev(struct ks_chan *chan)
 {
 	// FIXME LOCKING!!!
@@ -1299,5 +1564,8 @@ err_kset_register:
 
 void ks_pipeline_modexit()
 {
+	/* Wait for ks_pipeline_compiled_free() */
+	rcu_barrier();
+
 	kset_unregister(ks_pipelines_kset);
 }
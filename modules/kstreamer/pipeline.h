@@ -21,6 +21,8 @@ enum ks_pipeline_attribute_type
 	KS_PIPELINEATTR_PATH,
 	KS_PIPELINEATTR_STATUS,
 	KS_PIPELINEATTR_CHAN_ID,
+	KS_PIPELINEATTR_STATS,
+	KS_PIPELINEATTR_HOP_STATS,
 };
 
 enum ks_pipeline_status
@@ -31,15 +33,93 @@ enum ks_pipeline_status
 	KS_PIPELINE_STATUS_FLOWING,
 };
 
+/* Bucket 0 counts the frames which reached a hop less than 1024ns after
+ * being stamped at the source, bucket n those between 2^(n-1) and 2^n
+ * times 1024ns, the last one everything slower.
+ */
+#define KS_PIPELINE_LATENCY_BUCKETS 16
+
+/* Underruns and latencies are only accounted while
+ * /sys/devices/ks-system/stats is enabled
+ */
+struct ks_pipeline_stats
+{
+	__u64 frames;
+	__u64 bytes;
+	__u64 drops;
+	__u64 underruns;
+
+	__u64 latency_sum;		/* ns */
+	__u64 latency_samples;
+	__u32 latency_max;		/* ns */
+	__u32 latency_hist[KS_PIPELINE_LATENCY_BUCKETS];
+	__u32 pad;			/* same size on 32 and 64 bit */
+};
+
+/* Carried by KS_PIPELINEATTR_HOP_STATS, one per channel while FLOWING */
+struct ks_pipeline_hop_stats
+{
+	__u32 chan_id;
+	__u32 latency_max;		/* ns */
+
+	__u64 frames;
+	__u64 bytes;
+	__u64 drops;
+	__u64 underruns;
+
+	__u64 latency_sum;		/* ns */
+	__u64 latency_samples;
+};
+
 #ifdef __KERNEL__
 
 #include <linux/kobject.h>
 #include <linux/list.h>
 #include <linux/rcupdate.h>
 #include <linux/rwsem.h>
+#include <linux/spinlock.h>
 
 extern rwlock_t ks_connection_lock;
 
+struct sk_buff;
+struct ks_streamframe;
+struct ks_chan;
+struct ks_pipeline;
+
+/* When a pipeline starts flowing it is compiled into a flat array of hops,
+ * one per channel, whose fast path is resolved once by the node the channel
+ * enters. Each channel reaches its own hop through chan->hop, under RCU,
+ * without walking the pipeline.
+ */
+
+#define KS_PIPELINE_HOP_FIRST	(1 << 0)
+#define KS_PIPELINE_HOP_LAST	(1 << 1)
+
+struct ks_pipeline_hop
+{
+	struct ks_chan *chan;
+	struct ks_chan *next;
+
+	unsigned long flags;
+
+	/* Filled in by the node's compile op */
+	int (*push_frame)(struct ks_chan *chan, struct sk_buff *skb);
+	int (*push_raw)(struct ks_chan *chan, struct ks_streamframe *sf);
+	int (*get_pressure)(struct ks_chan *chan);
+
+	/* Updated by the node's fast path only */
+	struct ks_pipeline_stats stats;
+};
+
+struct ks_pipeline_compiled
+{
+	struct rcu_head rcu;
+	struct ks_pipeline *pipeline;
+
+	int num_hops;
+	struct ks_pipeline_hop hops[0];
+};
+
 struct ks_pipeline
 {
 	struct kobject kobj;
@@ -51,6 +131,13 @@ struct ks_pipeline
 
 	struct list_head entries;
 
+	/* RCU protected, set while FLOWING */
+	struct ks_pipeline_compiled *compiled;
+
+	/* Counters of the previous compilations, under stats_lock */
+	spinlock_t stats_lock;
+	struct ks_pipeline_stats stats;
+
 	struct file *file;
 
 	int mtu;
@@ -103,6 +190,10 @@ static inline void ks_pipeline_put(struct ks_pipeline *pipeline)
 
 void ks_pipeline_dump(struct ks_pipeline *pipeline);
 
+void ks_pipeline_get_stats(
+	struct ks_pipeline *pipeline,
+	struct ks_pipeline_stats *stats);
+
 int ks_pipeline_cmd_new(
 	struct ks_netlink_state *state,
 	struct ks_command *cmd,
@@ -124,6 +215,7 @@ extern int ks_pipeline_change_status(
 	struct ks_pipeline *pipeline,
 	enum ks_pipeline_status status);
 extern void ks_pipeline_stimulate(struct ks_pipeline *pipeline);
+extern int ks_pipeline_needs_stimulus(struct ks_pipeline *pipeline);
 
 extern struct ks_chan *ks_pipeline_first_chan(
 		struct ks_pipeline *pipeline);
@@ -12,21 +12,204 @@
 
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/spinlock.h>
+#include <linux/device.h>
 
+#include "kstreamer.h"
+#include "kstreamer_priv.h"
 #include "streamframe.h"
 
+/* Every rx scheduler tick allocates and releases a frame per channel,
+ * released frames are kept here instead of going back to the allocator
+ */
+#define KS_SF_POOL_MAX 256
+
+static LIST_HEAD(ks_sf_pool);
+static int ks_sf_pool_len;
+static unsigned long ks_sf_pool_hits;
+static unsigned long ks_sf_pool_misses;
+static DEFINE_SPINLOCK(ks_sf_pool_lock);
+
+#ifdef DEBUG_CODE
+static atomic_t ks_sf_copies_hist[KS_SF_COPIES_BUCKETS];
+#endif
+
+/* Brings back an exclusively held frame to its just-allocated state */
+void ks_sf_reset(struct ks_streamframe *sf)
+{
+	sf->flags = KS_SF_EXCLUSIVE;
+#ifdef DEBUG_CODE
+	sf->copies = 0;
+#endif
+
+	sf->data = sf->head + KS_SF_HEADROOM;
+	sf->size = KS_SF_ALLOC_SIZE - sizeof(*sf) - KS_SF_HEADROOM;
+	sf->len = 0;
+
+	if (ks_stats_enabled())
+		sf->tstamp = ktime_get();
+	else
+		sf->tstamp = ktime_set(0, 0);
+}
+EXPORT_SYMBOL(ks_sf_reset);
+
 struct ks_streamframe *ks_sf_alloc(void)
 {
-	struct ks_streamframe *sf;
+	struct ks_streamframe *sf = NULL;
+	unsigned long flags;
 
-	sf = kmalloc(1024, GFP_ATOMIC);
-	if (!sf)
-		return NULL;
+	spin_lock_irqsave(&ks_sf_pool_lock, flags);
+	if (!list_empty(&ks_sf_pool)) {
+		sf = list_entry(ks_sf_pool.next, struct ks_streamframe, node);
+		list_del(&sf->node);
+		ks_sf_pool_len--;
+		ks_sf_pool_hits++;
+	} else
+		ks_sf_pool_misses++;
+	spin_unlock_irqrestore(&ks_sf_pool_lock, flags);
+
+	if (!sf) {
+		sf = kmalloc(KS_SF_ALLOC_SIZE, GFP_ATOMIC);
+		if (!sf)
+			return NULL;
+	}
 
 	atomic_set(&sf->refcnt, 1);
-	sf->size = 1024 - sizeof(*sf);
-	sf->len = 0;
+	INIT_LIST_HEAD(&sf->node);
+
+	ks_sf_reset(sf);
 
 	return sf;
 }
 EXPORT_SYMBOL(ks_sf_alloc);
+
+/* Called on the last put, the frame must not be on any queue */
+void ks_sf_free(struct ks_streamframe *sf)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ks_sf_pool_lock, flags);
+	if (ks_sf_pool_len < KS_SF_POOL_MAX) {
+		list_add(&sf->node, &ks_sf_pool);
+		ks_sf_pool_len++;
+		sf = NULL;
+	}
+	spin_unlock_irqrestore(&ks_sf_pool_lock, flags);
+
+	if (sf)
+		kfree(sf);
+}
+EXPORT_SYMBOL(ks_sf_free);
+
+/* Returns a frame which may be modified in place, either sf itself or a
+ * private copy of it. The reference to sf is consumed in any case, NULL is
+ * returned if the copy cannot be allocated. Callers holding a borrowed
+ * reference, such as push_raw handlers, ks_sf_get() it beforehand.
+ */
+struct ks_streamframe *ks_sf_unshare(struct ks_streamframe *sf)
+{
+	struct ks_streamframe *new_sf;
+
+	if (ks_sf_writable(sf))
+		return sf;
+
+	new_sf = ks_sf_alloc();
+	if (!new_sf) {
+		ks_sf_put(sf);
+		return NULL;
+	}
+
+	new_sf->data = new_sf->head + ks_sf_headroom(sf);
+	new_sf->size = sf->size;
+	new_sf->len = sf->len;
+	new_sf->tstamp = sf->tstamp;
+
+	memcpy(new_sf->data, sf->data, sf->len);
+
+#ifdef DEBUG_CODE
+	new_sf->copies = sf->copies;
+#endif
+	ks_sf_count_copy(new_sf);
+
+	ks_sf_put(sf);
+
+	return new_sf;
+}
+EXPORT_SYMBOL(ks_sf_unshare);
+
+#ifdef DEBUG_CODE
+void ks_sf_delivered(struct ks_streamframe *sf)
+{
+	atomic_inc(&ks_sf_copies_hist[
+			min_t(int, sf->copies, KS_SF_COPIES_BUCKETS - 1)]);
+}
+EXPORT_SYMBOL(ks_sf_delivered);
+#endif
+
+static ssize_t ks_sf_show_streamframes(
+	struct device *device,
+	struct device_attribute *attr,
+	char *buf)
+{
+	ssize_t len;
+#ifdef DEBUG_CODE
+	int i;
+#endif
+
+	spin_lock_irq(&ks_sf_pool_lock);
+	len = snprintf(buf, PAGE_SIZE,
+		"pool: %d\n"
+		"pool_hits: %lu\n"
+		"pool_misses: %lu\n",
+		ks_sf_pool_len,
+		ks_sf_pool_hits,
+		ks_sf_pool_misses);
+	spin_unlock_irq(&ks_sf_pool_lock);
+
+#ifdef DEBUG_CODE
+	/* Frames delivered to their final consumer by number of copies */
+	for (i=0; i<KS_SF_COPIES_BUCKETS; i++) {
+		len += snprintf(buf + len, PAGE_SIZE - len,
+			"copies_%d%s: %d\n",
+			i,
+			i == KS_SF_COPIES_BUCKETS - 1 ? "+" : "",
+			atomic_read(&ks_sf_copies_hist[i]));
+	}
+#endif
+
+	return len;
+}
+
+static DEVICE_ATTR(streamframes, S_IRUGO,
+		ks_sf_show_streamframes,
+		NULL);
+
+int ks_sf_modinit(void)
+{
+	int err;
+
+	err = device_create_file(&ks_system_device, &dev_attr_streamframes);
+	if (err < 0)
+		goto err_create_file_streamframes;
+
+	return 0;
+
+	device_remove_file(&ks_system_device, &dev_attr_streamframes);
+err_create_file_streamframes:
+
+	return err;
+}
+
+void ks_sf_modexit(void)
+{
+	struct ks_streamframe *sf, *t;
+
+	device_remove_file(&ks_system_device, &dev_attr_streamframes);
+
+	list_for_each_entry_safe(sf, t, &ks_sf_pool, node) {
+		list_del(&sf->node);
+		kfree(sf);
+	}
+
+	ks_sf_pool_len = 0;
+}
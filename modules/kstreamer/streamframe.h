@@ -20,18 +20,77 @@
 #else
 #include <linux/slab.h>
 #endif
+#include <linux/list.h>
+#include <linux/ktime.h>
 #include <asm/atomic.h>
 
+#define KS_SF_ALLOC_SIZE	1024
+
+/* Room reserved in front of the payload so that nodes may prepend octets
+ * without moving the data
+ */
+#define KS_SF_HEADROOM		16
+
+/* The payload is not referenced by anything but the frame itself, whoever
+ * holds the only reference may modify it in place. Producers that keep
+ * the frame around expecting the data to be preserved clear the flag.
+ */
+#define KS_SF_EXCLUSIVE		(1 << 0)
+
+#ifdef DEBUG_CODE
+#define KS_SF_COPIES_BUCKETS	4
+#endif
+
+/* In-place processing contract:
+ *
+ * - The producer fills data with at most size octets and pushes the frame
+ *   holding one reference.
+ * - A node in the path may modify data, len and the head/tailroom only if
+ *   ks_sf_writable(), otherwise it has to ks_sf_unshare() first.
+ *   push_raw handlers only borrow the caller's reference while
+ *   ks_sf_unshare() consumes one, so a handler takes its own with
+ *   ks_sf_get() first and puts the returned frame when done with it.
+ *   The extra reference makes the frame look shared, so this always
+ *   copies; a handler that can work on the borrowed frame tests
+ *   ks_sf_writable() before taking it.
+ * - A sink which needs the payload after push_raw returns takes a reference
+ *   instead of copying, and may keep the frame on a queue of its own thru
+ *   node; a frame is on one queue at most.
+ * - Every copy of the payload into a frame is accounted with
+ *   ks_sf_count_copy() and the final consumer reports the frame with
+ *   ks_sf_delivered(), so that debug builds may verify that the fast path
+ *   copies just once.
+ */
 struct ks_streamframe
 {
 	atomic_t refcnt;
+
+	u8 flags;
+#ifdef DEBUG_CODE
+	u8 copies;
+#endif
+
+	/* Octets available from data to the end of the buffer */
 	u16 size;
 	u16 len;
 
-	u8 data[0];
+	u8 *data;
+
+	struct list_head node;
+
+	/* When the source produced it, zero if stats were disabled */
+	ktime_t tstamp;
+
+	u8 head[0];
 };
 
 struct ks_streamframe *ks_sf_alloc(void);
+void ks_sf_reset(struct ks_streamframe *sf);
+void ks_sf_free(struct ks_streamframe *sf);
+struct ks_streamframe *ks_sf_unshare(struct ks_streamframe *sf);
+
+int ks_sf_modinit(void);
+void ks_sf_modexit(void);
 
 static inline struct ks_streamframe *ks_sf_get(
 		struct ks_streamframe *sf)
@@ -44,8 +103,59 @@ static inline struct ks_streamframe *ks_sf_get(
 static inline void ks_sf_put(struct ks_streamframe *sf)
 {
 	if (atomic_dec_and_test(&sf->refcnt))
-		kfree(sf);
+		ks_sf_free(sf);
+}
+
+static inline int ks_sf_writable(struct ks_streamframe *sf)
+{
+	return (sf->flags & KS_SF_EXCLUSIVE) &&
+		atomic_read(&sf->refcnt) == 1;
+}
+
+static inline unsigned int ks_sf_headroom(struct ks_streamframe *sf)
+{
+	return sf->data - sf->head;
+}
+
+static inline unsigned int ks_sf_tailroom(struct ks_streamframe *sf)
+{
+	return sf->size - sf->len;
+}
+
+/* Extends the payload len octets towards the head, the caller checks
+ * ks_sf_headroom()
+ */
+static inline u8 *ks_sf_push(struct ks_streamframe *sf, unsigned int len)
+{
+	sf->data -= len;
+	sf->size += len;
+	sf->len += len;
+
+	return sf->data;
 }
 
+/* Removes len octets from the head of the payload */
+static inline u8 *ks_sf_pull(struct ks_streamframe *sf, unsigned int len)
+{
+	sf->data += len;
+	sf->size -= len;
+	sf->len -= len;
+
+	return sf->data;
+}
+
+#ifdef DEBUG_CODE
+static inline void ks_sf_count_copy(struct ks_streamframe *sf)
+{
+	if (sf->copies < 0xff)
+		sf->copies++;
+}
+
+void ks_sf_delivered(struct ks_streamframe *sf);
+#else
+static inline void ks_sf_count_copy(struct ks_streamframe *sf) {}
+static inline void ks_sf_delivered(struct ks_streamframe *sf) {}
+#endif
+
 #endif
 #endif
@@ -268,6 +268,10 @@ static void lapd_sock_destruct(struct sock *sk)
 
 			sk_del_node_init(newsk);
 
+			if (new_dlc->lapd_sock->dev)
+				lapd_dev_dlc_hash_del(new_dlc->lapd_sock->dev,
+							new_dlc->lapd_sock);
+
 			sock_orphan(newsk);
 
 			sock_put(&lapd_sock->sk);
@@ -337,6 +341,9 @@ static int lapd_release(struct socket *sock)
 		write_lock_bh(&lapd_hash_lock);
 		sk_del_node_init(sk);
 		write_unlock_bh(&lapd_hash_lock);
+
+		if (lapd_sock->dev)
+			lapd_dev_dlc_hash_del(lapd_sock->dev, lapd_sock);
 	}
 
 	lapd_release_sock(lapd_sock);
@@ -1275,6 +1282,9 @@ static void lapd_unhash_timer(unsigned long data)
 	sk_del_node_init(sk);
 	write_unlock_bh(&lapd_hash_lock);
 
+	if (lapd_sock->dev)
+		lapd_dev_dlc_hash_del(lapd_sock->dev, lapd_sock);
+
 	sock_put(sk);
 }
 
@@ -1343,6 +1353,7 @@ struct lapd_sock *lapd_new_sock(
 	new_lapd_sock->usr_tme = NULL;
 
 	INIT_HLIST_HEAD(&new_lapd_sock->new_dlcs);
+	new_lapd_sock->dlc_hashed = FALSE;
 
 	lapd_datalink_state_init(new_lapd_sock);
 	new_lapd_sock->state = LAPD_DLS_4_TEI_ASSIGNED;
@@ -1976,6 +1987,7 @@ static int lapd_create(struct net *net, struct socket *sock, int protocol,int ke
 	lapd_datalink_state_init(lapd_sock);
 
 	INIT_HLIST_HEAD(&lapd_sock->new_dlcs);
+	lapd_sock->dlc_hashed = FALSE;
 
 	return 0;
 
@@ -371,8 +371,18 @@ static void lapd_run_i_queue(struct lapd_sock *lapd_sock)
 	       lapd_sock->v_s != (lapd_sock->v_a + lapd_sock->sap->k) % 128;
 	     skb = skb->next, sk->sk_send_head = skb) {
 
-		struct lapd_data_hdr_e *hdr =
-			(struct lapd_data_hdr_e *)skb->data;
+		struct lapd_data_hdr_e *hdr;
+		struct sk_buff *tx_skb;
+
+		/* The frame stays on the write queue until acknowledged and
+		 * only a clone is handed to the device. The original never
+		 * touches the space in front of its data, release it so
+		 * that the clone may push its header without a copy.
+		 */
+		if (!skb->nohdr)
+			skb_header_release(skb);
+
+		hdr = (struct lapd_data_hdr_e *)skb->data;
 
 		BUG_ON(!hdr);
 
@@ -383,15 +393,16 @@ static void lapd_run_i_queue(struct lapd_sock *lapd_sock)
 			"Transmitting i-frame N(S)=%d\n",
 			hdr->i.n_s);
 
+		tx_skb = skb_clone(skb, GFP_ATOMIC);
+		if (!tx_skb)
+			break;
+
 		if (!timer_pending(&lapd_sock->timer_T200)) {
 			lapd_start_timer(lapd_sock, T200);
 			lapd_stop_timer(lapd_sock, T203);
 		}
 
-		/* We need to copy the datagram because we will
-		 * change N(S) and N(R) in the future
-		 */
-		lapd_ph_data_request(skb_copy(skb, GFP_ATOMIC));
+		lapd_ph_data_request(tx_skb);
 
 		lapd_sock->v_s = (lapd_sock->v_s + 1) % 128;
 	}
@@ -16,6 +16,7 @@
 
 #include <linux/kernel.h>
 #include <linux/skbuff.h>
+#include <linux/rcupdate.h>
 #include <linux/tcp.h>
 
 #include "lapd.h"
@@ -48,6 +49,104 @@ struct lapd_device *lapd_dev_get_by_name(const char *name)
 	}
 }
 
+static void lapd_dev_dlc_rcu_put(struct rcu_head *head)
+{
+	struct lapd_sock *lapd_sock =
+		container_of(head, struct lapd_sock, dlc_rcu);
+
+	sock_put(&lapd_sock->sk);
+}
+
+/*
+ * The hash holds a reference to the socket, released only after a grace
+ * period so that lookups in lapd_rcv() may use the socket without taking
+ * lapd_hash_lock.
+ */
+
+void lapd_dev_dlc_hash_add(
+	struct lapd_device *dev,
+	struct lapd_sock *lapd_sock)
+{
+	sock_hold(&lapd_sock->sk);
+
+	spin_lock_bh(&dev->dlc_hash_lock);
+	hlist_add_head_rcu(&lapd_sock->dlc_node,
+		lapd_dev_dlc_hash(dev, lapd_sock->sapi, lapd_sock->tei));
+	lapd_sock->dlc_hashed = TRUE;
+	spin_unlock_bh(&dev->dlc_hash_lock);
+}
+
+void lapd_dev_dlc_hash_del(
+	struct lapd_device *dev,
+	struct lapd_sock *lapd_sock)
+{
+	spin_lock_bh(&dev->dlc_hash_lock);
+
+	if (!lapd_sock->dlc_hashed) {
+		spin_unlock_bh(&dev->dlc_hash_lock);
+		return;
+	}
+
+	hlist_del_rcu(&lapd_sock->dlc_node);
+	lapd_sock->dlc_hashed = FALSE;
+	spin_unlock_bh(&dev->dlc_hash_lock);
+
+	call_rcu(&lapd_sock->dlc_rcu, lapd_dev_dlc_rcu_put);
+}
+
+static void lapd_dev_dlc_hash_flush(struct lapd_device *dev)
+{
+	int i;
+
+	spin_lock_bh(&dev->dlc_hash_lock);
+	for (i=0; i<ARRAY_SIZE(dev->dlc_hash); i++) {
+		while (!hlist_empty(&dev->dlc_hash[i])) {
+			struct lapd_sock *lapd_sock =
+				hlist_entry(dev->dlc_hash[i].first,
+					struct lapd_sock, dlc_node);
+
+			hlist_del_rcu(&lapd_sock->dlc_node);
+			lapd_sock->dlc_hashed = FALSE;
+
+			call_rcu(&lapd_sock->dlc_rcu, lapd_dev_dlc_rcu_put);
+		}
+	}
+	spin_unlock_bh(&dev->dlc_hash_lock);
+}
+
+/* The lapd_device is reallocated on every NETDEV_UP, sockets still bound
+ * to the interface are pointed to the new one and their DLCs hashed again
+ */
+static void lapd_dev_dlc_hash_rebuild(struct lapd_device *dev)
+{
+	struct sock *sk;
+	struct hlist_node *node;
+
+	write_lock_bh(&lapd_hash_lock);
+	sk_for_each(sk, node, lapd_get_hash(dev)) {
+		struct lapd_sock *lapd_sock = to_lapd_sock(sk);
+
+		if (sk->sk_bound_dev_if != dev->dev->ifindex)
+			continue;
+
+		/* The netdev reference held thru the old one carries over */
+		lapd_sock->dev = dev;
+
+		if (lapd_sock->sapi == LAPD_SAPI_Q931)
+			lapd_sock->sap = &dev->q931;
+		else if (lapd_sock->sapi == LAPD_SAPI_X25)
+			lapd_sock->sap = &dev->x25;
+
+		if (dev->role != LAPD_INTF_ROLE_NT ||
+		    sk->sk_state == LAPD_SK_STATE_LISTEN ||
+		    lapd_sock->dlc_hashed)
+			continue;
+
+		lapd_dev_dlc_hash_add(dev, lapd_sock);
+	}
+	write_unlock_bh(&lapd_hash_lock);
+}
+
 static void lapd_device_up(struct net_device *dev)
 {
 #if LINUX_VERSION_CODE <  KERNEL_VERSION(2,6,31)
@@ -74,6 +173,14 @@ static void lapd_device_up(struct net_device *dev)
 	spin_lock_init(&lapd_device->out_queue_lock);
 	skb_queue_head_init(&lapd_device->out_queue);
 
+	{
+	int i;
+	for (i=0; i<ARRAY_SIZE(lapd_device->dlc_hash); i++)
+		INIT_HLIST_HEAD(&lapd_device->dlc_hash[i]);
+	}
+
+	spin_lock_init(&lapd_device->dlc_hash_lock);
+
 	/* TODO FIXME use the correct pointer XXX */
 	dev->atalk_ptr = lapd_device;
 
@@ -119,6 +226,8 @@ static void lapd_device_up(struct net_device *dev)
 	lapd_device->x25.N201 = 260;
 	lapd_device->x25.T200 = 1 * HZ;
 	lapd_device->x25.T203 = 10 * HZ;
+
+	lapd_dev_dlc_hash_rebuild(lapd_device);
 }
 
 static void lapd_kill_by_device(struct lapd_device *dev)
@@ -156,6 +265,8 @@ static void lapd_device_down(struct net_device *dev)
 
 	if (lapd_device) {
 
+		lapd_dev_dlc_hash_flush(lapd_device);
+
 		lapd_out_queue_drop(lapd_device);
 
 		if (lapd_device->net_tme) {
@@ -167,6 +278,10 @@ static void lapd_device_down(struct net_device *dev)
 		}
 
 		dev->atalk_ptr = NULL;
+
+		/* Wait for lapd_rcv() readers still walking dlc_hash */
+		synchronize_rcu();
+
 		dev_put(dev);
 		kfree(lapd_device);
 	}
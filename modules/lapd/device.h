@@ -39,6 +39,9 @@ enum lapd_l1_state
 	LAPD_L1_STATE_ACTIVATING,
 };
 
+#define LAPD_DLC_HASHBITS	5
+#define LAPD_DLC_HASHSIZE	(1 << LAPD_DLC_HASHBITS)
+
 struct lapd_device
 {
 	struct net_device *dev;
@@ -54,6 +57,10 @@ struct lapd_device
 	enum lapd_l1_state l1_state;
 	struct sk_buff_head out_queue;
 	spinlock_t out_queue_lock;
+
+	/* NT-side DLC sockets indexed by SAPI/TEI, looked up under RCU */
+	struct hlist_head dlc_hash[LAPD_DLC_HASHSIZE];
+	spinlock_t dlc_hash_lock;
 };
 
 int lapd_device_event(struct notifier_block *this,
@@ -61,6 +68,19 @@ int lapd_device_event(struct notifier_block *this,
 
 struct lapd_device *lapd_dev_get_by_name(const char *name);
 
+void lapd_dev_dlc_hash_add(
+	struct lapd_device *dev,
+	struct lapd_sock *lapd_sock);
+void lapd_dev_dlc_hash_del(
+	struct lapd_device *dev,
+	struct lapd_sock *lapd_sock);
+
+static inline struct hlist_head *lapd_dev_dlc_hash(
+	struct lapd_device *dev, int sapi, int tei)
+{
+	return &dev->dlc_hash[(tei ^ (sapi << 2)) & (LAPD_DLC_HASHSIZE - 1)];
+}
+
 static inline void lapd_dev_get(struct lapd_device *dev)
 {
 	dev_hold(dev->dev);
@@ -16,6 +16,7 @@
 
 #include <linux/kernel.h>
 #include <linux/tcp.h>
+#include <linux/rcupdate.h>
 
 #include "lapd.h"
 #include "input.h"
@@ -118,22 +119,75 @@ static void lapd_handle_socketless_frame(struct sk_buff *skb)
  * lapd_pass_frame_to_socket_nt() handles an incoming frame, searches
  * the appropriate socket and creates a new socket if not found.
  *
+ * Established DLCs are looked up in the per-device SAPI/TEI hash under
+ * RCU; lapd_hash_lock is only taken (as a writer) when no DLC exists yet
+ * and a new socket has to be spawned from the listening one.
+ *
  * Frames are serialized when relative to the same socket
  */
 
+static struct lapd_sock *lapd_dev_dlc_lookup_rcu(
+	struct lapd_device *dev,
+	int sapi, int tei)
+{
+	struct lapd_sock *lapd_sock;
+	struct hlist_node *node;
+
+	hlist_for_each_entry_rcu(lapd_sock, node,
+			lapd_dev_dlc_hash(dev, sapi, tei), dlc_node) {
+		if (lapd_sock->sapi == sapi &&
+		    lapd_sock->tei == tei)
+			return lapd_sock;
+	}
+
+	return NULL;
+}
+
 static int lapd_pass_frame_to_socket_nt(
 	struct sk_buff *skb)
 {
 	struct lapd_sock *listening_lapd_sock = NULL;
+	struct lapd_sock *lapd_sock;
 	struct sock *sk = NULL;
 	struct hlist_node *node;
 	struct lapd_data_hdr *hdr = (struct lapd_data_hdr *)skb->data;
 	struct lapd_device *dev = to_lapd_dev(skb->dev);
 	int queued = 0;
 
+	rcu_read_lock();
+	lapd_sock = lapd_dev_dlc_lookup_rcu(dev,
+			hdr->addr.sapi, hdr->addr.tei);
+	if (lapd_sock) {
+		skb->sk = &lapd_sock->sk;
+
+		queued = lapd_pass_frame_to_socket(lapd_sock, skb);
+
+		rcu_read_unlock();
+
+		return queued;
+	}
+	rcu_read_unlock();
+
 	write_lock_bh(&lapd_hash_lock);
+
+	/* Somebody may have created the DLC while we were unlocked */
+	lapd_sock = lapd_dev_dlc_lookup_rcu(dev,
+			hdr->addr.sapi, hdr->addr.tei);
+	if (lapd_sock) {
+		skb->sk = &lapd_sock->sk;
+
+		sock_hold(&lapd_sock->sk);
+		write_unlock_bh(&lapd_hash_lock);
+
+		queued = lapd_pass_frame_to_socket(lapd_sock, skb);
+
+		sock_put(&lapd_sock->sk);
+
+		return queued;
+	}
+
 	sk_for_each(sk, node, lapd_get_hash(dev)) {
-		struct lapd_sock *lapd_sock = to_lapd_sock(sk);
+		lapd_sock = to_lapd_sock(sk);
 
 		if (lapd_sock->dev == dev) {
 
@@ -142,6 +196,7 @@ static int lapd_pass_frame_to_socket_nt(
 				continue;
 			}
 
+			/* Sockets not spawned by the listener (not hashed) */
 			if (lapd_sock->sapi == hdr->addr.sapi &&
 			    lapd_sock->tei == hdr->addr.tei) {
 
@@ -149,17 +204,14 @@ static int lapd_pass_frame_to_socket_nt(
 
 				write_unlock_bh(&lapd_hash_lock);
 
-				queued = lapd_pass_frame_to_socket(
+				return lapd_pass_frame_to_socket(
 						lapd_sock, skb);
-
-				goto frame_handled;
 			}
 		}
 	}
 
 	if (listening_lapd_sock) {
 		/* A socket has not been found */
-		struct lapd_data_hdr *hdr = (struct lapd_data_hdr *)skb->data;
 		struct lapd_sock *new_lapd_sock;
 
 		if (hdr->addr.sapi != LAPD_SAPI_Q931 &&
@@ -178,6 +230,7 @@ static int lapd_pass_frame_to_socket_nt(
 		}
 
 		sk_add_node(&new_lapd_sock->sk, lapd_get_hash(dev));
+		lapd_dev_dlc_hash_add(dev, new_lapd_sock);
 		write_unlock_bh(&lapd_hash_lock);
 
 		skb->sk = &new_lapd_sock->sk;
@@ -204,8 +257,6 @@ static int lapd_pass_frame_to_socket_nt(
 		write_unlock_bh(&lapd_hash_lock);
 	}
 
-frame_handled:
-
 	return queued;
 }
 
@@ -304,6 +304,11 @@ struct lapd_sock
 	int sapi;
 
 	struct hlist_head new_dlcs;
+
+	/* Membership in dev->dlc_hash */
+	struct hlist_node dlc_node;
+	struct rcu_head dlc_rcu;
+	int dlc_hashed;
 };
 
 #define to_lapd_sock(obj) container_of(obj, struct lapd_sock, sk)
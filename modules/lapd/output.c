@@ -20,6 +20,46 @@
 #include "tei_mgmt_nt.h"
 #include "tei_mgmt_te.h"
 
+/* Frames kept on the write queue for retransmission are sent as clones.
+ * The queued original has released its header (see lapd_run_i_queue()),
+ * so only the clone's header needs to be private before the primitive
+ * header is pushed; the payload stays shared.
+ */
+static int lapd_frame_ph_data(
+	struct lapd_device *dev,
+	struct sk_buff *skb)
+{
+	struct lapd_prim_hdr *prim_hdr;
+	int err;
+
+	err = skb_cow_head(skb, sizeof(struct lapd_prim_hdr));
+	if (err < 0) {
+		lapd_msg_dev(dev, KERN_ERR,
+			"skb_cow_head: %d\n", err);
+		return err;
+	}
+
+	/* The CRC placeholder is never read back, but fall back to a
+	 * reallocation if the buffer has no room left for it
+	 */
+	if (skb_tailroom(skb) < sizeof(u16)) {
+		err = pskb_expand_head(skb, 0, sizeof(u16), GFP_ATOMIC);
+		if (err < 0) {
+			lapd_msg_dev(dev, KERN_ERR,
+				"pskb_expand_head: %d\n", err);
+			return err;
+		}
+	}
+
+	skb_push(skb, sizeof(struct lapd_prim_hdr));
+	prim_hdr = (struct lapd_prim_hdr *)skb->data;
+	prim_hdr->primitive_type = LAPD_PH_DATA_REQUEST;
+
+	memset(skb_put(skb, sizeof(u16)), 0, sizeof(u16));
+
+	return 0;
+}
+
 void lapd_out_queue_flush(struct lapd_device *dev)
 {
 	struct sk_buff *skb;
@@ -27,13 +67,10 @@ void lapd_out_queue_flush(struct lapd_device *dev)
 	spin_lock_bh(&dev->out_queue_lock);
 
 	while ((skb = skb_dequeue(&dev->out_queue))) {
-		struct lapd_prim_hdr *prim_hdr;
-
-		skb_push(skb, sizeof(struct lapd_prim_hdr));
-		prim_hdr = (struct lapd_prim_hdr *)skb->data;
-		prim_hdr->primitive_type = LAPD_PH_DATA_REQUEST;
-
-		memset(skb_put(skb, sizeof(u16)), 0, sizeof(u16));
+		if (lapd_frame_ph_data(dev, skb) < 0) {
+			kfree_skb(skb);
+			continue;
+		}
 
 		dev_queue_xmit(skb);
 	}
@@ -102,14 +139,11 @@ void lapd_ph_data_request(struct sk_buff *skb)
 		spin_unlock_bh(&dev->out_queue_lock);
 	break;
 
-	case LAPD_L1_STATE_AVAILABLE: {
-		struct lapd_prim_hdr *prim_hdr;
-
-		skb_push(skb, sizeof(struct lapd_prim_hdr));
-		prim_hdr = (struct lapd_prim_hdr *)skb->data;
-		prim_hdr->primitive_type = LAPD_PH_DATA_REQUEST;
-
-		memset(skb_put(skb, sizeof(u16)), 0, sizeof(u16));
+	case LAPD_L1_STATE_AVAILABLE:
+		if (lapd_frame_ph_data(dev, skb) < 0) {
+			kfree_skb(skb);
+			break;
+		}
 
 		err = dev_queue_xmit(skb);
 		if (err < 0) {
@@ -119,7 +153,6 @@ void lapd_ph_data_request(struct sk_buff *skb)
 
 			kfree_skb(skb);
 		}
-	}
 	break;
 	}
 }
@@ -0,0 +1,103 @@
+/*
+ * Software loopback card
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#ifndef _KS_LOOPBACK_H
+#define _KS_LOOPBACK_H
+
+#ifdef __KERNEL__
+
+#include <linux/spinlock.h>
+
+#if LINUX_VERSION_CODE <= KERNEL_VERSION(2,6,9)
+#include <compat/kfifo.h>
+#else
+#include <linux/kfifo.h>
+#endif
+
+#include <linux/kstreamer/node.h>
+#include <linux/kstreamer/channel.h>
+#include <linux/kstreamer/softswitch.h>
+
+#define lb_MODULE_NAME "ks-loopback"
+#define lb_MODULE_PREFIX lb_MODULE_NAME ": "
+#define lb_MODULE_DESCR "kstreamer software loopback card"
+
+#define LB_FIFO_SIZE 1024
+#define LB_RX_SCHED_FREQUENCY 50
+
+struct lb_card;
+
+/* Every channel echoes whatever is written to its "tx" ks_chan back out of
+ * its "rx" ks_chan. The RX side is drained by the card's RX scheduler just
+ * like the FIFOs of a real streaming card, so this module can be used to
+ * exercise pipelines and the scheduler without hardware.
+ *
+ * With bench_octets set, every started RX channel is fed that many octets
+ * at each scheduler run, so the scheduler can be measured at full load
+ * with num_chans channels and nothing writing to the tx side. Writing to
+ * the rx_sched attribute resets the scheduler statistics.
+ */
+struct lb_chan
+{
+	struct lb_card *card;
+	int id;
+
+	struct ks_node ks_node;
+
+	struct ks_chan tx_chan;
+	struct ks_chan rx_chan;
+
+	struct kfifo *fifo;
+	struct kss_rx_sched_entry sched_entry;
+	int rx_started;
+
+	unsigned long tx_octets;
+	unsigned long tx_overruns;
+	unsigned long rx_octets;
+};
+
+struct lb_card
+{
+	spinlock_t lock;
+
+	struct kss_rx_sched rx_sched;
+
+	int num_chans;
+	struct lb_chan *chans;
+};
+
+#if defined(DEBUG_CODE) && defined(DEBUG_DEFAULTS)
+#define lb_debug(dbglevel, format, arg...)			\
+	if (debug_level >= dbglevel)				\
+		printk(KERN_DEBUG lb_MODULE_PREFIX		\
+			format,					\
+			## arg)
+#else
+#define lb_debug(format, arg...) do {} while (0)
+#endif
+
+#define lb_msg(level, format, arg...)				\
+	printk(level lb_MODULE_PREFIX				\
+		format,						\
+		## arg)
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#endif
+
+#endif
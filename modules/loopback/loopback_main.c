@@ -0,0 +1,638 @@
+/*
+ * Software loopback card
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/list.h>
+#include <linux/slab.h>
+
+#include <linux/kstreamer/kstreamer.h>
+#include <linux/kstreamer/node.h>
+#include <linux/kstreamer/pipeline.h>
+#include <linux/kstreamer/streamframe.h>
+#include <linux/kstreamer/softswitch.h>
+
+#include "loopback.h"
+
+#if LINUX_VERSION_CODE <= KERNEL_VERSION(2,6,9)
+#include <compat/kfifo_code.h>
+#endif
+
+#ifdef DEBUG_CODE
+#ifdef DEBUG_DEFAULTS
+int debug_level = 3;
+#else
+int debug_level = 0;
+#endif
+#endif
+
+static int num_chans = 4;
+static int bench_octets;
+static u8 lb_bench_pattern[LB_FIFO_SIZE];
+
+static struct lb_card *lb_card;
+
+/*---------------------------------------------------------------------------*/
+
+static struct kfifo *lb_fifo_alloc(struct lb_card *card)
+{
+	struct kfifo *fifo;
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,33)
+	fifo = kfifo_alloc(LB_FIFO_SIZE, GFP_KERNEL, &card->lock);
+	if (IS_ERR(fifo))
+		return NULL;
+#else
+	fifo = kmalloc(sizeof(*fifo), GFP_KERNEL);
+	if (!fifo)
+		return NULL;
+
+	if (kfifo_alloc(fifo, LB_FIFO_SIZE, GFP_KERNEL) < 0) {
+		kfree(fifo);
+		return NULL;
+	}
+#endif
+
+	return fifo;
+}
+
+static void lb_fifo_free(struct kfifo *fifo)
+{
+	kfifo_free(fifo);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,33)
+	kfree(fifo);
+#endif
+}
+
+/* Card lock must be held */
+static unsigned int lb_fifo_put(struct kfifo *fifo, u8 *buf, unsigned int len)
+{
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,33)
+	return __kfifo_put(fifo, buf, len);
+#else
+	return kfifo_in(fifo, buf, len);
+#endif
+}
+
+/* Card lock must be held */
+static unsigned int lb_fifo_get(struct kfifo *fifo, u8 *buf, unsigned int len)
+{
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,33)
+	return __kfifo_get(fifo, buf, len);
+#else
+	return kfifo_out(fifo, buf, len);
+#endif
+}
+
+/* Card lock must be held */
+static void lb_fifo_reset(struct kfifo *fifo)
+{
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,33)
+	__kfifo_reset(fifo);
+#else
+	kfifo_reset(fifo);
+#endif
+}
+
+/*---------------------------------------------------------------------------*/
+
+static ssize_t lb_show_rx_sched(
+	struct ks_node *ks_node,
+	struct ks_node_attribute *attr,
+	char *buf)
+{
+	struct lb_chan *chan = container_of(ks_node, struct lb_chan, ks_node);
+
+	return kss_rx_sched_show_stats(&chan->card->rx_sched, buf);
+}
+
+static ssize_t lb_store_rx_sched(
+	struct ks_node *ks_node,
+	struct ks_node_attribute *attr,
+	const char *buf,
+	size_t count)
+{
+	struct lb_chan *chan = container_of(ks_node, struct lb_chan, ks_node);
+
+	kss_rx_sched_reset_stats(&chan->card->rx_sched);
+
+	return count;
+}
+
+static KS_NODE_ATTR(rx_sched, S_IRUGO | S_IWUSR,
+		lb_show_rx_sched,
+		lb_store_rx_sched);
+
+static ssize_t lb_show_counters(
+	struct ks_node *ks_node,
+	struct ks_node_attribute *attr,
+	char *buf)
+{
+	struct lb_chan *chan = container_of(ks_node, struct lb_chan, ks_node);
+	ssize_t len;
+
+	spin_lock_bh(&chan->card->lock);
+	len = snprintf(buf, PAGE_SIZE,
+		"tx_octets: %lu\n"
+		"tx_overruns: %lu\n"
+		"rx_octets: %lu\n",
+		chan->tx_octets,
+		chan->tx_overruns,
+		chan->rx_octets);
+	spin_unlock_bh(&chan->card->lock);
+
+	return len;
+}
+
+static KS_NODE_ATTR(counters, S_IRUGO,
+		lb_show_counters,
+		NULL);
+
+/*---------------------------------------------------------------------------*/
+
+static void lb_node_release(struct ks_node *ks_node)
+{
+	lb_debug(3, "lb_node_release()\n");
+}
+
+static struct ks_node_ops lb_chan_node_ops = {
+	.owner		= THIS_MODULE,
+
+	.release	= lb_node_release,
+};
+
+/*---------------------------------------------------------------------------*/
+
+static void lb_tx_chan_release(struct ks_chan *ks_chan)
+{
+	lb_debug(3, "lb_tx_chan_release()\n");
+}
+
+static int lb_tx_chan_connect(struct ks_chan *ks_chan)
+{
+	lb_debug(3, "lb_tx_chan_connect()\n");
+
+	return 0;
+}
+
+static void lb_tx_chan_disconnect(struct ks_chan *ks_chan)
+{
+	lb_debug(3, "lb_tx_chan_disconnect()\n");
+}
+
+static int lb_tx_chan_open(struct ks_chan *ks_chan)
+{
+	lb_debug(3, "lb_tx_chan_open()\n");
+
+	return 0;
+}
+
+static void lb_tx_chan_close(struct ks_chan *ks_chan)
+{
+	lb_debug(3, "lb_tx_chan_close()\n");
+}
+
+static int lb_tx_chan_start(struct ks_chan *ks_chan)
+{
+	lb_debug(3, "lb_tx_chan_start()\n");
+
+	return 0;
+}
+
+static void lb_tx_chan_stop(struct ks_chan *ks_chan)
+{
+	struct lb_chan *chan = container_of(ks_chan, struct lb_chan, tx_chan);
+
+	lb_debug(3, "lb_tx_chan_stop()\n");
+
+	spin_lock_bh(&chan->card->lock);
+	lb_fifo_reset(chan->fifo);
+	spin_unlock_bh(&chan->card->lock);
+}
+
+static struct ks_chan_ops lb_tx_chan_ops = {
+	.owner		= THIS_MODULE,
+
+	.release	= lb_tx_chan_release,
+	.connect	= lb_tx_chan_connect,
+	.disconnect	= lb_tx_chan_disconnect,
+	.open		= lb_tx_chan_open,
+	.close		= lb_tx_chan_close,
+	.start		= lb_tx_chan_start,
+	.stop		= lb_tx_chan_stop,
+};
+
+static int lb_tx_chan_push_raw(
+	struct ks_chan *ks_chan,
+	struct ks_streamframe *sf)
+{
+	struct lb_chan *chan = container_of(ks_chan, struct lb_chan, tx_chan);
+	unsigned int copied;
+
+	spin_lock_bh(&chan->card->lock);
+	copied = lb_fifo_put(chan->fifo, sf->data, sf->len);
+
+	chan->tx_octets += copied;
+	if (copied < sf->len)
+		chan->tx_overruns++;
+	spin_unlock_bh(&chan->card->lock);
+
+	return 0;
+}
+
+static int lb_tx_chan_get_pressure(struct ks_chan *ks_chan)
+{
+	struct lb_chan *chan = container_of(ks_chan, struct lb_chan, tx_chan);
+	int pressure;
+
+	spin_lock_bh(&chan->card->lock);
+	pressure = kfifo_len(chan->fifo);
+	spin_unlock_bh(&chan->card->lock);
+
+	return pressure;
+}
+
+static struct kss_chan_from_ops lb_tx_chan_node_ops = {
+	.push_raw	= lb_tx_chan_push_raw,
+	.get_pressure	= lb_tx_chan_get_pressure,
+};
+
+/*---------------------------------------------------------------------------*/
+
+static void lb_rx_chan_release(struct ks_chan *ks_chan)
+{
+	lb_debug(3, "lb_rx_chan_release()\n");
+}
+
+static int lb_rx_chan_connect(struct ks_chan *ks_chan)
+{
+	lb_debug(3, "lb_rx_chan_connect()\n");
+
+	return 0;
+}
+
+static void lb_rx_chan_disconnect(struct ks_chan *ks_chan)
+{
+	lb_debug(3, "lb_rx_chan_disconnect()\n");
+}
+
+static int lb_rx_chan_open(struct ks_chan *ks_chan)
+{
+	lb_debug(3, "lb_rx_chan_open()\n");
+
+	return 0;
+}
+
+static void lb_rx_chan_close(struct ks_chan *ks_chan)
+{
+	lb_debug(3, "lb_rx_chan_close()\n");
+}
+
+static int lb_rx_chan_start(struct ks_chan *ks_chan)
+{
+	struct lb_chan *chan = container_of(ks_chan, struct lb_chan, rx_chan);
+
+	lb_debug(3, "lb_rx_chan_start()\n");
+
+	spin_lock_bh(&chan->card->lock);
+	chan->rx_started = TRUE;
+	spin_unlock_bh(&chan->card->lock);
+
+	kss_rx_sched_add(&chan->card->rx_sched, &chan->sched_entry, ks_chan);
+
+	return 0;
+}
+
+static void lb_rx_chan_stop(struct ks_chan *ks_chan)
+{
+	struct lb_chan *chan = container_of(ks_chan, struct lb_chan, rx_chan);
+
+	lb_debug(3, "lb_rx_chan_stop()\n");
+
+	kss_rx_sched_del(&chan->card->rx_sched, &chan->sched_entry);
+
+	spin_lock_bh(&chan->card->lock);
+	chan->rx_started = FALSE;
+	spin_unlock_bh(&chan->card->lock);
+}
+
+static struct ks_chan_ops lb_rx_chan_ops = {
+	.owner		= THIS_MODULE,
+
+	.release	= lb_rx_chan_release,
+	.connect	= lb_rx_chan_connect,
+	.disconnect	= lb_rx_chan_disconnect,
+	.open		= lb_rx_chan_open,
+	.close		= lb_rx_chan_close,
+	.start		= lb_rx_chan_start,
+	.stop		= lb_rx_chan_stop,
+};
+
+/*---------------------------------------------------------------------------*/
+
+static void lb_card_rx_sched_lock(struct kss_rx_sched *sched)
+{
+	struct lb_card *card = sched->driver_data;
+
+	spin_lock_bh(&card->lock);
+}
+
+static void lb_card_rx_sched_unlock(struct kss_rx_sched *sched)
+{
+	struct lb_card *card = sched->driver_data;
+
+	spin_unlock_bh(&card->lock);
+}
+
+/* Called by the RX scheduler with the card lock held, feeds the started
+ * channels when benchmarking
+ */
+static void lb_card_rx_prepare(struct kss_rx_sched *sched)
+{
+	struct lb_card *card = sched->driver_data;
+	int i;
+
+	if (bench_octets <= 0)
+		return;
+
+	for (i = 0; i < card->num_chans; i++) {
+		struct lb_chan *chan = &card->chans[i];
+
+		if (!chan->rx_started)
+			continue;
+
+		lb_fifo_put(chan->fifo, lb_bench_pattern,
+			min(bench_octets, LB_FIFO_SIZE));
+	}
+}
+
+/* Called by the RX scheduler with the card lock held */
+static void lb_card_rx_drain(
+	struct kss_rx_sched *sched,
+	struct ks_chan *ks_chan,
+	struct ks_streamframe *sf)
+{
+	struct lb_chan *chan = container_of(ks_chan, struct lb_chan, rx_chan);
+
+	sf->len = lb_fifo_get(chan->fifo, sf->data, sf->size);
+
+	chan->rx_octets += sf->len;
+}
+
+static struct kss_rx_sched_ops lb_card_rx_sched_ops = {
+	.lock		= lb_card_rx_sched_lock,
+	.unlock		= lb_card_rx_sched_unlock,
+	.prepare	= lb_card_rx_prepare,
+	.drain		= lb_card_rx_drain,
+};
+
+/*---------------------------------------------------------------------------*/
+
+static int lb_chan_create(
+	struct lb_chan *chan,
+	struct lb_card *card,
+	int id)
+{
+	memset(chan, 0, sizeof(*chan));
+
+	chan->card = card;
+	chan->id = id;
+
+	chan->fifo = lb_fifo_alloc(card);
+	if (!chan->fifo)
+		return -ENOMEM;
+
+	ks_node_create(&chan->ks_node, &lb_chan_node_ops, "loopback",
+			&ks_system_device.kobj);
+	kobject_set_name(&chan->ks_node.kobj, "loopback%d", id);
+
+	ks_chan_create(&chan->tx_chan, &lb_tx_chan_ops, "tx", NULL,
+			&chan->ks_node.kobj,
+			&kss_softswitch.ks_node,
+			&chan->ks_node);
+	chan->tx_chan.from_ops = &lb_tx_chan_node_ops;
+
+	ks_chan_create(&chan->rx_chan, &lb_rx_chan_ops, "rx", NULL,
+			&chan->ks_node.kobj,
+			&chan->ks_node,
+			&kss_softswitch.ks_node);
+
+	return 0;
+}
+
+static void lb_chan_destroy(struct lb_chan *chan)
+{
+	lb_fifo_free(chan->fifo);
+}
+
+static int lb_chan_register(struct lb_chan *chan)
+{
+	int err;
+
+	err = ks_node_register(&chan->ks_node);
+	if (err < 0)
+		goto err_node_register;
+
+	err = ks_node_create_file(&chan->ks_node, &ks_node_attr_rx_sched);
+	if (err < 0)
+		goto err_create_file_rx_sched;
+
+	err = ks_node_create_file(&chan->ks_node, &ks_node_attr_counters);
+	if (err < 0)
+		goto err_create_file_counters;
+
+	err = ks_chan_register(&chan->tx_chan);
+	if (err < 0)
+		goto err_tx_chan_register;
+
+	err = ks_chan_register(&chan->rx_chan);
+	if (err < 0)
+		goto err_rx_chan_register;
+
+	return 0;
+
+	ks_chan_unregister(&chan->rx_chan);
+err_rx_chan_register:
+	ks_chan_unregister(&chan->tx_chan);
+err_tx_chan_register:
+	ks_node_remove_file(&chan->ks_node, &ks_node_attr_counters);
+err_create_file_counters:
+	ks_node_remove_file(&chan->ks_node, &ks_node_attr_rx_sched);
+err_create_file_rx_sched:
+	ks_node_unregister(&chan->ks_node);
+err_node_register:
+
+	return err;
+}
+
+static void lb_chan_unregister(struct lb_chan *chan)
+{
+	ks_chan_unregister(&chan->rx_chan);
+	ks_chan_unregister(&chan->tx_chan);
+
+	ks_node_remove_file(&chan->ks_node, &ks_node_attr_counters);
+	ks_node_remove_file(&chan->ks_node, &ks_node_attr_rx_sched);
+
+	ks_node_unregister(&chan->ks_node);
+}
+
+/*---------------------------------------------------------------------------*/
+
+static struct lb_card *lb_card_create(int num_chans)
+{
+	struct lb_card *card;
+	int err;
+	int i;
+
+	card = kmalloc(sizeof(*card), GFP_KERNEL);
+	if (!card)
+		goto err_alloc_card;
+
+	memset(card, 0, sizeof(*card));
+
+	spin_lock_init(&card->lock);
+
+	card->chans = kmalloc(sizeof(*card->chans) * num_chans, GFP_KERNEL);
+	if (!card->chans)
+		goto err_alloc_chans;
+
+	for (i = 0; i < num_chans; i++) {
+		err = lb_chan_create(&card->chans[i], card, i);
+		if (err < 0)
+			goto err_chan_create;
+
+		card->num_chans++;
+	}
+
+	kss_rx_sched_init(&card->rx_sched, &lb_card_rx_sched_ops,
+			LB_RX_SCHED_FREQUENCY, card);
+
+	return card;
+
+err_chan_create:
+	for (i = 0; i < card->num_chans; i++)
+		lb_chan_destroy(&card->chans[i]);
+
+	kfree(card->chans);
+err_alloc_chans:
+	kfree(card);
+err_alloc_card:
+
+	return NULL;
+}
+
+static void lb_card_destroy(struct lb_card *card)
+{
+	int i;
+
+	kss_rx_sched_destroy(&card->rx_sched);
+
+	for (i = 0; i < card->num_chans; i++)
+		lb_chan_destroy(&card->chans[i]);
+
+	kfree(card->chans);
+	kfree(card);
+}
+
+static int lb_card_register(struct lb_card *card)
+{
+	int err;
+	int i;
+
+	for (i = 0; i < card->num_chans; i++) {
+		err = lb_chan_register(&card->chans[i]);
+		if (err < 0)
+			goto err_chan_register;
+	}
+
+	return 0;
+
+err_chan_register:
+	while (--i >= 0)
+		lb_chan_unregister(&card->chans[i]);
+
+	return err;
+}
+
+static void lb_card_unregister(struct lb_card *card)
+{
+	int i;
+
+	for (i = card->num_chans - 1; i >= 0; i--)
+		lb_chan_unregister(&card->chans[i]);
+}
+
+/******************************************
+ * Module stuff
+ ******************************************/
+
+static int __init lb_init_module(void)
+{
+	int err;
+
+	lb_msg(KERN_INFO, lb_MODULE_DESCR " loading\n");
+
+	if (num_chans < 1 || bench_octets < 0) {
+		err = -EINVAL;
+		goto err_num_chans;
+	}
+
+	/* A-law silence */
+	memset(lb_bench_pattern, 0xd5, sizeof(lb_bench_pattern));
+
+	lb_card = lb_card_create(num_chans);
+	if (!lb_card) {
+		err = -ENOMEM;
+		goto err_card_create;
+	}
+
+	err = lb_card_register(lb_card);
+	if (err < 0)
+		goto err_card_register;
+
+	return 0;
+
+	lb_card_unregister(lb_card);
+err_card_register:
+	lb_card_destroy(lb_card);
+err_card_create:
+err_num_chans:
+
+	return err;
+}
+
+module_init(lb_init_module);
+
+static void __exit lb_module_exit(void)
+{
+	lb_card_unregister(lb_card);
+	lb_card_destroy(lb_card);
+
+	lb_msg(KERN_INFO, lb_MODULE_DESCR " unloaded\n");
+}
+
+module_exit(lb_module_exit);
+
+MODULE_DESCRIPTION(lb_MODULE_DESCR);
+MODULE_AUTHOR("vstuff contributors");
+MODULE_LICENSE("GPL");
+
+module_param(num_chans, int, 0444);
+MODULE_PARM_DESC(num_chans, "Number of loopback channels");
+module_param(bench_octets, int, 0644);
+MODULE_PARM_DESC(bench_octets,
+	"Octets fed to every started channel at each scheduler run");
+
+#ifdef DEBUG_CODE
+module_param(debug_level, int, 0444);
+MODULE_PARM_DESC(debug_level, "Initial debug level");
+#endif
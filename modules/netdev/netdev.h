@@ -42,9 +42,26 @@ struct vnd_create
 #define VND_CONNECTED_NODE_SYMLINK_E "visdn_connected_node_e"
 #define VND_CONNECTED_PORT_SYMLINK "visdn_connected_port"
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,24)
+#define VND_NAPI
+#endif
+
 enum vnd_netdevice_state
 {
 	VND_NETDEVICE_STATE_RTNL_HELD = 0,
+	VND_NETDEVICE_STATE_TX_THROTTLED,
+};
+
+/* Exported via ethtool -S, keep in sync with vnd_xstats_strings */
+struct vnd_netdevice_xstats
+{
+	unsigned long rx_polls;
+	unsigned long rx_polled_frames;
+	unsigned long rx_max_batch;
+	unsigned long rx_ring_overruns;
+	unsigned long tx_queue_full;
+	unsigned long tx_throttled;
+	unsigned long tx_wakeups;
 };
 
 struct vnd_netdevice
@@ -73,6 +90,14 @@ struct vnd_netdevice
 	struct visdn_port *remote_port; 
 
 	struct net_device_stats stats;
+	struct vnd_netdevice_xstats xstats;
+
+#ifdef VND_NAPI
+	struct napi_struct napi;
+#endif
+	struct sk_buff_head rx_queue;
+
+	struct timer_list tx_throttle_timer;
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,20)
 	struct work_struct promiscuity_change_work;
@@ -20,6 +20,7 @@
 #include <linux/delay.h>
 #include <linux/list.h>
 #include <linux/crc32.h>
+#include <linux/ethtool.h>
 
 #include <linux/kstreamer/kstreamer.h>
 #include <linux/kstreamer/channel.h>
@@ -42,6 +43,13 @@ int debug_level = 0;
 #endif
 #endif
 
+/* Frames queued for NAPI delivery before dropping */
+static int rx_ring_size = 64;
+
+/* Octets allowed in the D-channel TX FIFO before the queue is throttled,
+ * 0 lets the hardware FIFO fill up completely */
+static int tx_fifo_limit = 256;
+
 static dev_t vnd_first_dev;
 static struct cdev vnd_cdev;
 
@@ -149,6 +157,101 @@ static struct vnd_netdevice *vnd_netdevice_get_by_name(const char *name)
 
 /*---------------------------------------------------------------------------*/
 
+#ifdef VND_NAPI
+static inline void vnd_napi_schedule(struct vnd_netdevice *netdevice)
+{
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,29)
+	netif_rx_schedule(netdevice->netdev, &netdevice->napi);
+#else
+	napi_schedule(&netdevice->napi);
+#endif
+}
+
+static inline void vnd_napi_complete(struct vnd_netdevice *netdevice)
+{
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,29)
+	netif_rx_complete(netdevice->netdev, &netdevice->napi);
+#else
+	napi_complete(&netdevice->napi);
+#endif
+}
+
+static int vnd_netdev_poll(struct napi_struct *napi, int budget)
+{
+	struct vnd_netdevice *netdevice =
+		container_of(napi, struct vnd_netdevice, napi);
+	struct sk_buff_head batch;
+	struct sk_buff *skb;
+	unsigned long flags;
+	int done = 0;
+
+	skb_queue_head_init(&batch);
+
+	/* Grab the whole batch with a single lock acquisition */
+	spin_lock_irqsave(&netdevice->rx_queue.lock, flags);
+	while (done < budget &&
+	       (skb = __skb_dequeue(&netdevice->rx_queue))) {
+		__skb_queue_tail(&batch, skb);
+		done++;
+	}
+	spin_unlock_irqrestore(&netdevice->rx_queue.lock, flags);
+
+	while ((skb = __skb_dequeue(&batch)))
+		netif_receive_skb(skb);
+
+	netdevice->xstats.rx_polls++;
+	netdevice->xstats.rx_polled_frames += done;
+	if (done > netdevice->xstats.rx_max_batch)
+		netdevice->xstats.rx_max_batch = done;
+
+	if (done < budget) {
+		vnd_napi_complete(netdevice);
+
+		/* Catch frames queued while NAPI was still scheduled */
+		if (!skb_queue_empty(&netdevice->rx_queue))
+			vnd_napi_schedule(netdevice);
+	}
+
+	return done;
+}
+#endif
+
+/* Frames and primitives towards the stack are queued on a per-netdevice
+ * ring and delivered in batches by vnd_netdev_poll() */
+static void vnd_netdevice_rx(
+	struct vnd_netdevice *netdevice,
+	struct sk_buff *skb)
+{
+#ifdef VND_NAPI
+	unsigned long flags;
+
+	if (!netif_running(netdevice->netdev)) {
+		kfree_skb(skb);
+		return;
+	}
+
+	spin_lock_irqsave(&netdevice->rx_queue.lock, flags);
+
+	if (skb_queue_len(&netdevice->rx_queue) >= rx_ring_size) {
+		spin_unlock_irqrestore(&netdevice->rx_queue.lock, flags);
+
+		netdevice->stats.rx_dropped++;
+		netdevice->xstats.rx_ring_overruns++;
+		kfree_skb(skb);
+
+		return;
+	}
+
+	__skb_queue_tail(&netdevice->rx_queue, skb);
+
+	spin_unlock_irqrestore(&netdevice->rx_queue.lock, flags);
+
+	vnd_napi_schedule(netdevice);
+#else
+	netif_rx(skb);
+#endif
+}
+
 static void vnd_chan_d_rx_release(struct ks_chan *ks_chan)
 {
 	struct vnd_netdevice *netdevice =
@@ -199,7 +302,9 @@ static int vnd_chan_d_rx_push_frame(
 	prim_hdr = (struct lapd_prim_hdr *)skb->data;
 	prim_hdr->primitive_type = LAPD_PH_DATA_INDICATION;
 
-	return netif_rx(skb);
+	vnd_netdevice_rx(netdevice, skb);
+
+	return 0;
 }
 
 static int vnd_chan_d_rx_connect(struct ks_chan *ks_chan)
@@ -493,6 +598,31 @@ static void vnd_chan_d_tx_wake_queue(struct ks_chan *ks_chan)
 	struct vnd_netdevice *netdevice =
 		container_of(ks_chan, struct vnd_netdevice, ks_chan_d_tx);
 
+	/* May be called with the hardware lock held, the throttle timer
+	 * will wake us up if we are still over tx_fifo_limit */
+	if (test_bit(VND_NETDEVICE_STATE_TX_THROTTLED, &netdevice->state))
+		return;
+
+	netdevice->xstats.tx_wakeups++;
+
+	netif_wake_queue(netdevice->netdev);
+}
+
+static void vnd_tx_throttle_timer(unsigned long data)
+{
+	struct vnd_netdevice *netdevice = (struct vnd_netdevice *)data;
+	int pressure;
+
+	pressure = kss_chan_get_pressure(&netdevice->ks_chan_d_tx);
+	if (pressure > tx_fifo_limit / 2) {
+		mod_timer(&netdevice->tx_throttle_timer, jiffies + HZ / 50);
+		return;
+	}
+
+	clear_bit(VND_NETDEVICE_STATE_TX_THROTTLED, &netdevice->state);
+
+	netdevice->xstats.tx_wakeups++;
+
 	netif_wake_queue(netdevice->netdev);
 }
 
@@ -621,7 +751,9 @@ static int vnd_chan_e_rx_push_frame(
 	prim_hdr = (struct lapd_prim_hdr *)skb->data;
 	prim_hdr->primitive_type = LAPD_PH_DATA_INDICATION;
 
-	return netif_rx(skb);
+	vnd_netdevice_rx(netdevice, skb);
+
+	return 0;
 }
 
 static int vnd_chan_e_rx_connect(struct ks_chan *ks_chan)
@@ -811,6 +943,10 @@ static int vnd_netdev_open(struct net_device *netdev)
 
 	/******/
 
+#ifdef VND_NAPI
+	napi_enable(&netdevice->napi);
+#endif
+
 	clear_bit(VND_NETDEVICE_STATE_RTNL_HELD, &netdevice->state);
 
 	vnd_debug(3, "vnd_netdev_open()\n");
@@ -842,6 +978,14 @@ static int vnd_netdev_stop(struct net_device *netdev)
 	cancel_delayed_work(&netdevice->promiscuity_change_work);
 	flush_scheduled_work();
 
+#ifdef VND_NAPI
+	napi_disable(&netdevice->napi);
+#endif
+	skb_queue_purge(&netdevice->rx_queue);
+
+	del_timer_sync(&netdevice->tx_throttle_timer);
+	clear_bit(VND_NETDEVICE_STATE_TX_THROTTLED, &netdevice->state);
+
 	if (netdevice->ks_chan_d_rx.pipeline)
 		ks_pipeline_change_status(netdevice->ks_chan_d_rx.pipeline,
 				KS_PIPELINE_STATUS_CONNECTED);
@@ -886,6 +1030,17 @@ static int vnd_netdev_hard_start_xmit(
 		res = kss_chan_push_frame(&netdevice->ks_chan_d_tx, skb);
 		switch(res) {
 		case KSS_TX_OK:
+			if (tx_fifo_limit &&
+			    kss_chan_get_pressure(&netdevice->ks_chan_d_tx) >=
+							tx_fifo_limit) {
+				set_bit(VND_NETDEVICE_STATE_TX_THROTTLED,
+							&netdevice->state);
+				netif_stop_queue(netdevice->netdev);
+				netdevice->xstats.tx_throttled++;
+
+				mod_timer(&netdevice->tx_throttle_timer,
+							jiffies + HZ / 50);
+			}
 #if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,32)
 				return NETDEV_TX_OK;
 #else
@@ -893,6 +1048,7 @@ static int vnd_netdev_hard_start_xmit(
 #endif		
 		case KSS_TX_FULL:
 			netif_stop_queue(netdevice->netdev);
+			netdevice->xstats.tx_queue_full++;
 			skb_push(skb, sizeof(struct lapd_prim_hdr));
 #if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,32)
 			 return NETDEV_TX_BUSY;
@@ -1068,6 +1224,78 @@ static int vnd_netdev_change_mtu(
 	return 0;
 }
 
+static const char vnd_xstats_strings[][ETH_GSTRING_LEN] = {
+	"rx_polls",
+	"rx_polled_frames",
+	"rx_max_batch",
+	"rx_ring_overruns",
+	"tx_queue_full",
+	"tx_throttled",
+	"tx_wakeups",
+};
+
+#define VND_XSTATS_LEN ARRAY_SIZE(vnd_xstats_strings)
+
+static void vnd_ethtool_get_drvinfo(
+	struct net_device *netdev,
+	struct ethtool_drvinfo *info)
+{
+	strlcpy(info->driver, vnd_MODULE_NAME, sizeof(info->driver));
+}
+
+static void vnd_ethtool_get_strings(
+	struct net_device *netdev,
+	u32 stringset,
+	u8 *data)
+{
+	if (stringset == ETH_SS_STATS)
+		memcpy(data, vnd_xstats_strings, sizeof(vnd_xstats_strings));
+}
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,22)
+static int vnd_ethtool_get_stats_count(struct net_device *netdev)
+{
+	return VND_XSTATS_LEN;
+}
+#else
+static int vnd_ethtool_get_sset_count(struct net_device *netdev, int sset)
+{
+	return sset == ETH_SS_STATS ? VND_XSTATS_LEN : -EOPNOTSUPP;
+}
+#endif
+
+static void vnd_ethtool_get_stats(
+	struct net_device *netdev,
+	struct ethtool_stats *stats,
+	u64 *data)
+{
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,29)
+	struct vnd_netdevice *netdevice = netdev->priv;
+#else
+	struct vnd_netdevice *netdevice = netdev->ml_priv;
+#endif
+	struct vnd_netdevice_xstats *xstats = &netdevice->xstats;
+
+	data[0] = xstats->rx_polls;
+	data[1] = xstats->rx_polled_frames;
+	data[2] = xstats->rx_max_batch;
+	data[3] = xstats->rx_ring_overruns;
+	data[4] = xstats->tx_queue_full;
+	data[5] = xstats->tx_throttled;
+	data[6] = xstats->tx_wakeups;
+}
+
+static struct ethtool_ops vnd_ethtool_ops = {
+	.get_drvinfo		= vnd_ethtool_get_drvinfo,
+	.get_strings		= vnd_ethtool_get_strings,
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,22)
+	.get_stats_count	= vnd_ethtool_get_stats_count,
+#else
+	.get_sset_count		= vnd_ethtool_get_sset_count,
+#endif
+	.get_ethtool_stats	= vnd_ethtool_get_stats,
+};
+
 static int vnd_cdev_open(
 	struct inode *inode,
 	struct file *file)
@@ -1192,7 +1420,7 @@ static void vnd_send_primitive(
 		prim_hdr->primitive_type = primitive_type;
 		ctrl_hdr->param = param1;
 
-		netif_rx(skb);
+		vnd_netdevice_rx(netdevice, skb);
 	}
 
 	spin_unlock_irqrestore(&vnd_netdevices_list_lock, flags);
@@ -1360,6 +1588,12 @@ static void vnd_netdevice_init(
 
 	/*****************************************/
 
+	skb_queue_head_init(&netdevice->rx_queue);
+
+	init_timer(&netdevice->tx_throttle_timer);
+	netdevice->tx_throttle_timer.function = vnd_tx_throttle_timer;
+	netdevice->tx_throttle_timer.data = (unsigned long)netdevice;
+
 #if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,20)
 	INIT_WORK(&netdevice->promiscuity_change_work,
 		vnd_promiscuity_change_work,
@@ -1504,6 +1738,13 @@ static struct net_device_ops dev_ops = {
 #endif
 	netdevice->netdev->features = 0;
 
+	SET_ETHTOOL_OPS(netdevice->netdev, &vnd_ethtool_ops);
+
+#ifdef VND_NAPI
+	netif_napi_add(netdevice->netdev, &netdevice->napi,
+			vnd_netdev_poll, 16);
+#endif
+
 	memset(netdevice->netdev->dev_addr, 0,
 		sizeof(netdevice->netdev->dev_addr));
 
@@ -1928,6 +2169,11 @@ MODULE_DESCRIPTION(vnd_MODULE_DESCR);
 MODULE_AUTHOR("Daniele (Vihai) Orlandi <daniele@orlandi.com>");
 MODULE_LICENSE("GPL");
 
+module_param(rx_ring_size, int, 0644);
+MODULE_PARM_DESC(rx_ring_size, "Frames queued for NAPI delivery before dropping");
+module_param(tx_fifo_limit, int, 0644);
+MODULE_PARM_DESC(tx_fifo_limit, "D-channel TX FIFO octets before throttling (0 = off)");
+
 #ifdef DEBUG_CODE
 module_param(debug_level, int, 0444);
 MODULE_PARM_DESC(debug_level, "Initial debug level");
@@ -16,6 +16,9 @@
 /* See core.h for IOC allocation */
 #define VISDN_PPP_GET_CHANID	_IOR(0xd0, 0x30, unsigned int)
 
+/* Nominal B-channel bitrate, in bit/s */
+#define VPPP_BCHAN_SPEED	64000
+
 #ifdef __KERNEL__
 
 #include <linux/skbuff.h>
@@ -61,6 +61,22 @@ static int vppp_ppp_start_xmit(
 	if (test_bit(VPPP_CHAN_STATUS_QUEUE_STOPPED, &chan->status))
 		return 0;
 
+	/* Multilink fragments are allocated by ppp_generic with just
+	 * hdrlen of headroom and no tailroom, make room for the fake CRC
+	 */
+	if (skb_tailroom(skb) < sizeof(u16) ||
+	    skb_headroom(skb) < sizeof(ppphdr) ||
+	    skb_cloned(skb)) {
+		int nhead = skb_headroom(skb) < sizeof(ppphdr) ?
+				sizeof(ppphdr) - skb_headroom(skb) : 0;
+
+		if (pskb_expand_head(skb, nhead, sizeof(u16),
+						GFP_ATOMIC) < 0) {
+			kfree_skb(skb);
+			return 1;
+		}
+	}
+
 	memcpy(skb_push(skb, sizeof(ppphdr)), ppphdr, sizeof(ppphdr));
 
 	/* Put in a fake CRC */
@@ -446,6 +462,10 @@ int vppp_cdev_open(
 	chan->ppp_chan.ops = &vppp_ppp_ops;
 	chan->ppp_chan.mtu = 300; //visdn_pipeline_find_lowest_mtu(pipeline);
 	chan->ppp_chan.hdrlen = sizeof(ppphdr) + sizeof(u16);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,36)
+	/* Each channel is a B-channel, used to weight multilink fragments */
+	chan->ppp_chan.speed = VPPP_BCHAN_SPEED;
+#endif
 
 //	visdn_pipeline_put(pipeline);
 
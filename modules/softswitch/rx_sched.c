@@ -0,0 +1,297 @@
+/*
+ * vISDN software crossconnector
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/list.h>
+#include <linux/timer.h>
+#include <linux/spinlock.h>
+#include <linux/smp.h>
+
+#include <linux/kstreamer/kstreamer.h>
+#include <linux/kstreamer/channel.h>
+#include <linux/kstreamer/streamframe.h>
+
+#include "softswitch.h"
+
+/* The channels are drained under sched->lock and the driver lock, then a
+ * snapshot of the drained entries is pushed downstream with no lock held,
+ * so push handlers are free to take any lock or to add and delete entries.
+ * Each entry in the snapshot is marked busy and its channel referenced
+ * until the push has returned, kss_rx_sched_del() waits for it.
+ *
+ * An entry keeps its frame between runs as long as nobody downstream took
+ * a reference to it, so that channels whose sinks copy do not allocate at
+ * all.
+ */
+static void kss_rx_sched_run(unsigned long data)
+{
+	struct kss_rx_sched *sched = (struct kss_rx_sched *)data;
+	struct kss_rx_sched_entry *entry, *t;
+	LIST_HEAD(run_entries);
+	cycles_t run_start, locked_start, locked_cycles, run_cycles;
+	int batch = 0;
+
+	run_start = get_cycles();
+
+	spin_lock(&sched->lock);
+
+	locked_start = get_cycles();
+
+	list_for_each_entry(entry, &sched->entries, node) {
+		if (entry->sf) {
+			ks_sf_reset(entry->sf);
+			sched->recycled++;
+			continue;
+		}
+
+		entry->sf = ks_sf_alloc();
+		if (!entry->sf)
+			sched->alloc_failures++;
+	}
+
+	sched->ops->lock(sched);
+
+	if (sched->ops->prepare)
+		sched->ops->prepare(sched);
+
+	list_for_each_entry(entry, &sched->entries, node) {
+		if (entry->sf)
+			sched->ops->drain(sched, entry->chan, entry->sf);
+	}
+	sched->ops->unlock(sched);
+
+	list_for_each_entry(entry, &sched->entries, node) {
+		if (!entry->sf)
+			continue;
+
+		entry->busy = TRUE;
+		entry->run_sf = entry->sf;
+		entry->sf = NULL;
+		ks_chan_get(entry->chan);
+
+		list_add_tail(&entry->run_node, &run_entries);
+	}
+
+	sched->run_cpu = smp_processor_id();
+
+	locked_cycles = get_cycles() - locked_start;
+
+	spin_unlock(&sched->lock);
+
+	list_for_each_entry(entry, &run_entries, run_node) {
+		if (entry->run_sf->len)
+			ks_sf_count_copy(entry->run_sf);
+
+		kss_chan_push_raw(entry->chan, entry->run_sf);
+
+		batch++;
+	}
+
+	spin_lock(&sched->lock);
+
+	sched->run_cpu = -1;
+
+	list_for_each_entry_safe(entry, t, &run_entries, run_node) {
+		list_del(&entry->run_node);
+
+		if (entry->linked && !entry->sf &&
+		    ks_sf_writable(entry->run_sf))
+			entry->sf = entry->run_sf;
+		else
+			ks_sf_put(entry->run_sf);
+
+		entry->run_sf = NULL;
+
+		ks_chan_put(entry->chan);
+		entry->busy = FALSE;
+	}
+
+	sched->runs++;
+	sched->frames += batch;
+
+	if (batch > sched->max_batch)
+		sched->max_batch = batch;
+
+	run_cycles = get_cycles() - run_start;
+
+	sched->run_cycles += run_cycles;
+	if (run_cycles > sched->max_run_cycles)
+		sched->max_run_cycles = run_cycles;
+
+	sched->locked_cycles += locked_cycles;
+	if (locked_cycles > sched->max_locked_cycles)
+		sched->max_locked_cycles = locked_cycles;
+
+	if (list_empty(&sched->entries)) {
+		sched->armed = FALSE;
+	} else {
+		sched->timer.expires += sched->interval;
+
+		/* Do not try to catch up, the FIFOs have been drained anyway */
+		if (time_after_eq(jiffies, sched->timer.expires)) {
+			sched->timer.expires = jiffies + sched->interval;
+			sched->late_runs++;
+		}
+
+		add_timer(&sched->timer);
+	}
+
+	spin_unlock(&sched->lock);
+}
+
+void kss_rx_sched_init(
+	struct kss_rx_sched *sched,
+	struct kss_rx_sched_ops *ops,
+	int frequency,
+	void *driver_data)
+{
+	memset(sched, 0, sizeof(*sched));
+
+	sched->ops = ops;
+	sched->driver_data = driver_data;
+
+	spin_lock_init(&sched->lock);
+	INIT_LIST_HEAD(&sched->entries);
+	sched->run_cpu = -1;
+
+	sched->interval = HZ / frequency;
+	if (sched->interval < 1)
+		sched->interval = 1;
+
+	init_timer(&sched->timer);
+	sched->timer.function = kss_rx_sched_run;
+	sched->timer.data = (unsigned long)sched;
+}
+EXPORT_SYMBOL(kss_rx_sched_init);
+
+void kss_rx_sched_destroy(struct kss_rx_sched *sched)
+{
+	WARN_ON(!list_empty(&sched->entries));
+
+	del_timer_sync(&sched->timer);
+}
+EXPORT_SYMBOL(kss_rx_sched_destroy);
+
+/* Must not be called with the driver lock held */
+void kss_rx_sched_add(
+	struct kss_rx_sched *sched,
+	struct kss_rx_sched_entry *entry,
+	struct ks_chan *chan)
+{
+	spin_lock_bh(&sched->lock);
+
+	entry->chan = chan;
+	entry->sf = NULL;
+	entry->linked = TRUE;
+
+	list_add_tail(&entry->node, &sched->entries);
+	sched->nentries++;
+
+	if (!sched->armed) {
+		sched->armed = TRUE;
+		sched->timer.expires = jiffies + sched->interval;
+		add_timer(&sched->timer);
+	}
+
+	spin_unlock_bh(&sched->lock);
+}
+EXPORT_SYMBOL(kss_rx_sched_add);
+
+/* Must not be called with the driver lock held, may be called from a
+ * push handler
+ */
+void kss_rx_sched_del(
+	struct kss_rx_sched *sched,
+	struct kss_rx_sched_entry *entry)
+{
+	struct ks_streamframe *sf;
+
+	spin_lock_bh(&sched->lock);
+	list_del(&entry->node);
+	entry->linked = FALSE;
+	sched->nentries--;
+
+	sf = entry->sf;
+	entry->sf = NULL;
+
+	/* A run pushing this entry's frame releases it by itself, wait for
+	 * it unless we have been called from the push
+	 */
+	while (entry->busy && sched->run_cpu != smp_processor_id()) {
+		spin_unlock_bh(&sched->lock);
+		cpu_relax();
+		spin_lock_bh(&sched->lock);
+	}
+	spin_unlock_bh(&sched->lock);
+
+	if (sf)
+		ks_sf_put(sf);
+
+	/* The timer stops by itself on the next run if the list is empty */
+}
+EXPORT_SYMBOL(kss_rx_sched_del);
+
+ssize_t kss_rx_sched_show_stats(
+	struct kss_rx_sched *sched,
+	char *buf)
+{
+	ssize_t len;
+
+	spin_lock_bh(&sched->lock);
+	len = snprintf(buf, PAGE_SIZE,
+		"channels: %d\n"
+		"interval: %d\n"
+		"runs: %lu\n"
+		"frames: %lu\n"
+		"late_runs: %lu\n"
+		"alloc_failures: %lu\n"
+		"recycled: %lu\n"
+		"max_batch: %d\n"
+		"run_cycles: %llu\n"
+		"max_run_cycles: %llu\n"
+		"locked_cycles: %llu\n"
+		"max_locked_cycles: %llu\n",
+		sched->nentries,
+		sched->interval,
+		sched->runs,
+		sched->frames,
+		sched->late_runs,
+		sched->alloc_failures,
+		sched->recycled,
+		sched->max_batch,
+		sched->run_cycles,
+		(unsigned long long)sched->max_run_cycles,
+		sched->locked_cycles,
+		(unsigned long long)sched->max_locked_cycles);
+	spin_unlock_bh(&sched->lock);
+
+	return len;
+}
+EXPORT_SYMBOL(kss_rx_sched_show_stats);
+
+void kss_rx_sched_reset_stats(struct kss_rx_sched *sched)
+{
+	spin_lock_bh(&sched->lock);
+	sched->runs = 0;
+	sched->frames = 0;
+	sched->late_runs = 0;
+	sched->alloc_failures = 0;
+	sched->recycled = 0;
+	sched->max_batch = 0;
+	sched->run_cycles = 0;
+	sched->locked_cycles = 0;
+	sched->max_run_cycles = 0;
+	sched->max_locked_cycles = 0;
+	spin_unlock_bh(&sched->lock);
+}
+EXPORT_SYMBOL(kss_rx_sched_reset_stats);
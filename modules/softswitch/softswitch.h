@@ -16,6 +16,9 @@
 #ifdef __KERNEL__
 
 #include <linux/skbuff.h>
+#include <linux/timer.h>
+#include <linux/spinlock.h>
+#include <linux/timex.h>
 
 #include <linux/kstreamer/node.h>
 #include <linux/kstreamer/streamframe.h>
@@ -24,6 +27,14 @@
 #define kss_MODULE_PREFIX kss_MODULE_NAME ": "
 #define kss_MODULE_DESCR "Kstreamer softswitch"
 
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
 enum kss_push_frame_return_codes
 {
 	KSS_TX_OK,
@@ -98,6 +109,130 @@ extern int kss_chan_get_pressure(struct ks_chan *chan);
 
 extern void kss_chan_wake_queue(struct ks_chan *chan);
 
+/* Taps are read-only observers of the streamframes entering the softswitch
+ * from a channel, e.g. tone detectors. process() runs in the caller's
+ * context, possibly atomic, must not modify or keep the streamframe and
+ * sees nothing of pipelines switched by the hardware.
+ */
+
+struct kss_tap;
+
+struct kss_tap_ops
+{
+	void (*process)(struct kss_tap *tap, struct ks_streamframe *sf);
+};
+
+struct kss_tap
+{
+	struct hlist_node node;
+
+	struct kss_tap_ops *ops;
+	struct ks_chan *chan;
+	void *data;
+};
+
+extern atomic_t kss_taps_count;
+
+extern void kss_tap_add(
+	struct kss_tap *tap,
+	struct kss_tap_ops *ops,
+	struct ks_chan *chan,
+	void *data);
+extern void kss_tap_del(struct kss_tap *tap);
+extern void kss_tap_run(struct ks_chan *chan, struct ks_streamframe *sf);
+
+/* Per-card periodic RX scheduler: drains every started RX channel of a card
+ * in a single pass under one acquisition of the driver's lock and pushes
+ * the resulting streamframes downstream once both the driver's lock and the
+ * scheduler's lock have been released.
+ *
+ * kss_rx_sched_del() waits for a run that is pushing the entry's frame to
+ * complete, unless it is called from that very push, in which case the
+ * entry must stay allocated until the push handler returns.
+ */
+
+struct kss_rx_sched;
+
+struct kss_rx_sched_ops
+{
+	void (*lock)(struct kss_rx_sched *sched);
+	void (*unlock)(struct kss_rx_sched *sched);
+
+	/* Optional, called once per run with the driver lock held, before
+	 * draining the channels
+	 */
+	void (*prepare)(struct kss_rx_sched *sched);
+
+	/* Called with the driver lock held, fills sf with at most sf->size
+	 * octets read from the channel's RX FIFO. The scheduler accounts for
+	 * the copy, drain must not hold on to sf.
+	 */
+	void (*drain)(struct kss_rx_sched *sched, struct ks_chan *chan,
+			struct ks_streamframe *sf);
+};
+
+struct kss_rx_sched_entry
+{
+	struct list_head node;
+
+	struct ks_chan *chan;
+	struct ks_streamframe *sf;
+
+	/* Protected by sched->lock */
+	int linked;
+	int busy;
+	struct list_head run_node;
+	struct ks_streamframe *run_sf;
+};
+
+struct kss_rx_sched
+{
+	struct kss_rx_sched_ops *ops;
+	void *driver_data;
+
+	spinlock_t lock;
+	struct list_head entries;
+	int nentries;
+
+	struct timer_list timer;
+	int interval;
+	int armed;
+	int run_cpu;
+
+	unsigned long runs;
+	unsigned long frames;
+	unsigned long late_runs;
+	unsigned long alloc_failures;
+	unsigned long recycled;
+	int max_batch;
+
+	/* get_cycles() spent in a whole run and with sched->lock held */
+	unsigned long long run_cycles;
+	unsigned long long locked_cycles;
+	cycles_t max_run_cycles;
+	cycles_t max_locked_cycles;
+};
+
+extern void kss_rx_sched_init(
+	struct kss_rx_sched *sched,
+	struct kss_rx_sched_ops *ops,
+	int frequency,
+	void *driver_data);
+extern void kss_rx_sched_destroy(struct kss_rx_sched *sched);
+
+extern void kss_rx_sched_add(
+	struct kss_rx_sched *sched,
+	struct kss_rx_sched_entry *entry,
+	struct ks_chan *chan);
+extern void kss_rx_sched_del(
+	struct kss_rx_sched *sched,
+	struct kss_rx_sched_entry *entry);
+
+extern ssize_t kss_rx_sched_show_stats(
+	struct kss_rx_sched *sched,
+	char *buf);
+extern void kss_rx_sched_reset_stats(struct kss_rx_sched *sched);
+
 #endif
 
 #endif
@@ -30,6 +30,51 @@ EXPORT_SYMBOL(kss_softswitch);
 #define to_kss_softswitch(ks_node)	\
 		container_of((ks_node), struct kss_softswitch, ks_node)
 
+/* A channel pushes from one context at a time and only its own hop is
+ * touched, so the counters need no locking
+ */
+static inline void kss_hop_account(
+	struct ks_pipeline_hop *hop,
+	int len,
+	int res)
+{
+	if (likely(res >= 0)) {
+		hop->stats.frames++;
+		hop->stats.bytes += len;
+	} else
+		hop->stats.drops++;
+
+	if (ks_stats_enabled() && !len)
+		hop->stats.underruns++;
+}
+
+static inline void kss_hop_account_latency(
+	struct ks_pipeline_hop *hop,
+	struct ks_streamframe *sf)
+{
+	s64 ns;
+	int bucket;
+
+	if (!ks_stats_enabled() || !ktime_to_ns(sf->tstamp))
+		return;
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), sf->tstamp));
+	if (ns < 0)
+		return;
+
+	hop->stats.latency_sum += ns;
+	hop->stats.latency_samples++;
+
+	if (ns > hop->stats.latency_max)
+		hop->stats.latency_max = min_t(s64, ns, 0xffffffff);
+
+	bucket = fls((u32)min_t(s64, ns >> 10, 0xffffffff));
+	if (bucket >= KS_PIPELINE_LATENCY_BUCKETS)
+		bucket = KS_PIPELINE_LATENCY_BUCKETS - 1;
+
+	hop->stats.latency_hist[bucket]++;
+}
+
 void kss_chan_wake_queue(struct ks_chan *chan)
 {
 	struct ks_chan *from_chan;
@@ -59,28 +104,22 @@ EXPORT_SYMBOL(kss_chan_wake_queue);
 
 int kss_chan_push_frame(struct ks_chan *chan, struct sk_buff *skb)
 {
-	struct ks_chan *to_chan;
+	struct ks_pipeline_hop *hop;
+	int len = skb->len;
 	int res;
 
 	BUG_ON(chan->to != &kss_softswitch.ks_node);
 
 	rcu_read_lock();
-	if (!chan->pipeline ||
-	    chan->pipeline_entry.next == &chan->pipeline->entries) {
+	hop = rcu_dereference(chan->hop);
+	if (!hop) {
 		rcu_read_unlock();
 		return -ENOTCONN;
 	}
 
-	to_chan = list_entry(chan->pipeline_entry.next, struct ks_chan,
-							pipeline_entry);
+	res = hop->push_frame(hop->next, skb);
 
-	if (!((struct kss_chan_from_ops *)to_chan->from_ops)->push_frame) {
-		rcu_read_unlock();
-		return -EOPNOTSUPP;
-	}
-
-	res = ((struct kss_chan_from_ops *)to_chan->from_ops)->
-			push_frame(to_chan, skb);
+	kss_hop_account(hop, len, res);
 
 	rcu_read_unlock();
 
@@ -92,28 +131,27 @@ int kss_chan_push_raw(
 	struct ks_chan *chan,
 	struct ks_streamframe *sf)
 {
-	struct ks_chan *to_chan;
+	struct ks_pipeline_hop *hop;
+	int len = sf->len;
 	int res;
 
 	BUG_ON(chan->to != &kss_softswitch.ks_node);
 
 	rcu_read_lock();
-	if (!chan->pipeline ||
-	    chan->pipeline_entry.next == &chan->pipeline->entries) {
+	hop = rcu_dereference(chan->hop);
+	if (!hop) {
 		rcu_read_unlock();
 		return -ENOTCONN;
 	}
 
-	to_chan = list_entry(chan->pipeline_entry.next, struct ks_chan,
-							pipeline_entry);
+	if (unlikely(atomic_read(&kss_taps_count)))
+		kss_tap_run(chan, sf);
 
-	if (!((struct kss_chan_from_ops *)to_chan->from_ops)->push_raw) {
-		rcu_read_unlock();
-		return -EOPNOTSUPP;
-	}
+	kss_hop_account_latency(hop, sf);
+
+	res = hop->push_raw(hop->next, sf);
 
-	res = ((struct kss_chan_from_ops *)to_chan->from_ops)->
-			push_raw(to_chan, sf);
+	kss_hop_account(hop, len, res);
 
 	rcu_read_unlock();
 
@@ -123,28 +161,19 @@ EXPORT_SYMBOL(kss_chan_push_raw);
 
 int kss_chan_get_pressure(struct ks_chan *chan)
 {
-	struct ks_chan *to_chan;
+	struct ks_pipeline_hop *hop;
 	int res;
 
 	BUG_ON(chan->to != &kss_softswitch.ks_node);
 
 	rcu_read_lock();
-	if (!chan->pipeline ||
-	    chan->pipeline_entry.next == &chan->pipeline->entries) {
+	hop = rcu_dereference(chan->hop);
+	if (!hop) {
 		rcu_read_unlock();
 		return -ENOTCONN;
 	}
 
-	to_chan = list_entry(chan->pipeline_entry.next, struct ks_chan,
-							pipeline_entry);
-
-	if (!((struct kss_chan_from_ops *)to_chan->from_ops)->get_pressure) {
-		rcu_read_unlock();
-		return -EOPNOTSUPP;
-	}
-
-	res = ((struct kss_chan_from_ops *)to_chan->from_ops)->
-			get_pressure(to_chan);
+	res = hop->get_pressure(hop->next);
 
 	rcu_read_unlock();
 
@@ -152,6 +181,70 @@ int kss_chan_get_pressure(struct ks_chan *chan)
 }
 EXPORT_SYMBOL(kss_chan_get_pressure);
 
+/*---------------------------------------------------------------------------*/
+
+/* Whatever is missing in the next channel's from_ops is resolved to a stub,
+ * so that the fast path never has to check
+ */
+
+static int kss_hop_push_frame_notconn(struct ks_chan *chan,
+	struct sk_buff *skb)
+{
+	return -ENOTCONN;
+}
+
+static int kss_hop_push_raw_notconn(struct ks_chan *chan,
+	struct ks_streamframe *sf)
+{
+	return -ENOTCONN;
+}
+
+static int kss_hop_get_pressure_notconn(struct ks_chan *chan)
+{
+	return -ENOTCONN;
+}
+
+static int kss_hop_push_frame_unsupp(struct ks_chan *chan,
+	struct sk_buff *skb)
+{
+	return -EOPNOTSUPP;
+}
+
+static int kss_hop_push_raw_unsupp(struct ks_chan *chan,
+	struct ks_streamframe *sf)
+{
+	return -EOPNOTSUPP;
+}
+
+static int kss_hop_get_pressure_unsupp(struct ks_chan *chan)
+{
+	return -EOPNOTSUPP;
+}
+
+static void kss_compile(
+	struct ks_node *node,
+	struct ks_pipeline_hop *hop)
+{
+	struct kss_chan_from_ops *from_ops;
+
+	if (!hop->next) {
+		hop->push_frame = kss_hop_push_frame_notconn;
+		hop->push_raw = kss_hop_push_raw_notconn;
+		hop->get_pressure = kss_hop_get_pressure_notconn;
+
+		return;
+	}
+
+	from_ops = hop->next->from_ops;
+
+	hop->push_frame = from_ops && from_ops->push_frame ?
+			from_ops->push_frame : kss_hop_push_frame_unsupp;
+	hop->push_raw = from_ops && from_ops->push_raw ?
+			from_ops->push_raw : kss_hop_push_raw_unsupp;
+	hop->get_pressure = from_ops && from_ops->get_pressure ?
+			from_ops->get_pressure : kss_hop_get_pressure_unsupp;
+}
+
 static void kss_release(struct ks_node *node)
 {
 	printk(KERN_DEBUG "kss_release()\n");
@@ -305,6 +398,7 @@ struct ks_node_ops kss_ops =
 {
 	.owner		= THIS_MODULE,
 	.release	= kss_release,
+	.compile	= kss_compile,
 /*	.timer_func	= kss_timer_func,
 
 	.frame_xmit	= kss_frame_xmit,
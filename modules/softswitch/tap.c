@@ -0,0 +1,81 @@
+/*
+ * vISDN software crossconnector
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/list.h>
+#include <linux/hash.h>
+#include <linux/spinlock.h>
+#include <linux/rcupdate.h>
+
+#include <linux/kstreamer/kstreamer.h>
+#include <linux/kstreamer/channel.h>
+#include <linux/kstreamer/streamframe.h>
+
+#include "softswitch.h"
+
+/* Taps are looked up by channel in an RCU protected hash; the fast path
+ * only reads kss_taps_count as long as no tap is installed.
+ */
+
+#define KSS_TAP_HASHBITS 6
+#define KSS_TAP_HASHSIZE (1 << KSS_TAP_HASHBITS)
+
+static struct hlist_head kss_taps_hash[KSS_TAP_HASHSIZE];
+static DEFINE_SPINLOCK(kss_taps_lock);
+atomic_t kss_taps_count = ATOMIC_INIT(0);
+
+static inline struct hlist_head *kss_tap_get_hash(struct ks_chan *chan)
+{
+	return &kss_taps_hash[hash_ptr(chan, KSS_TAP_HASHBITS)];
+}
+
+void kss_tap_add(
+	struct kss_tap *tap,
+	struct kss_tap_ops *ops,
+	struct ks_chan *chan,
+	void *data)
+{
+	tap->ops = ops;
+	tap->chan = chan;
+	tap->data = data;
+
+	spin_lock(&kss_taps_lock);
+	hlist_add_head_rcu(&tap->node, kss_tap_get_hash(chan));
+	atomic_inc(&kss_taps_count);
+	spin_unlock(&kss_taps_lock);
+}
+EXPORT_SYMBOL(kss_tap_add);
+
+/* May sleep; once it returns ops->process is not running anymore */
+void kss_tap_del(struct kss_tap *tap)
+{
+	spin_lock(&kss_taps_lock);
+	hlist_del_rcu(&tap->node);
+	atomic_dec(&kss_taps_count);
+	spin_unlock(&kss_taps_lock);
+
+	synchronize_rcu();
+}
+EXPORT_SYMBOL(kss_tap_del);
+
+/* Called under rcu_read_lock */
+void kss_tap_run(struct ks_chan *chan, struct ks_streamframe *sf)
+{
+	struct kss_tap *tap;
+	struct hlist_node *t;
+
+	hlist_for_each_entry_rcu(tap, t, kss_tap_get_hash(chan), node) {
+		if (tap->chan == chan)
+			tap->ops->process(tap, sf);
+	}
+}
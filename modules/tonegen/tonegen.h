@@ -0,0 +1,128 @@
+/*
+ * kstreamer precomputed tone generator
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#ifndef _KS_TONEGEN_H
+#define _KS_TONEGEN_H
+
+#ifdef __KERNEL__
+
+#include <linux/spinlock.h>
+
+#include <linux/kstreamer/node.h>
+#include <linux/kstreamer/channel.h>
+#include <linux/kstreamer/softswitch.h>
+
+#define ktg_MODULE_NAME "ks-tonegen"
+#define ktg_MODULE_PREFIX ktg_MODULE_NAME ": "
+#define ktg_MODULE_DESCR "kstreamer tone generator"
+
+#define KTG_RX_SCHED_FREQUENCY 50
+#define KTG_SAMPLE_RATE 8000
+
+#define KTG_MAX_GENERATORS 1024
+#define KTG_MAX_SEGMENTS 4
+
+/* Peak amplitudes of a single frequency tone at -10 dBm0 and of each of
+ * the components of a dual frequency tone at -13 dBm0
+ */
+#define KTG_AMPLITUDE_SINGLE 7241
+#define KTG_AMPLITUDE_DUAL 5126
+
+enum ktg_tone_type
+{
+	KTG_TONE_DIAL,
+	KTG_TONE_BUSY,
+	KTG_TONE_CONGESTION,
+	KTG_TONE_RINGBACK,
+	KTG_NUM_TONES
+};
+
+/* A step of a cadence; freq1 == 0 is silence, ms == 0 makes a single step
+ * play forever
+ */
+struct ktg_segment
+{
+	int freq1;
+	int freq2;
+	int ms;
+};
+
+struct ktg_country
+{
+	const char *name;
+
+	struct ktg_segment tones[KTG_NUM_TONES][KTG_MAX_SEGMENTS + 1];
+};
+
+struct ktg_tone;
+
+/* Every generator is a "txN" ks_chan of its tone's node, playing the shared
+ * table from its own position. The router picks whichever is not part of a
+ * pipeline yet.
+ */
+struct ktg_generator
+{
+	struct ktg_tone *tone;
+	int id;
+
+	struct ks_chan ks_chan;
+
+	struct kss_rx_sched_entry sched_entry;
+
+	int pos;
+};
+
+struct ktg_tone
+{
+	enum ktg_tone_type type;
+	const struct ktg_segment *cadence;
+
+	struct ks_node ks_node;
+
+	/* Whole cadence, companded once at load */
+	u8 *table;
+	int table_len;
+
+	int num_generators;
+	struct ktg_generator *generators;
+
+	/* Updated by the RX scheduler, under ktg_lock */
+	int active;
+	unsigned long out_octets;
+};
+
+#if defined(DEBUG_CODE) && defined(DEBUG_DEFAULTS)
+#define ktg_debug(dbglevel, format, arg...)			\
+	if (debug_level >= dbglevel)				\
+		printk(KERN_DEBUG ktg_MODULE_PREFIX		\
+			format,					\
+			## arg)
+#else
+#define ktg_debug(format, arg...) do {} while (0)
+#endif
+
+#define ktg_msg(level, format, arg...)				\
+	printk(level ktg_MODULE_PREFIX				\
+		format,						\
+		## arg)
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#endif
+
+#endif
@@ -0,0 +1,719 @@
+/*
+ * kstreamer precomputed tone generator
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/list.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+
+#include <linux/kstreamer/kstreamer.h>
+#include <linux/kstreamer/node.h>
+#include <linux/kstreamer/pipeline.h>
+#include <linux/kstreamer/streamframe.h>
+#include <linux/kstreamer/softswitch.h>
+
+#include "tonegen.h"
+
+#ifdef DEBUG_CODE
+#ifdef DEBUG_DEFAULTS
+int debug_level = 3;
+#else
+int debug_level = 0;
+#endif
+#endif
+
+static char *country = "it";
+static int num_generators = 32;
+static int mu_law;
+
+static const char *ktg_tone_names[KTG_NUM_TONES] = {
+	[KTG_TONE_DIAL]		= "dial",
+	[KTG_TONE_BUSY]		= "busy",
+	[KTG_TONE_CONGESTION]	= "congestion",
+	[KTG_TONE_RINGBACK]	= "ringback",
+};
+
+/* Same cadences as Asterisk's indications.conf */
+static const struct ktg_country ktg_countries[] = {
+	{
+		.name = "it",
+		.tones = {
+			[KTG_TONE_DIAL] = {
+				{ 425, 0, 200 }, { 0, 0, 200 },
+				{ 425, 0, 600 }, { 0, 0, 1000 } },
+			[KTG_TONE_BUSY] = {
+				{ 425, 0, 500 }, { 0, 0, 500 } },
+			[KTG_TONE_CONGESTION] = {
+				{ 425, 0, 200 }, { 0, 0, 200 } },
+			[KTG_TONE_RINGBACK] = {
+				{ 425, 0, 1000 }, { 0, 0, 4000 } },
+		},
+	},
+	{
+		.name = "uk",
+		.tones = {
+			[KTG_TONE_DIAL] = {
+				{ 350, 440, 0 } },
+			[KTG_TONE_BUSY] = {
+				{ 400, 0, 375 }, { 0, 0, 375 } },
+			[KTG_TONE_CONGESTION] = {
+				{ 400, 0, 400 }, { 0, 0, 350 },
+				{ 400, 0, 225 }, { 0, 0, 525 } },
+			[KTG_TONE_RINGBACK] = {
+				{ 400, 450, 400 }, { 0, 0, 200 },
+				{ 400, 450, 400 }, { 0, 0, 2000 } },
+		},
+	},
+	{
+		.name = "us",
+		.tones = {
+			[KTG_TONE_DIAL] = {
+				{ 350, 440, 0 } },
+			[KTG_TONE_BUSY] = {
+				{ 480, 620, 500 }, { 0, 0, 500 } },
+			[KTG_TONE_CONGESTION] = {
+				{ 480, 620, 250 }, { 0, 0, 250 } },
+			[KTG_TONE_RINGBACK] = {
+				{ 440, 480, 2000 }, { 0, 0, 4000 } },
+		},
+	},
+	{
+		.name = "de",
+		.tones = {
+			[KTG_TONE_DIAL] = {
+				{ 425, 0, 0 } },
+			[KTG_TONE_BUSY] = {
+				{ 425, 0, 480 }, { 0, 0, 480 } },
+			[KTG_TONE_CONGESTION] = {
+				{ 425, 0, 240 }, { 0, 0, 240 } },
+			[KTG_TONE_RINGBACK] = {
+				{ 425, 0, 1000 }, { 0, 0, 4000 } },
+		},
+	},
+	{
+		.name = "fr",
+		.tones = {
+			[KTG_TONE_DIAL] = {
+				{ 440, 0, 0 } },
+			[KTG_TONE_BUSY] = {
+				{ 440, 0, 500 }, { 0, 0, 500 } },
+			[KTG_TONE_CONGESTION] = {
+				{ 440, 0, 250 }, { 0, 0, 250 } },
+			[KTG_TONE_RINGBACK] = {
+				{ 440, 0, 1500 }, { 0, 0, 3500 } },
+		},
+	},
+};
+
+static const struct ktg_country *ktg_country;
+
+static struct ktg_tone *ktg_tones[KTG_NUM_TONES];
+
+/* Protects the generators' positions and the tones' counters */
+static DEFINE_SPINLOCK(ktg_lock);
+
+static struct kss_rx_sched ktg_rx_sched;
+static int ktg_tick_samples;
+
+/*---------------------------------------------------------------------------*/
+
+/* Tables are synthesized once, at load, so a fixed point Taylor series is
+ * plenty. k is the phase in 1/8000ths of a cycle; x is in Q28 radians.
+ */
+
+#define KTG_Q 28
+
+static int __init ktg_sin(int amplitude, int k)
+{
+	int quadrant = k / 2000;
+	int frac = k % 2000;
+	s32 x;
+	s32 x2;
+	s32 t;
+	s32 s;
+
+	if (quadrant & 1)
+		frac = 2000 - frac;
+
+	/* pi / 2 / 2000 in Q28 */
+	x = frac * 210829;
+	x2 = ((s64)x * x) >> KTG_Q;
+
+	t = (1 << KTG_Q) - x2 / 72;
+	t = (1 << KTG_Q) - (s32)(((s64)x2 * t) >> KTG_Q) / 42;
+	t = (1 << KTG_Q) - (s32)(((s64)x2 * t) >> KTG_Q) / 20;
+	t = (1 << KTG_Q) - (s32)(((s64)x2 * t) >> KTG_Q) / 6;
+
+	s = ((s64)x * t) >> KTG_Q;
+	s = ((s64)amplitude * s) >> KTG_Q;
+
+	return (quadrant & 2) ? -s : s;
+}
+
+static int __init ktg_segment(int val, int first_end)
+{
+	int seg;
+
+	for (seg = 0; seg < 8; seg++, first_end = (first_end << 1) | 1) {
+		if (val <= first_end)
+			return seg;
+	}
+
+	return 8;
+}
+
+static u8 __init ktg_linear_to_alaw(int pcm_val)
+{
+	int mask;
+	int seg;
+	u8 aval;
+
+	pcm_val >>= 3;
+
+	if (pcm_val >= 0) {
+		mask = 0xd5;
+	} else {
+		mask = 0x55;
+		pcm_val = -pcm_val - 1;
+	}
+
+	seg = ktg_segment(pcm_val, 0x1f);
+	if (seg >= 8)
+		return 0x7f ^ mask;
+
+	aval = seg << 4;
+
+	if (seg < 2)
+		aval |= (pcm_val >> 1) & 0x0f;
+	else
+		aval |= (pcm_val >> seg) & 0x0f;
+
+	return aval ^ mask;
+}
+
+static u8 __init ktg_linear_to_ulaw(int pcm_val)
+{
+	int mask;
+	int seg;
+
+	pcm_val >>= 2;
+
+	if (pcm_val < 0) {
+		pcm_val = -pcm_val;
+		mask = 0x7f;
+	} else {
+		mask = 0xff;
+	}
+
+	if (pcm_val > 8159)
+		pcm_val = 8159;
+
+	pcm_val += 0x84 >> 2;
+
+	seg = ktg_segment(pcm_val, 0x3f);
+	if (seg >= 8)
+		return 0x7f ^ mask;
+
+	return ((seg << 4) | ((pcm_val >> (seg + 1)) & 0x0f)) ^ mask;
+}
+
+static int __init ktg_gcd(int a, int b)
+{
+	while (b) {
+		int t = a % b;
+
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
+
+/* A cadence is played in a loop, so its table is one whole cycle of it. A
+ * steady tone only needs the shortest number of samples after which both
+ * its frequencies are back in phase.
+ */
+static int __init ktg_cadence_len(const struct ktg_segment *cadence)
+{
+	const struct ktg_segment *step;
+	int len = 0;
+
+	if (!cadence[0].ms)
+		return KTG_SAMPLE_RATE / ktg_gcd(KTG_SAMPLE_RATE,
+			ktg_gcd(cadence[0].freq1, cadence[0].freq2));
+
+	for (step = cadence; step->ms; step++)
+		len += step->ms * KTG_SAMPLE_RATE / 1000;
+
+	return len;
+}
+
+static void __init ktg_synthesize(
+	const struct ktg_segment *cadence,
+	u8 *table,
+	int table_len)
+{
+	const struct ktg_segment *step = cadence;
+	int step_len;
+	int pos = 0;
+
+	step_len = step->ms ? step->ms * KTG_SAMPLE_RATE / 1000 : table_len;
+
+	while (pos < table_len) {
+		int amplitude = step->freq2 ?
+				KTG_AMPLITUDE_DUAL : KTG_AMPLITUDE_SINGLE;
+		int i;
+
+		for (i = 0; i < step_len; i++) {
+			int val = 0;
+
+			if (step->freq1)
+				val += ktg_sin(amplitude,
+					(step->freq1 * i) % KTG_SAMPLE_RATE);
+
+			if (step->freq2)
+				val += ktg_sin(amplitude,
+					(step->freq2 * i) % KTG_SAMPLE_RATE);
+
+			table[pos++] = mu_law ?
+					ktg_linear_to_ulaw(val) :
+					ktg_linear_to_alaw(val);
+		}
+
+		step++;
+		step_len = step->ms * KTG_SAMPLE_RATE / 1000;
+	}
+}
+
+/*---------------------------------------------------------------------------*/
+
+static ssize_t ktg_show_tone(
+	struct ks_node *ks_node,
+	struct ks_node_attribute *attr,
+	char *buf)
+{
+	struct ktg_tone *tone = container_of(ks_node, struct ktg_tone, ks_node);
+	const struct ktg_segment *step;
+	int active;
+	unsigned long out_octets;
+	int len = 0;
+
+	spin_lock_bh(&ktg_lock);
+	active = tone->active;
+	out_octets = tone->out_octets;
+	spin_unlock_bh(&ktg_lock);
+
+	len += snprintf(buf + len, PAGE_SIZE - len,
+		"country: %s\n"
+		"law: %s\n"
+		"cadence:",
+		ktg_country->name,
+		mu_law ? "mu" : "A");
+
+	for (step = tone->cadence; step->freq1 || step->ms; step++) {
+		len += snprintf(buf + len, PAGE_SIZE - len,
+			"%s%d", step == tone->cadence ? " " : ",",
+			step->freq1);
+
+		if (step->freq2)
+			len += snprintf(buf + len, PAGE_SIZE - len,
+				"+%d", step->freq2);
+
+		if (step->ms)
+			len += snprintf(buf + len, PAGE_SIZE - len,
+				"/%d", step->ms);
+	}
+
+	len += snprintf(buf + len, PAGE_SIZE - len,
+		"\n"
+		"table: %d\n"
+		"generators: %d/%d\n"
+		"out_octets: %lu\n",
+		tone->table_len,
+		active, tone->num_generators,
+		out_octets);
+
+	return len;
+}
+
+static KS_NODE_ATTR(tone, S_IRUGO,
+		ktg_show_tone,
+		NULL);
+
+static ssize_t ktg_show_rx_sched(
+	struct ks_node *ks_node,
+	struct ks_node_attribute *attr,
+	char *buf)
+{
+	return kss_rx_sched_show_stats(&ktg_rx_sched, buf);
+}
+
+static KS_NODE_ATTR(rx_sched, S_IRUGO,
+		ktg_show_rx_sched,
+		NULL);
+
+/*---------------------------------------------------------------------------*/
+
+static void ktg_node_release(struct ks_node *ks_node)
+{
+	ktg_debug(3, "ktg_node_release()\n");
+}
+
+static struct ks_node_ops ktg_tone_node_ops = {
+	.owner		= THIS_MODULE,
+
+	.release	= ktg_node_release,
+};
+
+/*---------------------------------------------------------------------------*/
+
+static void ktg_chan_release(struct ks_chan *ks_chan)
+{
+	ktg_debug(3, "ktg_chan_release()\n");
+}
+
+static int ktg_chan_connect(struct ks_chan *ks_chan)
+{
+	ktg_debug(3, "ktg_chan_connect()\n");
+
+	return 0;
+}
+
+static void ktg_chan_disconnect(struct ks_chan *ks_chan)
+{
+	ktg_debug(3, "ktg_chan_disconnect()\n");
+}
+
+static int ktg_chan_open(struct ks_chan *ks_chan)
+{
+	ktg_debug(3, "ktg_chan_open()\n");
+
+	return 0;
+}
+
+static void ktg_chan_close(struct ks_chan *ks_chan)
+{
+	ktg_debug(3, "ktg_chan_close()\n");
+}
+
+/* Every time a generator is started the tone plays from its beginning */
+static int ktg_chan_start(struct ks_chan *ks_chan)
+{
+	struct ktg_generator *gen =
+		container_of(ks_chan, struct ktg_generator, ks_chan);
+
+	ktg_debug(3, "ktg_chan_start()\n");
+
+	spin_lock_bh(&ktg_lock);
+	gen->pos = 0;
+	gen->tone->active++;
+	spin_unlock_bh(&ktg_lock);
+
+	kss_rx_sched_add(&ktg_rx_sched, &gen->sched_entry, ks_chan);
+
+	return 0;
+}
+
+static void ktg_chan_stop(struct ks_chan *ks_chan)
+{
+	struct ktg_generator *gen =
+		container_of(ks_chan, struct ktg_generator, ks_chan);
+
+	ktg_debug(3, "ktg_chan_stop()\n");
+
+	kss_rx_sched_del(&ktg_rx_sched, &gen->sched_entry);
+
+	spin_lock_bh(&ktg_lock);
+	gen->tone->active--;
+	spin_unlock_bh(&ktg_lock);
+}
+
+static struct ks_chan_ops ktg_chan_ops = {
+	.owner		= THIS_MODULE,
+
+	.release	= ktg_chan_release,
+	.connect	= ktg_chan_connect,
+	.disconnect	= ktg_chan_disconnect,
+	.open		= ktg_chan_open,
+	.close		= ktg_chan_close,
+	.start		= ktg_chan_start,
+	.stop		= ktg_chan_stop,
+};
+
+/*---------------------------------------------------------------------------*/
+
+static void ktg_rx_sched_lock(struct kss_rx_sched *sched)
+{
+	spin_lock_bh(&ktg_lock);
+}
+
+static void ktg_rx_sched_unlock(struct kss_rx_sched *sched)
+{
+	spin_unlock_bh(&ktg_lock);
+}
+
+/* Nothing is synthesized here, a tick is a copy out of the shared table */
+static void ktg_rx_sched_drain(
+	struct kss_rx_sched *sched,
+	struct ks_chan *ks_chan,
+	struct ks_streamframe *sf)
+{
+	struct ktg_generator *gen =
+		container_of(ks_chan, struct ktg_generator, ks_chan);
+	struct ktg_tone *tone = gen->tone;
+	int n = min_t(int, ktg_tick_samples, sf->size);
+	int len = 0;
+
+	while (len < n) {
+		int chunk = min(n - len, tone->table_len - gen->pos);
+
+		memcpy(sf->data + len, tone->table + gen->pos, chunk);
+
+		len += chunk;
+		gen->pos += chunk;
+
+		if (gen->pos == tone->table_len)
+			gen->pos = 0;
+	}
+
+	sf->len = n;
+
+	tone->out_octets += n;
+}
+
+static struct kss_rx_sched_ops ktg_rx_sched_ops = {
+	.lock		= ktg_rx_sched_lock,
+	.unlock		= ktg_rx_sched_unlock,
+	.drain		= ktg_rx_sched_drain,
+};
+
+/*---------------------------------------------------------------------------*/
+
+static struct ktg_tone * __init ktg_tone_create(
+	enum ktg_tone_type type,
+	int num_generators)
+{
+	struct ktg_tone *tone;
+	int i;
+
+	tone = kmalloc(sizeof(*tone), GFP_KERNEL);
+	if (!tone)
+		goto err_alloc_tone;
+
+	memset(tone, 0, sizeof(*tone));
+
+	tone->type = type;
+	tone->cadence = ktg_country->tones[type];
+
+	tone->table_len = ktg_cadence_len(tone->cadence);
+	tone->table = vmalloc(tone->table_len);
+	if (!tone->table)
+		goto err_alloc_table;
+
+	ktg_synthesize(tone->cadence, tone->table, tone->table_len);
+
+	tone->generators = kmalloc(sizeof(*tone->generators) * num_generators,
+								GFP_KERNEL);
+	if (!tone->generators)
+		goto err_alloc_generators;
+
+	memset(tone->generators, 0,
+		sizeof(*tone->generators) * num_generators);
+
+	tone->num_generators = num_generators;
+
+	ks_node_create(&tone->ks_node, &ktg_tone_node_ops, "tone",
+			&ks_system_device.kobj);
+	kobject_set_name(&tone->ks_node.kobj, "tone-%s",
+			ktg_tone_names[type]);
+
+	for (i = 0; i < num_generators; i++) {
+		struct ktg_generator *gen = &tone->generators[i];
+		char name[16];
+
+		gen->tone = tone;
+		gen->id = i;
+
+		snprintf(name, sizeof(name), "tx%d", i);
+
+		ks_chan_create(&gen->ks_chan, &ktg_chan_ops, name, NULL,
+				&tone->ks_node.kobj,
+				&tone->ks_node,
+				&kss_softswitch.ks_node);
+	}
+
+	return tone;
+
+err_alloc_generators:
+	vfree(tone->table);
+err_alloc_table:
+	kfree(tone);
+err_alloc_tone:
+
+	return NULL;
+}
+
+static void ktg_tone_destroy(struct ktg_tone *tone)
+{
+	kfree(tone->generators);
+	vfree(tone->table);
+	kfree(tone);
+}
+
+static int ktg_tone_register(struct ktg_tone *tone)
+{
+	int err;
+	int i;
+
+	err = ks_node_register(&tone->ks_node);
+	if (err < 0)
+		goto err_node_register;
+
+	err = ks_node_create_file(&tone->ks_node, &ks_node_attr_tone);
+	if (err < 0)
+		goto err_create_file_tone;
+
+	err = ks_node_create_file(&tone->ks_node, &ks_node_attr_rx_sched);
+	if (err < 0)
+		goto err_create_file_rx_sched;
+
+	for (i = 0; i < tone->num_generators; i++) {
+		err = ks_chan_register(&tone->generators[i].ks_chan);
+		if (err < 0)
+			goto err_chan_register;
+	}
+
+	return 0;
+
+err_chan_register:
+	while (--i >= 0)
+		ks_chan_unregister(&tone->generators[i].ks_chan);
+
+	ks_node_remove_file(&tone->ks_node, &ks_node_attr_rx_sched);
+err_create_file_rx_sched:
+	ks_node_remove_file(&tone->ks_node, &ks_node_attr_tone);
+err_create_file_tone:
+	ks_node_unregister(&tone->ks_node);
+err_node_register:
+
+	return err;
+}
+
+static void ktg_tone_unregister(struct ktg_tone *tone)
+{
+	int i;
+
+	for (i = tone->num_generators - 1; i >= 0; i--)
+		ks_chan_unregister(&tone->generators[i].ks_chan);
+
+	ks_node_remove_file(&tone->ks_node, &ks_node_attr_rx_sched);
+	ks_node_remove_file(&tone->ks_node, &ks_node_attr_tone);
+
+	ks_node_unregister(&tone->ks_node);
+}
+
+/******************************************
+ * Module stuff
+ ******************************************/
+
+static int __init ktg_init_module(void)
+{
+	int err;
+	int i;
+
+	ktg_msg(KERN_INFO, ktg_MODULE_DESCR " loading\n");
+
+	if (num_generators < 1 || num_generators > KTG_MAX_GENERATORS) {
+		err = -EINVAL;
+		goto err_params;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(ktg_countries); i++) {
+		if (!strcmp(ktg_countries[i].name, country))
+			ktg_country = &ktg_countries[i];
+	}
+
+	if (!ktg_country) {
+		ktg_msg(KERN_ERR, "Unknown country '%s'\n", country);
+		err = -EINVAL;
+		goto err_params;
+	}
+
+	kss_rx_sched_init(&ktg_rx_sched, &ktg_rx_sched_ops,
+			KTG_RX_SCHED_FREQUENCY, NULL);
+
+	ktg_tick_samples = KTG_SAMPLE_RATE * ktg_rx_sched.interval / HZ;
+
+	for (i = 0; i < KTG_NUM_TONES; i++) {
+		ktg_tones[i] = ktg_tone_create(i, num_generators);
+		if (!ktg_tones[i]) {
+			err = -ENOMEM;
+			goto err_tone_create;
+		}
+
+		err = ktg_tone_register(ktg_tones[i]);
+		if (err < 0) {
+			ktg_tone_destroy(ktg_tones[i]);
+			goto err_tone_register;
+		}
+	}
+
+	return 0;
+
+err_tone_register:
+err_tone_create:
+	while (--i >= 0) {
+		ktg_tone_unregister(ktg_tones[i]);
+		ktg_tone_destroy(ktg_tones[i]);
+	}
+
+	kss_rx_sched_destroy(&ktg_rx_sched);
+err_params:
+
+	return err;
+}
+
+module_init(ktg_init_module);
+
+static void __exit ktg_module_exit(void)
+{
+	int i;
+
+	for (i = KTG_NUM_TONES - 1; i >= 0; i--)
+		ktg_tone_unregister(ktg_tones[i]);
+
+	kss_rx_sched_destroy(&ktg_rx_sched);
+
+	for (i = KTG_NUM_TONES - 1; i >= 0; i--)
+		ktg_tone_destroy(ktg_tones[i]);
+
+	ktg_msg(KERN_INFO, ktg_MODULE_DESCR " unloaded\n");
+}
+
+module_exit(ktg_module_exit);
+
+MODULE_DESCRIPTION(ktg_MODULE_DESCR);
+MODULE_AUTHOR("vstuff contributors");
+MODULE_LICENSE("GPL");
+
+module_param(country, charp, 0444);
+MODULE_PARM_DESC(country, "Country of the cadences (it, uk, us, de, fr)");
+module_param(num_generators, int, 0444);
+MODULE_PARM_DESC(num_generators, "Number of generators per tone");
+module_param(mu_law, int, 0444);
+MODULE_PARM_DESC(mu_law, "Generate mu-law instead of A-law");
+
+#ifdef DEBUG_CODE
+module_param(debug_level, int, 0444);
+MODULE_PARM_DESC(debug_level, "Initial debug level");
+#endif
@@ -23,6 +23,26 @@ struct ksup_ctl
 	__u32 node_id;
 };
 
+/* Status page, mapped read-only by mmap()ing one page at offset 0 of the
+ * userport file descriptor. The kernel bumps seq before and after each
+ * update, readers retry while seq is odd or changed under them.
+ */
+#define KS_UP_STATUS_VERSION	1
+
+struct ksup_status
+{
+	__u32 version;
+	__u32 seq;
+
+	__s32 tx_pressure;
+	__u32 tx_stamp_sec;
+	__u32 tx_stamp_usec;
+	__u32 tx_octets;
+
+	__u32 rx_octets;
+	__u32 rx_overruns;
+};
+
 #ifdef __KERNEL__
 
 #if LINUX_VERSION_CODE <= KERNEL_VERSION(2,6,9)
@@ -41,6 +61,9 @@ struct ksup_ctl
 #define SB_CHAN_HASHBITS 8
 #define SB_CHAN_HASHSIZE (1 << SB_CHAN_HASHBITS)
 
+/* Octets of queued RX frames after which new ones are dropped */
+#define KSUP_READ_SFS_MAX_OCTETS 1024
+
 #define to_ksup_chan(vchan) container_of((vchan), struct ksup_chan, visdn_chan)
 
 enum ksup_h223_rx_state
@@ -64,11 +87,20 @@ struct ksup_chan
 
 	int framed;
 
-	struct timer_list stimulus_timer;
-	int stimulus_frequency;
+	struct list_head stimulus_node;
+	int needs_stimulus;
+
+	struct ksup_status *status;
+	spinlock_t status_lock;
 
-	struct kfifo *read_fifo;
-	spinlock_t read_fifo_lock;
+	/* Frames taken from the RX pipeline, read() copies straight out of
+	 * them. The frames are shared with the pipeline and never modified,
+	 * a partially read head frame is resumed at read_sf_offset.
+	 */
+	struct list_head read_sfs;
+	int read_sfs_octets;
+	int read_sf_offset;
+	spinlock_t read_sfs_lock;
 	wait_queue_head_t read_wait_queue;
 	struct sk_buff_head read_queue;
 
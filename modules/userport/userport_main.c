@@ -18,6 +18,8 @@
 #include <linux/device.h>
 #include <linux/list.h>
 #include <linux/poll.h>
+#include <linux/mm.h>
+#include <linux/time.h>
 
 #include <linux/kstreamer/kstreamer.h>
 #include <linux/kstreamer/node.h>
@@ -54,6 +56,18 @@ static struct device ksup_frame_device;
 struct list_head ksup_chans_list = LIST_HEAD_INIT(ksup_chans_list);
 static rwlock_t ksup_chans_list_lock = RW_LOCK_UNLOCKED;
 
+/* A single timer serves all the started RX userports: it stimulates the
+ * pipelines which still contain elements needing to be polled (drivers with
+ * a per-card RX scheduler do not) and refreshes the TX status pages.
+ */
+static int stimulus_frequency = 50;
+
+static struct list_head ksup_stimulus_list =
+				LIST_HEAD_INIT(ksup_stimulus_list);
+static spinlock_t ksup_stimulus_lock = SPIN_LOCK_UNLOCKED;
+static struct timer_list ksup_stimulus_timer;
+static int ksup_stimulus_armed;
+
 static struct ksup_chan *ksup_chan_get(struct ksup_chan *chan)
 {
 	if (ks_node_get(&chan->ks_node))
@@ -105,6 +119,22 @@ static int _ksup_chan_new_id(void)
 	}
 }
 
+static void ksup_chan_flush_read_sfs(struct ksup_chan *chan)
+{
+	struct ks_streamframe *sf, *t;
+	unsigned long flags;
+
+	spin_lock_irqsave(&chan->read_sfs_lock, flags);
+	list_for_each_entry_safe(sf, t, &chan->read_sfs, node) {
+		list_del_init(&sf->node);
+		ks_sf_put(sf);
+	}
+
+	chan->read_sfs_octets = 0;
+	chan->read_sf_offset = 0;
+	spin_unlock_irqrestore(&chan->read_sfs_lock, flags);
+}
+
 static void ksup_node_release(struct ks_node *ks_node)
 {
 	struct ksup_chan *chan = container_of(ks_node,
@@ -112,7 +142,10 @@ static void ksup_node_release(struct ks_node *ks_node)
 
 	ksup_debug(3, "ksup_node_release()\n");
 
-	kfifo_free(chan->read_fifo);
+	ksup_chan_flush_read_sfs(chan);
+
+	ClearPageReserved(virt_to_page(chan->status));
+	free_page((unsigned long)chan->status);
 
 	kfree(chan);
 }
@@ -125,6 +158,41 @@ static struct ks_node_ops ksup_chan_node_ops = {
 
 /*---------------------------------------------------------------------------*/
 
+static inline void ksup_status_write_begin(struct ksup_chan *chan)
+{
+	spin_lock_bh(&chan->status_lock);
+	chan->status->seq++;
+	smp_wmb();
+}
+
+static inline void ksup_status_write_end(struct ksup_chan *chan)
+{
+	smp_wmb();
+	chan->status->seq++;
+	spin_unlock_bh(&chan->status_lock);
+}
+
+static void ksup_status_update_tx(struct ksup_chan *chan, int octets)
+{
+	struct timeval tv;
+	int pressure;
+
+	/* Query the pressure outside status_lock, the driver may take its
+	 * own locks in get_pressure
+	 */
+	pressure = kss_chan_get_pressure(chan->ks_chan_tx);
+	do_gettimeofday(&tv);
+
+	ksup_status_write_begin(chan);
+	chan->status->tx_pressure = pressure;
+	chan->status->tx_stamp_sec = tv.tv_sec;
+	chan->status->tx_stamp_usec = tv.tv_usec;
+	chan->status->tx_octets += octets;
+	ksup_status_write_end(chan);
+}
+
+/*---------------------------------------------------------------------------*/
+
 static void ksup_chan_rx_chan_release(struct ks_chan *ks_chan)
 {
 	ksup_debug(3, "ksup_chan_rx_chan_release()\n");
@@ -156,15 +224,36 @@ static void ksup_chan_rx_chan_close(struct ks_chan *ks_chan)
 	ksup_debug(3, "ksup_chan_rx_chan_close()\n");
 }
 
-static void ksup_timer_func(unsigned long data)
+static void ksup_stimulus_timer_func(unsigned long data)
 {
-	struct ksup_chan *chan = (struct ksup_chan *)data;
+	struct ksup_chan *chan;
+
+	spin_lock(&ksup_stimulus_lock);
+
+	list_for_each_entry(chan, &ksup_stimulus_list, stimulus_node) {
+		if (chan->needs_stimulus)
+			ks_pipeline_stimulate(chan->ks_chan_rx->pipeline);
+
+		/* Keep the TX fill level fresh between writes */
+		if (chan->ks_chan_tx && chan->ks_chan_tx->pipeline &&
+		    chan->ks_chan_tx->pipeline->status ==
+					KS_PIPELINE_STATUS_FLOWING)
+			ksup_status_update_tx(chan, 0);
+	}
 
-	chan->stimulus_timer.expires += HZ / chan->stimulus_frequency;
+	if (list_empty(&ksup_stimulus_list)) {
+		ksup_stimulus_armed = FALSE;
+	} else {
+		ksup_stimulus_timer.expires += HZ / stimulus_frequency;
+
+		if (time_after_eq(jiffies, ksup_stimulus_timer.expires))
+			ksup_stimulus_timer.expires =
+				jiffies + HZ / stimulus_frequency;
 
-	ks_pipeline_stimulate(chan->ks_chan_rx->pipeline);
+		add_timer(&ksup_stimulus_timer);
+	}
 
-	add_timer(&chan->stimulus_timer);
+	spin_unlock(&ksup_stimulus_lock);
 }
 
 static int ksup_chan_rx_chan_start(struct ks_chan *ks_chan)
@@ -173,11 +262,20 @@ static int ksup_chan_rx_chan_start(struct ks_chan *ks_chan)
 
 	ksup_debug(3, "ksup_chan_rx_chan_start()\n");
 
-	chan->stimulus_timer.expires = jiffies;
-	chan->stimulus_timer.function = ksup_timer_func;
-	chan->stimulus_timer.data = (unsigned long)chan;
+	chan->needs_stimulus = ks_pipeline_needs_stimulus(ks_chan->pipeline);
+
+	spin_lock_bh(&ksup_stimulus_lock);
+
+	if (list_empty(&chan->stimulus_node))
+		list_add_tail(&chan->stimulus_node, &ksup_stimulus_list);
 
-	add_timer(&chan->stimulus_timer);
+	if (!ksup_stimulus_armed) {
+		ksup_stimulus_armed = TRUE;
+		ksup_stimulus_timer.expires = jiffies + HZ / stimulus_frequency;
+		add_timer(&ksup_stimulus_timer);
+	}
+
+	spin_unlock_bh(&ksup_stimulus_lock);
 
 	return 0;
 }
@@ -188,7 +286,13 @@ static void ksup_chan_rx_chan_stop(struct ks_chan *ks_chan)
 
 	ksup_debug(3, "ksup_chan_rx_chan_stop()\n");
 
-	del_timer_sync(&chan->stimulus_timer);
+	/* Once removed the timer will not touch the channel anymore, it
+	 * stops by itself when the list becomes empty
+	 */
+	spin_lock_bh(&ksup_stimulus_lock);
+	if (!list_empty(&chan->stimulus_node))
+		list_del_init(&chan->stimulus_node);
+	spin_unlock_bh(&ksup_stimulus_lock);
 }
 
 struct ks_chan_ops ksup_chan_rx_chan_ops = {
@@ -262,20 +366,38 @@ struct ks_chan_ops ksup_chan_tx_chan_ops = {
 
 /*---------------------------------------------------------------------------*/
 
+/* The frame is kept as it is instead of being copied, read() copies the
+ * payload directly to userspace
+ */
 static int ksup_chan_rx_chan_push_raw(
 	struct ks_chan *ks_chan,
 	struct ks_streamframe *sf)
 {
 	struct ksup_chan *chan = ks_chan->driver_data;
+	unsigned long flags;
+	int queued = FALSE;
 
-#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,33)
-	if (__kfifo_put(chan->read_fifo, sf->data, sf->len))
-		wake_up(&chan->read_wait_queue);
+	if (!sf->len)
+		return 0;
 
-#else
-	if (kfifo_in(chan->read_fifo, sf->data, sf->len))
+	spin_lock_irqsave(&chan->read_sfs_lock, flags);
+	if (chan->read_sfs_octets + sf->len <= KSUP_READ_SFS_MAX_OCTETS) {
+		list_add_tail(&ks_sf_get(sf)->node, &chan->read_sfs);
+		chan->read_sfs_octets += sf->len;
+		queued = TRUE;
+	}
+	spin_unlock_irqrestore(&chan->read_sfs_lock, flags);
+
+	if (queued)
 		wake_up(&chan->read_wait_queue);
-#endif
+
+	ksup_status_write_begin(chan);
+	if (queued)
+		chan->status->rx_octets += sf->len;
+	else
+		chan->status->rx_overruns++;
+	ksup_status_write_end(chan);
+
 	return 0;
 }
 
@@ -301,11 +423,6 @@ static struct ksup_chan *ksup_chan_create(
 	struct ksup_chan *chan,
 	int framed)
 {
-#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,33)
-
-#else
-	int alloc_ret;
-#endif
 	BUG_ON(chan);
 
 	if (!chan) {
@@ -316,24 +433,20 @@ static struct ksup_chan *ksup_chan_create(
 
 	memset(chan, 0, sizeof(*chan));
 
-	init_timer(&chan->stimulus_timer);
-	chan->stimulus_frequency = 50;
 	chan->framed = framed;
 
-	spin_lock_init(&chan->read_fifo_lock);
-#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,33)
-	chan->read_fifo = kfifo_alloc(1024, GFP_KERNEL, &chan->read_fifo_lock);
-	if (!chan->read_fifo)
-		goto err_fifo_rx_alloc;
+	INIT_LIST_HEAD(&chan->stimulus_node);
 
-#else
- 	chan->read_fifo = kmalloc(sizeof(struct kfifo),GFP_KERNEL);
-	if (IS_ERR(chan->read_fifo))
-		goto err_fifo_rx_alloc;	
-	alloc_ret =kfifo_alloc(chan->read_fifo,1024,GFP_KERNEL);
-	if (alloc_ret == -ENOMEM) 
-	     goto err_fifo_rx_alloc;
-#endif
+	chan->status = (struct ksup_status *)get_zeroed_page(GFP_KERNEL);
+	if (!chan->status)
+		goto err_status_alloc;
+
+	SetPageReserved(virt_to_page(chan->status));
+	chan->status->version = KS_UP_STATUS_VERSION;
+	spin_lock_init(&chan->status_lock);
+
+	INIT_LIST_HEAD(&chan->read_sfs);
+	spin_lock_init(&chan->read_sfs_lock);
         skb_queue_head_init(&chan->read_queue);
 	init_waitqueue_head(&chan->read_wait_queue);
 
@@ -343,8 +456,9 @@ static struct ksup_chan *ksup_chan_create(
 
 	return chan;
 
-	kfifo_free(chan->read_fifo);
-err_fifo_rx_alloc:
+	ClearPageReserved(virt_to_page(chan->status));
+	free_page((unsigned long)chan->status);
+err_status_alloc:
 	kfree(chan);
 err_kmalloc:
 
@@ -512,28 +626,59 @@ static int ksup_cdev_release(
 	return 0;
 }
 
-ssize_t __kfifo_get_user(
-	struct kfifo *fifo,
-	void __user *buffer,
-	ssize_t len)
+static ssize_t ksup_chan_read_sfs(
+	struct ksup_chan *chan,
+	char __user *buf,
+	size_t count)
 {
-	ssize_t l;
+	struct ks_streamframe *sf;
+	unsigned long flags;
+	size_t copied = 0;
+	size_t offset;
+	size_t len;
+
+	while(copied < count) {
+		spin_lock_irqsave(&chan->read_sfs_lock, flags);
+		if (list_empty(&chan->read_sfs)) {
+			spin_unlock_irqrestore(&chan->read_sfs_lock, flags);
+			break;
+		}
 
-	len = min(len, (ssize_t)(fifo->in - fifo->out));
+		sf = list_entry(chan->read_sfs.next,
+				struct ks_streamframe, node);
+		list_del_init(&sf->node);
+		offset = chan->read_sf_offset;
+		chan->read_sf_offset = 0;
+		chan->read_sfs_octets -= sf->len - offset;
+		spin_unlock_irqrestore(&chan->read_sfs_lock, flags);
 
-	/* first get the data from fifo->out until the end of the buffer */
-	l = min(len, (ssize_t)(fifo->size - (fifo->out & (fifo->size - 1))));
-	if (copy_to_user(buffer, fifo->buffer + (fifo->out & (fifo->size - 1)),
-									l))
-		return -EFAULT;
+		len = min(count - copied, (size_t)(sf->len - offset));
 
-	/* then get the rest (if any) from the beginning of the buffer */
-	if (copy_to_user(buffer + l, fifo->buffer, len - l))
-		return -EFAULT;
+		if (copy_to_user(buf + copied, sf->data + offset, len)) {
+			ks_sf_put(sf);
+			return copied ? copied : -EFAULT;
+		}
 
-	fifo->out += len;
+		copied += len;
 
-	return len;
+		if (offset + len < sf->len) {
+			/* The frame may still be shared with the pipeline,
+			 * leave it alone and remember where we stopped
+			 */
+			spin_lock_irqsave(&chan->read_sfs_lock, flags);
+			list_add(&sf->node, &chan->read_sfs);
+			chan->read_sf_offset = offset + len;
+			chan->read_sfs_octets += sf->len - offset - len;
+			spin_unlock_irqrestore(&chan->read_sfs_lock, flags);
+
+			break;
+		}
+
+		ks_sf_delivered(sf);
+		ks_sf_put(sf);
+	}
+
+	return copied;
 }
 
 static ssize_t ksup_cdev_read(
@@ -566,7 +711,7 @@ static ssize_t ksup_cdev_read(
 			return -EFAULT;
 		}
 	} else {
-		copied = __kfifo_get_user(chan->read_fifo, buf, count);
+		copied = ksup_chan_read_sfs(chan, buf, count);
 		if (copied < 0)
 			return -EFAULT;
 	}
@@ -628,6 +773,7 @@ static ssize_t ksup_cdev_write_stream(
 	}
 
 	sf->len = copied_bytes;
+	ks_sf_count_copy(sf);
 
 	err = kss_chan_push_raw(chan->ks_chan_tx, sf);
 	if (err < 0)
@@ -635,6 +781,8 @@ static ssize_t ksup_cdev_write_stream(
 
 	ks_sf_put(sf);
 
+	ksup_status_update_tx(chan, copied_bytes);
+
 	return copied_bytes;
 
 err_kss_chan_push_raw:
@@ -747,6 +895,32 @@ static int ksup_cdev_ioctl(
 	return 0;
 }
 
+static int ksup_cdev_mmap(
+	struct file *file,
+	struct vm_area_struct *vma)
+{
+	struct ksup_chan *chan = file->private_data;
+
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start != PAGE_SIZE)
+		return -EINVAL;
+
+	/* The status page is written by the kernel only */
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,10)
+	return remap_page_range(vma, vma->vm_start,
+			virt_to_phys(chan->status),
+			PAGE_SIZE, vma->vm_page_prot);
+#else
+	return remap_pfn_range(vma, vma->vm_start,
+			virt_to_phys(chan->status) >> PAGE_SHIFT,
+			PAGE_SIZE, vma->vm_page_prot);
+#endif
+}
+
 #if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,20)
 static unsigned int ksup_cdev_poll(
 	struct file *file,
@@ -768,7 +942,7 @@ static unsigned int ksup_cdev_poll(
 			if (!skb_queue_empty(&chan->read_queue))
 				return POLLIN | POLLRDNORM;
 		} else {
-			if (kfifo_len(chan->read_fifo))
+			if (!list_empty(&chan->read_sfs))
 				return POLLIN | POLLRDNORM;
 		}
 	}
@@ -784,6 +958,7 @@ static struct file_operations ksup_fops =
 	.read		= ksup_cdev_read,
 	.write		= ksup_cdev_write,
 	.ioctl		= ksup_cdev_ioctl,
+	.mmap		= ksup_cdev_mmap,
 	.open		= ksup_cdev_open,
 	.release	= ksup_cdev_release,
 	.llseek		= no_llseek,
@@ -811,6 +986,12 @@ static int __init ksup_init_module(void)
 
 	ksup_msg(KERN_INFO, ksup_MODULE_DESCR " loading\n");
 
+	if (stimulus_frequency < 1 || stimulus_frequency > HZ)
+		stimulus_frequency = 50;
+
+	init_timer(&ksup_stimulus_timer);
+	ksup_stimulus_timer.function = ksup_stimulus_timer_func;
+
 	err = alloc_chrdev_region(&ksup_first_dev, 0, 3, ksup_MODULE_NAME);
 	if (err < 0)
 		goto err_register_chrdev;
@@ -1010,6 +1191,8 @@ static void __exit ksup_module_exit(void)
 	cdev_del(&ksup_cdev);
 	unregister_chrdev_region(ksup_first_dev, 3);
 
+	del_timer_sync(&ksup_stimulus_timer);
+
 	ksup_msg(KERN_INFO, ksup_MODULE_DESCR " unloaded\n");
 }
 
@@ -1019,6 +1202,9 @@ MODULE_DESCRIPTION(ksup_MODULE_DESCR);
 MODULE_AUTHOR("Daniele (Vihai) Orlandi <daniele@orlandi.com>");
 MODULE_LICENSE("GPL");
 
+module_param(stimulus_frequency, int, 0444);
+MODULE_PARM_DESC(stimulus_frequency, "Userports stimulus frequency (Hz)");
+
 #ifdef DEBUG_CODE
 module_param(debug_level, int, 0444);
 MODULE_PARM_DESC(debug_level, "Initial debug level");
@@ -765,6 +765,23 @@ void vgsm_card_put(struct vgsm_card *card)
 }
 
 
+static void vgsm_card_rx_sched_lock(struct kss_rx_sched *sched)
+{
+	vgsm_card_lock(sched->driver_data);
+}
+
+static void vgsm_card_rx_sched_unlock(struct kss_rx_sched *sched)
+{
+	vgsm_card_unlock(sched->driver_data);
+}
+
+static struct kss_rx_sched_ops vgsm_card_rx_sched_ops =
+{
+	.lock	= vgsm_card_rx_sched_lock,
+	.unlock	= vgsm_card_rx_sched_unlock,
+	.drain	= vgsm_me_rx_drain,
+};
+
 static void vgsm_card_init(
 	struct vgsm_card *card,
 	struct pci_dev *pci_dev,
@@ -783,6 +800,9 @@ static void vgsm_card_init(
 
 	spin_lock_init(&card->lock);
 
+	kss_rx_sched_init(&card->rx_sched, &vgsm_card_rx_sched_ops,
+				vgsm_RX_SCHED_FREQUENCY, card);
+
 	tasklet_init(&card->rx_tasklet, vgsm_card_rx_tasklet,
 			(unsigned long)card);
 
@@ -1073,6 +1093,8 @@ void vgsm_card_remove(struct vgsm_card *card)
 		}
 	}
 
+	kss_rx_sched_destroy(&card->rx_sched);
+
 	/* Disable IRQs */
 	vgsm_outb(card, VGSM_MASK0, 0x00);
 	vgsm_outb(card, VGSM_MASK1, 0x00);
@@ -27,6 +27,8 @@
 #include <linux/kfifo.h>
 #endif
 
+#include <linux/kstreamer/softswitch.h>
+
 #include "me.h"
 #include "micro.h"
 
@@ -60,6 +62,9 @@
 
 #define vgsm_SERIAL_BUFF	0x1000
 
+/* ME RX FIFOs are drained by the card's scheduler at this rate */
+#define vgsm_RX_SCHED_FREQUENCY	50
+
 enum vgsm_card_flags
 {
 	VGSM_CARD_FLAGS_SHUTTING_DOWN,
@@ -106,6 +111,8 @@ struct vgsm_card
 	struct tasklet_struct tx_tasklet;
 	int rr_last_me;
 
+	struct kss_rx_sched rx_sched;
+
 	struct timer_list maint_timer;
 };
 
@@ -255,6 +255,8 @@ static int vgsm_me_rx_chan_start(struct ks_chan *ks_chan)
 	vgsm_update_mask0(card);
 	vgsm_card_unlock(card);
 
+	kss_rx_sched_add(&card->rx_sched, &me_rx->sched_entry, ks_chan);
+
 	vgsm_debug_me(me, 1, "RX started.\n");
 
 	return 0;
@@ -267,6 +269,8 @@ static void vgsm_me_rx_chan_stop(struct ks_chan *ks_chan)
 	struct vgsm_me *me = me_rx->me;
 	struct vgsm_card *card = me->card;
 
+	kss_rx_sched_del(&card->rx_sched, &me_rx->sched_entry);
+
 	vgsm_card_lock(card);
 	me_rx->running = FALSE;
 	vgsm_update_mask0(card);
@@ -275,31 +279,25 @@ static void vgsm_me_rx_chan_stop(struct ks_chan *ks_chan)
 	vgsm_debug_me(me, 1, "RX stopped.\n");
 }
 
-static void vgsm_me_rx_chan_stimulus(
-	struct ks_chan *ks_chan)
+/* Called by the card's RX scheduler with the card lock held */
+void vgsm_me_rx_drain(
+	struct kss_rx_sched *sched,
+	struct ks_chan *ks_chan,
+	struct ks_streamframe *sf)
 {
 	struct vgsm_me_rx *me_rx =
 		container_of(ks_chan, struct vgsm_me_rx, ks_chan);
 	struct vgsm_me *me = me_rx->me;
 	struct vgsm_card *card = me->card;
-	size_t copied_octets = 0;
 	int inpos;
 	u8 *bufp;
 
-	struct ks_streamframe *sf;
-
-	sf = ks_sf_alloc();
-	if (!sf)
-		return;
-
 	bufp = sf->data;
 
-	vgsm_card_lock(card);
-
 	inpos = (le32_to_cpu(vgsm_inl(card, VGSM_DMA_RD_CUR)) -
 				card->readdma_bus_mem) / 4;
 
-	while(me_rx->fifo_pos != inpos && copied_octets < sf->size) {
+	while(me_rx->fifo_pos != inpos && sf->len < sf->size) {
 
 		*bufp++ = *(u8 *)(card->readdma_mem +
 				(me_rx->fifo_pos * 4) +
@@ -312,12 +310,6 @@ static void vgsm_me_rx_chan_stimulus(
 
 		sf->len++;
 	}
-
-	vgsm_card_unlock(card);
-
-	kss_chan_push_raw(ks_chan, sf);
-
-	ks_sf_put(sf);
 }
 
 
@@ -331,7 +323,6 @@ static struct ks_chan_ops vgsm_me_rx_chan_ops = {
 	.close		= vgsm_me_rx_chan_close,
 	.start		= vgsm_me_rx_chan_start,
 	.stop		= vgsm_me_rx_chan_stop,
-	.stimulus	= vgsm_me_rx_chan_stimulus,
 };
 
 
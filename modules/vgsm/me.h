@@ -19,6 +19,8 @@
 #include <linux/kstreamer/kstreamer.h>
 #include <linux/kstreamer/node.h>
 #include <linux/kstreamer/channel.h>
+#include <linux/kstreamer/streamframe.h>
+#include <linux/kstreamer/softswitch.h>
 
 enum vgsm_me_status
 {
@@ -43,6 +45,8 @@ struct vgsm_me_rx
 	int fifo_size;
 
 	u8 codec_gain;
+
+	struct kss_rx_sched_entry sched_entry;
 };
 
 struct vgsm_me_tx
@@ -116,6 +120,11 @@ struct vgsm_me *vgsm_me_create(
 struct vgsm_me *vgsm_me_get(struct vgsm_me *me);
 void vgsm_me_put(struct vgsm_me *me);
 
+void vgsm_me_rx_drain(
+	struct kss_rx_sched *sched,
+	struct ks_chan *ks_chan,
+	struct ks_streamframe *sf);
+
 int vgsm_me_register(struct vgsm_me *me);
 void vgsm_me_unregister(struct vgsm_me *me);
 
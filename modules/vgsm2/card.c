@@ -844,6 +844,23 @@ void vgsm_card_sysfs_delete_files(
 	}
 }
 
+static void vgsm_card_rx_sched_lock(struct kss_rx_sched *sched)
+{
+	vgsm_card_lock(sched->driver_data);
+}
+
+static void vgsm_card_rx_sched_unlock(struct kss_rx_sched *sched)
+{
+	vgsm_card_unlock(sched->driver_data);
+}
+
+static struct kss_rx_sched_ops vgsm_card_rx_sched_ops =
+{
+	.lock	= vgsm_card_rx_sched_lock,
+	.unlock	= vgsm_card_rx_sched_unlock,
+	.drain	= vgsm_me_rx_drain,
+};
+
 struct vgsm_card *vgsm_card_create(
 	struct vgsm_card *card,
 	struct pci_dev *pci_dev,
@@ -866,6 +883,9 @@ struct vgsm_card *vgsm_card_create(
 
 	spin_lock_init(&card->lock);
 
+	kss_rx_sched_init(&card->rx_sched, &vgsm_card_rx_sched_ops,
+				VGSM_RX_SCHED_FREQUENCY, card);
+
 	return card;
 }
 
@@ -873,6 +893,8 @@ void vgsm_card_destroy(struct vgsm_card *card)
 {
 	int i;
 
+	kss_rx_sched_destroy(&card->rx_sched);
+
 	for(i=card->mes_number-1; i>=0; i--) {
 		if (card->mes[i])
 			vgsm_me_destroy(card->mes[i]);
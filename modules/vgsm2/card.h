@@ -18,8 +18,13 @@
 #include <linux/pci.h>
 #include <linux/interrupt.h>
 
+#include <linux/kstreamer/softswitch.h>
+
 #include "me.h"
 #include "sim.h"
+
+/* ME RX FIFOs are drained by the card's scheduler at this rate */
+#define VGSM_RX_SCHED_FREQUENCY 50
 #ifdef DEBUG_CODE
 #if LINUX_VERSION_CODE < KERNEL_VERSION(2,6,30)
 #define vgsm_debug_card(card, dbglevel, format, arg...)			\
@@ -105,6 +110,8 @@ struct vgsm_card
 	struct vgsm_me *mes[4];
 	struct vgsm_sim sims[4];
 
+	struct kss_rx_sched rx_sched;
+
 	struct vgsm_fw_version fw_version;
 
 	union {
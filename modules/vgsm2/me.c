@@ -229,6 +229,8 @@ static int vgsm_me_rx_chan_start(struct ks_chan *ks_chan)
 	me_rx->fifo_out = vgsm_inl(card, VGSM_R_ME_FIFO_RX_IN(me->id));
 	vgsm_card_unlock(card);
 
+	kss_rx_sched_add(&card->rx_sched, &me_rx->sched_entry, ks_chan);
+
 	vgsm_debug_me(me, 1, "RX started.\n");
 
 	return 0;
@@ -241,14 +243,16 @@ static void vgsm_me_rx_chan_stop(struct ks_chan *ks_chan)
 	struct vgsm_me *me = me_rx->me;
 	struct vgsm_card *card = me->card;
 
-	vgsm_card_lock(card);
-	vgsm_card_unlock(card);
+	kss_rx_sched_del(&card->rx_sched, &me_rx->sched_entry);
 
 	vgsm_debug_me(me, 1, "RX stopped.\n");
 }
 
-static void vgsm_me_rx_chan_stimulus(
-	struct ks_chan *ks_chan)
+/* Called by the card's RX scheduler with the card lock held */
+void vgsm_me_rx_drain(
+	struct kss_rx_sched *sched,
+	struct ks_chan *ks_chan,
+	struct ks_streamframe *sf)
 {
 	struct vgsm_me_rx *me_rx =
 		container_of(ks_chan, struct vgsm_me_rx, ks_chan);
@@ -259,16 +263,8 @@ static void vgsm_me_rx_chan_stimulus(
 	int sample_size = me_rx->compander_enabled ?
 				sizeof(s8) : sizeof(u16);
 
-	struct ks_streamframe *sf;
-
-	sf = ks_sf_alloc();
-	if (!sf)
-		return;
-
 	bufp = sf->data;
 
-	vgsm_card_lock(card);
-
 	inpos = vgsm_inl(card, VGSM_R_ME_FIFO_RX_IN(me->id));
 
         /* Workaround for pre-2.8.3 firmware */
@@ -301,12 +297,6 @@ static void vgsm_me_rx_chan_stimulus(
 		if (me_rx->fifo_out >= me_rx->fifo_size)
 			me_rx->fifo_out = 0;
 	}
-
-	vgsm_card_unlock(card);
-
-	kss_chan_push_raw(ks_chan, sf);
-
-	ks_sf_put(sf);
 }
 
 static int vgsm_me_rx_chan_get_attr_count(struct ks_chan *chan)
@@ -381,7 +371,6 @@ static struct ks_chan_ops vgsm_me_rx_chan_ops = {
 	.close		= vgsm_me_rx_chan_close,
 	.start		= vgsm_me_rx_chan_start,
 	.stop		= vgsm_me_rx_chan_stop,
-	.stimulus	= vgsm_me_rx_chan_stimulus,
 
 	.get_attr_count	= vgsm_me_rx_chan_get_attr_count,
 	.get_attr	= vgsm_me_rx_chan_get_attr,
@@ -16,6 +16,8 @@
 #include <linux/kstreamer/channel.h>
 #include <linux/kstreamer/node.h>
 #include <linux/kstreamer/feature.h>
+#include <linux/kstreamer/streamframe.h>
+#include <linux/kstreamer/softswitch.h>
 
 #include <linux/kstreamer/amu_compander.h>
 
@@ -50,6 +52,8 @@ struct vgsm_me_rx
 	u16 fifo_size;
 	u32 fifo_base;
 	u32 fifo_out;
+
+	struct kss_rx_sched_entry sched_entry;
 };
 
 struct vgsm_amu_decompander
@@ -111,6 +115,11 @@ void vgsm_me_destroy(struct vgsm_me *me);
 struct vgsm_me *vgsm_me_get(struct vgsm_me *me);
 void vgsm_me_put(struct vgsm_me *me);
 
+void vgsm_me_rx_drain(
+	struct kss_rx_sched *sched,
+	struct ks_chan *ks_chan,
+	struct ks_streamframe *sf);
+
 int vgsm_me_register(struct vgsm_me *me);
 void vgsm_me_unregister(struct vgsm_me *me);
 
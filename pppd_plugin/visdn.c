@@ -13,7 +13,14 @@
  */
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <limits.h>
+#include <signal.h>
+#include <dirent.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
@@ -33,6 +40,33 @@
 
 static int device_got_set = 0;
 
+/* Bandwidth on demand: when this pppd is the master of a multilink bundle
+ * and the bundle load exceeds bod_threshold percent of the capacity of the
+ * B-channels in it, bod_command is run (with the interface name and the
+ * wanted number of links as arguments) to bring up another B-channel, e.g.
+ * by dropping an asterisk call file spawning vISDNppp with "multilink".
+ *
+ * Every pppd joining the bundle registers itself in a directory named
+ * after the bundle interface and removes itself when its link goes down,
+ * the master counts the live entries. A request is pending until a new link
+ * joins or bod_join_timeout seconds pass.
+ */
+#define VISDN_BOD_DIR "/var/run/visdn-bod-"
+
+static int bod_threshold = 0;
+static int bod_interval = 10;
+static int bod_max_links = 2;
+static int bod_join_timeout = 60;
+static char *bod_command = NULL;
+
+static int bod_links;
+static int bod_pending;
+static time_t bod_pending_since;
+static struct pppd_stats bod_prev_stats;
+
+static int bod_joined;
+static void (*bod_prev_join_hook)(void);
+
 char pppd_version[] = VERSION;
 
 extern int new_style_driver;	/* From sys-linux.c */
@@ -42,6 +76,16 @@ static int visdn_setdevname(char *cmd, char **argv, int doit);
 static option_t visdn_options[] = {
 	{ "device name", o_wild, (void *) &visdn_setdevname, "vISDN device name",
 		OPT_DEVNAM | OPT_PRIVFIX | OPT_NOARG | OPT_A2STRVAL | OPT_STATIC, devnam},
+	{ "visdn-bod-threshold", o_int, &bod_threshold,
+		"Bundle load (%) triggering a new B-channel, 0 disables" },
+	{ "visdn-bod-interval", o_int, &bod_interval,
+		"Bundle load sampling interval (seconds)" },
+	{ "visdn-bod-max-links", o_int, &bod_max_links,
+		"Maximum number of B-channels in the bundle" },
+	{ "visdn-bod-join-timeout", o_int, &bod_join_timeout,
+		"Seconds to wait for a requested B-channel to join" },
+	{ "visdn-bod-command", o_string, &bod_command,
+		"Command run to add a B-channel to the bundle", OPT_PRIV },
 	{ NULL }
 };
 
@@ -279,6 +323,196 @@ static void visdn_recv_config(int mru, u_int32_t asyncmap, int pcomp, int accomp
 	dbglog("PPPovISDN - visdn_recv_config");
 }
 
+static void visdn_bod_dir(char *path, size_t size)
+{
+	snprintf(path, size, VISDN_BOD_DIR "%s", ifname);
+}
+
+static void visdn_bod_link_path(char *path, size_t size, pid_t pid)
+{
+	snprintf(path, size, VISDN_BOD_DIR "%s/%d", ifname, (int)pid);
+}
+
+/* Returns the number of links in the bundle, the master included, and
+ * removes the entries of pppds which died without cleaning up
+ */
+static int visdn_bod_count_links(int remove_all)
+{
+	char path[PATH_MAX];
+	struct dirent *de;
+	DIR *dir;
+	int links = 1;
+
+	visdn_bod_dir(path, sizeof(path));
+
+	dir = opendir(path);
+	if (!dir)
+		return links;
+
+	while((de = readdir(dir))) {
+		pid_t pid = atoi(de->d_name);
+
+		if (pid <= 0)
+			continue;
+
+		if (!remove_all &&
+		    (kill(pid, 0) == 0 || errno == EPERM)) {
+			links++;
+			continue;
+		}
+
+		visdn_bod_link_path(path, sizeof(path), pid);
+		unlink(path);
+	}
+
+	closedir(dir);
+
+	return links;
+}
+
+static void visdn_bod_check(void *arg)
+{
+	struct pppd_stats stats;
+	unsigned int bytes;
+	unsigned int load;
+	int links;
+
+	links = visdn_bod_count_links(0);
+
+	if (bod_pending) {
+		if (links > bod_links) {
+			info("PPPovISDN - B-channel joined the bundle,"
+				" %d links", links);
+			bod_pending = 0;
+		} else if (time(NULL) - bod_pending_since >=
+							bod_join_timeout) {
+			warn("PPPovISDN - requested B-channel did not join"
+				" within %d seconds", bod_join_timeout);
+			bod_pending = 0;
+		}
+	}
+
+	if (links != bod_links)
+		dbglog("PPPovISDN - bundle has %d links", links);
+
+	bod_links = links;
+
+	if (!get_ppp_stats(ifunit, &stats))
+		goto rearm;
+
+	bytes = stats.bytes_in - bod_prev_stats.bytes_in;
+	if (stats.bytes_out - bod_prev_stats.bytes_out > bytes)
+		bytes = stats.bytes_out - bod_prev_stats.bytes_out;
+
+	bod_prev_stats = stats;
+
+	load = (bytes * 8ULL * 100) /
+		(bod_interval * bod_links * VPPP_BCHAN_SPEED);
+
+	dbglog("PPPovISDN - bundle load %u%% on %d links", load, bod_links);
+
+	if (load >= bod_threshold &&
+	    !bod_pending &&
+	    bod_links < bod_max_links) {
+		char links_str[8];
+		char *argv[] = { bod_command, ifname, links_str, NULL };
+
+		snprintf(links_str, sizeof(links_str), "%d", bod_links + 1);
+
+		info("PPPovISDN - load %u%%, adding B-channel %d to bundle",
+			load, bod_links + 1);
+
+		if (run_program(bod_command, argv, 0, NULL, NULL, 0) > 0) {
+			bod_pending = 1;
+			bod_pending_since = time(NULL);
+		}
+	}
+
+rearm:
+	TIMEOUT(visdn_bod_check, NULL, bod_interval);
+}
+
+static void visdn_bod_ip_up(void *arg, int dummy)
+{
+	char path[PATH_MAX];
+
+	if (!bod_threshold || !bod_command)
+		return;
+
+	/* Only the bundle master drives bandwidth on demand */
+	if (!multilink || !multilink_master)
+		return;
+
+	if (bod_interval <= 0)
+		bod_interval = 10;
+
+	visdn_bod_dir(path, sizeof(path));
+	if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+		error("PPPovISDN - cannot create %s: %m", path);
+		return;
+	}
+
+	bod_links = visdn_bod_count_links(0);
+	bod_pending = 0;
+
+	if (!get_ppp_stats(ifunit, &bod_prev_stats))
+		memset(&bod_prev_stats, 0, sizeof(bod_prev_stats));
+
+	TIMEOUT(visdn_bod_check, NULL, bod_interval);
+}
+
+static void visdn_bod_ip_down(void *arg, int dummy)
+{
+	char path[PATH_MAX];
+
+	if (!bod_threshold || !bod_command ||
+	    !multilink || !multilink_master)
+		return;
+
+	UNTIMEOUT(visdn_bod_check, NULL);
+
+	visdn_bod_count_links(1);
+
+	visdn_bod_dir(path, sizeof(path));
+	rmdir(path);
+}
+
+/* Runs in the pppd of a link which joined an existing bundle, ifname is
+ * the bundle's one by now. Nothing is registered if the master is not
+ * doing bandwidth on demand, as the directory does not exist.
+ */
+static void visdn_bod_join(void)
+{
+	char path[PATH_MAX];
+	int fd;
+
+	if (bod_prev_join_hook)
+		bod_prev_join_hook();
+
+	visdn_bod_link_path(path, sizeof(path), getpid());
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return;
+
+	close(fd);
+
+	bod_joined = 1;
+}
+
+static void visdn_bod_link_down(void *arg, int dummy)
+{
+	char path[PATH_MAX];
+
+	if (!bod_joined)
+		return;
+
+	visdn_bod_link_path(path, sizeof(path), getpid());
+	unlink(path);
+
+	bod_joined = 0;
+}
+
 void plugin_init(void)
 {
 	if (!ppp_available() && !new_style_driver)
@@ -286,6 +520,14 @@ void plugin_init(void)
 
 	add_options(visdn_options);
 
+	add_notifier(&ip_up_notifier, visdn_bod_ip_up, NULL);
+	add_notifier(&ip_down_notifier, visdn_bod_ip_down, NULL);
+
+	bod_prev_join_hook = multilink_join_hook;
+	multilink_join_hook = visdn_bod_join;
+	add_notifier(&link_down_notifier, visdn_bod_link_down, NULL);
+	add_notifier(&exitnotify, visdn_bod_link_down, NULL);
+
 	dbglog("vISDN plugin_init");
 }
 
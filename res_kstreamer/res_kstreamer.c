@@ -370,7 +370,7 @@ static int ks_kstreamer_show_pipelines_func(int fd, int argc, char *argv[])
 static char *ks_kstreamer_show_pipelines_func(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 #endif
 {
-	int i;
+	int i, j;
 #if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
 
 #else
@@ -383,7 +383,12 @@ static char *ks_kstreamer_show_pipelines_func(struct ast_cli_entry *e, int cmd,
 		return ks_kstreamer_show_pipelines_complete(a->line, a->word, a->pos, a->n);
 	}
 
+	int fd = a->fd;
 #endif
+	/* Counters are only sent along with topology changes, refresh them */
+	if (ks_pipeline_update_stats(ks_conn) < 0)
+		ast_cli(fd, "Cannot refresh pipeline stats\n");
+
 	ks_conn_topology_rdlock(ks_conn);
 	for (i=0; i<ARRAY_SIZE(ks_conn->pipelines_hash); i++) {
 		struct ks_pipeline *pipeline;
@@ -391,13 +396,52 @@ static char *ks_kstreamer_show_pipelines_func(struct ast_cli_entry *e, int cmd,
 
 		hlist_for_each_entry(pipeline, t, &ks_conn->pipelines_hash[i],
 									node) {
-#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
+			struct ks_pipeline_stats *stats = &pipeline->stats;
+
 			ast_cli(fd, "0x%08x: %s\n",
-#else
-			ast_cli(a->fd, "0x%08x: %s\n",
-#endif
 				pipeline->id,
 				pipeline->path);
+
+			ast_cli(fd, "  %llu frames, %llu bytes, %llu drops,"
+				" %llu underruns\n",
+				(unsigned long long)stats->frames,
+				(unsigned long long)stats->bytes,
+				(unsigned long long)stats->drops,
+				(unsigned long long)stats->underruns);
+
+			if (stats->latency_samples) {
+				ast_cli(fd, "  Latency: avg %lluus max %uus,"
+					" histogram:",
+					(unsigned long long)(
+						stats->latency_sum /
+						stats->latency_samples / 1000),
+					stats->latency_max / 1000);
+
+				for (j=0; j<KS_PIPELINE_LATENCY_BUCKETS; j++)
+					ast_cli(fd, " %u",
+						stats->latency_hist[j]);
+
+				ast_cli(fd, "\n");
+			}
+
+			for (j=0; j<pipeline->hop_stats_cnt; j++) {
+				struct ks_pipeline_hop_stats *hs =
+						&pipeline->hop_stats[j];
+
+				ast_cli(fd, "  Hop 0x%08x: %llu frames,"
+					" %llu drops, %llu underruns,"
+					" latency avg %lluus max %uus\n",
+					hs->chan_id,
+					(unsigned long long)hs->frames,
+					(unsigned long long)hs->drops,
+					(unsigned long long)hs->underruns,
+					(unsigned long long)(
+						hs->latency_samples ?
+						hs->latency_sum /
+						hs->latency_samples / 1000 :
+						0),
+					hs->latency_max / 1000);
+			}
 		}
 	}
 	ks_conn_topology_unlock(ks_conn);
@@ -412,7 +456,8 @@ static char *ks_kstreamer_show_pipelines_func(struct ast_cli_entry *e, int cmd,
 static char ks_kstreamer_show_pipelines_help[] =
 "Usage: kstreamer show pipelines\n"
 "\n"
-"	\n";
+"	Lists the pipelines with their counters. Latencies and underruns\n"
+"	are only accounted while /sys/devices/ks-system/stats is 1.\n";
 
 static struct ast_cli_entry ks_kstreamer_show_pipelines =
 {
@@ -424,6 +469,76 @@ static struct ast_cli_entry ks_kstreamer_show_pipelines =
 };
 #endif
 
+/*--------------------------------show connection---------------------------------------------*/
+#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
+static int ks_kstreamer_show_connection_func(int fd, int argc, char *argv[])
+#else
+static char *ks_kstreamer_show_connection_func(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+#endif
+{
+	struct ks_conn_stats *stats = &ks_conn->stats;
+	int i;
+#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
+
+#else
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "kstreamer show connection";
+		e->usage =   "Usage: kstreamer show connection\n"
+			"\n"
+			"	Shows the netlink socket's receive counters.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	int fd = a->fd;
+#endif
+	ast_cli(fd, "Receive buffer: %d bytes%s\n",
+		stats->rcvbuf_size,
+		stats->rcvbuf_forced ? " (forced)" : "");
+	ast_cli(fd, "Overruns: %lu\n", stats->rx_overruns);
+	ast_cli(fd, "Datagrams: %lu in %lu batches (avg %.1f, max %d)\n",
+		stats->rx_datagrams,
+		stats->rx_batches,
+		stats->rx_batches ?
+			(double)stats->rx_datagrams / stats->rx_batches : 0.0,
+		stats->rx_batch_max);
+
+	for (i=0; i<ARRAY_SIZE(stats->rx_batch_hist); i++) {
+		if (stats->rx_batch_hist[i])
+			ast_cli(fd, "  %2d per batch: %lu\n",
+				i + 1, stats->rx_batch_hist[i]);
+	}
+
+	ast_cli(fd, "Requests sent without ACK: %lu\n", stats->tx_noack);
+	ast_cli(fd, "Requests delayed by a full ring: %lu\n",
+		stats->tx_ring_full);
+	ast_cli(fd, "Requests timed out: %lu\n", stats->req_timeouts);
+
+#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
+	return RESULT_SUCCESS;
+#else
+	return CLI_SUCCESS;
+#endif
+}
+
+#if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >= 10200 && ASTERISK_VERSION_NUM < 10600)
+static char ks_kstreamer_show_connection_help[] =
+"Usage: kstreamer show connection\n"
+"\n"
+"	Shows the netlink socket's receive counters.\n";
+
+static struct ast_cli_entry ks_kstreamer_show_connection =
+{
+	{ "kstreamer", "show", "connection", NULL },
+	ks_kstreamer_show_connection_func,
+	"",
+	ks_kstreamer_show_connection_help,
+	NULL
+};
+#endif
+
 /*-----------------------------debug messages Mino----------------------------------------------*/
 #if ASTERISK_VERSION_NUM < 010600 || (ASTERISK_VERSION_NUM >=10200  && ASTERISK_VERSION_NUM < 10600)
 static int ks_kstreamer_debug_messages_func(int fd, int argc, char *argv[])
@@ -601,6 +716,7 @@ static struct ast_cli_entry cli_ks[] = {
 	AST_CLI_DEFINE(ks_kstreamer_show_nodes_func, "kstreamer show nodes"),
 	AST_CLI_DEFINE(ks_kstreamer_show_chans_func, "kstreamer show chans"),
 	AST_CLI_DEFINE(ks_kstreamer_show_pipelines_func, "kstreamer show pipelines"),
+	AST_CLI_DEFINE(ks_kstreamer_show_connection_func, "kstreamer show connection"),
 	AST_CLI_DEFINE(ks_kstreamer_debug_messages_func, "kstreamer debug messages"),
 	AST_CLI_DEFINE(ks_kstreamer_no_debug_messages_func, "no kstreamer debug messages"),
 	AST_CLI_DEFINE(ks_kstreamer_debug_router_func, "kstreamer debug router"),
@@ -637,6 +753,7 @@ static int ks_load_module(void)
 	ast_cli_register(&ks_kstreamer_show_nodes);
 	ast_cli_register(&ks_kstreamer_show_chans);
 	ast_cli_register(&ks_kstreamer_show_pipelines);
+	ast_cli_register(&ks_kstreamer_show_connection);
 	ast_cli_register(&ks_kstreamer_debug_messages);
 	ast_cli_register(&ks_kstreamer_no_debug_messages);
 	ast_cli_register(&ks_kstreamer_debug_router);
@@ -650,6 +767,7 @@ static int ks_load_module(void)
 	ast_cli_unregister(&ks_kstreamer_debug_router);
 	ast_cli_unregister(&ks_kstreamer_no_debug_messages);
 	ast_cli_unregister(&ks_kstreamer_debug_messages);
+	ast_cli_unregister(&ks_kstreamer_show_connection);
 	ast_cli_unregister(&ks_kstreamer_show_pipelines);
 	ast_cli_unregister(&ks_kstreamer_show_chans);
 	ast_cli_unregister(&ks_kstreamer_show_nodes);
@@ -676,6 +794,7 @@ static int ks_unload_module(void)
 	ast_cli_unregister(&ks_kstreamer_debug_router);
 	ast_cli_unregister(&ks_kstreamer_no_debug_messages);
 	ast_cli_unregister(&ks_kstreamer_debug_messages);
+	ast_cli_unregister(&ks_kstreamer_show_connection);
 	ast_cli_unregister(&ks_kstreamer_show_pipelines);
 	ast_cli_unregister(&ks_kstreamer_show_chans);
 	ast_cli_unregister(&ks_kstreamer_show_nodes);
@@ -0,0 +1,448 @@
+/*
+ * vISDN
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+/* Builds an N-party conference on ks-conference out of userports, makes
+ * party 0 play a milliwatt tone while the others are silent, then checks
+ * that everybody but party 0 hears it and reports the mixer's CPU time per
+ * tick.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/types.h>
+#include <getopt.h>
+
+#include <linux/kstreamer/pipeline.h>
+#include <linux/kstreamer/userport.h>
+
+#include <list.h>
+
+#include <libkstreamer/libkstreamer.h>
+
+#define CHUNK_SIZE 160
+#define CHUNK_INTERVAL_NS 20000000
+
+/* The classic A-law digital milliwatt */
+static const __u8 milliwatt[] = {
+	0x34, 0x21, 0x21, 0x34, 0xb4, 0xa1, 0xa1, 0xb4 };
+
+#define ALAW_SILENCE 0xd5
+
+struct party
+{
+	int up_fd;
+
+	struct ks_node *node_up;
+	struct ks_node *node;
+
+	struct ks_pipeline *rx_pipeline;
+	struct ks_pipeline *tx_pipeline;
+
+	double energy;
+	long samples;
+};
+
+struct opts
+{
+	int parties;
+	int conference;
+	int duration;
+	int verbose;
+};
+
+static int alaw_to_linear(__u8 a_val)
+{
+	int t;
+	int seg;
+
+	a_val ^= 0x55;
+
+	t = (a_val & 0x0f) << 4;
+	seg = (a_val & 0x70) >> 4;
+
+	switch(seg) {
+	case 0:
+		t += 8;
+	break;
+
+	case 1:
+		t += 0x108;
+	break;
+
+	default:
+		t += 0x108;
+		t <<= seg - 1;
+	}
+
+	return (a_val & 0x80) ? t : -t;
+}
+
+static void report_func(int level, const char *format, ...)
+{
+	va_list ap;
+
+	va_start(ap, format);
+	vfprintf(stderr, format, ap);
+	va_end(ap);
+}
+
+static struct ks_pipeline *route(
+	struct ks_conn *conn,
+	struct ks_node *from,
+	struct ks_node *to)
+{
+	struct ks_pipeline *pipeline;
+	int err;
+
+	pipeline = ks_pipeline_alloc();
+	if (!pipeline) {
+		fprintf(stderr, "Cannot alloc pipeline\n");
+		goto err_pipeline_alloc;
+	}
+
+	err = ks_pipeline_autoroute(pipeline, conn, from, to);
+	if (err < 0) {
+		fprintf(stderr, "Cannot connect nodes: %s\n", strerror(-err));
+		goto err_pipeline_autoroute;
+	}
+
+	pipeline->status = KS_PIPELINE_STATUS_CONNECTED;
+
+	err = ks_pipeline_create(pipeline, conn);
+	if (err < 0) {
+		fprintf(stderr,
+			"Cannot create pipeline: %s\n", strerror(-err));
+		goto err_pipeline_create;
+	}
+
+	pipeline->status = KS_PIPELINE_STATUS_FLOWING;
+	err = ks_pipeline_update(pipeline, conn);
+	if (err < 0) {
+		fprintf(stderr, "Cannot start the pipeline\n");
+		goto err_pipeline_start;
+	}
+
+	return pipeline;
+
+err_pipeline_start:
+	ks_pipeline_destroy(pipeline, conn);
+err_pipeline_create:
+err_pipeline_autoroute:
+	ks_pipeline_put(pipeline);
+err_pipeline_alloc:
+
+	return NULL;
+}
+
+static void unroute(struct ks_conn *conn, struct ks_pipeline *pipeline)
+{
+	if (!pipeline)
+		return;
+
+	ks_pipeline_destroy(pipeline, conn);
+	ks_pipeline_put(pipeline);
+}
+
+static void print_mixer_stats(struct opts *opts)
+{
+	char path[256];
+	char line[256];
+	FILE *f;
+
+	snprintf(path, sizeof(path),
+		"/sys/devices/ks-system/conference%d-0/mixer",
+		opts->conference);
+
+	f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+		return;
+	}
+
+	printf("\nMixer:\n");
+
+	while(fgets(line, sizeof(line), f))
+		printf("  %s", line);
+
+	fclose(f);
+}
+
+static void run(struct party *parties, struct opts *opts)
+{
+	__u8 tone[CHUNK_SIZE];
+	__u8 silence[CHUNK_SIZE];
+	__u8 buf[4096];
+	struct timespec next;
+	int warmup = 1000000000 / CHUNK_INTERVAL_NS;
+	int chunks = opts->duration * warmup;
+	int chunk;
+	int i;
+
+	for (i=0; i<CHUNK_SIZE; i++)
+		tone[i] = milliwatt[i % sizeof(milliwatt)];
+
+	memset(silence, ALAW_SILENCE, sizeof(silence));
+
+	clock_gettime(CLOCK_MONOTONIC, &next);
+
+	for (chunk=0; chunk < warmup + chunks; chunk++) {
+		for (i=0; i<opts->parties; i++) {
+			if (write(parties[i].up_fd, i ? silence : tone,
+					CHUNK_SIZE) < 0 &&
+			    errno != EAGAIN)
+				fprintf(stderr, "write(party %d): %s\n",
+					i, strerror(errno));
+		}
+
+		for (i=0; i<opts->parties; i++) {
+			int nread;
+			int j;
+
+			nread = read(parties[i].up_fd, buf, sizeof(buf));
+			if (nread < 0) {
+				if (errno != EAGAIN)
+					fprintf(stderr,
+						"read(party %d): %s\n",
+						i, strerror(errno));
+				continue;
+			}
+
+			/* Let the pipelines settle */
+			if (chunk < warmup)
+				continue;
+
+			for (j=0; j<nread; j++) {
+				int s = alaw_to_linear(buf[j]);
+
+				parties[i].energy += (double)s * s;
+			}
+
+			parties[i].samples += nread;
+		}
+
+		next.tv_nsec += CHUNK_INTERVAL_NS;
+		if (next.tv_nsec >= 1000000000) {
+			next.tv_nsec -= 1000000000;
+			next.tv_sec++;
+		}
+
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+	}
+}
+
+static void print_usage(const char *progname)
+{
+	fprintf(stderr,
+		"Usage: %s [-n parties] [-c conference] [-t seconds] [-v]\n",
+		progname);
+}
+
+int main(int argc, char *argv[])
+{
+	struct opts opts;
+	struct party *parties;
+	int failed = 0;
+	int err;
+	int i;
+
+	memset(&opts, 0, sizeof(opts));
+	opts.parties = 30;
+	opts.duration = 10;
+
+	int c;
+	while ((c = getopt(argc, argv, "n:c:t:v")) != -1) {
+		switch(c) {
+		case 'n':
+			opts.parties = atoi(optarg);
+		break;
+
+		case 'c':
+			opts.conference = atoi(optarg);
+		break;
+
+		case 't':
+			opts.duration = atoi(optarg);
+		break;
+
+		case 'v':
+			opts.verbose++;
+		break;
+
+		default:
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (opts.parties < 2 || opts.duration < 1) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	parties = calloc(opts.parties, sizeof(*parties));
+	if (!parties) {
+		fprintf(stderr, "Cannot allocate parties\n");
+		return 1;
+	}
+
+	/* Userports have to exist before the topology is read */
+	for (i=0; i<opts.parties; i++) {
+		parties[i].up_fd = open("/dev/ks/userport_stream",
+						O_RDWR | O_NONBLOCK);
+		if (parties[i].up_fd < 0) {
+			perror("cannot open /dev/ks/userport_stream");
+			goto err_open_userport;
+		}
+	}
+
+	struct ks_conn *conn;
+	conn = ks_conn_create();
+	if (!conn) {
+		fprintf(stderr, "Cannot initialize kstreamer library\n");
+		goto err_ks_conn_create;
+	}
+
+	conn->report_func = report_func;
+	conn->debug_netlink = opts.verbose > 1;
+
+	err = ks_conn_establish(conn);
+	if (err < 0) {
+		fprintf(stderr, "Cannot connect kstreamer library\n");
+		goto err_ks_conn_establish;
+	}
+
+	ks_update_topology(conn);
+
+	for (i=0; i<opts.parties; i++) {
+		char path[256];
+		__u32 node_up_id;
+
+		if (ioctl(parties[i].up_fd, KS_UP_GET_NODEID,
+						(caddr_t)&node_up_id) < 0) {
+			perror("ioctl(KS_UP_GET_NODEID)");
+			goto err_get_nodes;
+		}
+
+		parties[i].node_up = ks_node_get_by_id(conn, node_up_id);
+		if (!parties[i].node_up) {
+			fprintf(stderr, "Cannot find UP node\n");
+			goto err_get_nodes;
+		}
+
+		snprintf(path, sizeof(path),
+			"/sys/devices/ks-system/conference%d-%d",
+			opts.conference, i);
+
+		parties[i].node = ks_node_get_by_path(conn, path);
+		if (!parties[i].node) {
+			fprintf(stderr,
+				"Cannot find node '%s', is ks-conference"
+				" loaded with max_parties >= %d?\n",
+				path, opts.parties);
+			goto err_get_nodes;
+		}
+	}
+
+	err = ks_conn_remote_topology_lock(conn);
+	if (err < 0) {
+		fprintf(stderr,
+			"Cannot lock kstreamer topology: %s\n", strerror(-err));
+		goto err_kstreamer_lock;
+	}
+
+	for (i=0; i<opts.parties; i++) {
+		parties[i].tx_pipeline = route(conn,
+					parties[i].node_up, parties[i].node);
+		if (!parties[i].tx_pipeline)
+			goto err_route;
+
+		parties[i].rx_pipeline = route(conn,
+					parties[i].node, parties[i].node_up);
+		if (!parties[i].rx_pipeline)
+			goto err_route;
+	}
+
+	ks_conn_remote_topology_unlock(conn);
+
+	printf("%d parties conferenced, running for %d seconds...\n",
+		opts.parties, opts.duration);
+
+	run(parties, &opts);
+
+	printf("\nParty  Samples  RMS\n");
+
+	for (i=0; i<opts.parties; i++) {
+		double rms = parties[i].samples ?
+			sqrt(parties[i].energy / parties[i].samples) : 0;
+
+		/* The milliwatt is about 2300 RMS, silence decodes to 8 */
+		int ok = i ? rms > 1000 : parties[i].samples && rms < 100;
+
+		if (!ok)
+			failed++;
+
+		if (opts.verbose || !ok)
+			printf("%5d %8ld %6.0f %s\n",
+				i, parties[i].samples, rms,
+				ok ? "" : "FAILED");
+	}
+
+	print_mixer_stats(&opts);
+
+	printf("\n%s\n", failed ? "FAILED" : "PASSED");
+
+	err = ks_conn_remote_topology_lock(conn);
+	for (i=opts.parties - 1; i>=0; i--) {
+		unroute(conn, parties[i].rx_pipeline);
+		unroute(conn, parties[i].tx_pipeline);
+	}
+	if (err >= 0)
+		ks_conn_remote_topology_unlock(conn);
+
+	ks_conn_destroy(conn);
+
+	for (i=0; i<opts.parties; i++)
+		close(parties[i].up_fd);
+
+	free(parties);
+
+	return failed ? 1 : 0;
+
+err_route:
+	for (; i>=0; i--) {
+		unroute(conn, parties[i].rx_pipeline);
+		unroute(conn, parties[i].tx_pipeline);
+	}
+
+	ks_conn_remote_topology_unlock(conn);
+err_kstreamer_lock:
+err_get_nodes:
+err_ks_conn_establish:
+	ks_conn_destroy(conn);
+err_ks_conn_create:
+	i = opts.parties;
+err_open_userport:
+	while (--i >= 0)
+		close(parties[i].up_fd);
+
+	free(parties);
+
+	return 1;
+}
@@ -0,0 +1 @@
+../modules/dtmf/dtmf_detect.c
\ No newline at end of file
@@ -0,0 +1,385 @@
+/*
+ * vISDN
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+/* Test vectors for the ks-dtmf detector. The detector source is shared with
+ * the kernel module, so this runs the very same code on synthesized signals
+ * covering the ITU-T Q.24 timing, twist, frequency and level requirements.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "dtmf_detect.h"
+
+/* Peak of a 0 dBm0 sine in 16 bit linear */
+#define DBM0_PEAK 22706.0
+
+#define MAX_SAMPLES (KDTMF_SAMPLE_RATE * 10)
+
+/* Samples fed to the detector at a time, a 20ms streamframe */
+#define CHUNK_SIZE 160
+
+static const double rows[] = { 697, 770, 852, 941 };
+static const double cols[] = { 1209, 1336, 1477, 1633 };
+static const char digits[] = "123A456B789C*0#D";
+
+struct signal
+{
+	double buf[MAX_SAMPLES];
+	int len;
+};
+
+struct result
+{
+	char digits[64];
+	int ndigits;
+	int durations[64];
+	int open;
+};
+
+static int verbose;
+static int failures;
+static int tests;
+
+static void event(
+	void *data,
+	enum kdtmf_event_type type,
+	char digit,
+	int duration_ms)
+{
+	struct result *res = data;
+
+	if (verbose > 1)
+		printf("    %s '%c' %d ms\n",
+			type == KDTMF_EVENT_BEGIN ? "BEGIN" : "END",
+			digit, duration_ms);
+
+	if (type == KDTMF_EVENT_BEGIN) {
+		if (res->ndigits < sizeof(res->digits) - 1)
+			res->digits[res->ndigits] = digit;
+
+		res->open = 1;
+	} else {
+		if (res->ndigits < sizeof(res->digits) - 1)
+			res->durations[res->ndigits++] = duration_ms;
+
+		res->open = 0;
+	}
+}
+
+static void add_tone(struct signal *sig, double freq, double dbm0,
+	int start, int len)
+{
+	double amp = DBM0_PEAK * pow(10, dbm0 / 20);
+	double phase = (double)rand() / RAND_MAX * 2 * M_PI;
+	int i;
+
+	for (i=0; i<len && start + i < MAX_SAMPLES; i++)
+		sig->buf[start + i] += amp *
+			sin(phase + 2 * M_PI * freq * i / KDTMF_SAMPLE_RATE);
+
+	if (start + i > sig->len)
+		sig->len = start + i;
+}
+
+static void add_digit(struct signal *sig, char digit,
+	double row_dbm0, double col_dbm0, double deviation,
+	int start_ms, int len_ms)
+{
+	int idx = strchr(digits, digit) - digits;
+	int start = start_ms * KDTMF_SAMPLE_RATE / 1000;
+	int len = len_ms * KDTMF_SAMPLE_RATE / 1000;
+
+	add_tone(sig, rows[idx / 4] * (1 + deviation), row_dbm0, start, len);
+	add_tone(sig, cols[idx % 4] * (1 + deviation), col_dbm0, start, len);
+}
+
+static void add_noise(struct signal *sig, double dbm0, int len_ms)
+{
+	/* Uniform noise of the given RMS */
+	double amp = DBM0_PEAK / sqrt(2) * pow(10, dbm0 / 20) * sqrt(3);
+	int len = len_ms * KDTMF_SAMPLE_RATE / 1000;
+	int i;
+
+	for (i=0; i<len && i < MAX_SAMPLES; i++)
+		sig->buf[i] += amp * (2.0 * rand() / RAND_MAX - 1);
+
+	if (i > sig->len)
+		sig->len = i;
+}
+
+/* Runs the signal through a fresh detector, preceded by 'skew' samples of
+ * silence to move the signal across block boundaries
+ */
+static void detect(struct signal *sig, int skew, struct result *res)
+{
+	struct kdtmf_detector det;
+	__s16 pcm[MAX_SAMPLES + KDTMF_BLOCK_SIZE * 8];
+	int len = skew + sig->len + KDTMF_BLOCK_SIZE * 8;
+	int i;
+
+	memset(res, 0, sizeof(*res));
+	memset(pcm, 0, sizeof(pcm));
+
+	for (i=0; i<sig->len; i++) {
+		double s = sig->buf[i];
+
+		if (s > 32767)
+			s = 32767;
+		else if (s < -32768)
+			s = -32768;
+
+		pcm[skew + i] = lrint(s);
+	}
+
+	kdtmf_detector_init(&det, event, res);
+
+	for (i=0; i<len; i+=CHUNK_SIZE)
+		kdtmf_detector_process(&det, pcm + i,
+			len - i < CHUNK_SIZE ? len - i : CHUNK_SIZE);
+
+	res->digits[res->ndigits] = '\0';
+}
+
+/* Expects exactly 'expected' to be detected at every block alignment */
+static void check(const char *descr, struct signal *sig, const char *expected)
+{
+	struct result res;
+	int skew;
+	int ok = 1;
+
+	tests++;
+
+	for (skew=0; skew<KDTMF_BLOCK_SIZE; skew++) {
+		detect(sig, skew, &res);
+
+		if (strcmp(res.digits, expected) || res.open) {
+			printf("FAILED %s: skew %d detected \"%s\","
+				" expected \"%s\"\n",
+				descr, skew, res.digits, expected);
+			ok = 0;
+			break;
+		}
+	}
+
+	if (!ok)
+		failures++;
+	else if (verbose)
+		printf("ok     %s\n", descr);
+}
+
+static void test_all_digits(void)
+{
+	struct signal sig;
+	int i;
+
+	memset(&sig, 0, sizeof(sig));
+
+	for (i=0; i<16; i++)
+		add_digit(&sig, digits[i], -10, -10, 0, i * 100, 50);
+
+	check("all digits, 50 ms on 50 ms off", &sig, digits);
+}
+
+static void test_timing(void)
+{
+	struct signal sig;
+	char descr[80];
+	int i;
+
+	for (i=0; i<16; i++) {
+		char expected[2] = { digits[i], '\0' };
+
+		memset(&sig, 0, sizeof(sig));
+		add_digit(&sig, digits[i], -10, -10, 0, 0, 40);
+		snprintf(descr, sizeof(descr), "'%c' 40 ms accepted", digits[i]);
+		check(descr, &sig, expected);
+
+		memset(&sig, 0, sizeof(sig));
+		add_digit(&sig, digits[i], -10, -10, 0, 0, 20);
+		snprintf(descr, sizeof(descr), "'%c' 20 ms rejected", digits[i]);
+		check(descr, &sig, "");
+	}
+
+	memset(&sig, 0, sizeof(sig));
+	add_digit(&sig, '5', -10, -10, 0, 0, 40);
+	add_digit(&sig, '5', -10, -10, 0, 80, 40);
+	check("40 ms pause splits digits", &sig, "55");
+
+	memset(&sig, 0, sizeof(sig));
+	add_digit(&sig, '5', -10, -10, 0, 0, 50);
+	add_digit(&sig, '5', -10, -10, 0, 60, 50);
+	check("10 ms interruption bridged", &sig, "5");
+
+	memset(&sig, 0, sizeof(sig));
+	add_digit(&sig, '1', -10, -10, 0, 0, 50);
+	add_digit(&sig, '9', -10, -10, 0, 50, 50);
+	check("digit change without pause", &sig, "19");
+}
+
+static void test_duration(void)
+{
+	struct signal sig;
+	struct result res;
+	int skew;
+
+	tests++;
+
+	memset(&sig, 0, sizeof(sig));
+	add_digit(&sig, '#', -10, -10, 0, 0, 200);
+
+	for (skew=0; skew<KDTMF_BLOCK_SIZE; skew++) {
+		detect(&sig, skew, &res);
+
+		if (res.ndigits != 1 ||
+		    res.durations[0] < 200 - 26 ||
+		    res.durations[0] > 200 + 13) {
+			printf("FAILED 200 ms duration: skew %d, %d digits,"
+				" %d ms\n", skew, res.ndigits,
+				res.durations[0]);
+			failures++;
+			return;
+		}
+	}
+
+	if (verbose)
+		printf("ok     200 ms duration\n");
+}
+
+static void test_twist(void)
+{
+	static const struct {
+		double row;
+		double col;
+		const char *expected;
+		const char *descr;
+	} cases[] = {
+		{ -16, -10, "8", "+6 dB normal twist accepted" },
+		{ -10, -16, "8", "+6 dB reverse twist accepted" },
+		{ -20, -10, "",  "+10 dB normal twist rejected" },
+		{ -10, -20, "",  "+10 dB reverse twist rejected" },
+	};
+	struct signal sig;
+	int i;
+
+	for (i=0; i<sizeof(cases)/sizeof(*cases); i++) {
+		memset(&sig, 0, sizeof(sig));
+		add_digit(&sig, '8', cases[i].row, cases[i].col, 0, 0, 50);
+		check(cases[i].descr, &sig, cases[i].expected);
+	}
+}
+
+static void test_frequency(void)
+{
+	struct signal sig;
+	char descr[80];
+	int i;
+
+	for (i=0; i<16; i++) {
+		char expected[2] = { digits[i], '\0' };
+
+		memset(&sig, 0, sizeof(sig));
+		add_digit(&sig, digits[i], -10, -10, 0.015, 0, 50);
+		snprintf(descr, sizeof(descr), "'%c' +1.5%% accepted", digits[i]);
+		check(descr, &sig, expected);
+
+		memset(&sig, 0, sizeof(sig));
+		add_digit(&sig, digits[i], -10, -10, -0.015, 0, 50);
+		snprintf(descr, sizeof(descr), "'%c' -1.5%% accepted", digits[i]);
+		check(descr, &sig, expected);
+	}
+}
+
+static void test_level(void)
+{
+	struct signal sig;
+
+	memset(&sig, 0, sizeof(sig));
+	add_digit(&sig, '0', 0, 0, 0, 0, 50);
+	check("0 dBm0 per tone accepted", &sig, "0");
+
+	memset(&sig, 0, sizeof(sig));
+	add_digit(&sig, '0', -25, -25, 0, 0, 50);
+	check("-25 dBm0 per tone accepted", &sig, "0");
+
+	memset(&sig, 0, sizeof(sig));
+	add_digit(&sig, '0', -40, -40, 0, 0, 50);
+	check("-40 dBm0 per tone rejected", &sig, "");
+}
+
+static void test_talkoff(void)
+{
+	struct signal sig;
+	int i;
+
+	for (i=0; i<4; i++) {
+		memset(&sig, 0, sizeof(sig));
+		add_tone(&sig, rows[i], -10, 0, 4000);
+		check("single row tone rejected", &sig, "");
+
+		memset(&sig, 0, sizeof(sig));
+		add_tone(&sig, cols[i], -10, 0, 4000);
+		check("single column tone rejected", &sig, "");
+	}
+
+	memset(&sig, 0, sizeof(sig));
+	add_tone(&sig, 1000, -10, 0, 4000);
+	check("1 kHz tone rejected", &sig, "");
+
+	memset(&sig, 0, sizeof(sig));
+	add_noise(&sig, -10, 2000);
+	check("white noise rejected", &sig, "");
+
+	memset(&sig, 0, sizeof(sig));
+	add_noise(&sig, -30, 500);
+	add_digit(&sig, '7', -10, -10, 0, 100, 50);
+	check("digit over -30 dBm0 noise accepted", &sig, "7");
+}
+
+static void print_usage(const char *progname)
+{
+	fprintf(stderr, "Usage: %s [-v]\n", progname);
+}
+
+int main(int argc, char *argv[])
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "v")) != -1) {
+		switch(c) {
+		case 'v':
+			verbose++;
+		break;
+
+		default:
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+
+	srand(1);
+
+	test_all_digits();
+	test_timing();
+	test_duration();
+	test_twist();
+	test_frequency();
+	test_level();
+	test_talkoff();
+
+	printf("%d/%d tests passed\n", tests - failures, tests);
+
+	return failures ? 1 : 0;
+}
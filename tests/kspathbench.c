@@ -0,0 +1,222 @@
+/*
+ * libkstreamer path lookup microbenchmark
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/time.h>
+#include <linux/types.h>
+
+#include <libkstreamer/libkstreamer.h>
+
+#define MAX_LINKS 32
+
+static char *links[MAX_LINKS];
+static int links_cnt;
+
+/* Builds a synthetic topology of num_nodes nodes with a channel each and
+ * adds a node for every /sys/class/net entry, so that lookups thru
+ * symlinks have something real to resolve.
+ */
+static int build_topology(struct ks_conn *conn, int num_nodes)
+{
+	char path[PATH_MAX];
+	int i;
+
+	for (i=0; i<num_nodes; i++) {
+		struct ks_node *node = ks_node_alloc();
+		struct ks_chan *chan = ks_chan_alloc();
+
+		if (!node || !chan)
+			return -1;
+
+		snprintf(path, sizeof(path), "/devices/ks-bench/node%d", i);
+		node->id = i + 1;
+		node->path = strdup(path);
+		ks_node_add(node, conn);
+		ks_node_put(node);
+
+		snprintf(path, sizeof(path), "/devices/ks-bench/node%d/chan", i);
+		chan->id = i + 1;
+		chan->path = strdup(path);
+		ks_chan_add(chan, conn);
+		ks_chan_put(chan);
+	}
+
+	DIR *dir = opendir("/sys/class/net");
+	if (!dir)
+		return 0;
+
+	struct dirent *de;
+	while ((de = readdir(dir)) && links_cnt < MAX_LINKS) {
+		if (de->d_name[0] == '.')
+			continue;
+
+		snprintf(path, sizeof(path), "/sys/class/net/%s", de->d_name);
+
+		char *real_path = realpath(path, NULL);
+		if (!real_path)
+			continue;
+
+		struct ks_node *node = ks_node_alloc();
+		if (!node)
+			return -1;
+
+		node->id = num_nodes + links_cnt + 1;
+		node->path = strdup(real_path + strlen("/sys"));
+		ks_node_add(node, conn);
+		ks_node_put(node);
+
+		free(real_path);
+
+		links[links_cnt++] = strdup(path);
+	}
+
+	closedir(dir);
+
+	return 0;
+}
+
+static double elapsed_ns(struct timeval *start, int iterations)
+{
+	struct timeval end;
+	gettimeofday(&end, NULL);
+
+	return ((end.tv_sec - start->tv_sec) * 1000000.0 +
+		(end.tv_usec - start->tv_usec)) * 1000.0 / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+	int iterations = 1000000;
+	int num_nodes = 10000;
+	struct timeval start;
+	char path[PATH_MAX];
+	int i;
+
+	if (argc > 1)
+		iterations = atoi(argv[1]);
+
+	if (argc > 2)
+		num_nodes = atoi(argv[2]);
+
+	if (iterations <= 0 || num_nodes <= 0) {
+		fprintf(stderr, "Usage: %s [iterations] [nodes]\n", argv[0]);
+		return 1;
+	}
+
+	struct ks_conn *conn = ks_conn_create();
+	if (!conn) {
+		fprintf(stderr, "Cannot create kstreamer connection\n");
+		return 1;
+	}
+
+	if (build_topology(conn, num_nodes) < 0) {
+		fprintf(stderr, "Cannot build topology\n");
+		return 1;
+	}
+
+	printf("%d nodes, %d channels, %d symlinks\n",
+		num_nodes + links_cnt, num_nodes, links_cnt);
+
+	/* Canonical paths, resolved without touching sysfs */
+	gettimeofday(&start, NULL);
+	for (i=0; i<iterations; i++) {
+		snprintf(path, sizeof(path), "/sys/devices/ks-bench/node%d",
+			(i * 7919) % num_nodes);
+
+		struct ks_node *node = ks_node_get_by_path(conn, path);
+		if (!node) {
+			fprintf(stderr, "Node '%s' not found\n", path);
+			return 1;
+		}
+
+		ks_node_put(node);
+	}
+	printf("node canonical:    %8.1f ns/lookup\n",
+		elapsed_ns(&start, iterations));
+
+	gettimeofday(&start, NULL);
+	for (i=0; i<iterations; i++) {
+		snprintf(path, sizeof(path),
+			"/sys/devices/ks-bench/node%d/chan",
+			(i * 7919) % num_nodes);
+
+		struct ks_chan *chan = ks_chan_get_by_path(conn, path);
+		if (!chan) {
+			fprintf(stderr, "Chan '%s' not found\n", path);
+			return 1;
+		}
+
+		ks_chan_put(chan);
+	}
+	printf("chan canonical:    %8.1f ns/lookup\n",
+		elapsed_ns(&start, iterations));
+
+	if (!links_cnt) {
+		printf("No /sys/class/net entries, skipping symlink lookups\n");
+		goto out;
+	}
+
+	/* Symlinks, resolved once and then served from the cache */
+	gettimeofday(&start, NULL);
+	for (i=0; i<iterations; i++) {
+		struct ks_node *node =
+			ks_node_get_by_path(conn, links[i % links_cnt]);
+		if (!node) {
+			fprintf(stderr, "Node '%s' not found\n",
+				links[i % links_cnt]);
+			return 1;
+		}
+
+		ks_node_put(node);
+	}
+	printf("node symlink:      %8.1f ns/lookup (%lu hits, %lu misses)\n",
+		elapsed_ns(&start, iterations),
+		conn->path_cache.hits,
+		conn->path_cache.misses);
+
+	/* Same, with the cache invalidated as by a topology change before
+	 * every lookup, i.e. one realpath() each
+	 */
+	int cold_iterations = iterations / 100 ? iterations / 100 : 1;
+
+	gettimeofday(&start, NULL);
+	for (i=0; i<cold_iterations; i++) {
+		ks_path_cache_invalidate(&conn->path_cache);
+
+		struct ks_node *node =
+			ks_node_get_by_path(conn, links[i % links_cnt]);
+		if (!node) {
+			fprintf(stderr, "Node '%s' not found\n",
+				links[i % links_cnt]);
+			return 1;
+		}
+
+		ks_node_put(node);
+	}
+	printf("node symlink cold: %8.1f ns/lookup\n",
+		elapsed_ns(&start, cold_iterations));
+
+out:
+	ks_chan_flush(conn);
+	ks_node_flush(conn);
+
+	for (i=0; i<links_cnt; i++)
+		free(links[i]);
+
+	ks_conn_destroy(conn);
+
+	return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * q.931 IE encoder/decoder microbenchmark
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include <linux/types.h>
+
+#include <libq931/lib.h>
+#include <libq931/ies.h>
+#include <libq931/ie.h>
+#include <libq931/ie_bearer_capability.h>
+#include <libq931/ie_called_party_number.h>
+#include <libq931/ie_calling_party_number.h>
+#include <libq931/ie_display.h>
+#include <libq931/ie_sending_complete.h>
+
+#define NUM_SAMPLE_IES 5
+
+static struct q931_ie *sample_ies[NUM_SAMPLE_IES];
+
+/* A typical SETUP, in reverse order so that insertion has to sort */
+static void build_sample_ies(void)
+{
+	struct q931_ie_sending_complete *sc =
+		q931_ie_sending_complete_alloc();
+	sample_ies[0] = &sc->ie;
+
+	struct q931_ie_called_party_number *cdpn =
+		q931_ie_called_party_number_alloc();
+	cdpn->type_of_number = Q931_IE_CDPN_TON_NATIONAL;
+	cdpn->numbering_plan_identificator = Q931_IE_CDPN_NPI_ISDN_TELEPHONY;
+	strcpy(cdpn->number, "0212345678");
+	sample_ies[1] = &cdpn->ie;
+
+	struct q931_ie_calling_party_number *cgpn =
+		q931_ie_calling_party_number_alloc();
+	cgpn->type_of_number = Q931_IE_CGPN_TON_NATIONAL;
+	cgpn->numbering_plan_identificator = Q931_IE_CGPN_NPI_ISDN_TELEPHONY;
+	cgpn->presentation_indicator = Q931_IE_CGPN_PI_PRESENTATION_ALLOWED;
+	cgpn->screening_indicator =
+		Q931_IE_CGPN_SI_USER_PROVIDED_NOT_SCREENED;
+	strcpy(cgpn->number, "0698765432");
+	sample_ies[2] = &cgpn->ie;
+
+	struct q931_ie_display *disp = q931_ie_display_alloc();
+	strcpy(disp->text, "vISDN");
+	sample_ies[3] = &disp->ie;
+
+	struct q931_ie_bearer_capability *bc =
+		q931_ie_bearer_capability_alloc();
+	bc->information_transfer_capability = Q931_IE_BC_ITC_SPEECH;
+	bc->transfer_mode = Q931_IE_BC_TM_CIRCUIT;
+	bc->information_transfer_rate = Q931_IE_BC_ITR_64;
+	bc->user_information_layer_1_protocol = Q931_IE_BC_UIL1P_G711_ALAW;
+	bc->user_information_layer_2_protocol = Q931_IE_BC_UIL2P_UNUSED;
+	bc->user_information_layer_3_protocol = Q931_IE_BC_UIL3P_UNUSED;
+	sample_ies[4] = &bc->ie;
+}
+
+static void report(int level, const char *format, ...)
+{
+}
+
+static double elapsed_ns(struct timeval *start, int iterations)
+{
+	struct timeval end;
+	gettimeofday(&end, NULL);
+
+	return ((end.tv_sec - start->tv_sec) * 1000000.0 +
+		(end.tv_usec - start->tv_usec)) * 1000.0 / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+	int iterations = 1000000;
+	struct timeval start;
+	__u8 buf[512];
+	int len = 0;
+	int i, j;
+
+	if (argc > 1)
+		iterations = atoi(argv[1]);
+
+	if (iterations <= 0) {
+		fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	q931_init();
+	q931_set_log_level(Q931_LOG_ERR);
+
+	build_sample_ies();
+
+	/* Transient set built and encoded on every message */
+	gettimeofday(&start, NULL);
+	for (i=0; i<iterations; i++) {
+		Q931_DECLARE_IES(ies);
+
+		for (j=0; j<NUM_SAMPLE_IES; j++)
+			q931_ies_add(&ies, sample_ies[j]);
+
+		len = q931_ies_write(&ies, buf, sizeof(buf));
+
+		Q931_UNDECLARE_IES(ies);
+	}
+	printf("build+encode: %8.1f ns/msg (%d bytes)\n",
+		elapsed_ns(&start, iterations), len);
+
+	/* Encoder only */
+	Q931_DECLARE_IES(ies);
+	for (j=0; j<NUM_SAMPLE_IES; j++)
+		q931_ies_add(&ies, sample_ies[j]);
+
+	gettimeofday(&start, NULL);
+	for (i=0; i<iterations; i++)
+		len = q931_ies_write(&ies, buf, sizeof(buf));
+	printf("encode:       %8.1f ns/msg (%d bytes)\n",
+		elapsed_ns(&start, iterations), len);
+
+	/* Decoder, on the buffer just encoded */
+	gettimeofday(&start, NULL);
+	for (i=0; i<iterations; i++) {
+		Q931_DECLARE_IES(rx_ies);
+		int pos = 0;
+
+		while (pos < len) {
+			__u8 id = buf[pos];
+			int ie_len = 0;
+
+			if (!q931_is_so_ie(id))
+				ie_len = buf[pos + 1];
+
+			const struct q931_ie_class *cls =
+				q931_get_ie_class(0, q931_is_so_ie(id) ?
+					q931_get_so_ie_id(id) : id);
+			if (!cls) {
+				fprintf(stderr, "Unknown IE %#02x\n", id);
+				return 1;
+			}
+
+			struct q931_ie *ie = cls->alloc();
+
+			if (q931_is_so_ie(id)) {
+				cls->read_from_buf(ie, buf + pos, 1,
+					report, NULL);
+				pos++;
+			} else {
+				cls->read_from_buf(ie, buf + pos + 2, ie_len,
+					report, NULL);
+				pos += 2 + ie_len;
+			}
+
+			q931_ies_add_put(&rx_ies, ie);
+		}
+
+		if (rx_ies.count != NUM_SAMPLE_IES) {
+			fprintf(stderr, "Decoded %d IEs, expected %d\n",
+				rx_ies.count, NUM_SAMPLE_IES);
+			return 1;
+		}
+
+		Q931_UNDECLARE_IES(rx_ies);
+	}
+	printf("decode:       %8.1f ns/msg\n",
+		elapsed_ns(&start, iterations));
+
+	Q931_UNDECLARE_IES(ies);
+
+	for (j=0; j<NUM_SAMPLE_IES; j++)
+		q931_ie_put(sample_ies[j]);
+
+	q931_leave();
+
+	return 0;
+}
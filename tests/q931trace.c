@@ -0,0 +1,128 @@
+/*
+ * q.931 binary trace decoder
+ *
+ * Copyright (C) 2026 vstuff contributors
+ *
+ * Authors: see the git history
+ *
+ * This program is free software and may be modified and distributed
+ * under the terms and conditions of the GNU General Public License.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <linux/types.h>
+
+#include <libq931/msgtype.h>
+#include <libq931/trace.h>
+
+static const char *direction_to_text(int direction)
+{
+	switch(direction) {
+	case Q931_TRACE_RX: return "<-";
+	case Q931_TRACE_TX: return "->";
+	case Q931_TRACE_TX_BC: return "=>";
+	}
+
+	return "??";
+}
+
+static void decode_frame(const __u8 *frame, int len)
+{
+	int crlen;
+	int i;
+
+	if (len < 2)
+		return;
+
+	crlen = frame[1] & 0x0f;
+
+	if (frame[0] == 0x08 && len >= 2 + crlen + 1) {
+		const char *mt_name =
+			q931_message_type_to_text(frame[2 + crlen]);
+		unsigned int callref = 0;
+
+		for (i = 0; i < crlen; i++)
+			callref = (callref << 8) |
+				(frame[2 + i] & (i == 0 ? 0x7f : 0xff));
+
+		printf(" callref=%u.%c %s",
+			callref,
+			crlen && (frame[2] & 0x80) ? 'O' : 'I',
+			mt_name ? mt_name : "*UNKNOWN*");
+	} else {
+		printf(" pd=0x%02x", frame[0]);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	struct q931_trace_file_header fhdr;
+	struct q931_trace_record_header hdr;
+	__u8 frame[Q931_TRACE_MAX_FRAME];
+	FILE *f;
+	int i;
+
+	if (argc != 2) {
+		fprintf(stderr, "Usage: %s <trace file>\n", argv[0]);
+		return 1;
+	}
+
+	f = fopen(argv[1], "r");
+	if (!f) {
+		fprintf(stderr, "Cannot open %s: %s\n",
+			argv[1], strerror(errno));
+		return 1;
+	}
+
+	if (fread(&fhdr, sizeof(fhdr), 1, f) != 1 ||
+	    fhdr.magic != Q931_TRACE_MAGIC) {
+		fprintf(stderr, "%s is not a q.931 trace\n", argv[1]);
+		return 1;
+	}
+
+	if (fhdr.version != Q931_TRACE_VERSION ||
+	    fhdr.record_header_size != sizeof(hdr)) {
+		fprintf(stderr, "Unsupported trace version %d\n",
+			fhdr.version);
+		return 1;
+	}
+
+	q931_message_types_init();
+
+	while(fread(&hdr, sizeof(hdr), 1, f) == 1) {
+		char tstr[32];
+		time_t t = hdr.tv_sec;
+
+		if (hdr.len > sizeof(frame) ||
+		    fread(frame, hdr.len, 1, f) != 1) {
+			fprintf(stderr, "Truncated trace\n");
+			return 1;
+		}
+
+		strftime(tstr, sizeof(tstr), "%Y-%m-%d %H:%M:%S",
+			localtime(&t));
+
+		hdr.intf_name[sizeof(hdr.intf_name) - 1] = '\0';
+
+		printf("%s.%06u %s:TEI[%d] %s",
+			tstr, hdr.tv_usec,
+			hdr.intf_name, hdr.tei,
+			direction_to_text(hdr.direction));
+
+		decode_frame(frame, hdr.len);
+
+		printf("\n   ");
+		for (i = 0; i < hdr.len; i++)
+			printf(" %02x", frame[i]);
+		printf("\n");
+	}
+
+	fclose(f);
+
+	return 0;
+}